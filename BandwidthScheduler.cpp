@@ -0,0 +1,227 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "BandwidthScheduler.h"
+
+#include <algorithm>
+
+#include <Autolock.h>
+#include <OS.h>
+
+#include "TabIndex.h"
+
+
+static const double kBrowsingShare = 0.25;
+	// While pages load, the downloads get this much of their bandwidth.
+static const off_t kMinRate = 16 * 1024;
+	// Downloads that yield to browsing don't get slower than this.
+static const bigtime_t kBurstInterval = 250000;
+static const double kMinBurst = 16 * 1024;
+	// The bucket holds the tokens of this long, but at least this many, so
+	// a short stall doesn't waste bandwidth.
+static const bigtime_t kMaxWait = 50000;
+	// A waiting download checks this often whether it can go on.
+static const bigtime_t kMeasureInterval = 1000000;
+static const bigtime_t kMaxYieldTime = 10000000;
+	// Downloads yield to browsing for at most this long at a time, so a page
+	// that never finishes loading does not slow them down for good.
+
+
+BandwidthScheduler BandwidthScheduler::sDefaultInstance;
+
+
+static double
+bucket_capacity(off_t rate)
+{
+	return std::max(rate * kBurstInterval / 1000000.0, kMinBurst);
+}
+
+
+BandwidthScheduler::BandwidthScheduler()
+	:
+	BLocker("bandwidth scheduler"),
+	fRateLimit(0),
+	fYieldToBrowsing(true),
+	fYielding(false),
+	fLoadingSince(0),
+	fTokens(0),
+	fLastRefill(0),
+	fMeasuredBytes(0),
+	fMeasureStart(0),
+	fMeasuredRate(0)
+{
+	for (int32 i = 0; i < kPriorityCount; i++)
+		fWaiting[i] = 0;
+}
+
+
+BandwidthScheduler::~BandwidthScheduler()
+{
+}
+
+
+/*static*/ BandwidthScheduler*
+BandwidthScheduler::DefaultInstance()
+{
+	return &sDefaultInstance;
+}
+
+
+void
+BandwidthScheduler::SetRateLimit(off_t bytesPerSecond)
+{
+	BAutolock _(this);
+	fRateLimit = bytesPerSecond > 0 ? bytesPerSecond : 0;
+}
+
+
+void
+BandwidthScheduler::SetYieldToBrowsing(bool yield)
+{
+	BAutolock _(this);
+	fYieldToBrowsing = yield;
+}
+
+
+/*!	Waits until a download of \a priority may receive \a bytes, but no
+	longer than \a timeout. Returns \c B_TIMED_OUT if it may not yet, so
+	the caller can check whether it still wants to.
+	The \a priority only matters while the downloads are limited. Without
+	a limit, this returns right away for any priority.
+*/
+status_t
+BandwidthScheduler::Acquire(size_t bytes, int32 priority, bigtime_t timeout)
+{
+	priority = std::min(std::max(priority, (int32)PRIORITY_LOW),
+		(int32)kPriorityCount - 1);
+	bigtime_t deadline = system_time() + timeout;
+	bool waiting = false;
+
+	Lock();
+	while (true) {
+		bigtime_t now = system_time();
+		off_t rate = _Rate(now);
+		_Refill(now, rate);
+
+		// A chunk larger than the bucket is let through once the bucket is
+		// full, and paid off afterwards.
+		double needed = rate > 0
+			? std::min((double)bytes, bucket_capacity(rate)) : 0;
+		if (rate == 0
+			|| (fTokens >= needed && !_HigherPriorityWaiting(priority))) {
+			if (rate > 0)
+				fTokens -= bytes;
+			if (waiting)
+				fWaiting[priority]--;
+			_Measure(now, bytes);
+			Unlock();
+			return B_OK;
+		}
+
+		if (now >= deadline) {
+			if (waiting)
+				fWaiting[priority]--;
+			Unlock();
+			return B_TIMED_OUT;
+		}
+		if (!waiting) {
+			fWaiting[priority]++;
+			waiting = true;
+		}
+
+		bigtime_t delay = std::min(kMaxWait, deadline - now);
+		if (fTokens < needed) {
+			delay = std::min(delay,
+				(bigtime_t)((needed - fTokens) * 1000000 / rate) + 1);
+		}
+		Unlock();
+		snooze(delay);
+		Lock();
+	}
+}
+
+
+// #pragma mark - private
+
+
+/*!	Returns the rate the downloads may currently receive at, 0 if they are
+	not limited.
+	Without a rate limit, the downloads only yield once the rate they get
+	was measured, as there is nothing to take a share of before. And they
+	stop yielding after kMaxYieldTime, until no page is loading anymore.
+*/
+off_t
+BandwidthScheduler::_Rate(bigtime_t now)
+{
+	bool loading = fYieldToBrowsing
+		&& TabIndex::DefaultInstance()->CountLoading() > 0;
+	if (!loading)
+		fLoadingSince = 0;
+	else if (fLoadingSince == 0)
+		fLoadingSince = now;
+
+	bool yielding = loading && now - fLoadingSince < kMaxYieldTime
+		&& (fRateLimit > 0 || fMeasuredRate > 0);
+	if (yielding != fYielding) {
+		fYielding = yielding;
+		fMeasuredBytes = 0;
+		fMeasureStart = now;
+	}
+	if (!yielding)
+		return fRateLimit;
+
+	double base = fRateLimit > 0 ? fRateLimit : fMeasuredRate;
+	return std::max((off_t)(base * kBrowsingShare), kMinRate);
+}
+
+
+void
+BandwidthScheduler::_Refill(bigtime_t now, off_t rate)
+{
+	if (rate > 0 && fLastRefill > 0) {
+		fTokens = std::min(fTokens + rate * (now - fLastRefill) / 1000000.0,
+			bucket_capacity(rate));
+	}
+	fLastRefill = now;
+}
+
+
+bool
+BandwidthScheduler::_HigherPriorityWaiting(int32 priority) const
+{
+	for (int32 i = priority + 1; i < kPriorityCount; i++) {
+		if (fWaiting[i] > 0)
+			return true;
+	}
+	return false;
+}
+
+
+/*!	Measures the rate the downloads get while they don't yield, which they
+	get a share of while they do.
+*/
+void
+BandwidthScheduler::_Measure(bigtime_t now, size_t bytes)
+{
+	if (fYielding)
+		return;
+
+	bigtime_t elapsed = now - fMeasureStart;
+	if (fMeasureStart == 0 || elapsed > 4 * kMeasureInterval) {
+		// The downloads were idle, that says nothing about the rate.
+		fMeasureStart = now;
+		fMeasuredBytes = bytes;
+		return;
+	}
+
+	fMeasuredBytes += bytes;
+	if (elapsed < kMeasureInterval)
+		return;
+
+	double rate = fMeasuredBytes * 1000000.0 / elapsed;
+	fMeasuredRate = fMeasuredRate > 0 ? (fMeasuredRate + rate) / 2 : rate;
+	fMeasureStart = now;
+	fMeasuredBytes = 0;
+}
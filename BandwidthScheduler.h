@@ -0,0 +1,73 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BANDWIDTH_SCHEDULER_H
+#define BANDWIDTH_SCHEDULER_H
+
+
+#include <Locker.h>
+
+
+/*!	Shares the bandwidth between the downloads the browser runs itself,
+	with a token bucket. The bucket fills at the rate limit, and every
+	chunk a download receives takes its size out of it. When the bucket is
+	empty, the receiving thread waits, which in turn slows down the
+	connection.
+
+	While the downloads are limited, those of a higher priority are served
+	first: a download only gets bandwidth while none of a higher priority
+	waits for it. Without a limit, no download waits, and the priorities
+	have no effect, as there is no bandwidth to hand out. While pages are
+	loading, and the downloads yield to browsing, they only get a share of
+	the rate limit, or without one, of the rate they had before, so the
+	pages load first. They yield for a limited time only.
+*/
+class BandwidthScheduler : public BLocker {
+public:
+			enum Priority {
+				PRIORITY_LOW = 0,
+				PRIORITY_NORMAL,
+				PRIORITY_HIGH,
+				kPriorityCount
+			};
+
+	static	BandwidthScheduler*	DefaultInstance();
+
+			void				SetRateLimit(off_t bytesPerSecond);
+			void				SetYieldToBrowsing(bool yield);
+
+			status_t			Acquire(size_t bytes, int32 priority,
+									bigtime_t timeout);
+
+private:
+								BandwidthScheduler();
+	virtual						~BandwidthScheduler();
+
+			off_t				_Rate(bigtime_t now);
+			void				_Refill(bigtime_t now, off_t rate);
+			bool				_HigherPriorityWaiting(int32 priority) const;
+			void				_Measure(bigtime_t now, size_t bytes);
+
+private:
+			off_t				fRateLimit;
+				// in bytes per second, 0 for none
+			bool				fYieldToBrowsing;
+			bool				fYielding;
+			bigtime_t			fLoadingSince;
+				// when pages started loading, 0 while none are
+
+			double				fTokens;
+			bigtime_t			fLastRefill;
+			int32				fWaiting[kPriorityCount];
+
+			off_t				fMeasuredBytes;
+			bigtime_t			fMeasureStart;
+			double				fMeasuredRate;
+				// of the downloads while they did not yield
+
+	static	BandwidthScheduler	sDefaultInstance;
+};
+
+
+#endif // BANDWIDTH_SCHEDULER_H
@@ -7,11 +7,13 @@
 #include "BookmarkBar.h"
 
 #include <Alert.h>
+#include <Bitmap.h>
 #include <Catalog.h>
 #include <Directory.h>
 #include <Entry.h>
 #include <GroupLayout.h>
 #include <IconMenuItem.h>
+#include <List.h>
 #include <MessageRunner.h>
 #include <Messenger.h>
 #include <PopUpMenu.h>
@@ -25,9 +27,13 @@
 #include "tracker_private.h"
 
 #include "BrowserWindow.h"
+#include "MiniIconCache.h"
 #include "NavMenu.h"
 
+#include <algorithm>
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 
 #undef B_TRANSLATION_CONTEXT // Ensure B_TRANSLATION_CONTEXT is not doubly defined
@@ -44,6 +50,48 @@ const uint32 kAskBookmarkNameMsg = 'askn';
 const uint32 kShowInTrackerMsg = 'otrk';
 const uint32 kRenameBookmarkMsg = 'rena';
 const uint32 kFolderMsg = 'fold';
+const uint32 kLayoutItemsMsg = 'layi';
+
+static const int32 kItemsPerBatch = 250;
+static const float kOverflowMenuWidth = 32;
+static const float kIconWidth = 20;
+	// IconMenuItem puts this in front of the label for its icon.
+
+
+/*!	Gathers everything needed to create the bar item for \a ref, so that the
+	window thread only has to put it together: the name, the resolved target
+	of a symbolic link, and the decoded icon.
+*/
+static bool
+prepare_item(const entry_ref& ref, ino_t inode, BMessage& data)
+{
+	// In case it's a symlink, follow link to get the right icon for display,
+	// but the message should operate on the symlink itself.
+	BEntry followedEntry(&ref, true);
+	entry_ref target;
+	if (followedEntry.InitCheck() != B_OK
+		|| followedEntry.GetRef(&target) != B_OK) {
+		return false;
+	}
+
+	data.AddInt64("node", inode);
+	data.AddRef("refs", &ref);
+	data.AddString("name", ref.name);
+
+	if (followedEntry.IsDirectory()) {
+		data.AddBool("folder", true);
+		data.AddRef("target", &target);
+		return true;
+	}
+
+	BBitmap icon(BRect(0, 0, B_MINI_ICON - 1, B_MINI_ICON - 1),
+		B_BITMAP_NO_SERVER_LINK, B_RGBA32);
+	if (icon.InitCheck() == B_OK
+		&& MiniIconCache::DefaultInstance()->GetIcon(target, &icon) == B_OK) {
+		data.AddData("icon", B_RAW_TYPE, icon.Bits(), icon.BitsLength());
+	}
+	return true;
+}
 
 
 BookmarkBar::BookmarkBar(const char* title, BHandler* target,
@@ -51,6 +99,9 @@ BookmarkBar::BookmarkBar(const char* title, BHandler* target,
 	:
 	BMenuBar(title),
 	fNodeRef(), // Initialize properly
+	fWidthSums(1, 0.0f),
+	fVisibleCount(0),
+	fLayoutPending(false),
 	fOverflowMenu(NULL),
 	fOverflowMenuAdded(false),
 	fPopUpMenu(NULL),
@@ -143,6 +194,8 @@ void
 BookmarkBar::AttachedToWindow()
 {
 	BMenuBar::AttachedToWindow();
+	// BMenuBar takes the menu font from the menu settings here.
+	_MeasureItems();
 	watch_node(&fNodeRef, B_WATCH_DIRECTORY, BMessenger(this));
 
 	// Asynchronously load initial directory content
@@ -167,10 +220,11 @@ BookmarkBar::_LoadBookmarksThreadEntry(void* data)
 		return B_ERROR;
 	}
 
+	// The items are prepared completely here, the window only has to add
+	// them. Large batches let it do the layout once for many items.
 	BEntry entry;
 	BMessage batchMessage(MSG_ADD_BOOKMARK_ITEMS);
 	int32 itemsInBatch = 0;
-	const int32 BATCH_SIZE = 10; // Send items in batches
 
 	while (dir.GetNextEntry(&entry, false) == B_OK) {
 		if (!entry.IsFile() && !entry.IsDirectory() && !entry.IsSymLink())
@@ -178,18 +232,16 @@ BookmarkBar::_LoadBookmarksThreadEntry(void* data)
 
 		entry_ref ref;
 		node_ref nref; // For inode
-		if (entry.GetRef(&ref) == B_OK && entry.GetNodeRef(&nref) == B_OK) {
-			batchMessage.AddInt64("node", nref.node);
-			batchMessage.AddRef("refs", &ref);
+		BMessage item;
+		if (entry.GetRef(&ref) == B_OK && entry.GetNodeRef(&nref) == B_OK
+			&& prepare_item(ref, nref.node, item)) {
+			batchMessage.AddMessage("item", &item);
 			itemsInBatch++;
 
-			if (itemsInBatch >= BATCH_SIZE) {
+			if (itemsInBatch >= kItemsPerBatch) {
 				BMessenger(bar).SendMessage(&batchMessage);
 				batchMessage.MakeEmpty(); // Prepare for next batch
-				batchMessage.what = MSG_ADD_BOOKMARK_ITEMS;
 				itemsInBatch = 0;
-				// Yield for a moment to allow UI to process
-				snooze(20000); // 20ms
 			}
 		}
 	}
@@ -210,26 +262,34 @@ BookmarkBar::MessageReceived(BMessage* message)
 	switch (message->what) {
 		case MSG_ADD_BOOKMARK_ITEMS:
 		{
-			entry_ref ref;
-			int64 node;
-			for (int32 i = 0; message->FindRef("refs", i, &ref) == B_OK
-				&& message->FindInt64("node", i, &node) == B_OK; i++) {
-				_AddItem(node, ref);
+			BList items;
+			BMessage data;
+			for (int32 i = 0; message->FindMessage("item", i, &data) == B_OK;
+					i++) {
+				IconMenuItem* item = _CreateItem(data);
+				if (item != NULL)
+					items.AddItem(item);
 			}
-			// Reevaluate whether the "more" menu is needed after adding items
-			BRect rect = Bounds();
-			FrameResized(rect.Width(), rect.Height());
+			_InsertItems(items);
 			break;
 		}
 		case MSG_BOOKMARKS_LOADED:
 		{
-			// Optional: any final actions after all bookmarks are loaded.
-			// For example, ensure FrameResized is called one last time.
-			BRect rect = Bounds();
-			FrameResized(rect.Width(), rect.Height());
 			printf("Bookmarks loaded.\n");
 			break;
 		}
+		case B_FONTS_UPDATED:
+			_MeasureItems();
+			break;
+
+		case kLayoutItemsMsg:
+		{
+			// Several insertions or removals may have been queued, they all
+			// share this one pass.
+			if (fLayoutPending)
+				_LayoutItems(Bounds().Width());
+			break;
+		}
 		case B_NODE_MONITOR:
 		{
 			// If still loading, node monitor events might conflict or be redundant.
@@ -252,9 +312,14 @@ BookmarkBar::MessageReceived(BMessage* message)
 					message->FindString("name", &name);
 					ref.set_name(name);
 
-					BEntry entry(&ref);
-					if (entry.InitCheck() == B_OK)
-						_AddItem(inode, ref); // Pass the entry_ref directly
+					BMessage data;
+					if (prepare_item(ref, inode, data)) {
+						BList items;
+						IconMenuItem* item = _CreateItem(data);
+						if (item != NULL)
+							items.AddItem(item);
+						_InsertItems(items);
+					}
 					break;
 				}
 				case B_ENTRY_MOVED:
@@ -270,11 +335,17 @@ BookmarkBar::MessageReceived(BMessage* message)
 					BEntry entry(&ref);
 					BEntry followedEntry(&ref, true); // traverse in case it's a symlink
 
-					if (fItemsMap[inode] == NULL) {
-						// Pass the entry_ref directly
-						// Ensure BEntry 'entry' is initialized if used to get the ref,
-						// but 'ref' is already available.
-						_AddItem(inode, ref);
+					if (fItemsMap.find(inode) == fItemsMap.end()) {
+						// Moved in from elsewhere, unless it only passed by.
+						BMessage data;
+						if (ref.directory == fNodeRef.node
+							&& prepare_item(ref, inode, data)) {
+							BList items;
+							IconMenuItem* item = _CreateItem(data);
+							if (item != NULL)
+								items.AddItem(item);
+							_InsertItems(items);
+						}
 						break;
 					} else {
 						// Existing item. Check if it's a rename or a move
@@ -285,7 +356,7 @@ BookmarkBar::MessageReceived(BMessage* message)
 						if (from == to) {
 							const char* name;
 							if (message->FindString("name", &name) == B_OK)
-								fItemsMap[inode]->SetLabel(name);
+								_SetItemLabel(fItemsMap[inode], name);
 
 							BMessage* itemMessage = new BMessage(
 								followedEntry.IsDirectory() ? kFolderMsg : B_REFS_RECEIVED);
@@ -300,18 +371,8 @@ BookmarkBar::MessageReceived(BMessage* message)
 					// elsewhere, remove it from the bar.
 				}
 				case B_ENTRY_REMOVED:
-				{
-					IconMenuItem* item = fItemsMap[inode];
-					RemoveItem(item);
-					fOverflowMenu->RemoveItem(item);
-					fItemsMap.erase(inode);
-					delete item;
-
-					// Reevaluate whether the "more" menu is still needed
-					BRect rect = Bounds();
-					FrameResized(rect.Width(), rect.Height());
+					_RemoveItem(inode);
 					break;
-				}
 			}
 			break;
 		}
@@ -362,15 +423,8 @@ BookmarkBar::MessageReceived(BMessage* message)
 					break;
 				}
 
-				// Remove the item from the bookmark bar
-				if (!RemoveItem(fSelectedItemIndex)) {
-					// handle error case if necessary
-					BString errorMessage = B_TRANSLATE("Failed to remove bookmark '%leaf%' "
-							"from boookmark bar.");
-					errorMessage.ReplaceFirst("%leaf%", path.Leaf());
-					BAlert* alert = new BAlert("Error", errorMessage.String(), B_TRANSLATE("OK"));
-					alert->Go();
-				}
+				// The item is removed from the bar when the node monitor
+				// reports the removal.
 			}
 			break;
 		}
@@ -442,7 +496,7 @@ BookmarkBar::MessageReceived(BMessage* message)
 				entry.Rename(newName.String());
 
 				// Update the menu item label
-				selectedItem->SetLabel(newName);
+				_SetItemLabel(selectedItem, newName);
 			}
 			break;
 		}
@@ -455,65 +509,18 @@ BookmarkBar::MessageReceived(BMessage* message)
 
 
 void
-BookmarkBar::FrameResized(float width, float height)
+BookmarkBar::Show()
 {
-	int32 count = CountItems();
-
-	// Account for the "more" menu, in terms of item count and space occupied
-	int32 overflowMenuWidth = 0;
-	if (IndexOf(fOverflowMenu) != B_ERROR) {
-		count--;
-		// Ignore the width of the "more" menu if it would disappear after
-		// removing a bookmark from it.
-		if (fOverflowMenu->CountItems() > 1)
-			overflowMenuWidth = 32;
-	}
-
-	int32 i = 0;
-	float rightmost = 0.f;
-	while (i < count) {
-		BMenuItem* item = ItemAt(i);
-		BRect frame = item->Frame();
-		if (frame.right > width - overflowMenuWidth)
-			break;
-		rightmost = frame.right;
-		i++;
-	}
+	// The font may have changed while the bar was hidden.
+	_MeasureItems();
+	BMenuBar::Show();
+}
 
-	if (i == count) {
-		// See if we can move some items from the "more" menu in the remaining
-		// space.
-		BMenuItem* extraItem = fOverflowMenu->ItemAt(0);
-		while (extraItem != NULL) {
-			BRect frame = extraItem->Frame();
-			if (frame.Width() + rightmost > width - overflowMenuWidth)
-				break;
-			AddItem(fOverflowMenu->RemoveItem((int32)0), i);
-			i++;
-
-			rightmost = ItemAt(i)->Frame().right;
-			if (fOverflowMenu->CountItems() <= 1)
-				overflowMenuWidth = 0;
-			extraItem = fOverflowMenu->ItemAt(0);
-		}
-		if (fOverflowMenu->CountItems() == 0) {
-			RemoveItem(fOverflowMenu);
-			fOverflowMenuAdded = false;
-		}
 
-	} else {
-		// Remove any overflowing item and move them to the "more" menu.
-		// Counting backwards avoids complications when indices shift
-		// after an item is removed, and keeps bookmarks in the same order,
-		// provided they are added at index 0 of the "more" menu.
-		for (int j = count - 1; j >= i; j--)
-			fOverflowMenu->AddItem(RemoveItem(j), 0);
-
-		if (IndexOf(fOverflowMenu) == B_ERROR) {
-			AddItem(fOverflowMenu);
-			fOverflowMenuAdded = true;
-		}
-	}
+void
+BookmarkBar::FrameResized(float width, float height)
+{
+	_LayoutItems(width);
 
 	BMenuBar::FrameResized(width, height);
 }
@@ -525,7 +532,7 @@ BookmarkBar::MinSize()
 	BSize size = BMenuBar::MinSize();
 
 	// We only need space to show the "more" button.
-	size.width = 32;
+	size.width = kOverflowMenuWidth;
 
 	// We need enough vertical space to show bookmark icons.
 	if (size.height < 20)
@@ -538,55 +545,240 @@ BookmarkBar::MinSize()
 // #pragma mark - private methods
 
 
-void
-BookmarkBar::_AddItem(ino_t inode, const entry_ref& ref)
+/*!	Creates the item prepared by prepare_item(), or returns \c NULL if the
+	bar already has it. The item still has to be inserted.
+*/
+IconMenuItem*
+BookmarkBar::_CreateItem(const BMessage& data)
 {
+	int64 inode;
+	entry_ref ref;
+	const char* name;
+	if (data.FindInt64("node", &inode) != B_OK
+		|| data.FindRef("refs", &ref) != B_OK
+		|| data.FindString("name", &name) != B_OK) {
+		return NULL;
+	}
+
 	// make sure the item doesn't already exist in the map by inode
 	if (fItemsMap.count(inode)) // Use .count for std::map
-		return;
-
-	BEntry entry(&ref, false); // Don't traverse symlinks for GetName
-	if (entry.InitCheck() != B_OK)
-		return;
-
-	char name[B_FILE_NAME_LENGTH];
-	entry.GetName(name);
-
-	// In case it's a symlink, follow link to get the right icon for display,
-	// but the message should operate on the symlink itself (using the passed 'ref').
-	BEntry followedEntry(&ref, true); // Traverse link for icon and type check
+		return NULL;
 
 	IconMenuItem* item = NULL;
 
-	if (followedEntry.IsDirectory()) {
-		BNavMenu* menu = new BNavMenu(name, B_REFS_RECEIVED, Window());
-		// It's crucial that SetNavDir uses the original ref if it's a symlink
-		// to a directory, or the followed ref if that's the desired behavior.
-		// Current BNavMenu likely expects a real directory.
-		// For simplicity, let's assume we always want to navigate the target for directories.
+	if (data.GetBool("folder", false)) {
+		// We always navigate the target for directories.
 		entry_ref targetRef;
-		followedEntry.GetRef(&targetRef);
+		if (data.FindRef("target", &targetRef) != B_OK)
+			return NULL;
+		BNavMenu* menu = new BNavMenu(name, B_REFS_RECEIVED, Window());
 		menu->SetNavDir(&targetRef);
 
 		BMessage* message = new BMessage(kFolderMsg);
 		message->AddRef("refs", &ref); // Message uses original ref
 		item = new IconMenuItem(menu, message, "application/x-vnd.Be-directory", B_MINI_ICON);
 	} else {
-		BNode node(&followedEntry); // Use followed entry for icon
-		BNodeInfo info(&node);
 		BMessage* message = new BMessage(B_REFS_RECEIVED);
 		message->AddRef("refs", &ref); // Message uses original ref
-		item = new IconMenuItem(name, message, &info, B_MINI_ICON);
-	}
 
-	int32 count = CountItems();
-	if (IndexOf(fOverflowMenu) != B_ERROR)
-		count--;
+		BBitmap icon(BRect(0, 0, B_MINI_ICON - 1, B_MINI_ICON - 1),
+			B_BITMAP_NO_SERVER_LINK, B_RGBA32);
+		const void* bits;
+		ssize_t size;
+		if (icon.InitCheck() == B_OK
+			&& data.FindData("icon", B_RAW_TYPE, &bits, &size) == B_OK
+			&& size == icon.BitsLength()) {
+			memcpy(icon.Bits(), bits, size);
+			item = new IconMenuItem(name, message, &icon, B_MINI_ICON);
+		} else {
+			item = new IconMenuItem(name, message,
+				"application/x-vnd.Be-bookmark", B_MINI_ICON);
+		}
+	}
 
-	BMenuBar::AddItem(item, count);
 	fItemsMap[inode] = item;
+	return item;
+}
 
-	// Move the item to the "more" menu if it overflows.
-	BRect rect = Bounds();
-	FrameResized(rect.Width(), rect.Height());
+
+/*!	Appends \a items to the bookmarks. They are added to the bar together,
+	and if the "more" menu is in use, moved on behind the items already in
+	there.
+*/
+void
+BookmarkBar::_InsertItems(BList& items)
+{
+	int32 count = items.CountItems();
+	if (count == 0)
+		return;
+
+	// New items go behind the existing ones, so once the bar overflows,
+	// they go straight into the overflow menu.
+	if (fVisibleCount < (int32)fItems.size())
+		fOverflowMenu->AddList(&items, fOverflowMenu->CountItems());
+	else {
+		AddList(&items, fVisibleCount);
+		fVisibleCount += count;
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		BMenuItem* item = (BMenuItem*)items.ItemAt(i);
+		fItems.push_back(item);
+		fWidthSums.push_back(fWidthSums.back() + _ItemWidth(item) + 1);
+	}
+
+	_InvalidateItemLayout();
+}
+
+
+void
+BookmarkBar::_RemoveItem(ino_t inode)
+{
+	std::map<ino_t, IconMenuItem*>::iterator found = fItemsMap.find(inode);
+	if (found == fItemsMap.end())
+		return;
+
+	IconMenuItem* item = found->second;
+	fItemsMap.erase(found);
+
+	std::vector<BMenuItem*>::iterator position
+		= std::find(fItems.begin(), fItems.end(), item);
+	if (position != fItems.end()) {
+		int32 index = position - fItems.begin();
+		if (index < fVisibleCount) {
+			RemoveItem(item);
+			fVisibleCount--;
+		} else
+			fOverflowMenu->RemoveItem(item);
+
+		float width = fWidthSums[index + 1] - fWidthSums[index];
+		fItems.erase(position);
+		fWidthSums.erase(fWidthSums.begin() + index + 1);
+		for (size_t i = index + 1; i < fWidthSums.size(); i++)
+			fWidthSums[i] -= width;
+	}
+	delete item;
+
+	_InvalidateItemLayout();
+}
+
+
+/*!	Renames \a item. Its cached width is adjusted by the difference of the
+	widths, so the other items need not be measured again.
+*/
+void
+BookmarkBar::_SetItemLabel(BMenuItem* item, const char* label)
+{
+	float oldWidth = _ItemWidth(item);
+	item->SetLabel(label);
+
+	std::vector<BMenuItem*>::iterator position
+		= std::find(fItems.begin(), fItems.end(), item);
+	if (position != fItems.end()) {
+		float delta = _ItemWidth(item) - oldWidth;
+		for (size_t i = position - fItems.begin() + 1; i < fWidthSums.size();
+				i++) {
+			fWidthSums[i] += delta;
+		}
+	}
+
+	_InvalidateItemLayout();
+}
+
+
+/*!	Returns the width \a item takes in the bar, computed the way BMenu lays
+	out a row of items. Unlike the frame of the item, this is known before
+	the menu has laid out its items, which it doesn't do while the window is
+	hidden.
+*/
+float
+BookmarkBar::_ItemWidth(BMenuItem* item) const
+{
+	float left;
+	float right;
+	GetItemMargins(&left, NULL, &right, NULL);
+	return ceilf(StringWidth(item->Label())) + kIconWidth + left + right;
+}
+
+
+/*!	Measures all items again if the font changed since they were measured
+	last.
+*/
+void
+BookmarkBar::_MeasureItems()
+{
+	BFont font;
+	GetFont(&font);
+	if (font == fMeasuredFont)
+		return;
+	fMeasuredFont = font;
+
+	fWidthSums.resize(1);
+	for (size_t i = 0; i < fItems.size(); i++)
+		fWidthSums.push_back(fWidthSums.back() + _ItemWidth(fItems[i]) + 1);
+
+	_InvalidateItemLayout();
+}
+
+
+/*!	Schedules a _LayoutItems() pass, unless one is already pending. */
+void
+BookmarkBar::_InvalidateItemLayout()
+{
+	if (fLayoutPending)
+		return;
+
+	fLayoutPending = true;
+	BMessenger(this).SendMessage(kLayoutItemsMsg);
+}
+
+
+/*!	Splits the bookmarks between the bar and the "more" menu for a bar of
+	the given \a width, moving the items that change sides all at once.
+*/
+void
+BookmarkBar::_LayoutItems(float width)
+{
+	fLayoutPending = false;
+
+	int32 count = fItems.size();
+	int32 visible = _VisibleItemCount(width);
+	if (visible < count)
+		visible = _VisibleItemCount(width - kOverflowMenuWidth);
+
+	if (visible < fVisibleCount) {
+		BList moved(fVisibleCount - visible);
+		for (int32 i = visible; i < fVisibleCount; i++)
+			moved.AddItem(fItems[i]);
+		RemoveItems(visible, fVisibleCount - visible);
+		fOverflowMenu->AddList(&moved, 0);
+	} else if (visible > fVisibleCount) {
+		BList moved(visible - fVisibleCount);
+		for (int32 i = fVisibleCount; i < visible; i++)
+			moved.AddItem(fItems[i]);
+		fOverflowMenu->RemoveItems(0, visible - fVisibleCount);
+		AddList(&moved, fVisibleCount);
+	}
+	fVisibleCount = visible;
+
+	if (visible < count && !fOverflowMenuAdded) {
+		AddItem(fOverflowMenu);
+		fOverflowMenuAdded = true;
+	} else if (visible == count && fOverflowMenuAdded) {
+		RemoveItem(fOverflowMenu);
+		fOverflowMenuAdded = false;
+	}
+}
+
+
+/*!	Returns how many of the bookmarks fit into \a width, found by a binary
+	search over the cached widths.
+*/
+int32
+BookmarkBar::_VisibleItemCount(float width) const
+{
+	// The items start at the left edge, item i ends at fWidthSums[i + 1] - 1.
+	std::vector<float>::const_iterator end = std::upper_bound(
+		fWidthSums.begin() + 1, fWidthSums.end(), width + 1);
+	return end - (fWidthSums.begin() + 1);
 }
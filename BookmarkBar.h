@@ -7,7 +7,9 @@
 
 
 #include <map>
+#include <vector>
 
+#include <Font.h>
 #include <MenuBar.h>
 #include <Node.h>
 #include <NodeMonitor.h>
@@ -16,6 +18,7 @@
 
 
 class BEntry;
+class BList;
 
 namespace BPrivate {
 	class IconMenuItem;
@@ -32,12 +35,23 @@ public:
 	void							AttachedToWindow();
 	void							MessageReceived(BMessage* message);
 
+	void							Show();
 	void							FrameResized(float width, float height);
 	BSize							MinSize();
 
 	void 							MouseDown(BPoint where);
 private:
-	void							_AddItem(ino_t inode, const entry_ref& ref); // Modified to take entry_ref
+	BPrivate::IconMenuItem*			_CreateItem(const BMessage& data);
+	void							_InsertItems(BList& items);
+	void							_RemoveItem(ino_t inode);
+	void							_SetItemLabel(BMenuItem* item,
+										const char* label);
+
+	float							_ItemWidth(BMenuItem* item) const;
+	void							_MeasureItems();
+	void							_InvalidateItemLayout();
+	void							_LayoutItems(float width);
+	int32							_VisibleItemCount(float width) const;
 
 private:
 	static int32					_LoadBookmarksThreadEntry(void* data);
@@ -45,6 +59,17 @@ private:
 private:
 	node_ref						fNodeRef;
 	std::map<ino_t, BPrivate::IconMenuItem*>	fItemsMap;
+
+	// All bookmark items in order. The first fVisibleCount of them are in
+	// the bar, the others in fOverflowMenu.
+	std::vector<BMenuItem*>			fItems;
+	// fWidthSums[i] is the width the first i items take in the bar.
+	std::vector<float>				fWidthSums;
+	int32							fVisibleCount;
+	// The font fWidthSums was measured with.
+	BFont							fMeasuredFont;
+	bool							fLayoutPending;
+
 	BMenu*							fOverflowMenu;
 	// True if fOverflowMenu is currently added to BookmarkBar
 	bool							fOverflowMenuAdded;
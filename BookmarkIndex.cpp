@@ -0,0 +1,784 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "BookmarkIndex.h"
+
+#include <algorithm>
+#include <new>
+#include <string.h>
+
+#include <Autolock.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <Looper.h>
+#include <Messenger.h>
+#include <NodeMonitor.h>
+#include <Path.h>
+#include <StringList.h>
+
+
+/*!	Splits \a text into its lower case words, sorted and without duplicates.
+	Anything but ASCII letters and digits separates words; non-ASCII UTF-8
+	bytes are kept as part of the word.
+*/
+static void
+get_terms(const BString& text, std::vector<BString>& terms)
+{
+	terms.clear();
+
+	BString lower(text);
+	lower.ToLower();
+	const char* string = lower.String();
+
+	int32 start = -1;
+	for (int32 i = 0; ; i++) {
+		uint8 c = string[i];
+		if (c >= 0x80 || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+			if (start < 0)
+				start = i;
+			continue;
+		}
+		if (start >= 0) {
+			terms.push_back(BString(string + start, i - start));
+			start = -1;
+		}
+		if (c == '\0')
+			break;
+	}
+
+	std::sort(terms.begin(), terms.end());
+	terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+}
+
+
+static void
+get_entry_terms(const BString& title, const BString& url,
+	std::vector<BString>& titleTerms, std::vector<BString>& urlTerms)
+{
+	if (url.Length() == 0) {
+		// Only bookmarks can be searched, not folders.
+		titleTerms.clear();
+		urlTerms.clear();
+		return;
+	}
+
+	get_terms(title, titleTerms);
+
+	// The scheme is the same for almost every bookmark.
+	int32 schemeEnd = url.FindFirst("://");
+	if (schemeEnd >= 0) {
+		BString rest;
+		url.CopyInto(rest, schemeEnd + 3, url.Length() - schemeEnd - 3);
+		get_terms(rest, urlTerms);
+	} else
+		get_terms(url, urlTerms);
+}
+
+
+/*!	Returns 2 if \a terms contains \a prefix, 1 if one of them starts with
+	it, and -1 otherwise. \a terms must be sorted.
+*/
+static int32
+term_score(const std::vector<BString>& terms, const BString& prefix)
+{
+	std::vector<BString>::const_iterator found
+		= std::lower_bound(terms.begin(), terms.end(), prefix);
+	if (found == terms.end())
+		return -1;
+	if (*found == prefix)
+		return 2;
+	if (found->Compare(prefix, prefix.Length()) == 0)
+		return 1;
+	return -1;
+}
+
+
+struct BookmarkIndex::Entry {
+	Entry()
+		:
+		isFolder(false)
+	{
+	}
+
+	node_ref	node;
+	node_ref	parent;
+	BString		name;
+	BString		title;
+	BString		url;
+	bool		isFolder;
+	std::vector<Entry*> children;
+	std::vector<BString> titleTerms;
+	std::vector<BString> urlTerms;
+};
+
+
+/*!	Orders the best matches first, and among equally good ones those with
+	the shorter title, which are more likely to be exactly what was searched
+	for.
+*/
+struct BookmarkIndex::CompareMatches {
+	bool operator()(const std::pair<int32, Entry*>& a,
+		const std::pair<int32, Entry*>& b) const
+	{
+		if (a.first != b.first)
+			return a.first > b.first;
+		if (a.second->title.Length() != b.second->title.Length())
+			return a.second->title.Length() < b.second->title.Length();
+		return a.second->title.ICompare(b.second->title) < 0;
+	}
+};
+
+
+BookmarkIndex BookmarkIndex::sDefaultInstance;
+
+
+/*!	Reads what the index keeps about the entry at \a ref. Done outside of
+	the lock, since it has to go to the disk.
+*/
+static void
+read_entry(const entry_ref& ref, bool& isFolder, BString& title,
+	BString& url)
+{
+	BNode node(&ref);
+	isFolder = node.IsDirectory();
+	url.Truncate(0);
+	if (!isFolder)
+		node.ReadAttrString("META:url", &url);
+	if (node.ReadAttrString("META:title", &title) != B_OK
+		|| title.Length() == 0) {
+		title = ref.name;
+	}
+}
+
+
+BookmarkIndex::BookmarkIndex()
+	:
+	BHandler("bookmark index"),
+	fLock("bookmark index"),
+	fLooper(NULL),
+	fGeneration(0),
+	fReady(false),
+	fQuitting(false)
+{
+}
+
+
+BookmarkIndex::~BookmarkIndex()
+{
+	EntryMap::iterator iterator = fEntries.begin();
+	for (; iterator != fEntries.end(); iterator++)
+		delete iterator->second;
+}
+
+
+/*static*/ BookmarkIndex*
+BookmarkIndex::DefaultInstance()
+{
+	return &sDefaultInstance;
+}
+
+
+/*!	Starts the looper the node monitor messages are handled in. The
+	changed entries are read from the disk there, so neither the
+	application nor a window thread waits for it.
+*/
+status_t
+BookmarkIndex::Start()
+{
+	if (fLooper != NULL)
+		return B_OK;
+
+	fLooper = new(std::nothrow) BLooper("bookmark index");
+	if (fLooper == NULL)
+		return B_NO_MEMORY;
+
+	fLooper->AddHandler(this);
+	fLooper->Run();
+	return B_OK;
+}
+
+
+/*!	Reads the whole bookmark tree at \a root, and starts watching its
+	folders. Meant to run in a startup task, after Start().
+*/
+status_t
+BookmarkIndex::Build(const BPath& root)
+{
+	BEntry rootEntry(root.Path());
+	Entry* folder = new(std::nothrow) Entry;
+	if (folder == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = rootEntry.GetNodeRef(&folder->node);
+	if (status != B_OK) {
+		delete folder;
+		return status;
+	}
+	folder->name = root.Leaf();
+	folder->title = folder->name;
+	folder->isFolder = true;
+
+	node_ref rootRef = folder->node;
+	{
+		BAutolock _(fLock);
+		if (fQuitting) {
+			delete folder;
+			return B_CANCELED;
+		}
+		fEntries[rootRef] = folder;
+	}
+
+	_AddFolderContents(rootRef);
+
+	BAutolock _(fLock);
+	if (fQuitting)
+		return B_CANCELED;
+	fReady = true;
+	return B_OK;
+}
+
+
+void
+BookmarkIndex::Shutdown()
+{
+	{
+		BAutolock _(fLock);
+		fQuitting = true;
+		fReady = false;
+
+		EntryMap::iterator iterator = fEntries.begin();
+		for (; iterator != fEntries.end(); iterator++)
+			delete iterator->second;
+		fEntries.clear();
+		fURLs.clear();
+		fTerms.clear();
+	}
+
+	stop_watching(this);
+	if (fLooper != NULL && fLooper->Lock()) {
+		fLooper->RemoveHandler(this);
+		fLooper->Quit();
+	}
+	fLooper = NULL;
+}
+
+
+bool
+BookmarkIndex::IsReady()
+{
+	BAutolock _(fLock);
+	return fReady;
+}
+
+
+/*!	Returns a number that changes whenever a bookmark or folder is added,
+	removed, renamed or changes its URL, or -1 while the index is not ready.
+	Lets views built from the bookmarks tell whether they are still current.
+*/
+int32
+BookmarkIndex::Generation()
+{
+	BAutolock _(fLock);
+	return fReady ? fGeneration : -1;
+}
+
+
+/*!	Returns \c B_OK if the bookmark \a name in \a folder points to \a url,
+	and \c B_ENTRY_NOT_FOUND if it does not.
+*/
+status_t
+BookmarkIndex::FindBookmark(const node_ref& folder, const BString& name,
+	const BString& url)
+{
+	BAutolock _(fLock);
+	if (!fReady || fEntries.find(folder) == fEntries.end())
+		return B_NO_INIT;
+
+	URLMap::const_iterator found = fURLs.find(url);
+	if (found == fURLs.end())
+		return B_ENTRY_NOT_FOUND;
+
+	const std::vector<Entry*>& entries = found->second;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i]->parent == folder && entries[i]->name == name)
+			return B_OK;
+	}
+	return B_ENTRY_NOT_FOUND;
+}
+
+
+/*!	Returns the URL of the bookmark \a node, or \c B_ENTRY_NOT_FOUND if it
+	is a folder or has no URL.
+*/
+status_t
+BookmarkIndex::GetURL(const node_ref& node, BString& url)
+{
+	BAutolock _(fLock);
+	if (!fReady)
+		return B_NO_INIT;
+
+	EntryMap::const_iterator found = fEntries.find(node);
+	if (found == fEntries.end())
+		return B_NO_INIT;
+	if (found->second->url.Length() == 0)
+		return B_ENTRY_NOT_FOUND;
+
+	url = found->second->url;
+	return B_OK;
+}
+
+
+/*!	Adds the URLs of all bookmarks in \a folder and its sub-folders to
+	\a urls.
+*/
+status_t
+BookmarkIndex::GetFolderURLs(const node_ref& folder, BStringList& urls)
+{
+	BAutolock _(fLock);
+	if (!fReady)
+		return B_NO_INIT;
+
+	EntryMap::const_iterator found = fEntries.find(folder);
+	if (found == fEntries.end())
+		return B_NO_INIT;
+
+	std::vector<const Entry*> stack(1, found->second);
+	while (!stack.empty()) {
+		const Entry* entry = stack.back();
+		stack.pop_back();
+		if (entry->url.Length() > 0)
+			urls.Add(entry->url);
+		// Push in reverse, so the children come out in their order.
+		for (size_t i = entry->children.size(); i-- > 0;)
+			stack.push_back(entry->children[i]);
+	}
+	return B_OK;
+}
+
+
+bool
+BookmarkIndex::ContainsURL(const BString& url)
+{
+	BAutolock _(fLock);
+	return fURLs.find(url) != fURLs.end();
+}
+
+
+/*!	Fills \a matches with the bookmarks that have every word of \a query
+	as the start of a word in their title or URL, best matches first.
+
+	The candidates are taken from the query word with the fewest bookmarks,
+	and only those are checked against the other words, so this stays fast
+	even for very large collections.
+*/
+status_t
+BookmarkIndex::Search(const BString& query, MatchList& matches,
+	int32 maxMatches)
+{
+	matches.clear();
+
+	std::vector<BString> terms;
+	get_terms(query, terms);
+
+	BAutolock _(fLock);
+	if (!fReady)
+		return B_NO_INIT;
+	if (terms.empty())
+		return B_OK;
+
+	size_t rarest = 0;
+	size_t rarestCount = _CountPostings(terms[0], (size_t)-1);
+	for (size_t i = 1; i < terms.size() && rarestCount > 0; i++) {
+		size_t count = _CountPostings(terms[i], rarestCount);
+		if (count < rarestCount) {
+			rarest = i;
+			rarestCount = count;
+		}
+	}
+	if (rarestCount == 0)
+		return B_OK;
+
+	std::vector<Entry*> candidates;
+	candidates.reserve(rarestCount);
+	const BString& prefix = terms[rarest];
+	TermMap::const_iterator iterator = fTerms.lower_bound(prefix);
+	for (; iterator != fTerms.end()
+			&& iterator->first.Compare(prefix, prefix.Length()) == 0;
+			iterator++) {
+		candidates.insert(candidates.end(), iterator->second.begin(),
+			iterator->second.end());
+	}
+	// An entry may have several words starting with the prefix.
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()),
+		candidates.end());
+
+	std::vector<std::pair<int32, Entry*> > scored;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		Entry* entry = candidates[i];
+		int32 score = 0;
+		size_t j = 0;
+		for (; j < terms.size(); j++) {
+			// Words from the title count more than those from the URL.
+			int32 termScore = term_score(entry->titleTerms, terms[j]);
+			if (termScore >= 0)
+				termScore += 2;
+			else
+				termScore = term_score(entry->urlTerms, terms[j]);
+			if (termScore < 0)
+				break;
+			score += termScore;
+		}
+		if (j == terms.size())
+			scored.push_back(std::make_pair(score, entry));
+	}
+
+	size_t count = scored.size();
+	if (maxMatches >= 0 && count > (size_t)maxMatches)
+		count = maxMatches;
+	std::partial_sort(scored.begin(), scored.begin() + count, scored.end(),
+		CompareMatches());
+
+	matches.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		const Entry* entry = scored[i].second;
+		matches[i].node = entry->node;
+		matches[i].title = entry->title;
+		matches[i].url = entry->url;
+		matches[i].score = scored[i].first;
+	}
+	return B_OK;
+}
+
+
+void
+BookmarkIndex::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case B_NODE_MONITOR:
+			_HandleNodeMonitor(message);
+			break;
+
+		default:
+			BHandler::MessageReceived(message);
+	}
+}
+
+
+// #pragma mark - private
+
+
+/*!	Watches \a folder and adds everything in it, recursing into the
+	sub-folders. The lock is only held for each single entry, so lookups
+	are not blocked while the disk is read.
+
+	Besides the folder itself, the attributes of everything in it are
+	watched, so that changed titles and URLs are noticed. That takes a
+	single node monitor per folder, instead of one per bookmark.
+*/
+void
+BookmarkIndex::_AddFolderContents(const node_ref& folder)
+{
+	{
+		BAutolock _(fLock);
+		if (fQuitting)
+			return;
+	}
+
+	// Watch first, so that nothing created while reading is missed.
+	// Entries that show up twice are only added once.
+	watch_node(&folder, B_WATCH_DIRECTORY | B_WATCH_ATTR | B_WATCH_CHILDREN,
+		BMessenger(this));
+
+	BDirectory directory(&folder);
+	if (directory.InitCheck() != B_OK)
+		return;
+
+	std::vector<node_ref> subFolders;
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		entry_ref ref;
+		node_ref node;
+		if (entry.GetRef(&ref) != B_OK || entry.GetNodeRef(&node) != B_OK)
+			continue;
+
+		Entry* added = new(std::nothrow) Entry;
+		if (added == NULL)
+			break;
+		added->node = node;
+		added->parent = folder;
+		added->name = ref.name;
+		read_entry(ref, added->isFolder, added->title, added->url);
+		get_entry_terms(added->title, added->url, added->titleTerms,
+			added->urlTerms);
+
+		BAutolock _(fLock);
+		if (fQuitting || !_InsertEntry(added)) {
+			delete added;
+			if (fQuitting)
+				return;
+			continue;
+		}
+		if (added->isFolder)
+			subFolders.push_back(node);
+	}
+	directory.Unset();
+
+	for (size_t i = 0; i < subFolders.size(); i++)
+		_AddFolderContents(subFolders[i]);
+}
+
+
+/*!	Adds \a entry below its parent. Fails if the parent is not in the index
+	(anymore), or the entry already is. Must be called with the lock held.
+*/
+bool
+BookmarkIndex::_InsertEntry(Entry* entry)
+{
+	EntryMap::iterator parent = fEntries.find(entry->parent);
+	if (parent == fEntries.end()
+		|| fEntries.find(entry->node) != fEntries.end()) {
+		return false;
+	}
+
+	fEntries[entry->node] = entry;
+	parent->second->children.push_back(entry);
+	_AddURL(entry);
+	_AddTerms(entry);
+	fGeneration++;
+	return true;
+}
+
+
+/*!	Removes \a entry and, for a folder, everything below it. Must be called
+	with the lock held.
+*/
+void
+BookmarkIndex::_RemoveEntry(Entry* entry)
+{
+	EntryMap::iterator parent = fEntries.find(entry->parent);
+	if (parent != fEntries.end()) {
+		std::vector<Entry*>& children = parent->second->children;
+		children.erase(std::remove(children.begin(), children.end(), entry),
+			children.end());
+	}
+
+	_DeleteEntry(entry);
+	fGeneration++;
+}
+
+
+void
+BookmarkIndex::_DeleteEntry(Entry* entry)
+{
+	for (size_t i = 0; i < entry->children.size(); i++)
+		_DeleteEntry(entry->children[i]);
+
+	if (entry->isFolder)
+		watch_node(&entry->node, B_STOP_WATCHING, BMessenger(this));
+	_RemoveURL(entry);
+	_RemoveTerms(entry);
+	fEntries.erase(entry->node);
+	delete entry;
+}
+
+
+void
+BookmarkIndex::_AddURL(Entry* entry)
+{
+	if (entry->url.Length() > 0)
+		fURLs[entry->url].push_back(entry);
+}
+
+
+void
+BookmarkIndex::_RemoveURL(Entry* entry)
+{
+	if (entry->url.Length() == 0)
+		return;
+
+	URLMap::iterator found = fURLs.find(entry->url);
+	if (found == fURLs.end())
+		return;
+
+	std::vector<Entry*>& entries = found->second;
+	entries.erase(std::remove(entries.begin(), entries.end(), entry),
+		entries.end());
+	if (entries.empty())
+		fURLs.erase(found);
+}
+
+
+void
+BookmarkIndex::_AddTerms(Entry* entry)
+{
+	for (size_t i = 0; i < entry->titleTerms.size(); i++)
+		fTerms[entry->titleTerms[i]].push_back(entry);
+
+	for (size_t i = 0; i < entry->urlTerms.size(); i++) {
+		// Words in both title and URL are only listed once.
+		if (!std::binary_search(entry->titleTerms.begin(),
+				entry->titleTerms.end(), entry->urlTerms[i])) {
+			fTerms[entry->urlTerms[i]].push_back(entry);
+		}
+	}
+}
+
+
+void
+BookmarkIndex::_RemoveTerms(Entry* entry)
+{
+	std::vector<BString> terms(entry->titleTerms);
+	terms.insert(terms.end(), entry->urlTerms.begin(), entry->urlTerms.end());
+
+	for (size_t i = 0; i < terms.size(); i++) {
+		TermMap::iterator found = fTerms.find(terms[i]);
+		if (found == fTerms.end())
+			continue;
+
+		std::vector<Entry*>& entries = found->second;
+		entries.erase(std::remove(entries.begin(), entries.end(), entry),
+			entries.end());
+		if (entries.empty())
+			fTerms.erase(found);
+	}
+}
+
+
+/*!	Returns the number of postings of all words starting with \a prefix,
+	counting no further than \a limit.
+*/
+size_t
+BookmarkIndex::_CountPostings(const BString& prefix, size_t limit) const
+{
+	size_t count = 0;
+	TermMap::const_iterator iterator = fTerms.lower_bound(prefix);
+	for (; iterator != fTerms.end() && count < limit
+			&& iterator->first.Compare(prefix, prefix.Length()) == 0;
+			iterator++) {
+		count += iterator->second.size();
+	}
+	return count;
+}
+
+
+void
+BookmarkIndex::_HandleNodeMonitor(BMessage* message)
+{
+	int32 opcode;
+	node_ref node;
+	if (message->FindInt32("opcode", &opcode) != B_OK
+		|| message->FindInt32("device", &node.device) != B_OK
+		|| message->FindInt64("node", &node.node) != B_OK) {
+		return;
+	}
+
+	switch (opcode) {
+		case B_ENTRY_CREATED:
+		case B_ENTRY_MOVED:
+		{
+			const char* name;
+			ino_t directory;
+			if (message->FindString("name", &name) != B_OK
+				|| message->FindInt64(opcode == B_ENTRY_CREATED
+					? "directory" : "to directory", &directory) != B_OK) {
+				break;
+			}
+			node_ref parent(node.device, directory);
+			entry_ref ref(node.device, directory, name);
+
+			Entry* added = new(std::nothrow) Entry;
+			if (added == NULL)
+				break;
+			added->node = node;
+			added->parent = parent;
+			added->name = name;
+			read_entry(ref, added->isFolder, added->title, added->url);
+			get_entry_terms(added->title, added->url, added->titleTerms,
+				added->urlTerms);
+
+			bool isFolder = added->isFolder;
+			{
+				BAutolock _(fLock);
+				if (fQuitting) {
+					delete added;
+					break;
+				}
+
+				// A moved entry is taken out first: it went to another
+				// folder within the index, or out of it.
+				EntryMap::iterator existing = fEntries.find(node);
+				if (existing != fEntries.end())
+					_RemoveEntry(existing->second);
+
+				if (!_InsertEntry(added)) {
+					delete added;
+					break;
+				}
+			}
+
+			// Moved in folders come with their contents. New bookmark files
+			// are created before their attributes are written, those are
+			// picked up through the watch on the folder.
+			if (isFolder)
+				_AddFolderContents(node);
+			break;
+		}
+
+		case B_ENTRY_REMOVED:
+		{
+			BAutolock _(fLock);
+			EntryMap::iterator existing = fEntries.find(node);
+			if (existing != fEntries.end())
+				_RemoveEntry(existing->second);
+			break;
+		}
+
+		case B_ATTR_CHANGED:
+		{
+			const char* attribute;
+			if (message->FindString("attr", &attribute) != B_OK
+				|| (strcmp(attribute, "META:url") != 0
+					&& strcmp(attribute, "META:title") != 0)) {
+				break;
+			}
+
+			entry_ref ref;
+			{
+				BAutolock _(fLock);
+				EntryMap::iterator existing = fEntries.find(node);
+				if (existing == fEntries.end())
+					break;
+				Entry* entry = existing->second;
+				ref = entry_ref(entry->parent.device, entry->parent.node,
+					entry->name.String());
+			}
+
+			bool isFolder;
+			BString title;
+			BString url;
+			read_entry(ref, isFolder, title, url);
+			std::vector<BString> titleTerms;
+			std::vector<BString> urlTerms;
+			get_entry_terms(title, url, titleTerms, urlTerms);
+
+			BAutolock _(fLock);
+			EntryMap::iterator existing = fEntries.find(node);
+			if (existing == fEntries.end())
+				break;
+			Entry* entry = existing->second;
+			_RemoveURL(entry);
+			_RemoveTerms(entry);
+			entry->title = title;
+			entry->url = url;
+			entry->titleTerms.swap(titleTerms);
+			entry->urlTerms.swap(urlTerms);
+			_AddURL(entry);
+			_AddTerms(entry);
+			fGeneration++;
+			break;
+		}
+	}
+}
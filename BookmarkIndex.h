@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BOOKMARK_INDEX_H
+#define BOOKMARK_INDEX_H
+
+
+#include <Handler.h>
+#include <Locker.h>
+#include <Node.h>
+#include <String.h>
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "HashFunctions.h"
+
+
+class BLooper;
+class BPath;
+class BStringList;
+
+
+/*!	Keeps the URL and title of every bookmark in memory, together with the
+	folder hierarchy, so that bookmarks can be looked up without reading
+	their files.
+
+	The index is built once by a startup task, and then kept up to date by
+	node monitoring the bookmark folders. The node monitor messages are
+	handled in a looper of its own, the lookups can be done from any
+	thread. Until the index is built, and for folders outside the bookmark
+	folder, the lookups return \c B_NO_INIT and the caller has to go to the
+	disk itself.
+
+	The words of the bookmark titles and URLs are indexed as well, so that
+	bookmarks can be searched by any prefix of those words.
+*/
+class BookmarkIndex : public BHandler {
+public:
+			struct Match {
+				node_ref		node;
+				BString			title;
+				BString			url;
+				int32			score;
+			};
+			typedef std::vector<Match> MatchList;
+
+	static	BookmarkIndex*		DefaultInstance();
+
+			status_t			Start();
+			status_t			Build(const BPath& root);
+			void				Shutdown();
+
+			bool				IsReady();
+			int32				Generation();
+
+			status_t			FindBookmark(const node_ref& folder,
+									const BString& name,
+									const BString& url);
+			status_t			GetURL(const node_ref& node, BString& url);
+			status_t			GetFolderURLs(const node_ref& folder,
+									BStringList& urls);
+			bool				ContainsURL(const BString& url);
+			status_t			Search(const BString& query,
+									MatchList& matches, int32 maxMatches);
+
+	virtual	void				MessageReceived(BMessage* message);
+
+private:
+			struct Entry;
+			struct CompareMatches;
+
+			typedef std::unordered_map<node_ref, Entry*, NodeRefHash>
+				EntryMap;
+			typedef std::unordered_map<BString, std::vector<Entry*>,
+				StringHash> URLMap;
+			typedef std::map<BString, std::vector<Entry*> > TermMap;
+				// sorted, so all words starting with a prefix are adjacent
+
+								BookmarkIndex();
+	virtual						~BookmarkIndex();
+
+			void				_AddFolderContents(const node_ref& folder);
+			bool				_InsertEntry(Entry* entry);
+			void				_RemoveEntry(Entry* entry);
+			void				_DeleteEntry(Entry* entry);
+			void				_AddURL(Entry* entry);
+			void				_RemoveURL(Entry* entry);
+			void				_AddTerms(Entry* entry);
+			void				_RemoveTerms(Entry* entry);
+			size_t				_CountPostings(const BString& prefix,
+									size_t limit) const;
+			void				_HandleNodeMonitor(BMessage* message);
+
+private:
+			BLocker				fLock;
+			BLooper*			fLooper;
+			EntryMap			fEntries;
+			URLMap				fURLs;
+			TermMap				fTerms;
+			int32				fGeneration;
+			bool				fReady;
+			bool				fQuitting;
+
+	static	BookmarkIndex		sDefaultInstance;
+};
+
+
+#endif // BOOKMARK_INDEX_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "BookmarkSearchWindow.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Application.h>
+#include <Catalog.h>
+#include <Layout.h>
+#include <StringView.h>
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Bookmark search"
+
+
+static const int32 kMaxMatches = 500;
+
+
+BookmarkSearchWindow::BookmarkSearchWindow()
+	:
+	SearchPopUpWindow(B_TRANSLATE("Search bookmarks"))
+{
+	fStatusView = new BStringView("status", "");
+	fStatusView->SetExplicitMaxSize(BSize(B_SIZE_UNLIMITED, B_SIZE_UNSET));
+	GetLayout()->AddView(fStatusView);
+}
+
+
+BookmarkSearchWindow::~BookmarkSearchWindow()
+{
+}
+
+
+void
+BookmarkSearchWindow::GetResult(int32 index, BString& title,
+	BString& url) const
+{
+	const BookmarkIndex::Match& match = fMatches[index];
+	title = match.title;
+	url = match.url;
+}
+
+
+// #pragma mark - protected
+
+
+void
+BookmarkSearchWindow::UpdateResults()
+{
+	// One more match than shown tells whether there are more.
+	bigtime_t startTime = system_time();
+	status_t status = BookmarkIndex::DefaultInstance()->Search(Query(),
+		fMatches, kMaxMatches + 1);
+	bigtime_t elapsed = system_time() - startTime;
+
+	bool truncated = fMatches.size() > (size_t)kMaxMatches;
+	if (truncated)
+		fMatches.resize(kMaxMatches);
+
+	SetResultCount(fMatches.size());
+
+	if (status == B_NO_INIT) {
+		fStatusView->SetText(
+			B_TRANSLATE("The bookmarks are still being indexed."));
+	} else if (strlen(Query()) == 0) {
+		fStatusView->SetText("");
+	} else {
+		char time[32];
+		snprintf(time, sizeof(time), "%.1f", elapsed / 1000.0);
+		BString text;
+		if (truncated) {
+			text = B_TRANSLATE_COMMENT("More than %count bookmarks found in "
+				"%time ms, the first %count are shown",
+				"Number of search results shown, and the time the search "
+				"took");
+		} else {
+			text = B_TRANSLATE_COMMENT("%count bookmarks found in %time ms",
+				"Number of search results, and the time the search took");
+		}
+		text.ReplaceAll("%count", BString() << (int32)fMatches.size());
+		text.ReplaceFirst("%time", time);
+		fStatusView->SetText(text.String());
+	}
+}
+
+
+void
+BookmarkSearchWindow::InvokeResult(int32 index)
+{
+	BMessage message(B_REFS_RECEIVED);
+	message.AddString("url", fMatches[index].url);
+	be_app->PostMessage(&message);
+}
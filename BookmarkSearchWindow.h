@@ -0,0 +1,37 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BOOKMARK_SEARCH_WINDOW_H
+#define BOOKMARK_SEARCH_WINDOW_H
+
+
+#include "BookmarkIndex.h"
+#include "SearchPopUpWindow.h"
+
+
+class BStringView;
+
+
+/*!	Lets the user search all bookmarks by the words in their title and URL,
+	and opens the chosen one.
+*/
+class BookmarkSearchWindow : public SearchPopUpWindow {
+public:
+								BookmarkSearchWindow();
+	virtual						~BookmarkSearchWindow();
+
+	virtual	void				GetResult(int32 index, BString& title,
+									BString& url) const;
+
+protected:
+	virtual	void				UpdateResults();
+	virtual	void				InvokeResult(int32 index);
+
+private:
+			BStringView*		fStatusView;
+			BookmarkIndex::MatchList fMatches;
+};
+
+
+#endif // BOOKMARK_SEARCH_WINDOW_H
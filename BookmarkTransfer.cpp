@@ -0,0 +1,838 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "BookmarkTransfer.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <Catalog.h>
+#include <Directory.h>
+#include <File.h>
+#include <Message.h>
+#include <OS.h>
+
+#include "HashFunctions.h"
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Bookmark transfer"
+
+
+static const char* kBookmarkBarFolder = "Bookmark bar";
+	// The folder BrowserWindow shows in the bookmark bar.
+static const char* kBookmarkType = "application/x-vnd.Be-bookmark";
+
+static const size_t kReadChunkSize = 64 * 1024;
+static const size_t kWriteBufferSize = 64 * 1024;
+static const size_t kBookmarksPerBatch = 256;
+
+
+struct BookmarkTransfer::Job {
+	bool				import;
+	entry_ref			file;
+	BPath				bookmarks;
+	entry_ref			directory;
+	BString				name;
+	BMessenger			target;
+};
+
+
+static void
+append_utf8(std::string& text, uint32 c)
+{
+	if (c < 0x80) {
+		text += (char)c;
+	} else if (c < 0x800) {
+		text += (char)(0xc0 | (c >> 6));
+		text += (char)(0x80 | (c & 0x3f));
+	} else if (c < 0x10000) {
+		text += (char)(0xe0 | (c >> 12));
+		text += (char)(0x80 | ((c >> 6) & 0x3f));
+		text += (char)(0x80 | (c & 0x3f));
+	} else if (c < 0x110000) {
+		text += (char)(0xf0 | (c >> 18));
+		text += (char)(0x80 | ((c >> 12) & 0x3f));
+		text += (char)(0x80 | ((c >> 6) & 0x3f));
+		text += (char)(0x80 | (c & 0x3f));
+	}
+}
+
+
+/*!	Replaces the character references in \a text. Only the few named ones
+	the bookmark file writers use are known.
+*/
+static BString
+decode_entities(const char* text, size_t length)
+{
+	std::string decoded;
+	decoded.reserve(length);
+
+	const char* end = text + length;
+	while (text < end) {
+		const char* semicolon = NULL;
+		if (*text == '&') {
+			semicolon = (const char*)memchr(text, ';',
+				std::min<size_t>(end - text, 10));
+		}
+		if (semicolon == NULL) {
+			decoded += *text++;
+			continue;
+		}
+
+		std::string name(text + 1, semicolon - text - 1);
+		uint32 c = 0;
+		if (name == "amp")
+			c = '&';
+		else if (name == "lt")
+			c = '<';
+		else if (name == "gt")
+			c = '>';
+		else if (name == "quot")
+			c = '"';
+		else if (name == "apos")
+			c = '\'';
+		else if (name.size() > 1 && name[0] == '#') {
+			if (name[1] == 'x' || name[1] == 'X')
+				c = strtoul(name.c_str() + 2, NULL, 16);
+			else
+				c = strtoul(name.c_str() + 1, NULL, 10);
+		}
+
+		if (c == 0) {
+			decoded += *text++;
+			continue;
+		}
+		append_utf8(decoded, c);
+		text = semicolon + 1;
+	}
+
+	BString result(decoded.c_str(), decoded.size());
+	result.Trim();
+	return result;
+}
+
+
+static void
+append_escaped(std::string& out, const char* text)
+{
+	const char* start = text;
+	for (; *text != '\0'; text++) {
+		const char* replacement;
+		switch (*text) {
+			case '&':
+				replacement = "&amp;";
+				break;
+			case '<':
+				replacement = "&lt;";
+				break;
+			case '>':
+				replacement = "&gt;";
+				break;
+			case '"':
+				replacement = "&quot;";
+				break;
+			default:
+				continue;
+		}
+		out.append(start, text - start);
+		out += replacement;
+		start = text + 1;
+	}
+	out.append(start, text - start);
+}
+
+
+/*!	Looks for the attribute \a name in the start tag \a tag, which does not
+	include the angle brackets.
+*/
+static bool
+find_attribute(const char* tag, size_t length, const char* name,
+	BString& value)
+{
+	const char* end = tag + length;
+	size_t nameLength = strlen(name);
+
+	// Skip the element name
+	const char* position = tag;
+	while (position < end && !isspace(*position))
+		position++;
+
+	while (position < end) {
+		while (position < end && isspace(*position))
+			position++;
+		const char* attribute = position;
+		while (position < end && *position != '=' && !isspace(*position))
+			position++;
+		size_t attributeLength = position - attribute;
+		while (position < end && isspace(*position))
+			position++;
+
+		const char* valueStart = position;
+		const char* valueEnd = position;
+		if (position < end && *position == '=') {
+			position++;
+			while (position < end && isspace(*position))
+				position++;
+			if (position < end && (*position == '"' || *position == '\'')) {
+				char quote = *position++;
+				valueStart = position;
+				while (position < end && *position != quote)
+					position++;
+				valueEnd = position;
+				if (position < end)
+					position++;
+			} else {
+				valueStart = position;
+				while (position < end && !isspace(*position))
+					position++;
+				valueEnd = position;
+			}
+		}
+
+		if (attributeLength == nameLength
+			&& strncasecmp(attribute, name, nameLength) == 0) {
+			value = decode_entities(valueStart, valueEnd - valueStart);
+			return true;
+		}
+		if (attributeLength == 0 && position == valueStart)
+			position++;
+	}
+	return false;
+}
+
+
+/*!	Shortens \a name to at most \a length bytes, without cutting a UTF-8
+	character in two.
+*/
+static void
+truncate_name(BString& name, int32 length)
+{
+	if (name.Length() <= length)
+		return;
+
+	while (length > 0 && (name.ByteAt(length) & 0xc0) == 0x80)
+		length--;
+	name.Truncate(length);
+}
+
+
+static bool
+is_element(const char* tag, size_t length, const char* name)
+{
+	size_t nameLength = strlen(name);
+	return length >= nameLength && strncasecmp(tag, name, nameLength) == 0
+		&& (length == nameLength || isspace(tag[nameLength])
+			|| tag[nameLength] == '/');
+}
+
+
+// #pragma mark - Importer
+
+
+/*!	Parses a bookmark file as it is read, and writes the bookmarks out in
+	batches. Folders of the same name are merged with the existing ones, and
+	bookmarks for URLs that are already in their folder are skipped, so
+	importing the same file twice does not duplicate anything. The same URL
+	may still be bookmarked in several folders.
+*/
+class BookmarkTransfer::Importer {
+public:
+								Importer(const BPath& root);
+								~Importer();
+
+			status_t			Run(BFile& file);
+
+			int32				Folders() const { return fFolderCount; }
+			int32				Bookmarks() const { return fBookmarkCount; }
+			int32				Duplicates() const { return fDuplicateCount; }
+
+private:
+			typedef std::unordered_set<BString, StringHash> StringSet;
+
+			struct Folder {
+				BDirectory		directory;
+				StringSet		names;
+				StringSet		urls;
+			};
+
+			struct Bookmark {
+				Folder*			folder;
+				BString			title;
+				BString			url;
+			};
+
+			enum {
+				CAPTURE_NONE,
+				CAPTURE_LINK,
+				CAPTURE_FOLDER
+			};
+
+			size_t				_Parse(const std::string& data);
+			void				_HandleTag(const char* tag, size_t length);
+
+			Folder*				_CurrentFolder() const;
+			void				_PushFolder();
+			void				_PopFolder();
+			void				_AddBookmark(const BString& title,
+									const BString& url);
+			void				_Flush();
+
+			BString				_UniqueName(Folder* folder, BString name);
+			void				_ReadFolder(Folder* folder);
+
+private:
+			std::vector<Folder*> fFolders;
+				// NULL for lists that do not start a new folder
+			std::vector<Bookmark> fBatch;
+
+			int32				fCapture;
+			std::string			fText;
+			BString				fLinkURL;
+			BString				fFolderName;
+			bool				fFolderIsBar;
+			bool				fFolderPending;
+
+			status_t			fError;
+			int32				fFolderCount;
+			int32				fBookmarkCount;
+			int32				fDuplicateCount;
+};
+
+
+BookmarkTransfer::Importer::Importer(const BPath& root)
+	:
+	fCapture(CAPTURE_NONE),
+	fFolderIsBar(false),
+	fFolderPending(false),
+	fError(B_OK),
+	fFolderCount(0),
+	fBookmarkCount(0),
+	fDuplicateCount(0)
+{
+	Folder* folder = new(std::nothrow) Folder;
+	if (folder == NULL) {
+		fError = B_NO_MEMORY;
+		return;
+	}
+	fFolders.push_back(folder);
+
+	fError = folder->directory.SetTo(root.Path());
+	if (fError != B_OK)
+		return;
+	_ReadFolder(folder);
+}
+
+
+BookmarkTransfer::Importer::~Importer()
+{
+	for (size_t i = 0; i < fFolders.size(); i++)
+		delete fFolders[i];
+}
+
+
+status_t
+BookmarkTransfer::Importer::Run(BFile& file)
+{
+	if (fError != B_OK)
+		return fError;
+
+	char* chunk = new(std::nothrow) char[kReadChunkSize];
+	if (chunk == NULL)
+		return B_NO_MEMORY;
+
+	std::string pending;
+	status_t status = B_OK;
+	while (true) {
+		ssize_t bytesRead = file.Read(chunk, kReadChunkSize);
+		if (bytesRead <= 0) {
+			if (bytesRead < 0)
+				status = bytesRead;
+			break;
+		}
+
+		pending.append(chunk, bytesRead);
+		pending.erase(0, _Parse(pending));
+	}
+	delete[] chunk;
+
+	_Flush();
+	return status != B_OK ? status : fError;
+}
+
+
+/*!	Handles all complete tags in \a data, and returns how much of it was
+	consumed. The rest has to be passed in again with the next chunk.
+*/
+size_t
+BookmarkTransfer::Importer::_Parse(const std::string& data)
+{
+	const char* start = data.c_str();
+	const char* end = start + data.size();
+	const char* position = start;
+
+	while (position < end) {
+		const char* open = (const char*)memchr(position, '<', end - position);
+		if (open == NULL)
+			open = end;
+		if (fCapture != CAPTURE_NONE)
+			fText.append(position, open - position);
+		if (open == end)
+			return data.size();
+
+		// Find the end of the tag, a '>' in a quoted value does not count
+		const char* close = open + 1;
+		char quote = '\0';
+		for (; close < end; close++) {
+			if (quote != '\0') {
+				if (*close == quote)
+					quote = '\0';
+			} else if (*close == '"' || *close == '\'')
+				quote = *close;
+			else if (*close == '>')
+				break;
+		}
+		if (close == end)
+			return open - start;
+
+		_HandleTag(open + 1, close - open - 1);
+		position = close + 1;
+	}
+	return data.size();
+}
+
+
+void
+BookmarkTransfer::Importer::_HandleTag(const char* tag, size_t length)
+{
+	if (is_element(tag, length, "A")) {
+		fLinkURL.Truncate(0);
+		find_attribute(tag, length, "HREF", fLinkURL);
+		fText.clear();
+		fCapture = CAPTURE_LINK;
+	} else if (is_element(tag, length, "/A")) {
+		if (fCapture == CAPTURE_LINK)
+			_AddBookmark(decode_entities(fText.c_str(), fText.size()), fLinkURL);
+		fCapture = CAPTURE_NONE;
+	} else if (is_element(tag, length, "H3")) {
+		BString value;
+		fFolderIsBar = find_attribute(tag, length, "PERSONAL_TOOLBAR_FOLDER",
+			value);
+		fText.clear();
+		fCapture = CAPTURE_FOLDER;
+	} else if (is_element(tag, length, "/H3")) {
+		if (fCapture == CAPTURE_FOLDER) {
+			fFolderName = decode_entities(fText.c_str(), fText.size());
+			fFolderPending = true;
+		}
+		fCapture = CAPTURE_NONE;
+	} else if (is_element(tag, length, "DL")) {
+		_PushFolder();
+	} else if (is_element(tag, length, "/DL")) {
+		_PopFolder();
+	}
+}
+
+
+BookmarkTransfer::Importer::Folder*
+BookmarkTransfer::Importer::_CurrentFolder() const
+{
+	for (size_t i = fFolders.size(); i-- > 0;) {
+		if (fFolders[i] != NULL)
+			return fFolders[i];
+	}
+	return NULL;
+}
+
+
+/*!	Starts the list of the folder whose heading was read last. A list
+	without a heading, like the outermost one, stays in the current folder.
+*/
+void
+BookmarkTransfer::Importer::_PushFolder()
+{
+	if (!fFolderPending) {
+		fFolders.push_back(NULL);
+		return;
+	}
+	fFolderPending = false;
+
+	Folder* parent = _CurrentFolder();
+	BString name = fFolderIsBar ? BString(kBookmarkBarFolder) : fFolderName;
+	name.ReplaceAll('/', '-');
+	truncate_name(name, B_FILE_NAME_LENGTH - 1);
+	if (name.IsEmpty())
+		name = B_TRANSLATE("Unnamed folder");
+
+	Folder* folder = new(std::nothrow) Folder;
+	if (folder == NULL) {
+		fError = B_NO_MEMORY;
+		fFolders.push_back(NULL);
+		return;
+	}
+
+	BEntry entry(&parent->directory, name.String());
+	if (entry.Exists() && !entry.IsDirectory())
+		name = _UniqueName(parent, name);
+
+	if (folder->directory.SetTo(&parent->directory, name.String()) == B_OK)
+		_ReadFolder(folder);
+	else {
+		status_t status = parent->directory.CreateDirectory(name.String(),
+			&folder->directory);
+		if (status != B_OK) {
+			if (fError == B_OK)
+				fError = status;
+			delete folder;
+			fFolders.push_back(NULL);
+			return;
+		}
+		fFolderCount++;
+	}
+	parent->names.insert(name);
+	fFolders.push_back(folder);
+}
+
+
+void
+BookmarkTransfer::Importer::_PopFolder()
+{
+	if (fFolders.size() <= 1)
+		return;
+
+	Folder* folder = fFolders.back();
+	if (folder != NULL) {
+		// The queued bookmarks may still need it.
+		_Flush();
+		delete folder;
+	}
+	fFolders.pop_back();
+}
+
+
+void
+BookmarkTransfer::Importer::_AddBookmark(const BString& title,
+	const BString& url)
+{
+	// Firefox' "place:" queries only make sense inside Firefox.
+	if (url.IsEmpty() || url.StartsWith("place:"))
+		return;
+
+	Folder* folder = _CurrentFolder();
+	if (!folder->urls.insert(url).second) {
+		fDuplicateCount++;
+		return;
+	}
+
+	Bookmark bookmark;
+	bookmark.folder = folder;
+	bookmark.title = title;
+	bookmark.url = url;
+	fBatch.push_back(bookmark);
+
+	if (fBatch.size() >= kBookmarksPerBatch)
+		_Flush();
+}
+
+
+/*!	Writes out the queued bookmarks. The file names are picked from the
+	names already known for each folder, so no directory has to be searched,
+	and the attributes are written directly instead of through BNodeInfo.
+*/
+void
+BookmarkTransfer::Importer::_Flush()
+{
+	for (size_t i = 0; i < fBatch.size(); i++) {
+		Bookmark& bookmark = fBatch[i];
+
+		BString name = bookmark.title;
+		if (name.IsEmpty()) {
+			name = bookmark.url;
+			int32 leafPos = name.FindLast('/');
+			if (leafPos >= 0)
+				name.Remove(0, leafPos + 1);
+		}
+		name = _UniqueName(bookmark.folder, name);
+
+		BFile file(&bookmark.folder->directory, name.String(),
+			B_CREATE_FILE | B_FAIL_IF_EXISTS | B_WRITE_ONLY);
+		status_t status = file.InitCheck();
+		if (status == B_OK)
+			status = file.WriteAttrString("META:url", &bookmark.url);
+		if (status == B_OK)
+			status = file.WriteAttrString("META:title", &bookmark.title);
+		if (status == B_OK) {
+			ssize_t written = file.WriteAttr("BEOS:TYPE", B_MIME_STRING_TYPE,
+				0, kBookmarkType, strlen(kBookmarkType) + 1);
+			if (written < 0)
+				status = written;
+		}
+
+		if (status == B_OK)
+			fBookmarkCount++;
+		else if (fError == B_OK)
+			fError = status;
+	}
+	fBatch.clear();
+}
+
+
+BString
+BookmarkTransfer::Importer::_UniqueName(Folder* folder, BString name)
+{
+	name.ReplaceAll('/', '-');
+	// Leave room for a number
+	truncate_name(name, B_FILE_NAME_LENGTH - 8);
+	if (name.IsEmpty())
+		name = B_TRANSLATE("Bookmark");
+
+	BString unique = name;
+	for (int32 tries = 1; folder->names.find(unique) != folder->names.end();
+			tries++) {
+		unique = name;
+		unique << " " << tries;
+	}
+	folder->names.insert(unique);
+	return unique;
+}
+
+
+/*!	Reads the names and the bookmarked URLs of a folder that already
+	exists, so the imported bookmarks can be merged into it.
+*/
+void
+BookmarkTransfer::Importer::_ReadFolder(Folder* folder)
+{
+	BEntry entry;
+	while (folder->directory.GetNextEntry(&entry) == B_OK) {
+		char name[B_FILE_NAME_LENGTH];
+		if (entry.GetName(name) != B_OK)
+			continue;
+		folder->names.insert(name);
+
+		BNode node(&entry);
+		BString url;
+		if (!node.IsDirectory()
+			&& node.ReadAttrString("META:url", &url) == B_OK) {
+			folder->urls.insert(url);
+		}
+	}
+}
+
+
+// #pragma mark - Export
+
+
+static status_t
+flush_output(BFile& file, std::string& out)
+{
+	ssize_t written = file.Write(out.data(), out.size());
+	if (written < 0)
+		return written;
+	if ((size_t)written != out.size())
+		return B_IO_ERROR;
+	out.clear();
+	return B_OK;
+}
+
+
+static status_t
+export_folder(BDirectory& directory, BFile& file, std::string& out,
+	int32 depth, int32& folderCount, int32& bookmarkCount)
+{
+	std::string indent(depth * 4, ' ');
+
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		char name[B_FILE_NAME_LENGTH];
+		if (entry.GetName(name) != B_OK)
+			continue;
+
+		if (entry.IsDirectory()) {
+			out += indent;
+			out += "<DT><H3";
+			if (depth == 1 && strcmp(name, kBookmarkBarFolder) == 0)
+				out += " PERSONAL_TOOLBAR_FOLDER=\"true\"";
+			out += ">";
+			append_escaped(out, name);
+			out += "</H3>\n";
+			out += indent;
+			out += "<DL><p>\n";
+
+			BDirectory subDirectory(&entry);
+			entry.Unset();
+			status_t status = export_folder(subDirectory, file, out, depth + 1,
+				folderCount, bookmarkCount);
+			if (status != B_OK)
+				return status;
+
+			out += indent;
+			out += "</DL><p>\n";
+			folderCount++;
+		} else {
+			BNode node(&entry);
+			BString url;
+			if (node.ReadAttrString("META:url", &url) != B_OK)
+				continue;
+			BString title;
+			if (node.ReadAttrString("META:title", &title) != B_OK
+				|| title.IsEmpty()) {
+				title = name;
+			}
+
+			out += indent;
+			out += "<DT><A HREF=\"";
+			append_escaped(out, url.String());
+			out += "\">";
+			append_escaped(out, title.String());
+			out += "</A>\n";
+			bookmarkCount++;
+		}
+
+		if (out.size() >= kWriteBufferSize) {
+			status_t status = flush_output(file, out);
+			if (status != B_OK)
+				return status;
+		}
+	}
+	return B_OK;
+}
+
+
+// #pragma mark - BookmarkTransfer
+
+
+/*static*/ status_t
+BookmarkTransfer::StartImport(const entry_ref& file, const BPath& bookmarks,
+	const BMessenger& target)
+{
+	Job* job = new(std::nothrow) Job;
+	if (job == NULL)
+		return B_NO_MEMORY;
+
+	job->import = true;
+	job->file = file;
+	job->bookmarks = bookmarks;
+	job->target = target;
+	return _Start(job);
+}
+
+
+/*static*/ status_t
+BookmarkTransfer::StartExport(const BPath& bookmarks,
+	const entry_ref& directory, const char* name, const BMessenger& target)
+{
+	Job* job = new(std::nothrow) Job;
+	if (job == NULL)
+		return B_NO_MEMORY;
+
+	job->import = false;
+	job->bookmarks = bookmarks;
+	job->directory = directory;
+	job->name = name;
+	job->target = target;
+	return _Start(job);
+}
+
+
+/*static*/ status_t
+BookmarkTransfer::_Start(Job* job)
+{
+	thread_id thread = spawn_thread(_ThreadEntry,
+		job->import ? "bookmark import" : "bookmark export",
+		B_LOW_PRIORITY, job);
+	if (thread < 0) {
+		delete job;
+		return thread;
+	}
+
+	resume_thread(thread);
+	return B_OK;
+}
+
+
+/*static*/ int32
+BookmarkTransfer::_ThreadEntry(void* data)
+{
+	Job* job = static_cast<Job*>(data);
+	bigtime_t startTime = system_time();
+
+	BMessage reply(MSG_BOOKMARK_TRANSFER_DONE);
+	reply.AddBool("import", job->import);
+
+	status_t status;
+	if (job->import) {
+		BFile file(&job->file, B_READ_ONLY);
+		status = file.InitCheck();
+		if (status == B_OK) {
+			Importer importer(job->bookmarks);
+			status = importer.Run(file);
+			reply.AddInt32("folders", importer.Folders());
+			reply.AddInt32("bookmarks", importer.Bookmarks());
+			reply.AddInt32("duplicates", importer.Duplicates());
+		}
+	} else
+		status = _Export(*job, reply);
+
+	reply.AddInt64("elapsed", system_time() - startTime);
+	if (status != B_OK)
+		reply.AddString("error", strerror(status));
+
+	job->target.SendMessage(&reply);
+	delete job;
+	return status;
+}
+
+
+/*static*/ status_t
+BookmarkTransfer::_Export(Job& job, BMessage& reply)
+{
+	BDirectory bookmarks(job.bookmarks.Path());
+	status_t status = bookmarks.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	BDirectory directory(&job.directory);
+	BFile file(&directory, job.name.String(),
+		B_CREATE_FILE | B_ERASE_FILE | B_WRITE_ONLY);
+	status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	std::string out;
+	out.reserve(kWriteBufferSize + 4096);
+	out += "<!DOCTYPE NETSCAPE-Bookmark-file-1>\n"
+		"<META HTTP-EQUIV=\"Content-Type\" CONTENT=\"text/html; "
+			"charset=UTF-8\">\n"
+		"<TITLE>Bookmarks</TITLE>\n"
+		"<H1>Bookmarks</H1>\n"
+		"<DL><p>\n";
+
+	int32 folderCount = 0;
+	int32 bookmarkCount = 0;
+	status = export_folder(bookmarks, file, out, 1, folderCount,
+		bookmarkCount);
+	if (status == B_OK) {
+		out += "</DL><p>\n";
+		status = flush_output(file, out);
+	}
+	if (status == B_OK) {
+		const char* type = "text/html";
+		file.WriteAttr("BEOS:TYPE", B_MIME_STRING_TYPE, 0, type,
+			strlen(type) + 1);
+	}
+
+	reply.AddInt32("folders", folderCount);
+	reply.AddInt32("bookmarks", bookmarkCount);
+	reply.AddInt32("duplicates", 0);
+	return status;
+}
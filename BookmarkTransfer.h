@@ -0,0 +1,45 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BOOKMARK_TRANSFER_H
+#define BOOKMARK_TRANSFER_H
+
+
+#include <Entry.h>
+#include <Messenger.h>
+#include <Path.h>
+#include <String.h>
+
+
+/*!	Imports and exports bookmarks in the Netscape bookmark file format, as
+	read and written by most other browsers.
+
+	Both run in a thread of their own, and send a MSG_BOOKMARK_TRANSFER_DONE
+	message to the target when done. It contains the number of "folders"
+	created and "bookmarks" transferred, the "duplicates" that were skipped,
+	the "elapsed" time, and an "error" string if something went wrong.
+*/
+class BookmarkTransfer {
+public:
+	static	status_t			StartImport(const entry_ref& file,
+									const BPath& bookmarks,
+									const BMessenger& target);
+	static	status_t			StartExport(const BPath& bookmarks,
+									const entry_ref& directory,
+									const char* name,
+									const BMessenger& target);
+
+	static const uint32			MSG_BOOKMARK_TRANSFER_DONE = 'BtDn';
+
+private:
+			struct Job;
+			class Importer;
+
+	static	status_t			_Start(Job* job);
+	static	int32				_ThreadEntry(void* data);
+	static	status_t			_Export(Job& job, BMessage& reply);
+};
+
+
+#endif // BOOKMARK_TRANSFER_H
@@ -36,21 +36,34 @@
 #include <Entry.h>
 #include <FindDirectory.h>
 #include <Locale.h>
+#include <Node.h>
+#include <Notification.h>
 #include <Path.h>
 #include <Screen.h>
 #include <UrlContext.h>
 #include <debugger.h>
 
 #include <stdio.h>
+#include <string.h>
 
+#include "BookmarkIndex.h"
+#include "BookmarkSearchWindow.h"
 #include "BrowserWindow.h"
 #include "BrowsingHistory.h"
+#include "CredentialsStorage.h"
 #include "DownloadWindow.h"
+#include "FaviconStore.h"
+#include "SessionJournal.h"
 #include "SettingsMessage.h"
+#include "ResourceMonitorWindow.h"
 #include "SettingsWindow.h"
+#include "SparePool.h"
+#include "TabSwitcherWindow.h"
 #include "ConsoleWindow.h"
 #include "CookieWindow.h"
 #include "NetworkCookieJar.h"
+#include "TaskGraph.h"
+#include "TraceLog.h"
 #include "WebKitInfo.h"
 #include "WebPage.h"
 #include "WebSettings.h"
@@ -64,6 +77,7 @@
 const char* kApplicationSignature = "application/x-vnd.Haiku-WebPositive";
 const char* kApplicationName = B_TRANSLATE_SYSTEM_NAME("WebPositive");
 static const uint32 PRELOAD_BROWSING_HISTORY = 'plbh';
+static const int32 kMaxConsoleBacklog = 500;
 
 
 BrowserApp::BrowserApp()
@@ -75,12 +89,17 @@ BrowserApp::BrowserApp()
 	fInitialized(false),
 	fSettings(NULL),
 	fCookies(NULL),
-	fSession(NULL),
 	fContext(NULL),
+	fStartupTasks(NULL),
+	fHaveStartupSession(false),
+	fDownloadsTask(-1),
 	fDownloadWindow(NULL),
 	fSettingsWindow(NULL),
 	fConsoleWindow(NULL),
-	fCookieWindow(NULL)
+	fCookieWindow(NULL),
+	fTabSwitcherWindow(NULL),
+	fBookmarkSearchWindow(NULL),
+	fResourceMonitorWindow(NULL)
 {
 #ifdef __i386__
 	// First let's check SSE2 is available
@@ -97,16 +116,8 @@ BrowserApp::BrowserApp()
 	}
 #endif
 
-	BString cookieStorePath = kApplicationName;
-	cookieStorePath << "/Cookies";
-	fCookies = new SettingsMessage(B_USER_SETTINGS_DIRECTORY,
-		cookieStorePath.String());
+	// The cookie jar is filled in by a startup task, see ReadyToRun().
 	fContext = new BPrivate::Network::BUrlContext();
-	if (fCookies->InitCheck() == B_OK) {
-		BMessage cookieArchive = fCookies->GetValue("cookies", cookieArchive);
-		fContext->SetCookieJar(
-			BPrivate::Network::BNetworkCookieJar(&cookieArchive));
-	}
 
 	BPath curlCookies;
 	if (find_directory(B_USER_SETTINGS_DIRECTORY, &curlCookies) == B_OK
@@ -115,20 +126,17 @@ BrowserApp::BrowserApp()
 
 		setenv("CURL_COOKIE_JAR_PATH", curlCookies.Path(), 0);
 	}
-
-	BString sessionStorePath = kApplicationName;
-	sessionStorePath << "/Session";
-	fSession = new SettingsMessage(B_USER_SETTINGS_DIRECTORY,
-		sessionStorePath.String());
 }
 
 
 BrowserApp::~BrowserApp()
 {
+	// Waits for the startup tasks that may still be running.
+	delete fStartupTasks;
+
 	delete fLaunchRefsMessage;
 	delete fSettings;
 	delete fCookies;
-	delete fSession;
 }
 
 
@@ -191,11 +199,25 @@ BrowserApp::ArgvReceived(int32 argc, char** argv)
 void
 BrowserApp::ReadyToRun()
 {
+	TraceSpan readySpan("startup", "ReadyToRun");
+
 	// Since we will essentially run the GUI...
 	set_thread_priority(Thread(), B_DISPLAY_PRIORITY);
 
+	// Loading the settings files is left to the startup tasks, while this
+	// thread initializes WebKit. Only what the first window needs is waited
+	// for below, the rest finishes in the background.
+	BookmarkIndex::DefaultInstance()->Start();
+
+	int32 settingsTask;
+	int32 cookiesTask;
+	int32 sessionTask;
+	_StartStartupTasks(settingsTask, cookiesTask, sessionTask);
+
+	TraceSpan webKitSpan("startup", "BWebPage::InitializeOnce");
 	BWebPage::InitializeOnce();
 	BWebPage::SetCacheModel(B_WEBKIT_CACHE_MODEL_WEB_BROWSER);
+	webKitSpan.End();
 
 	BPath path;
 	if (find_directory(B_USER_SETTINGS_DIRECTORY, &path) == B_OK
@@ -205,88 +227,46 @@ BrowserApp::ReadyToRun()
 		BWebSettings::SetPersistentStoragePath(path.Path());
 	}
 
-	BString mainSettingsPath(kApplicationName);
-	mainSettingsPath << "/Application";
-	fSettings = new SettingsMessage(B_USER_SETTINGS_DIRECTORY,
-		mainSettingsPath.String());
+	TraceSpan waitSpan("startup", "Wait for first window dependencies");
+	fStartupTasks->WaitFor(settingsTask);
+	fStartupTasks->WaitFor(cookiesTask);
+	fStartupTasks->WaitFor(sessionTask);
+	waitSpan.End();
 
 	fLastWindowFrame = fSettings->GetValue("window frame", fLastWindowFrame);
-	BRect defaultDownloadWindowFrame(-10, -10, 365, 265);
-	BRect downloadWindowFrame = fSettings->GetValue("downloads window frame",
-		defaultDownloadWindowFrame);
-	BRect settingsWindowFrame = fSettings->GetValue("settings window frame",
-		BRect());
-	BRect consoleWindowFrame = fSettings->GetValue("console window frame",
-		BRect(50, 50, 400, 300));
-	BRect cookieWindowFrame = fSettings->GetValue("cookie window frame",
-		BRect(50, 50, 400, 300));
-	bool showDownloads = fSettings->GetValue("show downloads", false);
 
-	fDownloadWindow = new DownloadWindow(downloadWindowFrame, showDownloads,
-		fSettings);
-	if (downloadWindowFrame == defaultDownloadWindowFrame) {
-		// Initially put download window in lower right of screen.
-		BRect screenFrame = BScreen().Frame();
-		BMessage decoratorSettings;
-		fDownloadWindow->GetDecoratorSettings(&decoratorSettings);
-		float borderWidth = 0;
-		if (decoratorSettings.FindFloat("border width", &borderWidth) != B_OK)
-			borderWidth = 5;
-		fDownloadWindow->MoveTo(screenFrame.Width()
-			- fDownloadWindow->Frame().Width() - borderWidth,
-			screenFrame.Height() - fDownloadWindow->Frame().Height()
-			- borderWidth);
-	}
-	fSettingsWindow = new SettingsWindow(settingsWindowFrame, fSettings);
-
-	BWebPage::SetDownloadListener(BMessenger(fDownloadWindow));
-
-	fConsoleWindow = new ConsoleWindow(consoleWindowFrame);
-	fCookieWindow = new CookieWindow(cookieWindowFrame, fContext->GetCookieJar());
-
-	fInitialized = true;
+	// The pages of the first window need the web settings.
+	SettingsWindow::ApplyWebSettings(fSettings);
 
 	int32 pagesCreated = 0;
 	bool fullscreen = false;
 
 	// Handle startup session / page
-	if (fSession->InitCheck() == B_OK) {
-		const char* kSettingsKeyStartUpPolicy = "start up policy";
-		uint32 fStartUpPolicy = fSettings->GetValue(kSettingsKeyStartUpPolicy,
-			(uint32)ResumePriorSession);
-		// If requested not to load previous session
-		if (fStartUpPolicy == StartNewSession) {
-			// Check if lauchrefs will open a page
-			if (fLaunchRefsMessage == NULL) {
-				// else open new window
-				PostMessage(NEW_WINDOW);
-			}
-		} else {
-			// otherwise, restore previous session
-			BMessage archivedWindow;
-			for (int i = 0; fSession->FindMessage("window", i, &archivedWindow)
-				== B_OK; i++) {
-				BRect frame = archivedWindow.FindRect("window frame");
-				uint32 workspaces = B_CURRENT_WORKSPACE;
-				archivedWindow.FindUInt32("window workspaces", 0, &workspaces);
-				BString url;
-				archivedWindow.FindString("tab", 0, &url);
-				BrowserWindow* window = new(std::nothrow) BrowserWindow(frame, fSettings, url,
-					fContext, INTERFACE_ELEMENT_ALL, NULL, workspaces);
-
-				if (window != NULL) {
-					window->Show();
+	TraceSpan sessionSpan("startup", "Restore session");
+	if (fHaveStartupSession) {
+		BMessage archivedWindow;
+		for (int i = 0; fStartupSession.FindMessage("window", i,
+				&archivedWindow) == B_OK; i++) {
+			BRect frame = archivedWindow.FindRect("window frame");
+			uint32 workspaces = B_CURRENT_WORKSPACE;
+			archivedWindow.FindUInt32("window workspaces", 0, &workspaces);
+			BString url;
+			archivedWindow.FindString("tab", 0, &url);
+			BrowserWindow* window = new(std::nothrow) BrowserWindow(frame, fSettings, url,
+				fContext, INTERFACE_ELEMENT_ALL, NULL, workspaces);
+
+			if (window != NULL) {
+				window->Show();
+				pagesCreated++;
+
+				for (int j = 1; archivedWindow.FindString("tab", j, &url)
+					== B_OK; j++) {
+					_CreateNewTab(window, url, false);
 					pagesCreated++;
-
-					for (int j = 1; archivedWindow.FindString("tab", j, &url)
-						== B_OK; j++) {
-						printf("Create %d:%d\n", i, j);
-						_CreateNewTab(window, url, false);
-						pagesCreated++;
-					}
 				}
 			}
 		}
+		fStartupSession.MakeEmpty();
 	}
 	// If there is fLauchRefs message,
 	if (fLaunchRefsMessage != NULL) {
@@ -299,9 +279,23 @@ BrowserApp::ReadyToRun()
 	BrowserWindow* window = _FindWindowOnCurrentWorkspace();
 	if (pagesCreated == 0 || window == NULL)
 		_CreateNewWindow("", fullscreen);
+	sessionSpan.End();
+	TraceLog::Instant("startup", "First window created");
 
-	// Asynchronously load browsing history
-	BrowsingHistory::DefaultInstance()->LoadAsync(this);
+	// The auxiliary windows are only created when they are first needed.
+	// Until then, the application stands in for the download window as
+	// the download listener, and buffers the console messages.
+	BWebPage::SetDownloadListener(BMessenger(this));
+	if (fSettings->GetValue("show downloads", false))
+		_DownloadWindow();
+
+	fInitialized = true;
+
+	// All windows of the restored session are registered now, start
+	// journaling on top of them.
+	SessionJournal::DefaultInstance()->Start();
+
+	SparePool::DefaultInstance()->Init(fSettings, fContext);
 }
 
 
@@ -319,6 +313,29 @@ BrowserApp::MessageReceived(BMessage* message)
 	case BrowsingHistory::MSG_DO_SAVE_HISTORY:
 		BrowsingHistory::DefaultInstance()->SaveImmediatelyIfNeeded();
 		break;
+	case SparePool::MSG_REPLENISH:
+		SparePool::DefaultInstance()->Replenish();
+		break;
+	case RESTORE_TAB:
+	{
+		// The web view of a discarded tab has to be created in this thread.
+		BrowserWindow* window;
+		BView* view;
+		if (message->FindPointer("window", (void**)&window) != B_OK
+			|| message->FindPointer("view", (void**)&view) != B_OK) {
+			break;
+		}
+		for (int32 i = 0; BWindow* candidate = WindowAt(i); i++) {
+			if (candidate != window)
+				continue;
+			if (window->Lock()) {
+				window->RestoreDiscardedTab(view);
+				window->Unlock();
+			}
+			break;
+		}
+		break;
+	}
 	case MSG_APP_REQUEST_DOWNLOAD:
 	{
 		BString url;
@@ -326,8 +343,11 @@ BrowserApp::MessageReceived(BMessage* message)
 		if (message->FindString("url", &url) == B_OK) {
 			message->FindString("suggested_filename", &suggestedFilename); // Optional
 			BrowserWindow* window = _FindWindowOnCurrentWorkspace();
-			if (window == NULL && CountWindows() > 0)
-				window = dynamic_cast<BrowserWindow*>(WindowAt(0));
+			for (int32 i = 0; window == NULL && i < CountWindows(); i++) {
+				window = dynamic_cast<BrowserWindow*>(WindowAt(i));
+				if (window != NULL && window->IsSpare())
+					window = NULL;
+			}
 
 			if (window) {
 				BMessage triggerMsg(BrowserWindow::MSG_WINDOW_TRIGGER_DOWNLOAD);
@@ -355,6 +375,26 @@ BrowserApp::MessageReceived(BMessage* message)
 	case B_SILENT_RELAUNCH:
 		_CreateNewPage("");
 		break;
+	case DUMP_TRACE:
+	{
+		BPath path;
+		status_t status = TraceLog::Dump(path);
+		BNotification notification(status == B_OK
+			? B_INFORMATION_NOTIFICATION : B_ERROR_NOTIFICATION);
+		notification.SetGroup(B_TRANSLATE("WebPositive"));
+		if (status == B_OK) {
+			notification.SetTitle(B_TRANSLATE("Trace saved"));
+			notification.SetContent(path.Leaf());
+			entry_ref ref;
+			if (get_ref_for_path(path.Path(), &ref) == B_OK)
+				notification.SetOnClickFile(&ref);
+		} else {
+			notification.SetTitle(B_TRANSLATE("Saving trace failed"));
+			notification.SetContent(strerror(status));
+		}
+		notification.Send();
+		break;
+	}
 	case NEW_WINDOW: {
 		BString url;
 		if (message->FindString("url", &url) != B_OK)
@@ -376,32 +416,81 @@ BrowserApp::MessageReceived(BMessage* message)
 	}
 	case WINDOW_OPENED:
 		fWindowCount++;
-		fDownloadWindow->SetMinimizeOnClose(false);
+		if (fDownloadWindow != NULL)
+			fDownloadWindow->SetMinimizeOnClose(false);
 		break;
 	case WINDOW_CLOSED:
 		fWindowCount--;
 		message->FindRect("window frame", &fLastWindowFrame);
 		if (fWindowCount <= 0) {
+			// The last window stays in the session journal, so that it is
+			// restored on the next start.
 			BMessage* message = new BMessage(B_QUIT_REQUESTED);
 			message->AddMessage("window", DetachCurrentMessage());
 			PostMessage(message);
+		} else {
+			SessionJournal::DefaultInstance()->WindowClosed(
+				message->GetUInt32("session id", 0));
 		}
 		break;
 
 	case SHOW_DOWNLOAD_WINDOW:
-		_ShowWindow(message, fDownloadWindow);
+		_ShowWindow(message, _DownloadWindow());
 		break;
 	case SHOW_SETTINGS_WINDOW:
-		_ShowWindow(message, fSettingsWindow);
+		_ShowWindow(message, _SettingsWindow());
 		break;
 	case SHOW_CONSOLE_WINDOW:
-		_ShowWindow(message, fConsoleWindow);
+		_ShowWindow(message, _ConsoleWindow());
 		break;
 	case SHOW_COOKIE_WINDOW:
-		_ShowWindow(message, fCookieWindow);
+		_ShowWindow(message, _CookieWindow());
+		break;
+	case SHOW_RESOURCE_MONITOR:
+		_ShowWindow(message, _ResourceMonitorWindow());
+		break;
+	case SHOW_TAB_SWITCHER:
+	{
+		TabSwitcherWindow* window = _TabSwitcherWindow();
+		if (window->Lock()) {
+			window->Reset();
+			window->Unlock();
+		}
+		_ShowWindow(message, window);
 		break;
+	}
+	case SHOW_BOOKMARK_SEARCH:
+	{
+		BookmarkSearchWindow* window = _BookmarkSearchWindow();
+		if (window->Lock()) {
+			window->Reset();
+			window->Unlock();
+		}
+		_ShowWindow(message, window);
+		break;
+	}
 	case ADD_CONSOLE_MESSAGE:
-		fConsoleWindow->PostMessage(message);
+	{
+		if (fConsoleWindow != NULL) {
+			fConsoleWindow->PostMessage(message);
+			break;
+		}
+
+		// Keep the latest messages until the console is opened.
+		type_code type;
+		int32 count;
+		if (fConsoleBacklog.GetInfo("message", &type, &count) == B_OK
+			&& count >= kMaxConsoleBacklog) {
+			fConsoleBacklog.RemoveData("message", 0);
+		}
+		fConsoleBacklog.AddMessage("message", message);
+		break;
+	}
+
+	case B_DOWNLOAD_ADDED:
+	case B_DOWNLOAD_REMOVED:
+		// The download window shows itself when a download is added.
+		_DownloadWindow()->PostMessage(message);
 		break;
 
 	default:
@@ -427,13 +516,26 @@ BrowserApp::RefsReceived(BMessage* message)
 bool
 BrowserApp::QuitRequested()
 {
-	if (fDownloadWindow->DownloadsInProgress()) {
+	// See if we got here because the last window was closed.
+	uint32 closedWindowID = 0;
+	BMessage closedWindow;
+	if (CurrentMessage() != NULL
+		&& CurrentMessage()->FindMessage("window", &closedWindow) == B_OK) {
+		closedWindowID = closedWindow.GetUInt32("session id", 0);
+	}
+
+	if (fDownloadWindow != NULL && fDownloadWindow->DownloadsInProgress()) {
 		BAlert* alert = new BAlert(B_TRANSLATE("Downloads in progress"),
 			B_TRANSLATE("There are still downloads in progress, do you really "
 			"want to quit WebPositive now?"), B_TRANSLATE("Quit"),
 			B_TRANSLATE("Continue downloads"));
 		int32 choice = alert->Go();
 		if (choice == 1) {
+			// We keep running, so the closed window is no longer part of
+			// the session.
+			if (closedWindowID != 0)
+				SessionJournal::DefaultInstance()->WindowClosed(closedWindowID);
+
 			if (fWindowCount == 0) {
 				if (fDownloadWindow->Lock()) {
 					fDownloadWindow->SetWorkspaces(1 << current_workspace());
@@ -450,62 +552,61 @@ BrowserApp::QuitRequested()
 		}
 	}
 
-	fSession->MakeEmpty();
+	SparePool::DefaultInstance()->Shutdown();
 
-	/* See if we got here because the last window is already closed.
-	 * In that case we only need to save that one, which is already archived */
-	BMessage* message = CurrentMessage();
-	BMessage windowMessage;
-
-	status_t ret = message->FindMessage("window", &windowMessage);
-	if (ret == B_OK) {
-		fSession->AddMessage("window", &windowMessage);
-	} else {
-		for (int i = 0; BWindow* window = WindowAt(i); i++) {
-			BrowserWindow* webWindow = dynamic_cast<BrowserWindow*>(window);
-			if (!webWindow)
-				continue;
-			if (!webWindow->Lock())
-				continue;
-
-			BMessage windowArchive;
-			webWindow->Archive(&windowArchive, true);
-			fSession->AddMessage("window", &windowArchive);
+	// The session journal is already up to date, so the windows can simply
+	// be closed. Closing them here is not journaled, they stay in the
+	// session.
+	for (int i = 0; BWindow* window = WindowAt(i); i++) {
+		BrowserWindow* webWindow = dynamic_cast<BrowserWindow*>(window);
+		if (!webWindow)
+			continue;
+		if (!webWindow->Lock())
+			continue;
 
-			if (webWindow->QuitRequested()) {
-				fLastWindowFrame = webWindow->WindowFrame();
-				webWindow->Quit();
-				i--;
-			} else {
-				webWindow->Unlock();
-				return false;
-			}
+		if (webWindow->QuitRequested()) {
+			fLastWindowFrame = webWindow->WindowFrame();
+			webWindow->Quit();
+			i--;
+		} else {
+			webWindow->Unlock();
+			return false;
 		}
 	}
 
+	SessionJournal::DefaultInstance()->Shutdown();
+	BookmarkIndex::DefaultInstance()->Shutdown();
+	FaviconStore::DefaultInstance()->Shutdown();
+
 	// Ensure any pending history save is performed before quitting.
 	BrowsingHistory::DefaultInstance()->SaveImmediatelyIfNeeded();
 
 	BWebPage::ShutdownOnce();
 
 	fSettings->SetValue("window frame", fLastWindowFrame);
-	if (fDownloadWindow->Lock()) {
+	// Windows that were never opened keep their stored settings.
+	if (fDownloadWindow != NULL && fDownloadWindow->Lock()) {
 		fSettings->SetValue("downloads window frame", fDownloadWindow->Frame());
 		fSettings->SetValue("show downloads", !fDownloadWindow->IsHidden());
 		fDownloadWindow->Unlock();
 	}
-	if (fSettingsWindow->Lock()) {
+	if (fSettingsWindow != NULL && fSettingsWindow->Lock()) {
 		fSettings->SetValue("settings window frame", fSettingsWindow->Frame());
 		fSettingsWindow->Unlock();
 	}
-	if (fConsoleWindow->Lock()) {
+	if (fConsoleWindow != NULL && fConsoleWindow->Lock()) {
 		fSettings->SetValue("console window frame", fConsoleWindow->Frame());
 		fConsoleWindow->Unlock();
 	}
-	if (fCookieWindow->Lock()) {
+	if (fCookieWindow != NULL && fCookieWindow->Lock()) {
 		fSettings->SetValue("cookie window frame", fCookieWindow->Frame());
 		fCookieWindow->Unlock();
 	}
+	if (fResourceMonitorWindow != NULL && fResourceMonitorWindow->Lock()) {
+		fSettings->SetValue("resource monitor window frame",
+			fResourceMonitorWindow->Frame());
+		fResourceMonitorWindow->Unlock();
+	}
 
 	BMessage cookieArchive;
 	BPrivate::Network::BNetworkCookieJar& cookieJar = fContext->GetCookieJar();
@@ -572,7 +673,8 @@ BrowserApp::_FindWindowOnCurrentWorkspace()
 			continue;
 
 		if (webWindow->Lock()) {
-			if (webWindow->Workspaces() & workspace)
+			if ((webWindow->Workspaces() & workspace) != 0
+				&& !webWindow->IsSpare())
 				windowOnCurrentWorkspace = webWindow;
 			webWindow->Unlock();
 			if (windowOnCurrentWorkspace)
@@ -639,8 +741,16 @@ BrowserApp::_CreateNewWindow(const BString& url, bool fullscreen)
 	if (!BScreen().Frame().Contains(fLastWindowFrame))
 		fLastWindowFrame.OffsetTo(50, 50);
 
-	BrowserWindow* window = new BrowserWindow(fLastWindowFrame, fSettings,
-		url, fContext);
+	BrowserWindow* window = SparePool::DefaultInstance()->TakeWindow();
+	if (window != NULL && window->Lock()) {
+		window->ActivateSpare(fLastWindowFrame, url);
+		if (fullscreen)
+			window->ToggleFullscreen();
+		window->Unlock();
+		return window;
+	}
+
+	window = new BrowserWindow(fLastWindowFrame, fSettings, url, fContext);
 	if (fullscreen)
 		window->ToggleFullscreen();
 	window->Show();
@@ -673,6 +783,272 @@ BrowserApp::_ShowWindow(const BMessage* message, BWindow* window)
 }
 
 
+DownloadWindow*
+BrowserApp::_DownloadWindow()
+{
+	if (fDownloadWindow != NULL)
+		return fDownloadWindow;
+
+	TraceSpan span("ui", "Create download window");
+	BRect defaultDownloadWindowFrame(-10, -10, 365, 265);
+	BRect downloadWindowFrame = fSettings->GetValue("downloads window frame",
+		defaultDownloadWindowFrame);
+	bool showDownloads = fSettings->GetValue("show downloads", false);
+
+	// Use the list of downloads read on start up, if it is ready.
+	const BMessage* downloads = NULL;
+	if (fStartupTasks->WaitFor(fDownloadsTask) == B_OK)
+		downloads = &fStartupDownloads;
+	fDownloadWindow = new DownloadWindow(downloadWindowFrame, showDownloads,
+		fSettings, fContext, downloads);
+	fStartupDownloads.MakeEmpty();
+
+	if (downloadWindowFrame == defaultDownloadWindowFrame) {
+		// Initially put download window in lower right of screen.
+		BRect screenFrame = BScreen().Frame();
+		BMessage decoratorSettings;
+		fDownloadWindow->GetDecoratorSettings(&decoratorSettings);
+		float borderWidth = 0;
+		if (decoratorSettings.FindFloat("border width", &borderWidth) != B_OK)
+			borderWidth = 5;
+		fDownloadWindow->MoveTo(screenFrame.Width()
+			- fDownloadWindow->Frame().Width() - borderWidth,
+			screenFrame.Height() - fDownloadWindow->Frame().Height()
+			- borderWidth);
+	}
+	return fDownloadWindow;
+}
+
+
+SettingsWindow*
+BrowserApp::_SettingsWindow()
+{
+	if (fSettingsWindow == NULL) {
+		TraceSpan span("ui", "Create settings window");
+		fSettingsWindow = new SettingsWindow(
+			fSettings->GetValue("settings window frame", BRect()), fSettings);
+	}
+	return fSettingsWindow;
+}
+
+
+ConsoleWindow*
+BrowserApp::_ConsoleWindow()
+{
+	if (fConsoleWindow != NULL)
+		return fConsoleWindow;
+
+	TraceSpan span("ui", "Create console window");
+	fConsoleWindow = new ConsoleWindow(fSettings->GetValue(
+		"console window frame", BRect(50, 50, 400, 300)));
+
+	BMessage message;
+	for (int32 i = 0; fConsoleBacklog.FindMessage("message", i, &message)
+			== B_OK; i++) {
+		fConsoleWindow->PostMessage(&message);
+	}
+	fConsoleBacklog.MakeEmpty();
+
+	return fConsoleWindow;
+}
+
+
+CookieWindow*
+BrowserApp::_CookieWindow()
+{
+	if (fCookieWindow == NULL) {
+		TraceSpan span("ui", "Create cookie window");
+		fCookieWindow = new CookieWindow(fSettings->GetValue(
+			"cookie window frame", BRect(50, 50, 400, 300)),
+			fContext->GetCookieJar());
+	}
+	return fCookieWindow;
+}
+
+
+ResourceMonitorWindow*
+BrowserApp::_ResourceMonitorWindow()
+{
+	if (fResourceMonitorWindow == NULL) {
+		TraceSpan span("ui", "Create resource monitor window");
+		fResourceMonitorWindow = new ResourceMonitorWindow(fSettings->GetValue(
+			"resource monitor window frame", BRect(50, 50, 650, 400)));
+	}
+	return fResourceMonitorWindow;
+}
+
+
+TabSwitcherWindow*
+BrowserApp::_TabSwitcherWindow()
+{
+	if (fTabSwitcherWindow == NULL) {
+		TraceSpan span("ui", "Create tab switcher window");
+		fTabSwitcherWindow = new TabSwitcherWindow();
+	}
+	return fTabSwitcherWindow;
+}
+
+
+BookmarkSearchWindow*
+BrowserApp::_BookmarkSearchWindow()
+{
+	if (fBookmarkSearchWindow == NULL) {
+		TraceSpan span("ui", "Create bookmark search window");
+		fBookmarkSearchWindow = new BookmarkSearchWindow();
+	}
+	return fBookmarkSearchWindow;
+}
+
+
+/*!	Sets up the startup task graph and starts running it. Loading the
+	session depends on the settings, since it is skipped entirely when a new
+	session is requested. The others are independent of each other.
+*/
+void
+BrowserApp::_StartStartupTasks(int32& settingsTask, int32& cookiesTask,
+	int32& sessionTask)
+{
+	fStartupTasks = new TaskGraph("startup tasks");
+
+	settingsTask = fStartupTasks->AddTask("Load settings", _LoadSettingsTask,
+		this);
+	cookiesTask = fStartupTasks->AddTask("Unarchive cookies",
+		_LoadCookiesTask, this);
+	sessionTask = fStartupTasks->AddTask("Load session", _LoadSessionTask,
+		this);
+	fStartupTasks->AddDependency(sessionTask, settingsTask);
+	fDownloadsTask = fStartupTasks->AddTask("Load downloads list",
+		_LoadDownloadsTask, this);
+	fStartupTasks->AddTask("Load credentials", _LoadCredentialsTask, this);
+	int32 historyTask = fStartupTasks->AddTask("Load browsing history",
+		_LoadHistoryTask, this);
+	fStartupTasks->SetCompletionMessage(historyTask, BMessenger(this),
+		BMessage(BrowsingHistory::MSG_HISTORY_LOADED));
+	fStartupTasks->AddTask("Index bookmarks", _IndexBookmarksTask, this);
+
+	if (fStartupTasks->Start() != B_OK) {
+		// Without the workers, WaitFor() does not block. Load what is
+		// needed right here, the download window reads its list itself.
+		_LoadSettingsTask(this);
+		_LoadCookiesTask(this);
+		_LoadSessionTask(this);
+		BrowsingHistory::DefaultInstance()->LoadAsync(this);
+	}
+}
+
+
+/*static*/ status_t
+BrowserApp::_LoadSettingsTask(void* cookie)
+{
+	BrowserApp* app = static_cast<BrowserApp*>(cookie);
+
+	BString mainSettingsPath(kApplicationName);
+	mainSettingsPath << "/Application";
+	app->fSettings = new SettingsMessage(B_USER_SETTINGS_DIRECTORY,
+		mainSettingsPath.String());
+	return app->fSettings->InitCheck();
+}
+
+
+/*static*/ status_t
+BrowserApp::_LoadCookiesTask(void* cookie)
+{
+	BrowserApp* app = static_cast<BrowserApp*>(cookie);
+
+	BString cookieStorePath = kApplicationName;
+	cookieStorePath << "/Cookies";
+	app->fCookies = new SettingsMessage(B_USER_SETTINGS_DIRECTORY,
+		cookieStorePath.String());
+	status_t status = app->fCookies->InitCheck();
+	if (status != B_OK)
+		return status;
+
+	BMessage cookieArchive = app->fCookies->GetValue("cookies", cookieArchive);
+	app->fContext->SetCookieJar(
+		BPrivate::Network::BNetworkCookieJar(&cookieArchive));
+	return B_OK;
+}
+
+
+/*static*/ status_t
+BrowserApp::_LoadSessionTask(void* cookie)
+{
+	BrowserApp* app = static_cast<BrowserApp*>(cookie);
+
+	const char* kSettingsKeyStartUpPolicy = "start up policy";
+	uint32 startUpPolicy = app->fSettings->GetValue(kSettingsKeyStartUpPolicy,
+		(uint32)ResumePriorSession);
+	if (startUpPolicy == StartNewSession)
+		return B_OK;
+
+	if (SessionJournal::DefaultInstance()->Load(app->fStartupSession)
+			== B_OK) {
+		app->fHaveStartupSession = true;
+		return B_OK;
+	}
+
+	// No journal yet, fall back to the session archive written by previous
+	// versions.
+	BString sessionStorePath = kApplicationName;
+	sessionStorePath << "/Session";
+	SettingsMessage legacySession(B_USER_SETTINGS_DIRECTORY,
+		sessionStorePath.String());
+	status_t status = legacySession.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	app->fStartupSession = legacySession;
+	app->fHaveStartupSession = true;
+	return B_OK;
+}
+
+
+/*static*/ status_t
+BrowserApp::_LoadDownloadsTask(void* cookie)
+{
+	BrowserApp* app = static_cast<BrowserApp*>(cookie);
+	return DownloadWindow::ReadDownloads(app->fStartupDownloads);
+}
+
+
+/*static*/ status_t
+BrowserApp::_LoadCredentialsTask(void* cookie)
+{
+	// The persistent storage loads its file on first access, get that out of
+	// the way before the first page asks for a password.
+	CredentialsStorage::PersistentInstance();
+	return B_OK;
+}
+
+
+/*static*/ status_t
+BrowserApp::_LoadHistoryTask(void* cookie)
+{
+	BrowsingHistory::DefaultInstance()->Load();
+	return B_OK;
+}
+
+
+/*static*/ status_t
+BrowserApp::_IndexBookmarksTask(void* cookie)
+{
+	// Besides filling the index, reading every bookmark file with its
+	// attributes here gets them into the file cache, so building the
+	// bookmark bar and menu in the window threads does not wait for the
+	// disk either.
+	BPath path;
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+	if (status == B_OK)
+		status = path.Append(kApplicationName);
+	if (status == B_OK)
+		status = path.Append("Bookmarks");
+	if (status != B_OK)
+		return status;
+
+	return BookmarkIndex::DefaultInstance()->Build(path);
+}
+
+
 // #pragma mark -
 
 
@@ -680,8 +1056,10 @@ int
 main(int, char**)
 {
 	try {
+		TraceLog::Instant("startup", "main");
 		new BrowserApp();
 		be_app->Run();
+		TraceLog::DumpIfRequested();
 		delete be_app;
 	} catch (...) {
 		debugger("Exception caught.");
@@ -39,9 +39,13 @@
 class ConsoleWindow;
 class CookieWindow;
 class DownloadWindow;
+class BookmarkSearchWindow;
 class BrowserWindow;
 class SettingsMessage;
+class ResourceMonitorWindow;
 class SettingsWindow;
+class TabSwitcherWindow;
+class TaskGraph;
 
 
 class BrowserApp : public BApplication {
@@ -77,6 +81,24 @@ private:
 			void				_ShowWindow(const BMessage* message,
 									BWindow* window);
 
+			DownloadWindow*		_DownloadWindow();
+			SettingsWindow*		_SettingsWindow();
+			ConsoleWindow*		_ConsoleWindow();
+			CookieWindow*		_CookieWindow();
+			TabSwitcherWindow*	_TabSwitcherWindow();
+			BookmarkSearchWindow* _BookmarkSearchWindow();
+			ResourceMonitorWindow* _ResourceMonitorWindow();
+
+			void				_StartStartupTasks(int32& settingsTask,
+									int32& cookiesTask, int32& sessionTask);
+	static	status_t			_LoadSettingsTask(void* cookie);
+	static	status_t			_LoadCookiesTask(void* cookie);
+	static	status_t			_LoadSessionTask(void* cookie);
+	static	status_t			_LoadDownloadsTask(void* cookie);
+	static	status_t			_LoadCredentialsTask(void* cookie);
+	static	status_t			_LoadHistoryTask(void* cookie);
+	static	status_t			_IndexBookmarksTask(void* cookie);
+
 private:
 			int					fWindowCount;
 			BRect				fLastWindowFrame;
@@ -85,13 +107,22 @@ private:
 
 			SettingsMessage*	fSettings;
 			SettingsMessage*	fCookies;
-			SettingsMessage*	fSession;
 			BReference<BPrivate::Network::BUrlContext>	fContext;
 
+			TaskGraph*			fStartupTasks;
+			BMessage			fStartupSession;
+			bool				fHaveStartupSession;
+			int32				fDownloadsTask;
+			BMessage			fStartupDownloads;
+
 			DownloadWindow*		fDownloadWindow;
 			SettingsWindow*		fSettingsWindow;
 			ConsoleWindow*		fConsoleWindow;
 			CookieWindow*		fCookieWindow;
+			TabSwitcherWindow*	fTabSwitcherWindow;
+			BookmarkSearchWindow* fBookmarkSearchWindow;
+			ResourceMonitorWindow* fResourceMonitorWindow;
+			BMessage			fConsoleBacklog;
 };
 
 
@@ -65,6 +65,7 @@
 #include <Size.h>
 #include <SpaceLayoutItem.h>
 #include <StatusBar.h>
+#include <StringList.h>
 #include <StringView.h>
 #include <TextControl.h>
 #include <UnicodeChar.h>
@@ -77,14 +78,22 @@
 #include "BaseURL.h"
 #include "BitmapButton.h"
 #include "BookmarkBar.h"
+#include "BookmarkIndex.h"
+#include "BookmarkTransfer.h"
 #include "BrowserApp.h"
 #include "BrowsingHistory.h"
 #include "CredentialsStorage.h"
+#include "FaviconStore.h"
 #include "IconButton.h"
+#include "MemoryPressure.h"
 #include "NavMenu.h"
 #include "SettingsKeys.h"
+#include "SessionJournal.h"
 #include "SettingsMessage.h"
+#include "SparePool.h"
+#include "TabIndex.h"
 #include "TabManager.h"
+#include "TraceLog.h"
 #include "URLInputGroup.h"
 #include "WebPage.h"
 #include "WebView.h"
@@ -114,6 +123,10 @@ enum {
 
 	CREATE_BOOKMARK								= 'crbm',
 	SHOW_BOOKMARKS								= 'shbm',
+	IMPORT_BOOKMARKS							= 'imbm',
+	EXPORT_BOOKMARKS							= 'exbm',
+	IMPORT_BOOKMARKS_FILE						= 'imbf',
+	EXPORT_BOOKMARKS_FILE						= 'exbf',
 
 	ZOOM_FACTOR_INCREASE						= 'zfin',
 	ZOOM_FACTOR_DECREASE						= 'zfdc',
@@ -134,6 +147,20 @@ enum {
 
 	SELECT_TAB									= 'sltb',
 	CYCLE_TABS									= 'ctab',
+
+	CHECK_DISCARDABLE_TABS						= 'cdtb',
+	APPLY_PAGE_UPDATES							= 'apup',
+	PAGE_ICON_LOADED							= 'pilo',
+};
+
+
+// Fields of a BrowserWindow::PendingPageUpdate
+enum {
+	PAGE_UPDATE_TITLE			= 1 << 0,
+	PAGE_UPDATE_ICON			= 1 << 1,
+	PAGE_UPDATE_PROGRESS		= 1 << 2,
+	PAGE_UPDATE_STATUS			= 1 << 3,
+	PAGE_UPDATE_NAVIGATION		= 1 << 4,
 };
 
 
@@ -152,6 +179,20 @@ static const char* kHandledProtocols[] = {
 
 static const char* kBookmarkBarSubdir = "Bookmark bar";
 
+static const bigtime_t kDiscardCheckInterval = 60000000;
+static const bigtime_t kLowMemoryDiscardAfter = 60000000;
+	// When memory is low, any tab unused for this long is discarded.
+static const bigtime_t kPageUpdateInterval = 16667;
+	// One frame at 60 Hz, page notifications are shown at most this often.
+
+int32 BrowserWindow::sDiscardedTabCount = 0;
+int32 BrowserWindow::sReloadedTabCount = 0;
+int32 BrowserWindow::sBackgroundTabCount = 0;
+int64 BrowserWindow::sBackgroundSinceSum = 0;
+int64 BrowserWindow::sBackgroundTime = 0;
+int64 BrowserWindow::sSkippedUpdateCount = 0;
+
+
 static BLayoutItem*
 layoutItemFor(BView* view)
 {
@@ -165,7 +206,8 @@ class BookmarkMenu : public BNavMenu {
 public:
 	BookmarkMenu(const char* title, BHandler* target, const entry_ref* navDir)
 		:
-		BNavMenu(title, B_REFS_RECEIVED, target)
+		BNavMenu(title, B_REFS_RECEIVED, target),
+		fGeneration(-1)
 	{
 		// Add these items here already, so the shortcuts work even when
 		// the menu has never been opened yet.
@@ -176,6 +218,16 @@ public:
 
 	virtual void AttachedToWindow()
 	{
+		// The items built last time are kept as long as the bookmark index
+		// has not seen any change since. Without the index, we always have
+		// to rebuild.
+		int32 generation = BookmarkIndex::DefaultInstance()->Generation();
+		if (generation >= 0 && generation == fGeneration) {
+			BNavMenu::AttachedToWindow();
+			return;
+		}
+
+		fGeneration = generation;
 		RemoveItems(0, CountItems(), true);
 		ForceRebuild();
 		BNavMenu::AttachedToWindow();
@@ -188,11 +240,20 @@ public:
 private:
 	void _AddStaticItems()
 	{
+		AddItem(new BMenuItem(B_TRANSLATE("Export bookmarks" B_UTF8_ELLIPSIS),
+			new BMessage(EXPORT_BOOKMARKS)), 0);
+		AddItem(new BMenuItem(B_TRANSLATE("Import bookmarks" B_UTF8_ELLIPSIS),
+			new BMessage(IMPORT_BOOKMARKS)), 0);
+		AddItem(new BMenuItem(B_TRANSLATE("Search bookmarks" B_UTF8_ELLIPSIS),
+			new BMessage(SHOW_BOOKMARK_SEARCH), 'K', B_SHIFT_KEY), 0);
 		AddItem(new BMenuItem(B_TRANSLATE("Manage bookmarks"),
 			new BMessage(SHOW_BOOKMARKS), 'M'), 0);
 		AddItem(new BMenuItem(B_TRANSLATE("Bookmark this page"),
 			new BMessage(CREATE_BOOKMARK), 'B'), 0);
 	}
+
+private:
+	int32 fGeneration;
 };
 
 
@@ -201,15 +262,15 @@ public:
 	PageUserData(BView* focusedView)
 		:
 		fFocusedView(focusedView),
-		fPageIcon(NULL),
 		fURLInputSelectionStart(-1),
-		fURLInputSelectionEnd(-1)
+		fURLInputSelectionEnd(-1),
+		fLastActive(system_time()),
+		fBackgroundSince(0)
 	{
 	}
 
 	~PageUserData()
 	{
-		delete fPageIcon;
 	}
 
 	void SetFocusedView(BView* focusedView)
@@ -222,18 +283,14 @@ public:
 		return fFocusedView;
 	}
 
-	void SetPageIcon(const BBitmap* icon)
+	void SetPageIcon(Favicon* icon)
 	{
-		delete fPageIcon;
-		if (icon)
-			fPageIcon = new BBitmap(icon);
-		else
-			fPageIcon = NULL;
+		fPageIcon.SetTo(icon);
 	}
 
-	const BBitmap* PageIcon() const
+	Favicon* PageIcon() const
 	{
-		return fPageIcon;
+		return fPageIcon.Get();
 	}
 
 	void SetURLInputContents(const char* text)
@@ -262,12 +319,76 @@ public:
 		return fURLInputSelectionEnd;
 	}
 
+	void SetLastActive(bigtime_t when)
+	{
+		fLastActive = when;
+	}
+
+	bigtime_t LastActive() const
+	{
+		return fLastActive;
+	}
+
+	void SetBackgroundSince(bigtime_t when)
+	{
+		fBackgroundSince = when;
+	}
+
+	bigtime_t BackgroundSince() const
+	{
+		return fBackgroundSince;
+	}
+
 private:
 	BView*		fFocusedView;
-	BBitmap*	fPageIcon;
+	BReference<Favicon> fPageIcon;
 	BString		fURLInputContents;
 	int32		fURLInputSelectionStart;
 	int32		fURLInputSelectionEnd;
+	bigtime_t	fLastActive;
+	bigtime_t	fBackgroundSince;
+};
+
+
+/*!	Stands in for the web view of a discarded tab. It keeps what is needed
+	to show the tab and to load the page again once the tab is selected.
+*/
+class DiscardedTabView : public BView {
+public:
+	DiscardedTabView(const BString& url, PageUserData* userData)
+		:
+		BView("discarded tab", 0),
+		fURL(url),
+		fUserData(userData)
+	{
+		SetViewUIColor(B_DOCUMENT_BACKGROUND_COLOR);
+	}
+
+	~DiscardedTabView()
+	{
+		delete fUserData;
+	}
+
+	const BString& URL() const
+	{
+		return fURL;
+	}
+
+	PageUserData* UserData() const
+	{
+		return fUserData;
+	}
+
+	PageUserData* DetachUserData()
+	{
+		PageUserData* userData = fUserData;
+		fUserData = NULL;
+		return userData;
+	}
+
+private:
+	BString			fURL;
+	PageUserData*	fUserData;
 };
 
 
@@ -351,7 +472,7 @@ private:
 
 BrowserWindow::BrowserWindow(BRect frame, SettingsMessage* appSettings, const BString& url,
 	BPrivate::Network::BUrlContext* context, uint32 interfaceElements, BWebView* webView,
-	uint32 workspaces)
+	uint32 workspaces, bool spare)
 	:
 	BWebWindow(frame, kApplicationName, B_DOCUMENT_WINDOW_LOOK, B_NORMAL_WINDOW_FEEL,
 		B_AUTO_UPDATE_SIZE_LIMITS | B_ASYNCHRONOUS_CONTROLS, workspaces),
@@ -359,6 +480,8 @@ BrowserWindow::BrowserWindow(BRect frame, SettingsMessage* appSettings, const BS
 	fInterfaceVisible(false),
 	fMenusRunning(false),
 	fPulseRunner(NULL),
+	fDiscardRunner(NULL),
+	fPageUpdateRunner(NULL),
 	fVisibleInterfaceElements(interfaceElements),
 	fContext(context),
 	fAppSettings(appSettings),
@@ -366,7 +489,13 @@ BrowserWindow::BrowserWindow(BRect frame, SettingsMessage* appSettings, const BS
 	fShowTabsIfSinglePageOpen(true),
 	fAutoHideInterfaceInFullscreenMode(false),
 	fAutoHidePointer(false),
-	fBookmarkBar(NULL)
+	fBookmarkBar(NULL),
+	fBookmarkImportPanel(NULL),
+	fBookmarkExportPanel(NULL),
+	fSessionID(0),
+	fIsSpare(spare),
+	fPageUpdatesScheduled(false),
+	fLastPageUpdate(0)
 {
 	// Begin listening to settings changes and read some current values.
 	fAppSettings->AddListener(BMessenger(this));
@@ -412,6 +541,8 @@ BrowserWindow::BrowserWindow(BRect frame, SettingsMessage* appSettings, const BS
 	newItem->SetTarget(be_app);
 	menu->AddItem(new BMenuItem(B_TRANSLATE("Open location"),
 		new BMessage(OPEN_LOCATION), 'L'));
+	menu->AddItem(new BMenuItem(B_TRANSLATE("Switch to tab" B_UTF8_ELLIPSIS),
+		new BMessage(SHOW_TAB_SWITCHER), 'K'));
 	menu->AddSeparatorItem();
 	menu->AddItem(new BMenuItem(B_TRANSLATE("Close window"),
 		new BMessage(B_QUIT_REQUESTED), 'W', B_SHIFT_KEY));
@@ -428,6 +559,8 @@ BrowserWindow::BrowserWindow(BRect frame, SettingsMessage* appSettings, const BS
 		new BMessage(SHOW_COOKIE_WINDOW)));
 	menu->AddItem(new BMenuItem(B_TRANSLATE("Script console"),
 		new BMessage(SHOW_CONSOLE_WINDOW)));
+	menu->AddItem(new BMenuItem(B_TRANSLATE("Resource monitor"),
+		new BMessage(SHOW_RESOURCE_MONITOR)));
 	BMenuItem* aboutItem = new BMenuItem(B_TRANSLATE("About"),
 		new BMessage(B_ABOUT_REQUESTED));
 	menu->AddItem(aboutItem);
@@ -665,6 +798,12 @@ BrowserWindow::BrowserWindow(BRect frame, SettingsMessage* appSettings, const BS
 	fFindGroup->SetVisible(false);
 	fToggleFullscreenButton->SetVisible(false);
 
+	// Spare windows are only added to the session once they are used.
+	if (!fIsSpare) {
+		fSessionID = SessionJournal::DefaultInstance()->WindowOpened(Frame(),
+			Workspaces());
+	}
+
 	CreateNewTab(url, true, webView);
 	_ShowInterface(true);
 	_SetAutoHideInterfaceInFullscreen(fAppSettings->GetValue(
@@ -688,6 +827,9 @@ BrowserWindow::BrowserWindow(BRect frame, SettingsMessage* appSettings, const BS
 	// Add shortcut to cycle through tabs like in every other web browser
 	AddShortcut(B_TAB, B_COMMAND_KEY, new BMessage(CYCLE_TABS));
 
+	AddShortcut('T', B_COMMAND_KEY | B_OPTION_KEY | B_SHIFT_KEY,
+		new BMessage(DUMP_TRACE));
+
 	BKeymap keymap;
 	keymap.SetToCurrent();
 	BStringList unmodified(3);
@@ -705,7 +847,12 @@ BrowserWindow::BrowserWindow(BRect frame, SettingsMessage* appSettings, const BS
 	}
 	unmodified.MakeEmpty();
 
-	be_app->PostMessage(WINDOW_OPENED);
+	BMessage checkDiscardable(CHECK_DISCARDABLE_TABS);
+	fDiscardRunner = new BMessageRunner(BMessenger(this), &checkDiscardable,
+		kDiscardCheckInterval);
+
+	if (!fIsSpare)
+		be_app->PostMessage(WINDOW_OPENED);
 }
 
 
@@ -714,7 +861,11 @@ BrowserWindow::~BrowserWindow()
 	fAppSettings->RemoveListener(BMessenger(this));
 	delete fTabManager;
 	delete fPulseRunner;
+	delete fDiscardRunner;
+	delete fPageUpdateRunner;
 	delete fSavePanel;
+	delete fBookmarkImportPanel;
+	delete fBookmarkExportPanel;
 }
 
 
@@ -915,6 +1066,23 @@ BrowserWindow::MessageReceived(BMessage* message)
 			_ShowBookmarks();
 			break;
 
+		case IMPORT_BOOKMARKS:
+			_ImportBookmarks();
+			break;
+
+		case EXPORT_BOOKMARKS:
+			_ExportBookmarks();
+			break;
+
+		case IMPORT_BOOKMARKS_FILE:
+		case EXPORT_BOOKMARKS_FILE:
+			_TransferBookmarks(message);
+			break;
+
+		case BookmarkTransfer::MSG_BOOKMARK_TRANSFER_DONE:
+			_BookmarkTransferDone(message);
+			break;
+
 		case B_REFS_RECEIVED:
 		{
 			// Currently the only source of these messages is the bookmarks
@@ -932,9 +1100,19 @@ BrowserWindow::MessageReceived(BMessage* message)
 					_AddBookmarkURLsRecursively(directory, message,
 						addedSubCount);
 				} else {
-					BFile file(&ref, B_READ_ONLY);
+					node_ref node;
 					BString url;
-					if (_ReadURLAttr(file, url)) {
+					status_t status = entry.GetNodeRef(&node);
+					if (status == B_OK) {
+						status = BookmarkIndex::DefaultInstance()->GetURL(node,
+							url);
+					}
+					if (status == B_NO_INIT) {
+						BFile file(&ref, B_READ_ONLY);
+						if (_ReadURLAttr(file, url))
+							status = B_OK;
+					}
+					if (status == B_OK) {
 						message->AddString("url", url.String());
 						addedSubCount++;
 					}
@@ -1120,20 +1298,38 @@ BrowserWindow::MessageReceived(BMessage* message)
 		case SHOW_SETTINGS_WINDOW:
 		case SHOW_CONSOLE_WINDOW:
 		case SHOW_COOKIE_WINDOW:
+		case SHOW_TAB_SWITCHER:
+		case SHOW_BOOKMARK_SEARCH:
+		case SHOW_RESOURCE_MONITOR:
 			message->AddUInt32("workspaces", Workspaces());
 			be_app->PostMessage(message);
 			break;
 
+		case DUMP_TRACE:
+			be_app->PostMessage(message);
+			break;
+
 		case CLOSE_TAB:
+		{
+			int32 index;
+			BView* view;
+			if (message->FindPointer("tab", (void**)&view) == B_OK) {
+				// Sent from outside the window, the tab may be gone.
+				index = fTabManager->TabForView(view);
+				if (index < 0)
+					break;
+			} else if (message->FindInt32("tab index", &index) != B_OK)
+				index = fTabManager->SelectedTabIndex();
+
 			if (fTabManager->CountTabs() > 1) {
-				int32 index;
-				if (message->FindInt32("tab index", &index) != B_OK)
-					index = fTabManager->SelectedTabIndex();
+				SessionJournal::DefaultInstance()->TabClosed(fSessionID,
+					fTabManager->ViewForTab(index));
 				_ShutdownTab(index);
 				_UpdateTabGroupVisibility();
 			} else
 				PostMessage(B_QUIT_REQUESTED);
 			break;
+		}
 
 		case SELECT_TAB:
 		{
@@ -1156,6 +1352,54 @@ BrowserWindow::MessageReceived(BMessage* message)
 			break;
 		}
 
+		case CHECK_DISCARDABLE_TABS:
+			_CheckDiscardableTabs();
+			break;
+
+		case APPLY_PAGE_UPDATES:
+			_ApplyPageUpdates();
+			break;
+
+		case PAGE_ICON_LOADED:
+		{
+			BWebView* view;
+			const char* host;
+			if (message->FindPointer("view", (void**)&view) == B_OK
+				&& message->FindString("host", &host) == B_OK
+				&& fTabManager->TabForView(view) >= 0
+				&& BUrl(view->MainFrameURL()).Host() == host) {
+				_ShowKnownPageIcon(view,
+					FaviconStore::DefaultInstance()->Get(host));
+			}
+			break;
+		}
+
+		case DISCARD_TAB:
+		{
+			BView* view;
+			if (message->FindPointer("tab", (void**)&view) == B_OK) {
+				int32 index = fTabManager->TabForView(view);
+				if (index >= 0)
+					_DiscardTab(index);
+			}
+			break;
+		}
+
+		case ACTIVATE_TAB:
+		{
+			// Sent by the tab switcher, the tab may have been closed since.
+			BView* view;
+			if (message->FindPointer("tab", (void**)&view) == B_OK) {
+				int32 index = fTabManager->TabForView(view);
+				if (index >= 0 && index != fTabManager->SelectedTabIndex())
+					fTabManager->SelectTab(index);
+			}
+			if (IsMinimized())
+				Minimize(false);
+			Activate();
+			break;
+		}
+
 		case TAB_CHANGED:
 		{
 			// This message may be received also when the last tab closed,
@@ -1366,13 +1610,17 @@ BrowserWindow::Archive(BMessage* archive, bool deep) const
 		status = archive->AddUInt32("window workspaces", Workspaces());
 
 	for (int i = 0; i < fTabManager->CountTabs(); i++) {
-		BWebView* view = dynamic_cast<BWebView*>(fTabManager->ViewForTab(i));
-		if (view == NULL) {
+		BView* view = fTabManager->ViewForTab(i);
+		BString url;
+		if (BWebView* webView = dynamic_cast<BWebView*>(view))
+			url = webView->MainFrameURL();
+		else if (DiscardedTabView* tab = dynamic_cast<DiscardedTabView*>(view))
+			url = tab->URL();
+		else
 			continue;
-		}
 
 		if (status == B_OK)
-			status = archive->AddString("tab", view->MainFrameURL());
+			status = archive->AddString("tab", url);
 	}
 
 	return status;
@@ -1384,8 +1632,16 @@ BrowserWindow::QuitRequested()
 {
 	// TODO: Check for modified form data and ask user for confirmation, etc.
 
+	if (fIsSpare) {
+		// Never shown to the user, nothing to tell the application.
+		SetCurrentWebView(NULL);
+		while (fTabManager->CountTabs() > 0)
+			_ShutdownTab(0);
+		return true;
+	}
+
 	BMessage message(WINDOW_CLOSED);
-	Archive(&message);
+	message.AddUInt32("session id", fSessionID);
 
 	// Iterate over all tabs to delete all BWebViews.
 	// Do this here, so WebKit tear down happens earlier.
@@ -1415,6 +1671,24 @@ BrowserWindow::MenusEnded()
 }
 
 
+void
+BrowserWindow::FrameMoved(BPoint newPosition)
+{
+	BWebWindow::FrameMoved(newPosition);
+	SessionJournal::DefaultInstance()->WindowChanged(fSessionID,
+		WindowFrame(), Workspaces());
+}
+
+
+void
+BrowserWindow::FrameResized(float width, float height)
+{
+	BWebWindow::FrameResized(width, height);
+	SessionJournal::DefaultInstance()->WindowChanged(fSessionID,
+		WindowFrame(), Workspaces());
+}
+
+
 void
 BrowserWindow::ScreenChanged(BRect screenSize, color_space format)
 {
@@ -1428,6 +1702,9 @@ BrowserWindow::WorkspacesChanged(uint32 oldWorkspaces, uint32 newWorkspaces)
 {
 	if (fIsFullscreen)
 		_ResizeToScreen();
+
+	SessionJournal::DefaultInstance()->WindowChanged(fSessionID,
+		WindowFrame(), newWorkspaces);
 }
 
 
@@ -1463,6 +1740,7 @@ BrowserWindow::SetCurrentWebView(BWebView* webView)
 			userData = new PageUserData(CurrentFocus());
 			CurrentWebView()->SetUserData(userData);
 		}
+		userData->SetLastActive(system_time());
 		userData->SetFocusedView(CurrentFocus());
 		userData->SetURLInputContents(fURLInputGroup->Text());
 		int32 selectionStart;
@@ -1470,12 +1748,18 @@ BrowserWindow::SetCurrentWebView(BWebView* webView)
 		fURLInputGroup->TextView()->GetSelection(&selectionStart,
 			&selectionEnd);
 		userData->SetURLInputSelection(selectionStart, selectionEnd);
+		_SendTabToBackground(CurrentWebView());
 	}
 
+	// Take the new tab out of the background before anything else, so
+	// that none of its notifications are skipped.
+	_BringTabToForeground(webView);
+
 	BWebWindow::SetCurrentWebView(webView);
 
 	if (webView != NULL) {
 		webView->SetAutoHidePointer(fAutoHidePointer);
+		TabIndex::DefaultInstance()->TabActivated(webView);
 
 		_UpdateTitle(webView->MainFrameTitle());
 
@@ -1540,11 +1824,17 @@ BrowserWindow::CreateNewTab(const BString& _url, bool select,
 {
 	bool applyNewPagePolicy = webView == NULL;
 	// Executed in app thread (new BWebPage needs to be created in app thread).
+	if (webView == NULL)
+		webView = SparePool::DefaultInstance()->TakeWebView();
 	if (webView == NULL)
 		webView = new BWebView("web view", fContext);
 
 	bool isNewWindow = fTabManager->CountTabs() == 0;
 
+	// Background tabs are discarded based on the time they were last used.
+	if (webView->GetUserData() == NULL)
+		webView->SetUserData(new PageUserData(NULL));
+
 	fTabManager->AddTab(webView, B_TRANSLATE("New tab"));
 
 	BString url(_url);
@@ -1554,6 +1844,12 @@ BrowserWindow::CreateNewTab(const BString& _url, bool select,
 	if (url.Length() > 0)
 		webView->LoadURL(url.String());
 
+	if (!fIsSpare) {
+		SessionJournal::DefaultInstance()->TabOpened(fSessionID, webView,
+			fTabManager->TabForView(webView), url);
+		TabIndex::DefaultInstance()->TabOpened(BMessenger(this), webView, url);
+	}
+
 	if (select) {
 		fTabManager->SelectTab(fTabManager->CountTabs() - 1);
 		SetCurrentWebView(webView);
@@ -1561,13 +1857,141 @@ BrowserWindow::CreateNewTab(const BString& _url, bool select,
 		fURLInputGroup->SetPageIcon(NULL);
 		fURLInputGroup->SetText(url.String());
 		fURLInputGroup->MakeFocus(true);
-	}
+	} else
+		_SendTabToBackground(webView);
 
 	_ShowInterface(true);
 	_UpdateTabGroupVisibility();
 }
 
 
+/*!	Loads the page of a tab that was discarded by _DiscardTab() again.
+	Must be called from the application thread with the window locked, since
+	the new web view has to be created there.
+*/
+void
+BrowserWindow::RestoreDiscardedTab(BView* placeholder)
+{
+	// The tab may have been closed since the restore was requested, only
+	// look at the placeholder while it is still there.
+	int32 index = fTabManager->TabForView(placeholder);
+	if (index < 0)
+		return;
+	DiscardedTabView* tab = dynamic_cast<DiscardedTabView*>(placeholder);
+	if (tab == NULL)
+		return;
+
+	TraceSpan span("tabs", "Restore discarded tab");
+
+	BWebView* webView = SparePool::DefaultInstance()->TakeWebView();
+	if (webView == NULL)
+		webView = new BWebView("web view", fContext);
+
+	PageUserData* userData = tab->DetachUserData();
+	if (userData != NULL) {
+		userData->SetLastActive(system_time());
+		webView->SetUserData(userData);
+	}
+
+	fTabManager->ReplaceView(index, webView);
+	SessionJournal::DefaultInstance()->TabReplaced(fSessionID, tab, webView);
+	TabIndex::DefaultInstance()->TabReplaced(tab, webView);
+
+	webView->LoadURL(tab->URL().String());
+	delete tab;
+
+	if (fTabManager->SelectedTabIndex() == index)
+		SetCurrentWebView(webView);
+	else
+		_SendTabToBackground(webView);
+
+	atomic_add(&sReloadedTabCount, 1);
+}
+
+
+/*!	Returns how many tabs have been discarded since the application
+	started.
+*/
+/*static*/ int32
+BrowserWindow::DiscardedTabCount()
+{
+	return atomic_get(&sDiscardedTabCount);
+}
+
+
+/*!	Returns how many discarded tabs have been loaded again since the
+	application started.
+*/
+/*static*/ int32
+BrowserWindow::ReloadedTabCount()
+{
+	return atomic_get(&sReloadedTabCount);
+}
+
+
+/*!	Returns the time all tabs together have spent in the background since
+	the application started.
+*/
+/*static*/ bigtime_t
+BrowserWindow::BackgroundTime()
+{
+	// The tabs that are still in the background are accounted for by how
+	// long ago they were sent there on average.
+	bigtime_t running = (bigtime_t)atomic_get(&sBackgroundTabCount)
+		* system_time() - atomic_get64(&sBackgroundSinceSum);
+	return atomic_get64(&sBackgroundTime) + running;
+}
+
+
+/*!	Returns how many page notifications of background tabs the windows
+	did not show since the application started.
+*/
+/*static*/ int64
+BrowserWindow::SkippedUpdateCount()
+{
+	return atomic_get64(&sSkippedUpdateCount);
+}
+
+
+/*!	Turns a spare window from the SparePool into a regular one, and shows
+	it. Must be called from the application thread with the window locked.
+*/
+void
+BrowserWindow::ActivateSpare(BRect frame, const BString& _url)
+{
+	if (!fIsSpare)
+		return;
+	fIsSpare = false;
+
+	MoveTo(frame.LeftTop());
+	ResizeTo(frame.Width(), frame.Height());
+	SetWorkspaces(B_CURRENT_WORKSPACE);
+
+	fSessionID = SessionJournal::DefaultInstance()->WindowOpened(Frame(),
+		Workspaces());
+
+	// The spare was built with a blank tab, apply the new window policy now.
+	BString url(_url);
+	if (url.Length() == 0)
+		url = _NewTabURL(true);
+
+	BWebView* webView = CurrentWebView();
+	if (url.Length() > 0)
+		webView->LoadURL(url.String());
+	SessionJournal::DefaultInstance()->TabOpened(fSessionID, webView,
+		fTabManager->TabForView(webView), url);
+	TabIndex::DefaultInstance()->TabOpened(BMessenger(this), webView, url);
+
+	fURLInputGroup->SetText(url.String());
+	fURLInputGroup->MakeFocus(true);
+
+	be_app->PostMessage(WINDOW_OPENED);
+
+	if (IsHidden())
+		Show();
+}
+
+
 BRect
 BrowserWindow::WindowFrame() const
 {
@@ -1659,6 +2083,10 @@ BrowserWindow::CloseWindowRequested(BWebView* view)
 void
 BrowserWindow::LoadNegotiating(const BString& url, BWebView* view)
 {
+	TraceLog::Instant("page", "Load negotiating", url.String());
+	TabIndex::DefaultInstance()->TabLoadStateChanged(view,
+		TabIndex::LOAD_LOADING);
+
 	if (view != CurrentWebView()) {
 		// Update the userData contents instead so the user sees
 		// the correct URL when they switch back to that tab.
@@ -1669,6 +2097,9 @@ BrowserWindow::LoadNegotiating(const BString& url, BWebView* view)
 		}
 	}
 
+	if (_SkipBackgroundUpdate(view))
+		return;
+
 	fURLInputGroup->SetText(url.String());
 
 	BString status(B_TRANSLATE("Requesting %url"));
@@ -1680,12 +2111,29 @@ BrowserWindow::LoadNegotiating(const BString& url, BWebView* view)
 void
 BrowserWindow::LoadCommitted(const BString& url, BWebView* view)
 {
-	if (view != CurrentWebView())
+	TraceLog::Instant("page", "Load committed", url.String());
+	SessionJournal::DefaultInstance()->TabNavigated(fSessionID, view, url);
+	TabIndex::DefaultInstance()->TabNavigated(view, url);
+
+	if (_SkipBackgroundUpdate(view))
 		return;
 
 	// This hook is invoked when the load is committed.
 	fURLInputGroup->SetText(url.String());
 
+	// Show the icon we know for the site until the page sends its own. If
+	// it isn't in memory, the disk cache is read in the background.
+	BString host = BUrl(url).Host();
+	BReference<Favicon> favicon = FaviconStore::DefaultInstance()->Get(host);
+	if (favicon.IsSet())
+		_ShowKnownPageIcon(view, favicon);
+	else {
+		BMessage message(PAGE_ICON_LOADED);
+		message.AddPointer("view", view);
+		FaviconStore::DefaultInstance()->Load(host, BMessenger(this),
+			message);
+	}
+
 	BString status(B_TRANSLATE("Loading %url"));
 	status.ReplaceFirst("%url", url);
 	view->WebPage()->SetStatusMessage(status);
@@ -1695,27 +2143,34 @@ BrowserWindow::LoadCommitted(const BString& url, BWebView* view)
 void
 BrowserWindow::LoadProgress(float progress, BWebView* view)
 {
-	if (view != CurrentWebView())
+	TabIndex::DefaultInstance()->TabLoadStateChanged(view,
+		progress < 100 ? TabIndex::LOAD_LOADING : TabIndex::LOAD_FINISHED,
+		progress);
+
+	if (_SkipBackgroundUpdate(view))
 		return;
 
-	if (progress < 100 && fLoadingProgressBar->IsHidden())
-		_ShowProgressBar(true);
-	else if (progress == 100 && !fLoadingProgressBar->IsHidden())
-		_ShowProgressBar(false);
-	fLoadingProgressBar->SetTo(progress);
+	PendingPageUpdate& update = _PendingPageUpdate(view);
+	update.progress = progress;
+	update.fields |= PAGE_UPDATE_PROGRESS;
 }
 
 
 void
 BrowserWindow::LoadFailed(const BString& url, BWebView* view)
 {
-	if (view != CurrentWebView())
+	TraceLog::Instant("page", "Load failed", url.String());
+	TabIndex::DefaultInstance()->TabLoadStateChanged(view,
+		TabIndex::LOAD_FAILED);
+
+	if (_SkipBackgroundUpdate(view))
 		return;
 
 	BString status(B_TRANSLATE_COMMENT("%url failed", "Loading URL failed. "
 		"Don't translate variable %url."));
 	status.ReplaceFirst("%url", url);
 	view->WebPage()->SetStatusMessage(status);
+	_PendingPageUpdate(view).fields &= ~PAGE_UPDATE_PROGRESS;
 	if (!fLoadingProgressBar->IsHidden())
 		fLoadingProgressBar->Hide();
 }
@@ -1724,7 +2179,11 @@ BrowserWindow::LoadFailed(const BString& url, BWebView* view)
 void
 BrowserWindow::LoadFinished(const BString& url, BWebView* view)
 {
-	if (view != CurrentWebView())
+	TraceLog::Instant("page", "Load finished", url.String());
+	TabIndex::DefaultInstance()->TabLoadStateChanged(view,
+		TabIndex::LOAD_FINISHED, 100);
+
+	if (_SkipBackgroundUpdate(view))
 		return;
 
 	fURLInputGroup->SetText(url.String());
@@ -1736,8 +2195,15 @@ BrowserWindow::LoadFinished(const BString& url, BWebView* view)
 	if (!fLoadingProgressBar->IsHidden())
 		fLoadingProgressBar->Hide();
 
-	NavigationCapabilitiesChanged(fBackButton->IsEnabled(),
-		fForwardButton->IsEnabled(), false, view);
+	// Progress that is still waiting to be shown would bring the bar back.
+	PendingPageUpdate& pending = _PendingPageUpdate(view);
+	pending.fields &= ~PAGE_UPDATE_PROGRESS;
+	if ((pending.fields & PAGE_UPDATE_NAVIGATION) == 0) {
+		pending.canGoBackward = fBackButton->IsEnabled();
+		pending.canGoForward = fForwardButton->IsEnabled();
+		pending.fields |= PAGE_UPDATE_NAVIGATION;
+	}
+	pending.canStop = false;
 
 	int32 tabIndex = fTabManager->TabForView(view);
 	if (tabIndex > 0 && strcmp(B_TRANSLATE("New tab"),
@@ -1788,12 +2254,12 @@ BrowserWindow::TitleChanged(const BString& title, BWebView* view)
 	if (tabIndex < 0)
 		return;
 
-	fTabManager->SetTabLabel(tabIndex, title);
+	TabIndex::DefaultInstance()->TabTitleChanged(view, title);
 
-	if (view != CurrentWebView())
-		return;
-
-	_UpdateTitle(title);
+	// The tab label is updated for background tabs as well.
+	PendingPageUpdate& update = _PendingPageUpdate(view);
+	update.title = title;
+	update.fields |= PAGE_UPDATE_TITLE;
 }
 
 
@@ -1893,11 +2359,12 @@ BrowserWindow::SetResizable(bool flag, BWebView* view)
 void
 BrowserWindow::StatusChanged(const BString& statusText, BWebView* view)
 {
-	if (view != CurrentWebView())
+	if (_SkipBackgroundUpdate(view))
 		return;
 
-	if (fStatusText)
-		fStatusText->SetText(statusText.String());
+	PendingPageUpdate& update = _PendingPageUpdate(view);
+	update.status = statusText;
+	update.fields |= PAGE_UPDATE_STATUS;
 }
 
 
@@ -1905,15 +2372,14 @@ void
 BrowserWindow::NavigationCapabilitiesChanged(bool canGoBackward,
 	bool canGoForward, bool canStop, BWebView* view)
 {
-	if (view != CurrentWebView())
+	if (_SkipBackgroundUpdate(view))
 		return;
 
-	fBackButton->SetEnabled(canGoBackward);
-	fForwardButton->SetEnabled(canGoForward);
-	fStopButton->SetEnabled(canStop);
-
-	fBackMenuItem->SetEnabled(canGoBackward);
-	fForwardMenuItem->SetEnabled(canGoForward);
+	PendingPageUpdate& update = _PendingPageUpdate(view);
+	update.canGoBackward = canGoBackward;
+	update.canGoForward = canGoForward;
+	update.canStop = canStop;
+	update.fields |= PAGE_UPDATE_NAVIGATION;
 }
 
 
@@ -2023,11 +2489,14 @@ void
 BrowserWindow::_ShutdownTab(int32 index)
 {
 	BView* view = fTabManager->RemoveTab(index);
+	TabIndex::DefaultInstance()->TabClosed(view);
 	BWebView* webView = dynamic_cast<BWebView*>(view);
 	if (webView == CurrentWebView())
 		SetCurrentWebView(NULL);
 
 	if (webView != NULL) {
+		_BringTabToForeground(webView);
+		fPendingPageUpdates.erase(webView);
 		// Clean up PageUserData if BWebView doesn't own it
 		PageUserData* userData = static_cast<PageUserData*>(webView->GetUserData());
 		if (userData) {
@@ -2052,7 +2521,247 @@ BrowserWindow::_ShutdownTab(int32 index)
 void
 BrowserWindow::_TabChanged(int32 index)
 {
-	SetCurrentWebView(dynamic_cast<BWebView*>(fTabManager->ViewForTab(index)));
+	BView* view = fTabManager->ViewForTab(index);
+	DiscardedTabView* tab = dynamic_cast<DiscardedTabView*>(view);
+	if (tab == NULL) {
+		SetCurrentWebView(dynamic_cast<BWebView*>(view));
+		return;
+	}
+
+	// Show what we know about the page until the application has built a
+	// new web view for it.
+	SetCurrentWebView(NULL);
+	_UpdateTitle(fTabManager->TabLabel(index));
+	PageUserData* userData = tab->UserData();
+	fURLInputGroup->SetPageIcon(userData != NULL ? userData->PageIcon() : NULL);
+	fURLInputGroup->SetText(tab->URL().String());
+
+	BMessage message(RESTORE_TAB);
+	message.AddPointer("window", this);
+	message.AddPointer("view", tab);
+	be_app->PostMessage(&message);
+}
+
+
+/*!	Discards background tabs that have not been used for the configured
+	time. When the system is low on memory, any background tab that has not
+	been used for a minute is discarded.
+*/
+void
+BrowserWindow::_CheckDiscardableTabs()
+{
+	bigtime_t threshold = (bigtime_t)fAppSettings->GetValue(
+		kSettingsKeyDiscardTabsAfter, kDefaultDiscardTabsAfter) * 60000000LL;
+	if (isLowOnMemory())
+		threshold = kLowMemoryDiscardAfter;
+	if (threshold <= 0)
+		return;
+
+	bigtime_t now = system_time();
+	int32 selected = fTabManager->SelectedTabIndex();
+	for (int32 i = 0; i < fTabManager->CountTabs(); i++) {
+		if (i == selected)
+			continue;
+
+		BWebView* webView = dynamic_cast<BWebView*>(
+			fTabManager->ViewForTab(i));
+		if (webView == NULL)
+			continue;
+
+		PageUserData* userData = static_cast<PageUserData*>(
+			webView->GetUserData());
+		if (userData != NULL && now - userData->LastActive() >= threshold)
+			_DiscardTab(i);
+	}
+}
+
+
+/*!	Replaces the web view of a background tab with a DiscardedTabView, and
+	shuts the web view down to free its memory. The page is loaded again
+	once the tab is selected.
+*/
+void
+BrowserWindow::_DiscardTab(int32 index)
+{
+	BWebView* webView = dynamic_cast<BWebView*>(fTabManager->ViewForTab(index));
+	if (webView == NULL || webView == CurrentWebView())
+		return;
+
+	BString url = webView->MainFrameURL();
+	if (url.Length() == 0)
+		return;
+
+	// Only pages count as background tabs, the placeholder has none.
+	_BringTabToForeground(webView);
+	fPendingPageUpdates.erase(webView);
+
+	PageUserData* userData = static_cast<PageUserData*>(
+		webView->GetUserData());
+	webView->SetUserData(NULL);
+	if (userData != NULL) {
+		// The focused view belongs to the web view that is going away.
+		userData->SetFocusedView(NULL);
+	}
+
+	DiscardedTabView* tab = new DiscardedTabView(url, userData);
+	fTabManager->ReplaceView(index, tab);
+	SessionJournal::DefaultInstance()->TabReplaced(fSessionID, webView, tab);
+	TabIndex::DefaultInstance()->TabReplaced(webView, tab);
+	TabIndex::DefaultInstance()->TabLoadStateChanged(tab,
+		TabIndex::LOAD_DISCARDED);
+
+	webView->Shutdown();
+
+	atomic_add(&sDiscardedTabCount, 1);
+	TraceLog::Instant("tabs", "Tab discarded", url.String());
+}
+
+
+/*!	Puts the page of a tab that is no longer shown into the background
+	state. The BWebPage interface has no way to suspend the timers, layout
+	or painting of a page; the card layout hides the web view, which stops
+	its painting, and the window skips the work it does for the page's
+	notifications until the tab is selected again, when they are all sent
+	again with BWebPage::ResendNotifications().
+*/
+void
+BrowserWindow::_SendTabToBackground(BWebView* view)
+{
+	if (view == NULL)
+		return;
+
+	PageUserData* userData = static_cast<PageUserData*>(view->GetUserData());
+	if (userData == NULL || userData->BackgroundSince() != 0)
+		return;
+
+	bigtime_t now = system_time();
+	userData->SetBackgroundSince(now);
+	atomic_add(&sBackgroundTabCount, 1);
+	atomic_add64(&sBackgroundSinceSum, now);
+}
+
+
+void
+BrowserWindow::_BringTabToForeground(BWebView* view)
+{
+	if (view == NULL)
+		return;
+
+	PageUserData* userData = static_cast<PageUserData*>(view->GetUserData());
+	if (userData == NULL || userData->BackgroundSince() == 0)
+		return;
+
+	bigtime_t since = userData->BackgroundSince();
+	userData->SetBackgroundSince(0);
+	atomic_add(&sBackgroundTabCount, -1);
+	atomic_add64(&sBackgroundSinceSum, -since);
+	atomic_add64(&sBackgroundTime, system_time() - since);
+}
+
+
+/*!	Returns whether a notification from \a view is not to be shown,
+	because the tab is not the current one.
+*/
+bool
+BrowserWindow::_SkipBackgroundUpdate(BWebView* view)
+{
+	if (view == CurrentWebView())
+		return false;
+
+	atomic_add64(&sSkippedUpdateCount, 1);
+	return true;
+}
+
+
+/*!	Returns the notifications of \a view that wait to be shown, and makes
+	sure they are. WebKit sends page notifications much faster than they can
+	be seen during a load, so only the latest state of each tab is kept, and
+	applied at most once per frame by _ApplyPageUpdates().
+*/
+BrowserWindow::PendingPageUpdate&
+BrowserWindow::_PendingPageUpdate(BWebView* view)
+{
+	if (!fPageUpdatesScheduled) {
+		fPageUpdatesScheduled = true;
+
+		bigtime_t wait = fLastPageUpdate + kPageUpdateInterval
+			- system_time();
+		if (wait <= 0) {
+			// Still behind all notifications that are already queued.
+			PostMessage(APPLY_PAGE_UPDATES);
+		} else {
+			delete fPageUpdateRunner;
+			BMessage message(APPLY_PAGE_UPDATES);
+			fPageUpdateRunner = new BMessageRunner(BMessenger(this),
+				&message, wait, 1);
+		}
+	}
+
+	return fPendingPageUpdates[view];
+}
+
+
+void
+BrowserWindow::_ApplyPageUpdates()
+{
+	fPageUpdatesScheduled = false;
+	fLastPageUpdate = system_time();
+
+	std::map<BWebView*, PendingPageUpdate> updates;
+	updates.swap(fPendingPageUpdates);
+
+	std::map<BWebView*, PendingPageUpdate>::iterator iterator;
+	for (iterator = updates.begin(); iterator != updates.end(); iterator++) {
+		BWebView* view = iterator->first;
+		const PendingPageUpdate& update = iterator->second;
+
+		int32 tabIndex = fTabManager->TabForView(view);
+		if (tabIndex < 0)
+			continue;
+
+		bool isCurrent = view == CurrentWebView();
+
+		if ((update.fields & PAGE_UPDATE_TITLE) != 0) {
+			fTabManager->SetTabLabel(tabIndex, update.title);
+			if (isCurrent)
+				_UpdateTitle(update.title);
+		}
+
+		if ((update.fields & PAGE_UPDATE_ICON) != 0) {
+			PageUserData* userData = static_cast<PageUserData*>(
+				view->GetUserData());
+			Favicon* icon = userData != NULL ? userData->PageIcon() : NULL;
+			fTabManager->SetTabIcon(view, icon);
+			if (isCurrent)
+				fURLInputGroup->SetPageIcon(icon);
+		}
+
+		// Anything else is requested again when the tab is selected.
+		if (!isCurrent)
+			continue;
+
+		if ((update.fields & PAGE_UPDATE_PROGRESS) != 0) {
+			if (update.progress < 100 && fLoadingProgressBar->IsHidden())
+				_ShowProgressBar(true);
+			else if (update.progress == 100
+				&& !fLoadingProgressBar->IsHidden()) {
+				_ShowProgressBar(false);
+			}
+			fLoadingProgressBar->SetTo(update.progress);
+		}
+
+		if ((update.fields & PAGE_UPDATE_STATUS) != 0 && fStatusText != NULL)
+			fStatusText->SetText(update.status.String());
+
+		if ((update.fields & PAGE_UPDATE_NAVIGATION) != 0) {
+			fBackButton->SetEnabled(update.canGoBackward);
+			fForwardButton->SetEnabled(update.canGoForward);
+			fStopButton->SetEnabled(update.canStop);
+
+			fBackMenuItem->SetEnabled(update.canGoBackward);
+			fForwardMenuItem->SetEnabled(update.canGoForward);
+		}
+	}
 }
 
 
@@ -2169,27 +2878,9 @@ BrowserWindow::_CreateBookmark(const BPath& path, BString fileName, const BStrin
 				// If largeIcon is not available but miniIcon is, use a magnified miniIcon instead.
 				BBitmap substituteLargeIcon(BRect(0, 0, 31, 31), B_BITMAP_NO_SERVER_LINK,
 					B_CMAP8);
-				const uint8* src = (const uint8*)miniIcon->Bits();
-				uint32 srcBPR = miniIcon->BytesPerRow();
-				uint8* dst = (uint8*)substituteLargeIcon.Bits();
-				uint32 dstBPR = substituteLargeIcon.BytesPerRow();
-				for (uint32 y = 0; y < 16; y++) {
-					const uint8* s = src;
-					uint8* d = dst;
-					for (uint32 x = 0; x < 16; x++) {
-						*d++ = *s;
-						*d++ = *s++;
-					}
-					dst += dstBPR;
-					s = src;
-					for (uint32 x = 0; x < 16; x++) {
-						*d++ = *s;
-						*d++ = *s++;
-					}
-					dst += dstBPR;
-					src += srcBPR;
-				}
-				ret = nodeInfo.SetIcon(&substituteLargeIcon, B_LARGE_ICON);
+				ret = FaviconStore::ScaleUp(miniIcon, &substituteLargeIcon);
+				if (ret == B_OK)
+					ret = nodeInfo.SetIcon(&substituteLargeIcon, B_LARGE_ICON);
 			} else
 				ret = B_OK;
 			if (ret != B_OK) {
@@ -2237,7 +2928,7 @@ BrowserWindow::_CreateBookmark(BMessage* message)
 		originatorData.FindData("miniIcon", B_COLOR_8_BIT_TYPE,
 			reinterpret_cast<const void**>(&miniIcon), NULL);
 		originatorData.FindData("largeIcon", B_COLOR_8_BIT_TYPE,
-			reinterpret_cast<const void**>(&miniIcon), NULL);
+			reinterpret_cast<const void**>(&largeIcon), NULL);
 
 		if (validData == true) {
 			_CreateBookmark(BPath(&ref), BString(fileName), BString(title), BString(url),
@@ -2265,20 +2956,18 @@ BrowserWindow::_CreateBookmark()
 	BPath path;
 	status_t status = _BookmarkPath(path);
 
-	BBitmap* miniIcon = NULL;
-	BBitmap* largeIcon = NULL;
+	// The favicon store made both bookmark icons when it got the page icon.
+	const BBitmap* miniIcon = NULL;
+	const BBitmap* largeIcon = NULL;
 	PageUserData* userData = static_cast<PageUserData*>(CurrentWebView()->GetUserData());
 	if (userData != NULL && userData->PageIcon() != NULL) {
-		miniIcon = new BBitmap(BRect(0, 0, 15, 15), B_BITMAP_NO_SERVER_LINK, B_CMAP8);
-		miniIcon->ImportBits(userData->PageIcon());
-		// TODO:  retrieve the large icon too, once PageUserData can provide it.
+		miniIcon = userData->PageIcon()->MiniIcon();
+		largeIcon = userData->PageIcon()->LargeIcon();
 	}
 
 	if (status == B_OK)
 		_CreateBookmark(path, fileName, title, url, miniIcon, largeIcon);
 
-	delete miniIcon; // Clean up the created miniIcon after use
-
 	if (status != B_OK) {
 		BString message(B_TRANSLATE_COMMENT("There was an error retrieving "
 			"the bookmark folder.\n\nError: %error", "Don't translate the "
@@ -2320,9 +3009,134 @@ BrowserWindow::_ShowBookmarks()
 }
 
 
+void
+BrowserWindow::_ImportBookmarks()
+{
+	if (fBookmarkImportPanel == NULL) {
+		BMessenger target(this);
+		BMessage message(IMPORT_BOOKMARKS_FILE);
+		fBookmarkImportPanel = new BFilePanel(B_OPEN_PANEL, &target, NULL,
+			B_FILE_NODE, false, &message);
+		fBookmarkImportPanel->Window()->SetTitle(
+			B_TRANSLATE("WebPositive: Import bookmarks"));
+	}
+	fBookmarkImportPanel->Show();
+}
+
+
+void
+BrowserWindow::_ExportBookmarks()
+{
+	if (fBookmarkExportPanel == NULL) {
+		BMessenger target(this);
+		BMessage message(EXPORT_BOOKMARKS_FILE);
+		fBookmarkExportPanel = new BFilePanel(B_SAVE_PANEL, &target, NULL,
+			0, false, &message);
+		fBookmarkExportPanel->Window()->SetTitle(
+			B_TRANSLATE("WebPositive: Export bookmarks"));
+	}
+	fBookmarkExportPanel->SetSaveText("bookmarks.html");
+	fBookmarkExportPanel->Show();
+}
+
+
+/*!	Starts the import or export chosen in one of the file panels. The work
+	is done by BookmarkTransfer in a thread of its own.
+*/
+void
+BrowserWindow::_TransferBookmarks(const BMessage* message)
+{
+	BPath path;
+	status_t status = _BookmarkPath(path);
+	if (status == B_OK) {
+		entry_ref ref;
+		const char* name;
+		if (message->what == IMPORT_BOOKMARKS_FILE) {
+			status = message->FindRef("refs", &ref);
+			if (status == B_OK) {
+				status = BookmarkTransfer::StartImport(ref, path,
+					BMessenger(this));
+			}
+		} else {
+			status = message->FindRef("directory", &ref);
+			if (status == B_OK)
+				status = message->FindString("name", &name);
+			if (status == B_OK) {
+				status = BookmarkTransfer::StartExport(path, ref, name,
+					BMessenger(this));
+			}
+		}
+	}
+
+	if (status != B_OK) {
+		BString text(B_TRANSLATE_COMMENT("The bookmarks could not be "
+			"transferred.\n\nError: %error", "Don't translate variable "
+			"%error"));
+		text.ReplaceFirst("%error", strerror(status));
+		BAlert* alert = new BAlert(B_TRANSLATE("Bookmark error"),
+			text.String(), B_TRANSLATE("OK"), NULL, NULL,
+			B_WIDTH_AS_USUAL, B_STOP_ALERT);
+		alert->SetFlags(alert->Flags() | B_CLOSE_ON_ESCAPE);
+		alert->Go(NULL);
+	}
+}
+
+
+void
+BrowserWindow::_BookmarkTransferDone(const BMessage* message)
+{
+	bool import = message->GetBool("import", true);
+	int32 bookmarks = message->GetInt32("bookmarks", 0);
+	double seconds = message->GetInt64("elapsed", 0) / 1000000.0;
+
+	BString text;
+	if (import) {
+		text = B_TRANSLATE("Imported %bookmarks% bookmarks in %folders% new "
+			"folders, and skipped %duplicates% that were already in their folder.");
+	} else
+		text = B_TRANSLATE("Exported %bookmarks% bookmarks in %folders% folders.");
+	text.ReplaceFirst("%bookmarks%", BString() << bookmarks);
+	text.ReplaceFirst("%folders%",
+		BString() << message->GetInt32("folders", 0));
+	text.ReplaceFirst("%duplicates%",
+		BString() << message->GetInt32("duplicates", 0));
+
+	BString throughput;
+	throughput.SetToFormat(B_TRANSLATE("%.1f seconds, %.0f bookmarks per "
+		"second."), seconds, seconds > 0 ? bookmarks / seconds : 0.0);
+	text << "\n\n" << throughput;
+
+	const char* error;
+	alert_type type = B_INFO_ALERT;
+	if (message->FindString("error", &error) == B_OK) {
+		BString errorText(B_TRANSLATE_COMMENT("Not everything could be "
+			"transferred.\n\nError: %error", "Don't translate variable "
+			"%error"));
+		errorText.ReplaceFirst("%error", error);
+		text << "\n\n" << errorText;
+		type = B_WARNING_ALERT;
+	}
+
+	BAlert* alert = new BAlert(import ? B_TRANSLATE("Import bookmarks")
+			: B_TRANSLATE("Export bookmarks"), text.String(),
+		B_TRANSLATE("OK"), NULL, NULL, B_WIDTH_AS_USUAL, type);
+	alert->SetFlags(alert->Flags() | B_CLOSE_ON_ESCAPE);
+	alert->Go(NULL);
+}
+
+
 bool BrowserWindow::_CheckBookmarkExists(BDirectory& directory,
 	const BString& bookmarkName, const BString& url) const
 {
+	node_ref folder;
+	if (directory.GetNodeRef(&folder) == B_OK) {
+		status_t status = BookmarkIndex::DefaultInstance()->FindBookmark(
+			folder, bookmarkName, url);
+		if (status != B_NO_INIT)
+			return status == B_OK;
+	}
+
+	// The index is not built yet, or the folder is not a bookmark folder.
 	BEntry entry;
 	while (directory.GetNextEntry(&entry) == B_OK) {
 		char entryName[B_FILE_NAME_LENGTH];
@@ -2352,6 +3166,18 @@ void
 BrowserWindow::_AddBookmarkURLsRecursively(BDirectory& directory,
 	BMessage* message, uint32& addedCount) const
 {
+	node_ref folder;
+	BStringList urls;
+	if (directory.GetNodeRef(&folder) == B_OK
+		&& BookmarkIndex::DefaultInstance()->GetFolderURLs(folder, urls)
+			== B_OK) {
+		for (int32 i = 0; i < urls.CountStrings(); i++)
+			message->AddString("url", urls.StringAt(i));
+		addedCount += urls.CountStrings();
+		return;
+	}
+
+	// The index is not built yet, or the folder is not a bookmark folder.
 	BEntry entry;
 	while (directory.GetNextEntry(&entry) == B_OK) {
 		if (entry.IsDirectory()) {
@@ -2383,12 +3209,33 @@ BrowserWindow::_SetPageIcon(BWebView* view, const BBitmap* icon)
 			return;
 		view->SetUserData(userData);
 	}
-	// The PageUserData makes a copy of the icon, which we pass on to
-	// the TabManager for display in the respective tab.
-	userData->SetPageIcon(icon);
-	fTabManager->SetTabIcon(view, userData->PageIcon());
-	if (view == CurrentWebView())
-		fURLInputGroup->SetPageIcon(icon);
+	// The store only copies icons it has not seen yet. The tab, the URL bar
+	// and new bookmarks all use the shared one.
+	BReference<Favicon> favicon;
+	if (icon != NULL) {
+		favicon = FaviconStore::DefaultInstance()->Put(
+			BUrl(view->MainFrameURL()).Host(), icon);
+	}
+	userData->SetPageIcon(favicon.Get());
+	_PendingPageUpdate(view).fields |= PAGE_UPDATE_ICON;
+}
+
+
+/*!	Shows the icon the FaviconStore knows for the site of \a view. The store
+	always has the newest one, either from the page or from the disk cache.
+*/
+void
+BrowserWindow::_ShowKnownPageIcon(BWebView* view,
+	const BReference<Favicon>& favicon)
+{
+	if (!favicon.IsSet())
+		return;
+
+	PageUserData* userData = static_cast<PageUserData*>(view->GetUserData());
+	if (userData != NULL && userData->PageIcon() != favicon.Get()) {
+		userData->SetPageIcon(favicon.Get());
+		_PendingPageUpdate(view).fields |= PAGE_UPDATE_ICON;
+	}
 }
 
 
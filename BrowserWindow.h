@@ -32,9 +32,12 @@
 #include "WebWindow.h"
 
 #include <Messenger.h>
+#include <Referenceable.h>
 #include <String.h>
 #include <UrlContext.h>
 
+#include <map>
+
 class BButton;
 class BCheckBox;
 class BDirectory;
@@ -52,6 +55,7 @@ class BTextControl;
 class BWebView;
 
 class BookmarkBar;
+class Favicon;
 class SettingsMessage;
 class TabManager;
 class URLInputGroup;
@@ -91,7 +95,14 @@ enum {
 	SHOW_DOWNLOAD_WINDOW			= 'sdwd',
 	SHOW_SETTINGS_WINDOW			= 'sswd',
 	SHOW_CONSOLE_WINDOW				= 'scwd',
-	SHOW_COOKIE_WINDOW				= 'skwd'
+	SHOW_COOKIE_WINDOW				= 'skwd',
+	DUMP_TRACE						= 'dtrc',
+	RESTORE_TAB						= 'rstb',
+	SHOW_TAB_SWITCHER				= 'stsw',
+	SHOW_BOOKMARK_SEARCH			= 'sbks',
+	SHOW_RESOURCE_MONITOR			= 'srmw',
+	ACTIVATE_TAB					= 'actb',
+	DISCARD_TAB						= 'dstb'
 };
 
 
@@ -101,7 +112,8 @@ public:
 									const BString& url, BPrivate::Network::BUrlContext* context,
 									uint32 interfaceElements = INTERFACE_ELEMENT_ALL,
 									BWebView* webView = NULL,
-									uint32 workspaces = B_CURRENT_WORKSPACE);
+									uint32 workspaces = B_CURRENT_WORKSPACE,
+									bool spare = false);
 	virtual						~BrowserWindow();
 
 	virtual	void				DispatchMessage(BMessage* message,
@@ -111,6 +123,8 @@ public:
 	virtual	bool				QuitRequested();
 	virtual	void				MenusBeginning();
 	virtual	void				MenusEnded();
+	virtual	void				FrameMoved(BPoint newPosition);
+	virtual	void				FrameResized(float width, float height);
 
 	virtual	void				NewWindowRequested(const BString& url,
 									bool primaryAction);
@@ -125,7 +139,20 @@ public:
 			void				CreateNewTab(const BString& url, bool select,
 									BWebView* webView = 0);
 
+			void				ActivateSpare(BRect frame,
+									const BString& url);
+			bool				IsSpare() const
+									{ return fIsSpare; }
+
+			void				RestoreDiscardedTab(BView* placeholder);
+	static	int32				DiscardedTabCount();
+	static	int32				ReloadedTabCount();
+	static	bigtime_t			BackgroundTime();
+	static	int64				SkippedUpdateCount();
+
 			BRect				WindowFrame() const;
+			uint32				SessionID() const
+									{ return fSessionID; }
 
 			void				ToggleFullscreen();
 
@@ -175,6 +202,15 @@ private:
 			bool				_TabGroupShouldBeVisible() const;
 			void				_ShutdownTab(int32 index);
 			void				_TabChanged(int32 index);
+			void				_CheckDiscardableTabs();
+			void				_DiscardTab(int32 index);
+			void				_SendTabToBackground(BWebView* view);
+			void				_BringTabToForeground(BWebView* view);
+			bool				_SkipBackgroundUpdate(BWebView* view);
+
+			struct PendingPageUpdate;
+			PendingPageUpdate&	_PendingPageUpdate(BWebView* view);
+			void				_ApplyPageUpdates();
 
 			status_t			_BookmarkPath(BPath& path) const;
 			void				_CreateBookmark(const BPath& path,
@@ -184,6 +220,10 @@ private:
 			void				_CreateBookmark(BMessage* message);
 			void				_CreateBookmark();
 			void				_ShowBookmarks();
+			void				_ImportBookmarks();
+			void				_ExportBookmarks();
+			void				_TransferBookmarks(const BMessage* message);
+			void				_BookmarkTransferDone(const BMessage* message);
 			bool				_CheckBookmarkExists(BDirectory& directory,
 									const BString& fileName,
 									const BString& url) const;
@@ -196,6 +236,8 @@ private:
 
 			void				_SetPageIcon(BWebView* view,
 									const BBitmap* icon);
+			void				_ShowKnownPageIcon(BWebView* view,
+									const BReference<Favicon>& favicon);
 
 			void				_UpdateHistoryMenu();
 			void				_UpdateClipboardItems();
@@ -264,6 +306,8 @@ private:
 			bool				fMenusRunning;
 			BRect				fNonFullscreenWindowFrame;
 			BMessageRunner*		fPulseRunner;
+			BMessageRunner*		fDiscardRunner;
+			BMessageRunner*		fPageUpdateRunner;
 			uint32				fVisibleInterfaceElements;
 			bigtime_t			fLastMouseMovedTime;
 			BPoint				fLastMousePos;
@@ -284,6 +328,35 @@ private:
 			BMenuItem*			fBookmarkBarMenuItem;
 			BookmarkBar*		fBookmarkBar;
 			BFilePanel*			fSavePanel;
+			BFilePanel*			fBookmarkImportPanel;
+			BFilePanel*			fBookmarkExportPanel;
+
+			uint32				fSessionID;
+			bool				fIsSpare;
+
+			// Page notifications waiting to be shown, see
+			// _PendingPageUpdate().
+			struct PendingPageUpdate {
+				uint32			fields;
+				BString			title;
+				float			progress;
+				BString			status;
+				bool			canGoBackward;
+				bool			canGoForward;
+				bool			canStop;
+
+				PendingPageUpdate() : fields(0) {}
+			};
+			std::map<BWebView*, PendingPageUpdate> fPendingPageUpdates;
+			bool				fPageUpdatesScheduled;
+			bigtime_t			fLastPageUpdate;
+
+	static	int32				sDiscardedTabCount;
+	static	int32				sReloadedTabCount;
+	static	int32				sBackgroundTabCount;
+	static	int64				sBackgroundSinceSum;
+	static	int64				sBackgroundTime;
+	static	int64				sSkippedUpdateCount;
 
 	// For asynchronous page source saving
 	struct PageSourceSaveData {
@@ -17,6 +17,7 @@
 #include <Path.h>
 
 #include "BrowserApp.h"
+#include "TraceLog.h"
 #include <os/kernel/OS.h> // For spawn_thread, wait_for_thread, thread_id, find_thread etc.
 #include <Looper.h>      // For BLooper
 #include <Handler.h>     // For BHandler
@@ -205,7 +206,9 @@ BrowsingHistory::_LoadThreadEntry(void* data)
 {
 	BrowsingHistory* history = static_cast<BrowsingHistory*>(data);
 	if (history->Lock()) {
+		TraceSpan span("startup", "Load browsing history");
 		history->_LoadSettings();
+		span.End();
 		BHandler* target = history->fCompletionTarget;
 		history->fLoadThreadId = B_NO_THREAD;
 		history->Unlock();
@@ -219,6 +222,17 @@ BrowsingHistory::_LoadThreadEntry(void* data)
 }
 
 
+/*!	Loads the history in the calling thread, for callers that are already
+	running in the background.
+*/
+void
+BrowsingHistory::Load()
+{
+	BAutolock _(this);
+	_LoadSettings();
+}
+
+
 void
 BrowsingHistory::LoadAsync(BHandler* completionTarget)
 {
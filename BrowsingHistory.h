@@ -60,6 +60,7 @@ public:
 	static	const uint32		MSG_HISTORY_LOADED = 'HlDd';
 	static	const uint32		MSG_DO_SAVE_HISTORY = 'HdSf';
 
+			void				Load();
 			void				LoadAsync(BHandler* completionTarget = NULL);
 			bool				IsLoaded() const;
 
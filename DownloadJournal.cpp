@@ -0,0 +1,308 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "DownloadJournal.h"
+
+#include <new>
+
+#include <Autolock.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Path.h>
+
+#include "BrowserApp.h"
+
+
+enum {
+	kDownloadAddedRecord		= 'jdad',
+	kDownloadChangedRecord		= 'jdch',
+	kDownloadProgressedRecord	= 'jdpr',
+	kDownloadRemovedRecord		= 'jdrm'
+};
+
+
+DownloadJournal DownloadJournal::sDefaultInstance;
+
+
+DownloadJournal::DownloadJournal()
+	:
+	RecordJournal("download journal", "DownloadJournal"),
+	fNextID(1),
+	fLoaded(false)
+{
+}
+
+
+DownloadJournal::~DownloadJournal()
+{
+	Shutdown();
+
+	for (size_t i = 0; i < fDownloads.size(); i++)
+		delete fDownloads[i];
+}
+
+
+/*static*/ DownloadJournal*
+DownloadJournal::DefaultInstance()
+{
+	return &sDefaultInstance;
+}
+
+
+/*!	Replays the journal into \a downloads, using the layout of the old
+	download list: one "download" message per download, oldest first. Each
+	of them also carries the "id" the download is known by in the journal.
+	If there is no journal yet, the old download list is read instead, and
+	becomes the first snapshot once the journal is started.
+
+	The journal is only read once, later calls return the history as it is
+	now. This can be called from any thread.
+*/
+status_t
+DownloadJournal::Load(BMessage& downloads)
+{
+	BAutolock _(this);
+
+	if (!fLoaded) {
+		fLoaded = true;
+		if (_Replay() != B_OK)
+			_LoadLegacy();
+	}
+
+	if (fDownloads.empty())
+		return B_ENTRY_NOT_FOUND;
+
+	for (int32 i = fDownloads.size() - 1; i >= 0; i--) {
+		BMessage archive(fDownloads[i]->archive);
+		archive.AddUInt32("id", fDownloads[i]->id);
+		downloads.AddMessage("download", &archive);
+	}
+	return B_OK;
+}
+
+
+/*!	Adds a download at \a index of the history, newest first, and returns
+	the id it is known by from now on.
+*/
+uint32
+DownloadJournal::DownloadAdded(const BMessage& archive, int32 index)
+{
+	BAutolock _(this);
+
+	uint32 id = fNextID++;
+
+	BMessage* record = new(std::nothrow) BMessage(kDownloadAddedRecord);
+	if (record == NULL)
+		return id;
+	record->AddUInt32("id", id);
+	record->AddInt32("index", index);
+	record->AddMessage("download", &archive);
+
+	_Apply(*record);
+	_Append(record);
+	return id;
+}
+
+
+/*!	Replaces the stored state of a download, after it started, finished,
+	failed or was moved.
+*/
+void
+DownloadJournal::DownloadChanged(uint32 id, const BMessage& archive)
+{
+	BAutolock _(this);
+
+	if (_FindDownload(id) == NULL)
+		return;
+
+	BMessage* record = new(std::nothrow) BMessage(kDownloadChangedRecord);
+	if (record == NULL)
+		return;
+	record->AddUInt32("id", id);
+	record->AddMessage("download", &archive);
+
+	_Apply(*record);
+	_Append(record, "id");
+}
+
+
+/*!	Checkpoints the progress of a running download, and from where it could
+	be resumed. A checkpoint that was not written yet is replaced by the
+	newer one.
+*/
+void
+DownloadJournal::DownloadProgressed(uint32 id, float progress,
+	off_t resumeOffset, off_t expectedSize)
+{
+	BAutolock _(this);
+
+	DownloadState* state = _FindDownload(id);
+	if (state == NULL || (state->archive.GetFloat("value", -1) == progress
+			&& state->archive.GetInt64("resume offset", 0) == resumeOffset)) {
+		return;
+	}
+
+	BMessage* record = new(std::nothrow) BMessage(kDownloadProgressedRecord);
+	if (record == NULL)
+		return;
+	record->AddUInt32("id", id);
+	record->AddFloat("value", progress);
+	record->AddInt64("resume offset", resumeOffset);
+	record->AddInt64("expected size", expectedSize);
+
+	_Apply(*record);
+	_Append(record, "id");
+}
+
+
+void
+DownloadJournal::DownloadRemoved(uint32 id)
+{
+	BAutolock _(this);
+
+	if (_FindDownload(id) == NULL)
+		return;
+
+	BMessage* record = new(std::nothrow) BMessage(kDownloadRemovedRecord);
+	if (record == NULL)
+		return;
+	record->AddUInt32("id", id);
+
+	_Apply(*record);
+	_Append(record);
+}
+
+
+// #pragma mark - private
+
+
+DownloadJournal::DownloadState*
+DownloadJournal::_FindDownload(uint32 id) const
+{
+	DownloadMap::const_iterator found = fDownloadsByID.find(id);
+	return found != fDownloadsByID.end() ? found->second : NULL;
+}
+
+
+/*!	Applies a record to the in-memory history. This is used both for
+	replaying the journal and for live events, so both always agree.
+*/
+void
+DownloadJournal::_Apply(const BMessage& record)
+{
+	uint32 id = record.GetUInt32("id", 0);
+
+	if (record.what == kDownloadAddedRecord) {
+		if (id == 0 || _FindDownload(id) != NULL)
+			return;
+
+		DownloadState* state = new(std::nothrow) DownloadState;
+		if (state == NULL)
+			return;
+		state->id = id;
+		record.FindMessage("download", &state->archive);
+
+		int32 index = record.GetInt32("index", 0);
+		if (index < 0 || index > (int32)fDownloads.size())
+			index = fDownloads.size();
+		fDownloads.insert(fDownloads.begin() + index, state);
+		fDownloadsByID[id] = state;
+
+		if (id >= fNextID)
+			fNextID = id + 1;
+		return;
+	}
+
+	DownloadState* state = _FindDownload(id);
+	if (state == NULL)
+		return;
+
+	switch (record.what) {
+		case kDownloadChangedRecord:
+			record.FindMessage("download", &state->archive);
+			break;
+
+		case kDownloadProgressedRecord:
+			state->archive.SetFloat("value", record.GetFloat("value", 0));
+			state->archive.SetInt64("resume offset",
+				record.GetInt64("resume offset", 0));
+			state->archive.SetInt64("expected size",
+				record.GetInt64("expected size", 0));
+			break;
+
+		case kDownloadRemovedRecord:
+			for (size_t i = 0; i < fDownloads.size(); i++) {
+				if (fDownloads[i] == state) {
+					fDownloads.erase(fDownloads.begin() + i);
+					break;
+				}
+			}
+			fDownloadsByID.erase(id);
+			delete state;
+			break;
+	}
+}
+
+
+/*!	Reads the download list the download window used to rewrite on every
+	change, and adds its downloads to the history.
+*/
+void
+DownloadJournal::_LoadLegacy()
+{
+	BPath path;
+	if (find_directory(B_USER_SETTINGS_DIRECTORY, &path) != B_OK
+		|| path.Append(kApplicationName) != B_OK
+		|| path.Append("Downloads") != B_OK) {
+		return;
+	}
+
+	BFile file(path.Path(), B_READ_ONLY);
+	BMessage downloads;
+	if (file.InitCheck() != B_OK || downloads.Unflatten(&file) != B_OK)
+		return;
+
+	// The newest download was archived last.
+	BMessage archive;
+	for (int32 i = 0; downloads.FindMessage("download", i, &archive) == B_OK;
+			i++) {
+		BMessage record(kDownloadAddedRecord);
+		record.AddUInt32("id", fNextID);
+		record.AddInt32("index", 0);
+		record.AddMessage("download", &archive);
+		_Apply(record);
+	}
+}
+
+
+/*!	Creates the records that rebuild the current history from scratch.
+	Must be called with the lock held.
+*/
+void
+DownloadJournal::_SnapshotRecords(RecordList& records) const
+{
+	// Every download is added in front of the ones added before it, so the
+	// oldest one comes first.
+	for (int32 i = fDownloads.size() - 1; i >= 0; i--) {
+		BMessage* record = new(std::nothrow) BMessage(kDownloadAddedRecord);
+		if (record == NULL)
+			return;
+		record->AddUInt32("id", fDownloads[i]->id);
+		record->AddInt32("index", 0);
+		record->AddMessage("download", &fDownloads[i]->archive);
+		records.push_back(record);
+	}
+}
+
+
+/*!	A snapshot has one record per download, so the journal is compacted
+	once that many records were appended on top, and a long history is not
+	rewritten for every few progress checkpoints.
+*/
+size_t
+DownloadJournal::_CompactionThreshold() const
+{
+	return RecordJournal::_CompactionThreshold() + fDownloads.size();
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef DOWNLOAD_JOURNAL_H
+#define DOWNLOAD_JOURNAL_H
+
+
+#include <Message.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "RecordJournal.h"
+
+
+/*!	Keeps the download history on disk as an append-only journal of small
+	records (download added/changed/progressed/removed), instead of rewriting
+	the whole list whenever one download changes.
+
+	Records are queued by the download window and written in batches by the
+	RecordJournal writer thread, and an in-memory copy of the history is
+	kept alongside, from which the journal is compacted once enough records
+	were appended. Downloads are kept newest first, the way the download
+	window shows them.
+*/
+class DownloadJournal : public RecordJournal {
+public:
+	static	DownloadJournal*	DefaultInstance();
+
+			status_t			Load(BMessage& downloads);
+
+			uint32				DownloadAdded(const BMessage& archive,
+									int32 index);
+			void				DownloadChanged(uint32 id,
+									const BMessage& archive);
+			void				DownloadProgressed(uint32 id, float progress,
+									off_t resumeOffset, off_t expectedSize);
+			void				DownloadRemoved(uint32 id);
+
+private:
+			struct DownloadState {
+				uint32			id;
+				BMessage		archive;
+			};
+
+			typedef std::unordered_map<uint32, DownloadState*> DownloadMap;
+
+								DownloadJournal();
+	virtual						~DownloadJournal();
+
+			DownloadState*		_FindDownload(uint32 id) const;
+	virtual	void				_Apply(const BMessage& record);
+	virtual	void				_SnapshotRecords(RecordList& records) const;
+	virtual	size_t				_CompactionThreshold() const;
+			void				_LoadLegacy();
+
+private:
+			std::vector<DownloadState*> fDownloads;
+			DownloadMap			fDownloadsByID;
+			uint32				fNextID;
+			bool				fLoaded;
+
+	static	DownloadJournal		sDefaultInstance;
+};
+
+
+#endif // DOWNLOAD_JOURNAL_H
@@ -0,0 +1,565 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "DownloadModel.h"
+
+#include <string.h>
+
+#include <GraphicsDefs.h>
+#include <Message.h>
+#include <Rect.h>
+#include <SupportDefs.h>
+
+#include "BandwidthScheduler.h"
+#include "DownloadJournal.h"
+#include "SegmentedDownload.h"
+#include "WebDownload.h"
+
+
+static const BRect kIconFrame(0, 0, 31, 31);
+static const int32 kIconBytesPerRow = 32 * 4;
+static const size_t kIconSize = 32 * kIconBytesPerRow;
+
+static const bigtime_t kCheckpointInterval = 5000000;
+	// The progress of a running download is journaled at most this often.
+
+
+/*!	Reads the icon from a download archive. The icon is stored the way
+	BBitmap::Archive() stores a 32x32 B_RGBA32 bitmap, so older download
+	lists can still be read.
+*/
+static void
+unarchive_icon(const BMessage* archive, std::vector<uint8>& icon)
+{
+	BRect frame;
+	int32 colorSpace;
+	int32 bytesPerRow;
+	const void* data;
+	ssize_t size;
+	if (archive->FindRect("_frame", &frame) != B_OK
+		|| archive->FindInt32("_cspace", &colorSpace) != B_OK
+		|| archive->FindInt32("_rowbytes", &bytesPerRow) != B_OK
+		|| archive->FindData("_data", B_RAW_TYPE, &data, &size) != B_OK
+		|| frame != kIconFrame || colorSpace != B_RGBA32
+		|| bytesPerRow != kIconBytesPerRow || (size_t)size != kIconSize) {
+		icon.clear();
+		return;
+	}
+
+	icon.assign((const uint8*)data, (const uint8*)data + size);
+}
+
+
+static status_t
+archive_icon(const std::vector<uint8>& icon, BMessage* archive)
+{
+	status_t status = archive->AddString("class", "BBitmap");
+	if (status == B_OK)
+		status = archive->AddRect("_frame", kIconFrame);
+	if (status == B_OK)
+		status = archive->AddInt32("_cspace", B_RGBA32);
+	if (status == B_OK)
+		status = archive->AddInt32("_bmflags", 0);
+	if (status == B_OK)
+		status = archive->AddInt32("_rowbytes", kIconBytesPerRow);
+	if (status == B_OK) {
+		// Downloads that never got an icon are stored with a blank one.
+		std::vector<uint8> bits(icon);
+		bits.resize(kIconSize, 0);
+		status = archive->AddData("_data", B_RAW_TYPE, &bits[0], kIconSize);
+	}
+	return status;
+}
+
+
+DownloadItem::DownloadItem(BWebDownload* download)
+	:
+	id(0),
+	download(download),
+	segmented(NULL),
+	url(download->URL()),
+	path(download->Path()),
+	progress(0),
+	missing(false),
+	failed(false),
+	restarting(false),
+	priority(BandwidthScheduler::PRIORITY_NORMAL),
+	resumeOffset(0),
+	iconLoaded(false),
+	listener(NULL),
+	fIndex(-1),
+	fIndexedDownload(NULL),
+	fCountedFinished(false),
+	fCountedMissing(false),
+	fJournaledProgress(-1),
+	fJournaledResumeOffset(0),
+	fJournaledExpectedSize(0),
+	fJournaledPriority(BandwidthScheduler::PRIORITY_NORMAL),
+	fJournaledIconSize(0),
+	fLastCheckpointTime(0)
+{
+	_ResetSpeed();
+}
+
+
+DownloadItem::DownloadItem(const BMessage* archive)
+	:
+	id(archive->GetUInt32("id", 0)),
+	download(NULL),
+	segmented(NULL),
+	progress(0),
+	missing(false),
+	failed(false),
+	restarting(false),
+	priority(BandwidthScheduler::PRIORITY_NORMAL),
+	resumeOffset(0),
+	iconLoaded(false),
+	listener(NULL),
+	fIndex(-1),
+	fIndexedDownload(NULL),
+	fCountedFinished(false),
+	fCountedMissing(false),
+	fJournaledProgress(-1),
+	fJournaledResumeOffset(0),
+	fJournaledExpectedSize(0),
+	fJournaledPriority(BandwidthScheduler::PRIORITY_NORMAL),
+	fJournaledIconSize(0),
+	fLastCheckpointTime(0)
+{
+	_ResetSpeed();
+
+	const char* string;
+	if (archive->FindString("path", &string) == B_OK)
+		path.SetTo(string);
+	if (archive->FindString("url", &string) == B_OK)
+		url = string;
+	archive->FindFloat("value", &progress);
+	priority = archive->GetInt32("priority",
+		BandwidthScheduler::PRIORITY_NORMAL);
+	resumeOffset = archive->GetInt64("resume offset", 0);
+	expectedSize = archive->GetInt64("expected size", 0);
+	if (archive->FindString("etag", &string) == B_OK)
+		etag = string;
+	if (archive->FindString("last modified", &string) == B_OK)
+		lastModified = string;
+	unarchive_icon(archive, icon);
+}
+
+
+DownloadItem::~DownloadItem()
+{
+	if (segmented != NULL) {
+		segmented->Cancel();
+		segmented->ReleaseReference();
+	}
+}
+
+
+status_t
+DownloadItem::SaveSettings(BMessage* archive) const
+{
+	if (!archive)
+		return B_BAD_VALUE;
+	status_t ret = archive->AddString("path", path.Path());
+	if (ret == B_OK)
+		ret = archive->AddString("url", url.String());
+	if (ret == B_OK)
+		ret = archive->AddFloat("value", progress);
+	if (ret == B_OK && priority != BandwidthScheduler::PRIORITY_NORMAL)
+		ret = archive->AddInt32("priority", priority);
+	if (ret == B_OK && resumeOffset > 0) {
+		ret = archive->AddInt64("resume offset", resumeOffset);
+		if (ret == B_OK)
+			ret = archive->AddInt64("expected size", expectedSize);
+	}
+	if (ret == B_OK && !etag.IsEmpty())
+		ret = archive->AddString("etag", etag);
+	if (ret == B_OK && !lastModified.IsEmpty())
+		ret = archive->AddString("last modified", lastModified);
+	if (ret == B_OK)
+		ret = archive_icon(icon, archive);
+	return ret;
+}
+
+
+/*!	Returns whether the downloaded file is complete and still there, and
+	can be opened.
+*/
+bool
+DownloadItem::CanOpen() const
+{
+	return !IsRunning() && !restarting && !missing && progress == 100
+		&& path.InitCheck() == B_OK;
+}
+
+
+/*!	Returns whether the download stopped early, and can be continued where
+	it stopped instead of being started over.
+*/
+bool
+DownloadItem::CanResume() const
+{
+	return !IsRunning() && !missing && path.InitCheck() == B_OK
+		&& resumeOffset > 0 && expectedSize > resumeOffset
+		&& SegmentedDownload::CanDownload(url);
+}
+
+
+/*!	Returns the download the progress of a running item comes from, which
+	is also what the item can be found by in its DownloadModel.
+*/
+const void*
+DownloadItem::RunningDownload() const
+{
+	if (segmented != NULL)
+		return segmented;
+	return download;
+}
+
+
+void
+DownloadItem::_ResetSpeed()
+{
+	currentSize = 0;
+	expectedSize = 0;
+	lastUpdateTime = 0;
+	bytesPerSecond = 0.0;
+	for (size_t i = 0; i < kBytesPerSecondSlots; i++)
+		bytesPerSecondSlot[i] = 0.0;
+	currentBytesPerSecondSlot = 0;
+	lastSpeedReferenceSize = 0;
+	estimatedFinishReferenceSize = 0;
+
+	processStartTime = lastSpeedReferenceTime
+		= estimatedFinishReferenceTime = system_time();
+}
+
+
+// #pragma mark - DownloadModel
+
+
+DownloadModel::DownloadModel()
+	:
+	fFinishedCount(0),
+	fMissingCount(0)
+{
+}
+
+
+DownloadModel::~DownloadModel()
+{
+	for (size_t i = 0; i < fItems.size(); i++)
+		delete fItems[i];
+}
+
+
+DownloadItem*
+DownloadModel::ItemAt(int32 index) const
+{
+	if (index < 0 || index >= (int32)fItems.size())
+		return NULL;
+	return fItems[index];
+}
+
+
+int32
+DownloadModel::IndexOf(const DownloadItem* item) const
+{
+	if (item == NULL || item->fIndex < 0
+		|| item->fIndex >= (int32)fItems.size()
+		|| fItems[item->fIndex] != item) {
+		return -1;
+	}
+	return item->fIndex;
+}
+
+
+void
+DownloadModel::AddItem(DownloadItem* item, int32 index)
+{
+	if (index < 0 || index > (int32)fItems.size())
+		index = fItems.size();
+
+	fItems.insert(fItems.begin() + index, item);
+	_Renumber(index);
+	_Journal(item, true);
+		// assigns the id of new items
+	_Index(item);
+}
+
+
+/*!	Removes the item at \a index from the model, and returns it. The caller
+	gets ownership of the item.
+*/
+DownloadItem*
+DownloadModel::RemoveItemAt(int32 index)
+{
+	DownloadItem* item = ItemAt(index);
+	if (item == NULL)
+		return NULL;
+
+	_Unindex(item);
+	fItems.erase(fItems.begin() + index);
+	item->fIndex = -1;
+	_Renumber(index);
+	DownloadJournal::DefaultInstance()->DownloadRemoved(item->id);
+	return item;
+}
+
+
+/*!	Removes all items \a filter returns \c true for in a single pass, and
+	adds them to \a removed. The caller gets ownership of the items.
+*/
+void
+DownloadModel::RemoveItems(ItemFilter filter,
+	std::vector<DownloadItem*>& removed)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < fItems.size(); i++) {
+		DownloadItem* item = fItems[i];
+		if (filter(item)) {
+			_Unindex(item);
+			item->fIndex = -1;
+			DownloadJournal::DefaultInstance()->DownloadRemoved(item->id);
+			removed.push_back(item);
+		} else
+			fItems[kept++] = item;
+	}
+	fItems.resize(kept);
+	_Renumber(0);
+}
+
+
+/*!	Brings the lookup tables, the counts and the journal up to date with
+	the current state of \a item.
+*/
+void
+DownloadModel::ItemChanged(DownloadItem* item)
+{
+	if (IndexOf(item) < 0)
+		return;
+
+	_Unindex(item);
+	_Index(item);
+	_Journal(item, false);
+}
+
+
+/*!	Journals the progress of the running download \a item, unless that was
+	done less than kCheckpointInterval ago. After a crash, the download is
+	shown with about the progress it had.
+*/
+void
+DownloadModel::CheckpointProgress(DownloadItem* item)
+{
+	bigtime_t now = system_time();
+	if (IndexOf(item) < 0 || (item->progress == item->fJournaledProgress
+			&& item->resumeOffset == item->fJournaledResumeOffset)
+		|| now - item->fLastCheckpointTime < kCheckpointInterval) {
+		return;
+	}
+
+	item->fLastCheckpointTime = now;
+	item->fJournaledProgress = item->progress;
+	item->fJournaledResumeOffset = item->resumeOffset;
+	item->fJournaledExpectedSize = item->expectedSize;
+	DownloadJournal::DefaultInstance()->DownloadProgressed(item->id,
+		item->progress, item->resumeOffset, item->expectedSize);
+}
+
+
+/*!	Journals the current progress of all running downloads.
+*/
+void
+DownloadModel::CheckpointRunning()
+{
+	for (DownloadMap::iterator iterator = fDownloads.begin();
+			iterator != fDownloads.end(); iterator++) {
+		DownloadItem* item = iterator->second;
+		item->fLastCheckpointTime = 0;
+		CheckpointProgress(item);
+	}
+}
+
+
+DownloadItem*
+DownloadModel::FindID(uint32 id) const
+{
+	IDMap::const_iterator found = fIDs.find(id);
+	return found != fIDs.end() ? found->second : NULL;
+}
+
+
+/*!	Returns one of the downloads of \a url, there can be more than one.
+*/
+DownloadItem*
+DownloadModel::FindURL(const BString& url) const
+{
+	URLMap::const_iterator found = fURLs.find(url);
+	return found != fURLs.end() ? found->second : NULL;
+}
+
+
+DownloadItem*
+DownloadModel::FindDownload(const void* download) const
+{
+	DownloadMap::const_iterator found = fDownloads.find(download);
+	return found != fDownloads.end() ? found->second : NULL;
+}
+
+
+DownloadItem*
+DownloadModel::FindNode(const node_ref& node) const
+{
+	NodeMap::const_iterator found = fNodes.find(node);
+	return found != fNodes.end() ? found->second : NULL;
+}
+
+
+/*!	Adds up the progress and the speed of all running downloads.
+*/
+void
+DownloadModel::GetRunningTotals(Totals& totals) const
+{
+	totals.running = fDownloads.size();
+	totals.currentSize = 0;
+	totals.expectedSize = 0;
+	totals.bytesPerSecond = 0;
+
+	for (DownloadMap::const_iterator iterator = fDownloads.begin();
+			iterator != fDownloads.end(); iterator++) {
+		const DownloadItem* item = iterator->second;
+		totals.currentSize += item->currentSize;
+		if (item->expectedSize <= 0 || totals.expectedSize < 0)
+			totals.expectedSize = -1;
+		else
+			totals.expectedSize += item->expectedSize;
+		totals.bytesPerSecond += item->bytesPerSecond;
+	}
+}
+
+
+// #pragma mark - private
+
+
+void
+DownloadModel::_Index(DownloadItem* item)
+{
+	if (item->id != 0)
+		fIDs[item->id] = item;
+
+	item->fIndexedURL = item->url;
+	if (item->url.Length() > 0)
+		fURLs.insert(std::make_pair(item->url, item));
+
+	item->fIndexedDownload = item->RunningDownload();
+	if (item->fIndexedDownload != NULL)
+		fDownloads[item->fIndexedDownload] = item;
+
+	item->fIndexedNode = item->node;
+	if (item->node != node_ref())
+		fNodes[item->node] = item;
+
+	item->fCountedFinished = item->IsFinished();
+	if (item->fCountedFinished)
+		fFinishedCount++;
+	item->fCountedMissing = item->IsMissing();
+	if (item->fCountedMissing)
+		fMissingCount++;
+}
+
+
+void
+DownloadModel::_Unindex(DownloadItem* item)
+{
+	if (item->id != 0) {
+		IDMap::iterator found = fIDs.find(item->id);
+		if (found != fIDs.end() && found->second == item)
+			fIDs.erase(found);
+	}
+
+	if (item->fIndexedURL.Length() > 0) {
+		std::pair<URLMap::iterator, URLMap::iterator> range
+			= fURLs.equal_range(item->fIndexedURL);
+		for (URLMap::iterator iterator = range.first;
+				iterator != range.second; iterator++) {
+			if (iterator->second == item) {
+				fURLs.erase(iterator);
+				break;
+			}
+		}
+	}
+
+	if (item->fIndexedDownload != NULL) {
+		DownloadMap::iterator found = fDownloads.find(item->fIndexedDownload);
+		if (found != fDownloads.end() && found->second == item)
+			fDownloads.erase(found);
+	}
+
+	if (item->fIndexedNode != node_ref()) {
+		NodeMap::iterator found = fNodes.find(item->fIndexedNode);
+		if (found != fNodes.end() && found->second == item)
+			fNodes.erase(found);
+	}
+
+	if (item->fCountedFinished)
+		fFinishedCount--;
+	if (item->fCountedMissing)
+		fMissingCount--;
+	item->fCountedFinished = false;
+	item->fCountedMissing = false;
+}
+
+
+void
+DownloadModel::_Renumber(int32 from)
+{
+	for (size_t i = from; i < fItems.size(); i++)
+		fItems[i]->fIndex = i;
+}
+
+
+/*!	Hands the stored state of \a item to the journal, if it is new or
+	changed since it was last journaled. Items that come with an id were
+	read from the journal, and are already in it.
+*/
+void
+DownloadModel::_Journal(DownloadItem* item, bool added)
+{
+	BString path = item->path.Path();
+	if (!added && item->fJournaledPath == path
+		&& item->fJournaledProgress == item->progress
+		&& item->fJournaledResumeOffset == item->resumeOffset
+		&& item->fJournaledExpectedSize == item->expectedSize
+		&& item->fJournaledETag == item->etag
+		&& item->fJournaledLastModified == item->lastModified
+		&& item->fJournaledPriority == item->priority
+		&& item->fJournaledIconSize == item->icon.size()) {
+		return;
+	}
+
+	item->fJournaledPath = path;
+	item->fJournaledProgress = item->progress;
+	item->fJournaledResumeOffset = item->resumeOffset;
+	item->fJournaledExpectedSize = item->expectedSize;
+	item->fJournaledETag = item->etag;
+	item->fJournaledLastModified = item->lastModified;
+	item->fJournaledPriority = item->priority;
+	item->fJournaledIconSize = item->icon.size();
+	item->fLastCheckpointTime = system_time();
+
+	if (added && item->id != 0)
+		return;
+
+	BMessage archive;
+	if (item->SaveSettings(&archive) != B_OK)
+		return;
+
+	if (added)
+		item->id = DownloadJournal::DefaultInstance()->DownloadAdded(archive,
+			item->fIndex);
+	else
+		DownloadJournal::DefaultInstance()->DownloadChanged(item->id, archive);
+}
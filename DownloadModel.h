@@ -0,0 +1,199 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef DOWNLOAD_MODEL_H
+#define DOWNLOAD_MODEL_H
+
+
+#include <Node.h>
+#include <Path.h>
+#include <String.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "HashFunctions.h"
+
+
+class BHandler;
+class BMessage;
+class BWebDownload;
+class SegmentedDownload;
+
+
+/*!	Everything the download window knows about a single download, running
+	or from the history. The icon is kept as the bits of a 32x32 B_RGBA32
+	bitmap, and only read from the file once the download is shown.
+	The \c id identifies the download in the DownloadJournal, it is 0 until
+	the download is added to a DownloadModel.
+
+	A running download is either run by WebKit, or by a SegmentedDownload.
+	While a SegmentedDownload checks whether it can take over, the item has
+	both. A download that stopped early can be resumed by a
+	SegmentedDownload from its \c resumeOffset on.
+*/
+struct DownloadItem {
+								DownloadItem(BWebDownload* download);
+								DownloadItem(const BMessage* archive);
+								~DownloadItem();
+
+			status_t			SaveSettings(BMessage* archive) const;
+
+			bool				IsRunning() const
+									{ return download != NULL
+										|| segmented != NULL; }
+			const void*			RunningDownload() const;
+			bool				IsFinished() const
+									{ return !IsRunning()
+										&& progress == 100; }
+			bool				IsMissing() const
+									{ return missing; }
+			bool				CanOpen() const;
+			bool				CanResume() const;
+
+			uint32				id;
+			BWebDownload*		download;
+			SegmentedDownload*	segmented;
+				// the item holds a reference to it
+			BString				url;
+			BPath				path;
+			float				progress;
+				// in percent
+			bool				missing;
+			bool				failed;
+			bool				restarting;
+			int32				priority;
+				// for the BandwidthScheduler
+
+			off_t				resumeOffset;
+				// how much of the start of the file is complete
+			BString				etag;
+			BString				lastModified;
+				// what the server described the file with, if anything
+
+			std::vector<uint8>	icon;
+			bool				iconLoaded;
+
+			node_ref			node;
+				// of the watched file, if any
+			BHandler*			listener;
+				// receives the progress of a running download
+
+			off_t				currentSize;
+			off_t				expectedSize;
+			off_t				lastSpeedReferenceSize;
+			off_t				estimatedFinishReferenceSize;
+			bigtime_t			lastUpdateTime;
+			bigtime_t			lastSpeedReferenceTime;
+			bigtime_t			processStartTime;
+			bigtime_t			estimatedFinishReferenceTime;
+	static	const size_t		kBytesPerSecondSlots = 10;
+			size_t				currentBytesPerSecondSlot;
+			double				bytesPerSecondSlot[kBytesPerSecondSlots];
+			double				bytesPerSecond;
+
+private:
+	friend class DownloadModel;
+
+			void				_ResetSpeed();
+
+			int32				fIndex;
+			BString				fIndexedURL;
+			const void*			fIndexedDownload;
+			node_ref			fIndexedNode;
+			bool				fCountedFinished;
+			bool				fCountedMissing;
+
+			BString				fJournaledPath;
+			float				fJournaledProgress;
+			off_t				fJournaledResumeOffset;
+			off_t				fJournaledExpectedSize;
+			BString				fJournaledETag;
+			BString				fJournaledLastModified;
+			int32				fJournaledPriority;
+			size_t				fJournaledIconSize;
+			bigtime_t			fLastCheckpointTime;
+};
+
+
+/*!	The list of downloads shown in the download window, newest first.
+
+	Downloads can be found by their position, id, URL, running BWebDownload
+	or SegmentedDownload, and watched file without going through the list, and
+	the number of finished and missing downloads is kept as the downloads
+	change. Whoever changes
+	the state of an item has to call ItemChanged() afterwards.
+
+	The model also keeps the DownloadJournal up to date: downloads are
+	journaled as they are added and removed, and whenever ItemChanged()
+	finds their stored state changed. The progress of running downloads is
+	only checkpointed every so often, through CheckpointProgress().
+*/
+class DownloadModel {
+public:
+			typedef bool (*ItemFilter)(const DownloadItem* item);
+
+			struct Totals {
+				int32			running;
+				off_t			currentSize;
+				off_t			expectedSize;
+					// -1 if any running download has no expected size
+				double			bytesPerSecond;
+			};
+
+								DownloadModel();
+								~DownloadModel();
+
+			int32				CountItems() const
+									{ return fItems.size(); }
+			DownloadItem*		ItemAt(int32 index) const;
+			int32				IndexOf(const DownloadItem* item) const;
+
+			void				AddItem(DownloadItem* item, int32 index);
+			DownloadItem*		RemoveItemAt(int32 index);
+			void				RemoveItems(ItemFilter filter,
+									std::vector<DownloadItem*>& removed);
+			void				ItemChanged(DownloadItem* item);
+			void				CheckpointProgress(DownloadItem* item);
+			void				CheckpointRunning();
+
+			DownloadItem*		FindID(uint32 id) const;
+			DownloadItem*		FindURL(const BString& url) const;
+			DownloadItem*		FindDownload(const void* download) const;
+			DownloadItem*		FindNode(const node_ref& node) const;
+
+			int32				CountFinished() const
+									{ return fFinishedCount; }
+			int32				CountMissing() const
+									{ return fMissingCount; }
+			int32				CountRunning() const
+									{ return fDownloads.size(); }
+			void				GetRunningTotals(Totals& totals) const;
+
+private:
+			typedef std::unordered_map<uint32, DownloadItem*> IDMap;
+			typedef std::unordered_multimap<BString, DownloadItem*,
+				StringHash> URLMap;
+			typedef std::unordered_map<const void*, DownloadItem*>
+				DownloadMap;
+			typedef std::unordered_map<node_ref, DownloadItem*, NodeRefHash>
+				NodeMap;
+
+			void				_Index(DownloadItem* item);
+			void				_Unindex(DownloadItem* item);
+			void				_Renumber(int32 from);
+			void				_Journal(DownloadItem* item, bool added);
+
+private:
+			std::vector<DownloadItem*> fItems;
+			IDMap				fIDs;
+			URLMap				fURLs;
+			DownloadMap			fDownloads;
+			NodeMap				fNodes;
+			int32				fFinishedCount;
+			int32				fMissingCount;
+};
+
+
+#endif // DOWNLOAD_MODEL_H
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "DownloadProgressAggregator.h"
+
+#include <Handler.h>
+#include <Message.h>
+#include <MessageRunner.h>
+
+#include "SegmentedDownload.h"
+#include "WebDownload.h"
+
+
+static const bigtime_t kDeliveryInterval = 100000;
+	// The target is told about new progress at most this often.
+
+
+/*!	Receives the messages of one running download.
+*/
+class DownloadProgressAggregator::Listener : public BHandler {
+public:
+	Listener(DownloadProgressAggregator* aggregator, const void* download)
+		:
+		BHandler("download listener"),
+		fAggregator(aggregator),
+		fDownload(download),
+		fCurrentSize(0),
+		fExpectedSize(0),
+		fChanged(false)
+	{
+	}
+
+	virtual void MessageReceived(BMessage* message)
+	{
+		switch (message->what) {
+			case B_DOWNLOAD_PROGRESS:
+			{
+				int64 currentSize;
+				int64 expectedSize;
+				if (message->FindInt64("current size", &currentSize) == B_OK
+					&& message->FindInt64("expected size", &expectedSize)
+						== B_OK) {
+					fCurrentSize = currentSize;
+					fExpectedSize = expectedSize;
+					fAggregator->_ProgressChanged(this);
+				}
+				break;
+			}
+
+			case B_DOWNLOAD_STARTED:
+			case B_DOWNLOAD_REMOVED:
+			case SEGMENTED_DOWNLOAD_DECLINED:
+			{
+				BMessage forward(*message);
+				forward.RemoveName("download");
+				forward.AddPointer("download", fDownload);
+				fAggregator->fTarget.SendMessage(&forward);
+				break;
+			}
+
+			default:
+				BHandler::MessageReceived(message);
+				break;
+		}
+	}
+
+private:
+	friend class DownloadProgressAggregator;
+
+	DownloadProgressAggregator*	fAggregator;
+	const void*					fDownload;
+	off_t						fCurrentSize;
+	off_t						fExpectedSize;
+	bool						fChanged;
+};
+
+
+// #pragma mark - DownloadProgressAggregator
+
+
+DownloadProgressAggregator::DownloadProgressAggregator()
+	:
+	BLooper("download progress"),
+	fLastDelivery(0),
+	fDeliveryPending(false)
+{
+}
+
+
+/*!	Sets where the progress is delivered to. Must be called before any
+	download is added.
+*/
+void
+DownloadProgressAggregator::SetTarget(const BMessenger& target)
+{
+	if (Lock()) {
+		fTarget = target;
+		Unlock();
+	}
+}
+
+
+/*!	Starts receiving the messages of \a download, and returns the handler
+	that receives them. It must be passed to RemoveDownload() once the
+	download is no longer of interest.
+*/
+BHandler*
+DownloadProgressAggregator::AddDownload(BWebDownload* download)
+{
+	Listener* listener = _AddListener(download);
+	if (listener != NULL)
+		download->SetProgressListener(BMessenger(listener));
+	return listener;
+}
+
+
+BHandler*
+DownloadProgressAggregator::AddDownload(SegmentedDownload* download)
+{
+	Listener* listener = _AddListener(download);
+	if (listener != NULL)
+		download->SetProgressListener(BMessenger(listener));
+	return listener;
+}
+
+
+void
+DownloadProgressAggregator::RemoveDownload(BHandler* handler)
+{
+	Listener* listener = dynamic_cast<Listener*>(handler);
+	if (listener == NULL || !Lock())
+		return;
+
+	if (listener->fChanged) {
+		for (size_t i = 0; i < fChanged.size(); i++) {
+			if (fChanged[i] == listener) {
+				fChanged.erase(fChanged.begin() + i);
+				break;
+			}
+		}
+	}
+	RemoveHandler(listener);
+	Unlock();
+
+	delete listener;
+}
+
+
+/*!	Adds the latest sizes of all downloads that made progress since the
+	last call to \a progress.
+*/
+void
+DownloadProgressAggregator::Collect(std::vector<Progress>& progress)
+{
+	if (!Lock())
+		return;
+
+	for (size_t i = 0; i < fChanged.size(); i++) {
+		Listener* listener = fChanged[i];
+		Progress entry = { listener->fDownload, listener->fCurrentSize,
+			listener->fExpectedSize };
+		progress.push_back(entry);
+		listener->fChanged = false;
+	}
+	fChanged.clear();
+	fDeliveryPending = false;
+	fLastDelivery = system_time();
+
+	Unlock();
+}
+
+
+// #pragma mark - private
+
+
+DownloadProgressAggregator::Listener*
+DownloadProgressAggregator::_AddListener(const void* download)
+{
+	Listener* listener = new Listener(this, download);
+	if (!Lock()) {
+		delete listener;
+		return NULL;
+	}
+	AddHandler(listener);
+	Unlock();
+	return listener;
+}
+
+
+/*!	Called in the looper thread whenever \a listener received progress.
+	The target is told once, no sooner than kDeliveryInterval after it
+	last collected, and collects everything that arrived until then.
+*/
+void
+DownloadProgressAggregator::_ProgressChanged(Listener* listener)
+{
+	if (!listener->fChanged) {
+		listener->fChanged = true;
+		fChanged.push_back(listener);
+	}
+
+	if (fDeliveryPending)
+		return;
+
+	fDeliveryPending = true;
+	BMessage message(DOWNLOAD_PROGRESS_AVAILABLE);
+	bigtime_t delay = fLastDelivery + kDeliveryInterval - system_time();
+	if (delay <= 0
+		|| BMessageRunner::StartSending(fTarget, &message, delay, 1)
+			!= B_OK) {
+		fTarget.SendMessage(&message);
+	}
+}
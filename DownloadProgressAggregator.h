@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef DOWNLOAD_PROGRESS_AGGREGATOR_H
+#define DOWNLOAD_PROGRESS_AGGREGATOR_H
+
+
+#include <Looper.h>
+#include <Messenger.h>
+
+#include <vector>
+
+
+class BWebDownload;
+class SegmentedDownload;
+
+
+enum {
+	DOWNLOAD_PROGRESS_AVAILABLE = 'dlpa'
+};
+
+
+/*!	Receives the messages of all running downloads in its own thread. Of
+	the progress messages, only the latest sizes of each download are kept,
+	and the target is sent a single DOWNLOAD_PROGRESS_AVAILABLE message at
+	most every kDeliveryInterval, upon which it collects them all at once.
+	This way, the download window does not get a message for every chunk
+	received, no matter how many downloads are running.
+
+	The other download messages are rare, and are forwarded to the target
+	right away, with the "download" they belong to added. Both WebKit's
+	downloads and SegmentedDownloads send the same messages.
+*/
+class DownloadProgressAggregator : public BLooper {
+public:
+			struct Progress {
+				const void*		download;
+				off_t			currentSize;
+				off_t			expectedSize;
+			};
+
+								DownloadProgressAggregator();
+
+			void				SetTarget(const BMessenger& target);
+
+			BHandler*			AddDownload(BWebDownload* download);
+			BHandler*			AddDownload(SegmentedDownload* download);
+			void				RemoveDownload(BHandler* listener);
+
+			void				Collect(std::vector<Progress>& progress);
+
+private:
+			class Listener;
+			friend class Listener;
+
+			Listener*			_AddListener(const void* download);
+			void				_ProgressChanged(Listener* listener);
+
+private:
+			BMessenger			fTarget;
+			std::vector<Listener*> fChanged;
+			bigtime_t			fLastDelivery;
+			bool				fDeliveryPending;
+};
+
+
+#endif // DOWNLOAD_PROGRESS_AGGREGATOR_H
@@ -7,33 +7,36 @@
 #include "DownloadProgressView.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include <Alert.h>
 #include <Application.h>
 #include <Bitmap.h>
-#include <Button.h>
 #include <Catalog.h>
 #include <Clipboard.h>
+#include <ControlLook.h>
 #include <Directory.h>
 #include <DateTimeFormat.h>
 #include <DurationFormat.h>
 #include <Entry.h>
 #include <FindDirectory.h>
-#include <GroupLayoutBuilder.h>
 #include <Locale.h>
+#include <Looper.h>
+#include <Menu.h>
 #include <MenuItem.h>
 #include <NodeInfo.h>
 #include <NodeMonitor.h>
 #include <Notification.h>
 #include <PopUpMenu.h>
 #include <Roster.h>
-#include <SpaceLayoutItem.h>
-#include <StatusBar.h>
-#include <StringView.h>
 #include <TimeFormat.h>
+#include <Window.h>
 
+#include "BandwidthScheduler.h"
 #include "BrowserApp.h" // For MSG_APP_REQUEST_DOWNLOAD
 #include "BrowserWindow.h"
+#include "DownloadProgressAggregator.h"
+#include "SegmentedDownload.h"
 #include "WebDownload.h"
 #include "WebPage.h"
 #include "StringForSize.h"
@@ -49,6 +52,13 @@ enum {
 	REMOVE_DOWNLOAD			= 'rmdn',
 	COPY_URL_TO_CLIPBOARD	= 'curl',
 	OPEN_CONTAINING_FOLDER	= 'opfd',
+	PAUSE_DOWNLOAD			= 'padn',
+	SET_DOWNLOAD_PRIORITY	= 'prdn',
+};
+
+enum {
+	TOP_BUTTON = 0,
+	BOTTOM_BUTTON
 };
 
 const bigtime_t kMaxUpdateInterval = 100000LL;
@@ -61,311 +71,127 @@ bool DownloadProgressView::sShowSpeed = true;
 static const time_t kSecondsPerDay = 24 * 60 * 60;
 static const time_t kSecondsPerHour = 60 * 60;
 
+static const float kIconSize = 32;
+static const float kBarHeight = 12;
+static const float kSpacing = 8;
+static const float kInsetLeft = 8;
+static const float kInsetTop = 5;
+static const float kInsetRight = 5;
+static const float kInsetBottom = 6;
 
-class IconView : public BView {
-public:
-	IconView(const BEntry& entry)
-		:
-		BView("Download icon", B_WILL_DRAW),
-		fIconBitmap(BRect(0, 0, 31, 31), 0, B_RGBA32),
-		fDimmedIcon(false)
-	{
-		SetDrawingMode(B_OP_OVER);
-		SetTo(entry);
-	}
-
-	IconView()
-		:
-		BView("Download icon", B_WILL_DRAW),
-		fIconBitmap(BRect(0, 0, 31, 31), 0, B_RGBA32),
-		fDimmedIcon(false)
-	{
-		SetDrawingMode(B_OP_OVER);
-		memset(fIconBitmap.Bits(), 0, fIconBitmap.BitsLength());
-	}
-
-	IconView(BMessage* archive)
-		:
-		BView("Download icon", B_WILL_DRAW),
-		fIconBitmap(archive),
-		fDimmedIcon(true)
-	{
-		SetDrawingMode(B_OP_OVER);
-	}
-
-	void SetTo(const BEntry& entry)
-	{
-		BNode node(&entry);
-		BNodeInfo info(&node);
-		info.GetTrackerIcon(&fIconBitmap, B_LARGE_ICON);
-		Invalidate();
-	}
-
-	void SetIconDimmed(bool iconDimmed)
-	{
-		if (fDimmedIcon != iconDimmed) {
-			fDimmedIcon = iconDimmed;
-			Invalidate();
-		}
-	}
-
-	bool IsIconDimmed() const
-	{
-		return fDimmedIcon;
-	}
-
-	status_t SaveSettings(BMessage* archive)
-	{
-		return fIconBitmap.Archive(archive);
-	}
-
-	virtual void AttachedToWindow()
-	{
-		AdoptParentColors();
-	}
-
-	virtual void Draw(BRect updateRect)
-	{
-		if (fDimmedIcon) {
-			SetDrawingMode(B_OP_ALPHA);
-			SetBlendingMode(B_CONSTANT_ALPHA, B_ALPHA_OVERLAY);
-			SetHighColor(0, 0, 0, 100);
-		}
-		DrawBitmapAsync(&fIconBitmap);
-	}
 
-	virtual BSize MinSize()
-	{
-		return BSize(fIconBitmap.Bounds().Width(),
-			fIconBitmap.Bounds().Height());
-	}
-
-	virtual BSize PreferredSize()
-	{
-		return MinSize();
-	}
-
-	virtual BSize MaxSize()
-	{
-		return MinSize();
-	}
-
-	BBitmap* Bitmap()
-	{
-		return &fIconBitmap;
-	}
-
-private:
-	BBitmap	fIconBitmap;
-	bool	fDimmedIcon;
-};
-
-
-class SmallButton : public BButton {
-public:
-	SmallButton(const char* label, BMessage* message = NULL)
-		:
-		BButton(label, message)
-	{
-		BFont font;
-		GetFont(&font);
-		float size = ceilf(font.Size() * 0.8);
-		font.SetSize(max_c(8, size));
-		SetFont(&font, B_FONT_SIZE);
-	}
-};
-
-
-// #pragma mark - DownloadProgressView
+static const char*
+top_button_label(const DownloadItem* item)
+{
+	if (item->restarting)
+		return B_TRANSLATE("Restarting...");
+	if (item->IsRunning() || item->CanOpen())
+		return B_TRANSLATE("Open");
+	if (item->CanResume())
+		return B_TRANSLATE("Resume");
+	return B_TRANSLATE("Restart");
+}
 
 
-DownloadProgressView::DownloadProgressView(BWebDownload* download)
-	:
-	BGroupView(B_HORIZONTAL, 8),
-	fDownload(download),
-	fURL(download->URL()),
-	fPath(download->Path())
+static const char*
+bottom_button_label(const DownloadItem* item)
 {
+	if (item->IsRunning())
+		return B_TRANSLATE("Cancel");
+	return B_TRANSLATE("Remove");
 }
 
 
-DownloadProgressView::DownloadProgressView(const BMessage* archive)
-	:
-	BGroupView(B_HORIZONTAL, 8),
-	fDownload(NULL),
-	fURL(),
-	fPath()
+static bool
+is_button_enabled(const DownloadItem* item, int32 button)
 {
-	const char* string;
-	if (archive->FindString("path", &string) == B_OK)
-		fPath.SetTo(string);
-	if (archive->FindString("url", &string) == B_OK)
-		fURL = string;
+	if (button == TOP_BUTTON)
+		return !item->IsRunning() && !item->restarting;
+	return true;
 }
 
 
-bool
-DownloadProgressView::Init(BMessage* archive)
-{
-	fCurrentSize = 0;
-	fExpectedSize = 0;
-	fLastUpdateTime = 0;
-	fBytesPerSecond = 0.0;
-	for (size_t i = 0; i < kBytesPerSecondSlots; i++)
-		fBytesPerSecondSlot[i] = 0.0;
-	fCurrentBytesPerSecondSlot = 0;
-	fLastSpeedReferenceSize = 0;
-	fEstimatedFinishReferenceSize = 0;
-
-	fProcessStartTime = fLastSpeedReferenceTime
-		= fEstimatedFinishReferenceTime	= system_time();
-
-	SetViewUIColor(B_LIST_BACKGROUND_COLOR);
-	SetFlags(Flags() | B_FULL_UPDATE_ON_RESIZE | B_WILL_DRAW);
-
-	if (archive) {
-		fStatusBar = new BStatusBar("download progress", fPath.Leaf());
-		float value;
-		if (archive->FindFloat("value", &value) == B_OK)
-			fStatusBar->SetTo(value);
-	} else
-		fStatusBar = new BStatusBar("download progress", "Download");
-	fStatusBar->SetMaxValue(100);
-	fStatusBar->SetBarHeight(12);
-
-	// fPath is only valid when constructed from archive (fDownload == NULL)
-	BEntry entry(fPath.Path());
-
-	if (archive) {
-		if (!entry.Exists())
-			fIconView = new IconView(archive);
-		else
-			fIconView = new IconView(entry);
-	} else
-		fIconView = new IconView();
-
-	if (!fDownload && (fStatusBar->CurrentValue() < 100 || !entry.Exists())) {
-		fTopButton = new SmallButton(B_TRANSLATE("Restart"),
-			new BMessage(RESTART_DOWNLOAD));
-	} else {
-		fTopButton = new SmallButton(B_TRANSLATE("Open"),
-			new BMessage(OPEN_DOWNLOAD));
-		fTopButton->SetEnabled(fDownload == NULL);
-	}
-	if (fDownload) {
-		fBottomButton = new SmallButton(B_TRANSLATE("Cancel"),
-			new BMessage(CANCEL_DOWNLOAD));
-	} else {
-		fBottomButton = new SmallButton(B_TRANSLATE("Remove"),
-			new BMessage(REMOVE_DOWNLOAD));
-		fBottomButton->SetEnabled(fDownload == NULL);
-	}
-
-	fInfoView = new BStringView("info view", "");
-	fInfoView->SetViewColor(ViewColor());
+// #pragma mark - DownloadProgressView
 
-	BSize topButtonSize = fTopButton->PreferredSize();
-	BSize bottomButtonSize = fBottomButton->PreferredSize();
-	if (bottomButtonSize.width < topButtonSize.width)
-		fBottomButton->SetExplicitMaxSize(topButtonSize);
-	else
-		fTopButton->SetExplicitMaxSize(bottomButtonSize);
-
-	BGroupLayout* layout = GroupLayout();
-	layout->SetInsets(8, 5, 5, 6);
-	layout->AddView(fIconView);
-	BView* verticalGroup = BGroupLayoutBuilder(B_VERTICAL, 3)
-		.Add(fStatusBar)
-		.Add(fInfoView)
-		.TopView()
-	;
-	verticalGroup->SetViewColor(ViewColor());
-	layout->AddView(verticalGroup);
-
-	verticalGroup = BGroupLayoutBuilder(B_VERTICAL, 3)
-		.Add(fTopButton)
-		.Add(fBottomButton)
-		.TopView()
-	;
-	verticalGroup->SetViewColor(ViewColor());
-	layout->AddView(verticalGroup);
-
-	BFont font;
-	fInfoView->GetFont(&font);
-	float fontSize = font.Size() * 0.8f;
-	font.SetSize(max_c(8.0f, fontSize));
-	fInfoView->SetFont(&font, B_FONT_SIZE);
-	fInfoView->SetExplicitMaxSize(BSize(B_SIZE_UNLIMITED, B_SIZE_UNSET));
 
-	return true;
+DownloadProgressView::DownloadProgressView(DownloadModel& model,
+		DownloadProgressAggregator& aggregator)
+	:
+	VirtualListView("downloads", new BMessage(OPEN_DOWNLOAD)),
+	fModel(model),
+	fAggregator(aggregator),
+	fIconBitmap(new BBitmap(BRect(0, 0, kIconSize - 1, kIconSize - 1), 0,
+		B_RGBA32)),
+	fPressedItem(NULL),
+	fPressedButton(-1)
+{
+	SetFlags(Flags() | B_PULSE_NEEDED);
+
+	fSmallFont = *be_plain_font;
+	float fontSize = fSmallFont.Size() * 0.8f;
+	fSmallFont.SetSize(max_c(8.0f, fontSize));
+
+	font_height smallHeight;
+	fSmallFont.GetHeight(&smallHeight);
+	float smallLineHeight = ceilf(smallHeight.ascent + smallHeight.descent);
+	font_height plainHeight;
+	be_plain_font->GetHeight(&plainHeight);
+	float plainLineHeight = ceilf(plainHeight.ascent + plainHeight.descent);
+
+	const char* labels[] = {
+		B_TRANSLATE("Open"),
+		B_TRANSLATE("Restart"),
+		B_TRANSLATE("Restarting..."),
+		B_TRANSLATE("Cancel"),
+		B_TRANSLATE("Remove")
+	};
+	fButtonWidth = 0;
+	for (size_t i = 0; i < sizeof(labels) / sizeof(labels[0]); i++)
+		fButtonWidth = max_c(fButtonWidth, fSmallFont.StringWidth(labels[i]));
+	fButtonWidth = ceilf(fButtonWidth
+		+ 2 * be_control_look->DefaultLabelSpacing() + 6);
+	fButtonHeight = smallLineHeight + 8;
+
+	// The icon, the status bar with its label and the info text, and the
+	// two buttons next to each other.
+	float contentHeight = max_c(kIconSize, plainLineHeight + 3 + kBarHeight
+		+ 3 + smallLineHeight);
+	contentHeight = max_c(contentHeight, 2 * fButtonHeight + 3);
+	SetItemHeight(kInsetTop + contentHeight + kInsetBottom);
+
+	SetExplicitMinSize(BSize(kInsetLeft + kIconSize + 2 * kSpacing
+		+ fButtonWidth + kInsetRight + 150, 80));
 }
 
 
-status_t
-DownloadProgressView::SaveSettings(BMessage* archive)
+DownloadProgressView::~DownloadProgressView()
 {
-	if (!archive)
-		return B_BAD_VALUE;
-	status_t ret = archive->AddString("path", fPath.Path());
-	if (ret == B_OK)
-		ret = archive->AddString("url", fURL.String());
-	if (ret == B_OK)
-		ret = archive->AddFloat("value", fStatusBar->CurrentValue());
-	if (ret == B_OK)
-		ret = fIconView->SaveSettings(archive);
-	return ret;
+	delete fIconBitmap;
 }
 
 
 void
 DownloadProgressView::AttachedToWindow()
 {
-	if (fDownload) {
-		fDownload->SetProgressListener(BMessenger(this));
-		// Will start node monitor upon receiving the B_DOWNLOAD_STARTED
-		// message.
-	} else {
-		BEntry entry(fPath.Path());
-		if (entry.Exists())
-			_StartNodeMonitor(entry);
-	}
-
-	fTopButton->SetTarget(this);
-	fBottomButton->SetTarget(this);
+	SetTarget(this);
+	fAggregator.SetTarget(BMessenger(this));
+	VirtualListView::AttachedToWindow();
 }
 
 
 void
 DownloadProgressView::DetachedFromWindow()
 {
-	_StopNodeMonitor();
-}
-
+	stop_watching(this);
 
-void
-DownloadProgressView::AllAttached()
-{
-	fStatusBar->SetLowColor(ViewColor());
-	fInfoView->SetLowColor(ViewColor());
-	fInfoView->SetHighUIColor(B_LIST_ITEM_TEXT_COLOR);
+	for (int32 i = 0; i < fModel.CountItems(); i++) {
+		DownloadItem* item = fModel.ItemAt(i);
+		_StopListening(item);
+		item->node = node_ref();
+		fModel.ItemChanged(item);
+	}
 
-	SetViewColor(B_TRANSPARENT_COLOR);
-	SetLowUIColor(B_LIST_BACKGROUND_COLOR);
-	if (LowColor().IsLight())
-		SetHighColor(tint_color(LowColor(), B_DARKEN_1_TINT));
-	else
-		SetHighColor(tint_color(LowColor(), B_LIGHTEN_1_TINT));
-}
-
-
-void
-DownloadProgressView::Draw(BRect updateRect)
-{
-	BRect bounds(Bounds());
-	bounds.bottom--;
-	FillRect(bounds, B_SOLID_LOW);
-	bounds.bottom++;
-	StrokeLine(bounds.LeftBottom(), bounds.RightBottom());
+	VirtualListView::DetachedFromWindow();
 }
 
 
@@ -373,316 +199,439 @@ void
 DownloadProgressView::MessageReceived(BMessage* message)
 {
 	switch (message->what) {
+		case B_NODE_MONITOR:
+			_NodeMonitorMessage(message);
+			break;
+
 		case B_DOWNLOAD_STARTED:
+		case B_DOWNLOAD_REMOVED:
+		case SEGMENTED_DOWNLOAD_DECLINED:
 		{
-			BString path;
-			if (message->FindString("path", &path) != B_OK)
+			void* download;
+			if (message->FindPointer("download", &download) != B_OK)
 				break;
-			fPath.SetTo(path);
-			BEntry entry(fPath.Path());
-			fIconView->SetTo(entry);
-			fStatusBar->Reset(fPath.Leaf());
-			_StartNodeMonitor(entry);
-
-			// Immediately switch to speed display whenever a new download
-			// starts.
-			sShowSpeed = true;
-			sLastEstimatedFinishSpeedToggleTime
-				= fProcessStartTime = fLastSpeedReferenceTime
-				= fEstimatedFinishReferenceTime = system_time();
+			DownloadItem* item = fModel.FindDownload(download);
+			if (item != NULL)
+				_DownloadMessage(item, message);
 			break;
 		}
-		case B_DOWNLOAD_PROGRESS:
-		{
-			int64 currentSize;
-			int64 expectedSize;
-			if (message->FindInt64("current size", &currentSize) == B_OK
-				&& message->FindInt64("expected size", &expectedSize) == B_OK) {
-				_UpdateStatus(currentSize, expectedSize);
-			}
-			break;
-		}
-		case B_DOWNLOAD_REMOVED:
-			// TODO: This is a bit asymetric. The removed notification
-			// arrives here, but it would be nicer if it arrived
-			// at the window...
-			Window()->PostMessage(message);
+		case DOWNLOAD_PROGRESS_AVAILABLE:
+			_CollectProgress();
 			break;
+
 		case OPEN_DOWNLOAD:
 		{
-			// TODO: In case of executable files, ask the user first!
-			entry_ref ref;
-			status_t status = get_ref_for_path(fPath.Path(), &ref);
-			if (status == B_OK)
-				status = be_roster->Launch(&ref);
-			if (status != B_OK && status != B_ALREADY_RUNNING) {
-				BAlert* alert = new BAlert(B_TRANSLATE("Open download error"),
-					B_TRANSLATE("The download could not be opened."),
-					B_TRANSLATE("OK"));
-				alert->SetFlags(alert->Flags() | B_CLOSE_ON_ESCAPE);
-				alert->Go(NULL);
-			}
+			// Sent on double click and Enter.
+			DownloadItem* item = fModel.ItemAt(
+				message->GetInt32("index", -1));
+			if (item != NULL && item->CanOpen())
+				_ItemMessage(item, message);
 			break;
 		}
+
+		// Context menu messages
 		case RESTART_DOWNLOAD:
+		case PAUSE_DOWNLOAD:
+		case SET_DOWNLOAD_PRIORITY:
 		{
-			BMessage request(BrowserApp::MSG_APP_REQUEST_DOWNLOAD);
-			request.AddString("url", fURL);
-			if (fPath.InitCheck() == B_OK)
-				request.AddString("suggested_filename", fPath.Leaf());
-
-			be_app->PostMessage(&request);
-
-			// Update UI to reflect restart attempt
-			fTopButton->SetEnabled(false); // Disable restart until new download starts or fails
-			fTopButton->SetLabel(B_TRANSLATE("Restarting..."));
-			// The old DownloadProgressView will eventually be removed when the new
-			// download starts (if successful) or could be manually removed by user.
-			break;
-		}
-
-		case CANCEL_DOWNLOAD:
-			CancelDownload();
+			DownloadItem* item = fModel.FindID(message->GetUInt32("id", 0));
+			if (item != NULL)
+				_ItemMessage(item, message);
 			break;
-
-		case REMOVE_DOWNLOAD:
-		{
-			Window()->PostMessage(SAVE_SETTINGS);
-			RemoveSelf();
-			delete this;
-			// TOAST!
-			return;
 		}
-		case B_NODE_MONITOR:
+		case COPY_URL_TO_CLIPBOARD:
 		{
-			int32 opCode;
-			if (message->FindInt32("opcode", &opCode) != B_OK)
+			BString url;
+			if (message->FindString("url", &url) != B_OK)
 				break;
-			switch (opCode) {
-				case B_ENTRY_REMOVED:
-					fIconView->SetIconDimmed(true);
-					CancelDownload();
-					break;
-				case B_ENTRY_MOVED:
-				{
-					// Follow the entry to the new location
-					dev_t device;
-					ino_t directory;
-					const char* name;
-					if (message->FindInt32("device",
-							reinterpret_cast<int32*>(&device)) != B_OK
-						|| message->FindInt64("to directory",
-							reinterpret_cast<int64*>(&directory)) != B_OK
-						|| message->FindString("name", &name) != B_OK
-						|| strlen(name) == 0) {
-						break;
-					}
-					// Construct the BEntry and update fPath
-					entry_ref ref(device, directory, name);
-					BEntry entry(&ref);
-					if (entry.GetPath(&fPath) != B_OK)
-						break;
-
-					// Find out if the directory is the Trash for this
-					// volume
-					char trashPath[B_PATH_NAME_LENGTH];
-					if (find_directory(B_TRASH_DIRECTORY, device, false,
-							trashPath, B_PATH_NAME_LENGTH) == B_OK) {
-						BPath trashDirectory(trashPath);
-						BPath parentDirectory;
-						fPath.GetParent(&parentDirectory);
-						if (parentDirectory == trashDirectory) {
-							// The entry was moved into the Trash.
-							// If the download is still in progress,
-							// cancel it.
-							fIconView->SetIconDimmed(true);
-							CancelDownload();
-							break;
-						} else if (fIconView->IsIconDimmed()) {
-							// Maybe it was moved out of the trash.
-							fIconView->SetIconDimmed(false);
-						}
-					}
-
-					// Inform download of the new path
-					if (fDownload)
-						fDownload->HasMovedTo(fPath);
-
-					float value = fStatusBar->CurrentValue();
-					fStatusBar->Reset(name);
-					fStatusBar->SetTo(value);
-					Window()->PostMessage(SAVE_SETTINGS);
-					break;
-				}
-				case B_ATTR_CHANGED:
-				{
-					BEntry entry(fPath.Path());
-					fIconView->SetIconDimmed(false);
-					fIconView->SetTo(entry);
-					break;
-				}
-			}
-			break;
-		}
-
-		// Context menu messages
-		case COPY_URL_TO_CLIPBOARD:
 			if (be_clipboard->Lock()) {
 				BMessage* data = be_clipboard->Data();
 				if (data != NULL) {
 					be_clipboard->Clear();
-					data->AddData("text/plain", B_MIME_TYPE, fURL.String(),
-						fURL.Length());
+					data->AddData("text/plain", B_MIME_TYPE, url.String(),
+						url.Length());
 				}
 				be_clipboard->Commit();
 				be_clipboard->Unlock();
 			}
 			break;
+		}
 		case OPEN_CONTAINING_FOLDER:
-			if (fPath.InitCheck() == B_OK) {
-				BEntry selected(fPath.Path());
-				if (!selected.Exists())
-					break;
+		{
+			const char* path;
+			if (message->FindString("path", &path) != B_OK)
+				break;
 
-				BPath containingFolder;
-				if (fPath.GetParent(&containingFolder) != B_OK)
-					break;
-				entry_ref ref;
-				if (get_ref_for_path(containingFolder.Path(), &ref) != B_OK)
-					break;
+			BPath selectedPath(path);
+			BEntry selected(path);
+			if (!selected.Exists())
+				break;
 
-				// Ask Tracker to open the containing folder and select the
-				// file inside it.
-				BMessenger trackerMessenger("application/x-vnd.Be-TRAK");
+			BPath containingFolder;
+			if (selectedPath.GetParent(&containingFolder) != B_OK)
+				break;
+			entry_ref ref;
+			if (get_ref_for_path(containingFolder.Path(), &ref) != B_OK)
+				break;
 
-				if (trackerMessenger.IsValid()) {
-					BMessage selectionCommand(B_REFS_RECEIVED);
-					selectionCommand.AddRef("refs", &ref);
+			// Ask Tracker to open the containing folder and select the
+			// file inside it.
+			BMessenger trackerMessenger("application/x-vnd.Be-TRAK");
 
-					node_ref selectedRef;
-					if (selected.GetNodeRef(&selectedRef) == B_OK) {
-						selectionCommand.AddData("nodeRefToSelect", B_RAW_TYPE,
-							(void*)&selectedRef, sizeof(node_ref));
-					}
+			if (trackerMessenger.IsValid()) {
+				BMessage selectionCommand(B_REFS_RECEIVED);
+				selectionCommand.AddRef("refs", &ref);
 
-					trackerMessenger.SendMessage(&selectionCommand);
+				node_ref selectedRef;
+				if (selected.GetNodeRef(&selectedRef) == B_OK) {
+					selectionCommand.AddData("nodeRefToSelect", B_RAW_TYPE,
+						(void*)&selectedRef, sizeof(node_ref));
 				}
+
+				trackerMessenger.SendMessage(&selectionCommand);
 			}
 			break;
+		}
 
 		default:
-			BGroupView::MessageReceived(message);
+			VirtualListView::MessageReceived(message);
 	}
 }
 
 
 void
-DownloadProgressView::ShowContextMenu(BPoint screenWhere)
+DownloadProgressView::MouseDown(BPoint where)
 {
-	screenWhere += BPoint(2, 2);
+	int32 buttons = 0;
+	if (Window()->CurrentMessage() != NULL)
+		Window()->CurrentMessage()->FindInt32("buttons", &buttons);
 
-	BPopUpMenu* contextMenu = new BPopUpMenu("download context");
-	BMenuItem* copyURL = new BMenuItem(B_TRANSLATE("Copy URL to clipboard"),
-		new BMessage(COPY_URL_TO_CLIPBOARD));
-	copyURL->SetEnabled(fURL.Length() > 0);
-	contextMenu->AddItem(copyURL);
-	BMenuItem* openFolder = new BMenuItem(B_TRANSLATE("Open containing folder"),
-		new BMessage(OPEN_CONTAINING_FOLDER));
-	contextMenu->AddItem(openFolder);
+	int32 button;
+	DownloadItem* item = _ItemAt(where, &button);
 
-	contextMenu->SetTargetForItems(this);
-	contextMenu->Go(screenWhere, true, true, true);
+	if ((buttons & B_SECONDARY_MOUSE_BUTTON) != 0) {
+		if (item != NULL) {
+			Select(fModel.IndexOf(item));
+			ShowContextMenu(item, ConvertToScreen(where));
+		}
+		return;
+	}
+
+	if (item != NULL && button >= 0) {
+		if (is_button_enabled(item, button)) {
+			fPressedItem = item;
+			fPressedButton = button;
+			SetMouseEventMask(B_POINTER_EVENTS, B_LOCK_WINDOW_FOCUS);
+			InvalidateItem(fModel.IndexOf(item));
+		}
+		return;
+	}
+
+	VirtualListView::MouseDown(where);
 }
 
 
-BWebDownload*
-DownloadProgressView::Download() const
+void
+DownloadProgressView::MouseUp(BPoint where)
 {
-	return fDownload;
+	DownloadItem* item = fPressedItem;
+	int32 pressedButton = fPressedButton;
+	fPressedItem = NULL;
+	fPressedButton = -1;
+	if (item == NULL)
+		return;
+
+	InvalidateItem(fModel.IndexOf(item));
+
+	int32 button;
+	if (_ItemAt(where, &button) != item || button != pressedButton
+		|| !is_button_enabled(item, button)) {
+		return;
+	}
+
+	uint32 what;
+	if (button == TOP_BUTTON)
+		what = item->CanOpen() ? OPEN_DOWNLOAD : RESTART_DOWNLOAD;
+	else
+		what = item->IsRunning() ? CANCEL_DOWNLOAD : REMOVE_DOWNLOAD;
+
+	BMessage message(what);
+	_ItemMessage(item, &message);
 }
 
 
-const BString&
-DownloadProgressView::URL() const
+void
+DownloadProgressView::Pulse()
 {
-	return fURL;
+	SpeedVersusEstimatedFinishTogglePulse();
+
+	// Only the visible running downloads show a status text.
+	BRect bounds(Bounds());
+	int32 first = (int32)(bounds.top / ItemHeight());
+	int32 last = (int32)(bounds.bottom / ItemHeight());
+	for (int32 i = first; i <= last; i++) {
+		DownloadItem* item = fModel.ItemAt(i);
+		if (item != NULL && item->IsRunning())
+			InvalidateItem(i);
+	}
 }
 
 
-bool
-DownloadProgressView::IsMissing() const
+/*!	Adds \a item to the model at \a index, and starts following the
+	download, or watching the downloaded file.
+*/
+void
+DownloadProgressView::AddDownload(DownloadItem* item, int32 index)
 {
-	return fIconView->IsIconDimmed();
+	if (index < 0 || index > fModel.CountItems())
+		index = fModel.CountItems();
+
+	fModel.AddItem(item, index);
+
+	if (item->IsRunning())
+		_StartListening(item);
+	else if (!_StartNodeMonitor(item))
+		item->missing = true;
+
+	fModel.ItemChanged(item);
+	ItemsInserted(index, 1);
 }
 
 
-bool
-DownloadProgressView::IsFinished() const
+void
+DownloadProgressView::RemoveDownload(DownloadItem* item)
 {
-	return !fDownload && fStatusBar->CurrentValue() == 100;
+	int32 index = fModel.IndexOf(item);
+	if (index < 0)
+		return;
+
+	_StopListening(item);
+	_StopNodeMonitor(item);
+	if (fPressedItem == item)
+		fPressedItem = NULL;
+
+	fModel.RemoveItemAt(index);
+	ItemsRemoved(index, 1);
+	delete item;
 }
 
 
 void
-DownloadProgressView::DownloadFinished()
+DownloadProgressView::RemoveDownloads(DownloadModel::ItemFilter filter)
 {
-	fDownload = NULL;
-	if (fExpectedSize == -1) {
-		fStatusBar->SetTo(100.0);
-		fExpectedSize = fCurrentSize;
+	std::vector<DownloadItem*> removed;
+	fModel.RemoveItems(filter, removed);
+	if (removed.empty())
+		return;
+
+	for (size_t i = 0; i < removed.size(); i++) {
+		DownloadItem* item = removed[i];
+		_StopListening(item);
+		if (item->node != node_ref())
+			watch_node(&item->node, B_STOP_WATCHING, BMessenger(this));
+		if (fPressedItem == item)
+			fPressedItem = NULL;
+		delete item;
 	}
-	fTopButton->SetEnabled(true);
-	fBottomButton->SetLabel(B_TRANSLATE("Remove"));
-	fBottomButton->SetMessage(new BMessage(REMOVE_DOWNLOAD));
-	fBottomButton->SetEnabled(true);
-	fInfoView->SetText("");
-	fStatusBar->SetBarColor(ui_color(B_SUCCESS_COLOR));
+
+	SetItemCount(fModel.CountItems());
+}
+
+
+void
+DownloadProgressView::DownloadFinished(DownloadItem* item)
+{
+	if (item->segmented != NULL)
+		item->resumeOffset = item->segmented->ResumeOffset();
+	_ReleaseDownload(item);
+	if (item->expectedSize == -1) {
+		item->progress = 100.0;
+		item->expectedSize = item->currentSize;
+	}
+	_ItemChanged(item);
 
 	BNotification success(B_INFORMATION_NOTIFICATION);
 	success.SetGroup(B_TRANSLATE("WebPositive"));
 	success.SetTitle(B_TRANSLATE("Download finished"));
-	success.SetContent(fPath.Leaf());
-	BEntry entry(fPath.Path());
+	success.SetContent(item->path.Leaf());
+	BEntry entry(item->path.Path());
 	entry_ref ref;
 	entry.GetRef(&ref);
 	success.SetOnClickFile(&ref);
-	success.SetIcon(fIconView->Bitmap());
+	if (const BBitmap* icon = _Icon(item))
+		success.SetIcon(icon);
 	success.Send();
-
 }
 
 
 void
-DownloadProgressView::CancelDownload()
+DownloadProgressView::CancelDownload(DownloadItem* item)
 {
 	// Show the cancel notification, and set the progress bar red, only if the
 	// download was still running. In cases where the file is deleted after
 	// the download was finished, we don't want these things to happen.
-	if (fDownload) {
+	if (item->IsRunning()) {
 		// Also cancel the download
-		fDownload->Cancel();
+		if (item->segmented != NULL)
+			item->segmented->Cancel();
+		if (item->download != NULL)
+			item->download->Cancel();
 		BNotification success(B_ERROR_NOTIFICATION);
 		success.SetGroup(B_TRANSLATE("WebPositive"));
 		success.SetTitle(B_TRANSLATE("Download aborted"));
-		success.SetContent(fPath.Leaf());
+		success.SetContent(item->path.Leaf());
 		// Don't make a click on the notification open the file: it is not
 		// complete
-		success.SetIcon(fIconView->Bitmap());
+		if (const BBitmap* icon = _Icon(item))
+			success.SetIcon(icon);
 		success.Send();
 
-		fStatusBar->SetBarColor(ui_color(B_FAILURE_COLOR));
+		item->failed = true;
 	}
 
-	fDownload = NULL;
-	fTopButton->SetLabel(B_TRANSLATE("Restart"));
-	fTopButton->SetMessage(new BMessage(RESTART_DOWNLOAD));
-	fTopButton->SetEnabled(true);
-	fBottomButton->SetLabel(B_TRANSLATE("Remove"));
-	fBottomButton->SetMessage(new BMessage(REMOVE_DOWNLOAD));
-	fBottomButton->SetEnabled(true);
-	fInfoView->SetText("");
+	_ReleaseDownload(item);
+	item->restarting = false;
+	item->path.Unset();
+	_ItemChanged(item);
+}
+
 
-	fPath.Unset();
+/*!	Lets \a download continue the download of \a item where it stopped.
+	The item keeps the reference to \a download that the caller passes.
+*/
+status_t
+DownloadProgressView::ResumeDownload(DownloadItem* item,
+	SegmentedDownload* download, int32 connections)
+{
+	item->segmented = download;
+	item->restarting = true;
+	_ItemChanged(item);
+	_StartListening(item);
+
+	status_t status = download->Resume(item->path, item->resumeOffset,
+		item->expectedSize, item->etag, item->lastModified, connections);
+	if (status != B_OK) {
+		_ReleaseDownload(item);
+		_ItemChanged(item);
+	}
+	return status;
+}
+
+
+/*!	Stops the download of \a item, so that it can be resumed later. The
+	partly downloaded file is kept.
+*/
+void
+DownloadProgressView::PauseDownload(DownloadItem* item)
+{
+	if (item->segmented == NULL || item->download != NULL)
+		return;
+
+	item->segmented->Cancel();
+	item->resumeOffset = item->segmented->ResumeOffset();
+	_ReleaseDownload(item);
+	_ItemChanged(item);
+	Window()->PostMessage(DOWNLOADS_CHANGED);
+}
+
+
+/*!	Downloads the URL of \a item again, from the start. The new download
+	replaces the item once it starts.
+*/
+void
+DownloadProgressView::RestartDownload(DownloadItem* item)
+{
+	BMessage request(BrowserApp::MSG_APP_REQUEST_DOWNLOAD);
+	request.AddString("url", item->url);
+	if (item->path.InitCheck() == B_OK)
+		request.AddString("suggested_filename", item->path.Leaf());
+
+	be_app->PostMessage(&request);
+
+	// Disable restart until the new download starts. The old entry
+	// is replaced when it does, or can be removed by the user.
+	item->restarting = true;
+	_ItemChanged(item);
+}
+
+
+void
+DownloadProgressView::ShowContextMenu(DownloadItem* item, BPoint screenWhere)
+{
+	screenWhere += BPoint(2, 2);
+
+	// The messages carry what they need, the download may be gone by the
+	// time they arrive.
+	BPopUpMenu* contextMenu = new BPopUpMenu("download context");
+	BMessage* message = new BMessage(COPY_URL_TO_CLIPBOARD);
+	message->AddString("url", item->url);
+	BMenuItem* copyURL = new BMenuItem(B_TRANSLATE("Copy URL to clipboard"),
+		message);
+	copyURL->SetEnabled(item->url.Length() > 0);
+	contextMenu->AddItem(copyURL);
+	message = new BMessage(OPEN_CONTAINING_FOLDER);
+	message->AddString("path", item->path.Path());
+	BMenuItem* openFolder = new BMenuItem(B_TRANSLATE("Open containing folder"),
+		message);
+	openFolder->SetEnabled(item->path.InitCheck() == B_OK);
+	contextMenu->AddItem(openFolder);
+	contextMenu->AddSeparatorItem();
+
+	if (item->IsRunning()) {
+		if (item->bytesPerSecond > 0) {
+			char buffer[128];
+			BString speed(B_TRANSLATE_COMMENT("Receiving at %rate/s",
+				"Don't translate variable %rate"));
+			speed.ReplaceFirst("%rate", string_for_size(item->bytesPerSecond,
+				buffer, sizeof(buffer)));
+			BMenuItem* speedItem = new BMenuItem(speed, NULL);
+			speedItem->SetEnabled(false);
+			contextMenu->AddItem(speedItem);
+		}
+
+		// Only downloads run by a SegmentedDownload can be continued, or
+		// prioritized.
+		message = new BMessage(PAUSE_DOWNLOAD);
+		message->AddUInt32("id", item->id);
+		BMenuItem* pause = new BMenuItem(B_TRANSLATE("Pause"), message);
+		pause->SetEnabled(item->segmented != NULL && item->download == NULL);
+		contextMenu->AddItem(pause);
+	} else {
+		message = new BMessage(RESTART_DOWNLOAD);
+		message->AddUInt32("id", item->id);
+		BMenuItem* resume = new BMenuItem(B_TRANSLATE("Resume"), message);
+		resume->SetEnabled(item->CanResume() && !item->restarting);
+		contextMenu->AddItem(resume);
+	}
+
+	BMenu* priorityMenu = new BMenu(B_TRANSLATE("Priority"));
+	static const int32 kPriorities[] = {
+		BandwidthScheduler::PRIORITY_HIGH,
+		BandwidthScheduler::PRIORITY_NORMAL,
+		BandwidthScheduler::PRIORITY_LOW
+	};
+	const char* labels[] = {
+		B_TRANSLATE("High"),
+		B_TRANSLATE("Normal"),
+		B_TRANSLATE("Low")
+	};
+	for (size_t i = 0; i < sizeof(kPriorities) / sizeof(kPriorities[0]);
+			i++) {
+		message = new BMessage(SET_DOWNLOAD_PRIORITY);
+		message->AddUInt32("id", item->id);
+		message->AddInt32("priority", kPriorities[i]);
+		BMenuItem* priorityItem = new BMenuItem(labels[i], message);
+		priorityItem->SetMarked(item->priority == kPriorities[i]);
+		priorityMenu->AddItem(priorityItem);
+	}
+	priorityMenu->SetTargetForItems(this);
+	priorityMenu->SetEnabled(item->IsRunning()
+		? item->segmented != NULL && item->download == NULL
+		: item->CanResume());
+	contextMenu->AddItem(priorityMenu);
+
+	contextMenu->SetTargetForItems(this);
+	contextMenu->Go(screenWhere, true, true, true);
 }
 
 
@@ -704,61 +653,433 @@ DownloadProgressView::SpeedVersusEstimatedFinishTogglePulse()
 }
 
 
+void
+DownloadProgressView::DrawItem(int32 index, BRect frame, bool selected)
+{
+	DownloadItem* item = fModel.ItemAt(index);
+	if (item == NULL)
+		return;
+
+	SetLowUIColor(selected
+		? B_LIST_SELECTED_BACKGROUND_COLOR : B_LIST_BACKGROUND_COLOR);
+	rgb_color background = LowColor();
+	BRect bounds(frame);
+	bounds.bottom--;
+	FillRect(bounds, B_SOLID_LOW);
+	if (background.IsLight())
+		SetHighColor(tint_color(background, B_DARKEN_1_TINT));
+	else
+		SetHighColor(tint_color(background, B_LIGHTEN_1_TINT));
+	StrokeLine(frame.LeftBottom(), frame.RightBottom());
+
+	BRect content(frame.left + kInsetLeft, frame.top + kInsetTop,
+		frame.right - kInsetRight, frame.bottom - kInsetBottom);
+
+	// Icon
+	if (const BBitmap* icon = _Icon(item)) {
+		BPoint iconWhere(content.left,
+			floorf(content.top + (content.Height() - kIconSize) / 2));
+		if (item->IsMissing()) {
+			SetDrawingMode(B_OP_ALPHA);
+			SetBlendingMode(B_CONSTANT_ALPHA, B_ALPHA_OVERLAY);
+			SetHighColor(0, 0, 0, 100);
+		} else
+			SetDrawingMode(B_OP_OVER);
+		// Not asynchronously, the bitmap is refilled for the next row.
+		DrawBitmap(icon, iconWhere);
+		SetDrawingMode(B_OP_COPY);
+	}
+
+	// Buttons
+	for (int32 button = TOP_BUTTON; button <= BOTTOM_BUTTON; button++) {
+		BRect buttonFrame = _ButtonFrame(frame, button == TOP_BUTTON);
+		uint32 flags = 0;
+		if (!is_button_enabled(item, button))
+			flags |= BControlLook::B_DISABLED;
+		if (item == fPressedItem && button == fPressedButton)
+			flags |= BControlLook::B_ACTIVATED;
+		rgb_color base = ui_color(B_CONTROL_BACKGROUND_COLOR);
+		SetFont(&fSmallFont);
+		be_control_look->DrawButtonFrame(this, buttonFrame, frame, base,
+			background, flags);
+		be_control_look->DrawButtonBackground(this, buttonFrame, frame, base,
+			flags);
+		be_control_look->DrawLabel(this, button == TOP_BUTTON
+				? top_button_label(item) : bottom_button_label(item),
+			buttonFrame, frame, base, flags,
+			BAlignment(B_ALIGN_CENTER, B_ALIGN_MIDDLE));
+	}
+
+	// Status bar with the file name as its label, and the info text below
+	float left = content.left + kIconSize + kSpacing;
+	float right = _ButtonFrame(frame, true).left - kSpacing;
+	float width = right - left;
+
+	SetFont(be_plain_font);
+	font_height plainHeight;
+	GetFontHeight(&plainHeight);
+	BString label(item->path.InitCheck() == B_OK
+		? item->path.Leaf() : item->url.String());
+	if (label.Length() == 0)
+		label = B_TRANSLATE("Download");
+	TruncateString(&label, B_TRUNCATE_MIDDLE, width);
+	SetHighUIColor(selected
+		? B_LIST_SELECTED_ITEM_TEXT_COLOR : B_LIST_ITEM_TEXT_COLOR);
+	float baseline = content.top + ceilf(plainHeight.ascent);
+	DrawString(label.String(), BPoint(left, baseline));
+
+	BRect barFrame(left, baseline + ceilf(plainHeight.descent) + 3, right,
+		baseline + ceilf(plainHeight.descent) + 3 + kBarHeight - 1);
+	rgb_color barColor = ui_color(B_STATUS_BAR_COLOR);
+	if (item->failed)
+		barColor = ui_color(B_FAILURE_COLOR);
+	else if (item->IsFinished())
+		barColor = ui_color(B_SUCCESS_COLOR);
+	float position = barFrame.left + barFrame.Width() * item->progress / 100;
+	be_control_look->DrawStatusBar(this, barFrame, frame,
+		ui_color(B_PANEL_BACKGROUND_COLOR), barColor, position);
+
+	BString status = _StatusText(item, width);
+	if (status.Length() > 0) {
+		SetFont(&fSmallFont);
+		font_height smallHeight;
+		fSmallFont.GetHeight(&smallHeight);
+		SetHighUIColor(selected
+			? B_LIST_SELECTED_ITEM_TEXT_COLOR : B_LIST_ITEM_TEXT_COLOR);
+		DrawString(status.String(), BPoint(left,
+			barFrame.bottom + 4 + ceilf(smallHeight.ascent)));
+	}
+
+	SetFont(be_plain_font);
+	SetLowUIColor(B_LIST_BACKGROUND_COLOR);
+}
+
+
 // #pragma mark - private
 
 
 void
-DownloadProgressView::_UpdateStatus(off_t currentSize, off_t expectedSize)
+DownloadProgressView::_DownloadMessage(DownloadItem* item, BMessage* message)
+{
+	switch (message->what) {
+		case B_DOWNLOAD_STARTED:
+		{
+			BString path;
+			if (message->FindString("path", &path) != B_OK)
+				break;
+			item->path.SetTo(path);
+			item->icon.clear();
+			item->iconLoaded = false;
+			_StartNodeMonitor(item);
+
+			if (item->segmented != NULL) {
+				// A resumed download does not start from zero.
+				item->currentSize = item->lastSpeedReferenceSize
+					= item->estimatedFinishReferenceSize
+					= item->segmented->CurrentSize();
+				item->etag = item->segmented->ETag();
+				item->lastModified = item->segmented->LastModified();
+			}
+			item->restarting = false;
+			item->failed = false;
+
+			// Immediately switch to speed display whenever a new download
+			// starts.
+			sShowSpeed = true;
+			sLastEstimatedFinishSpeedToggleTime
+				= item->processStartTime = item->lastSpeedReferenceTime
+				= item->estimatedFinishReferenceTime = system_time();
+			if (item->segmented != NULL && item->download != NULL) {
+				// The segmented download took over, WebKit's is not needed.
+				item->download->Cancel();
+				item->download = NULL;
+			}
+			_ItemChanged(item);
+			break;
+		}
+		case SEGMENTED_DOWNLOAD_DECLINED:
+		{
+			if (item->segmented == NULL)
+				break;
+			if (item->download == NULL) {
+				// The download could not be resumed, it is started over.
+				_ReleaseDownload(item);
+				RestartDownload(item);
+				break;
+			}
+
+			// The server does not support ranges, WebKit downloads the file
+			// as usual.
+			BPath directory = item->segmented->Directory();
+			_StopListening(item);
+			item->segmented->ReleaseReference();
+			item->segmented = NULL;
+			_ItemChanged(item);
+			_StartListening(item);
+			item->download->Start(directory);
+			break;
+		}
+		case B_DOWNLOAD_REMOVED:
+			// The last progress may still wait to be collected, the
+			// download is only complete with it.
+			_CollectProgress();
+
+			// TODO: This is a bit asymetric. The removed notification
+			// arrives here, but it would be nicer if it arrived
+			// at the window...
+			Window()->PostMessage(message);
+			break;
+	}
+}
+
+
+void
+DownloadProgressView::_NodeMonitorMessage(BMessage* message)
 {
-	fCurrentSize = currentSize;
-	fExpectedSize = expectedSize;
+	int32 opCode;
+	node_ref nodeRef;
+	if (message->FindInt32("opcode", &opCode) != B_OK
+		|| message->FindInt32("device", &nodeRef.device) != B_OK
+		|| message->FindInt64("node", &nodeRef.node) != B_OK) {
+		return;
+	}
 
-	fStatusBar->SetTo(100.0 * currentSize / expectedSize);
+	DownloadItem* item = fModel.FindNode(nodeRef);
+	if (item == NULL)
+		return;
+
+	switch (opCode) {
+		case B_ENTRY_REMOVED:
+			_StopNodeMonitor(item);
+			item->missing = true;
+			CancelDownload(item);
+			Window()->PostMessage(DOWNLOADS_CHANGED);
+			break;
+		case B_ENTRY_MOVED:
+		{
+			// Follow the entry to the new location
+			dev_t device;
+			ino_t directory;
+			const char* name;
+			if (message->FindInt32("device",
+					reinterpret_cast<int32*>(&device)) != B_OK
+				|| message->FindInt64("to directory",
+					reinterpret_cast<int64*>(&directory)) != B_OK
+				|| message->FindString("name", &name) != B_OK
+				|| strlen(name) == 0) {
+				break;
+			}
+			// Construct the BEntry and update the path
+			entry_ref ref(device, directory, name);
+			BEntry entry(&ref);
+			if (entry.GetPath(&item->path) != B_OK)
+				break;
+
+			// Find out if the directory is the Trash for this
+			// volume
+			char trashPath[B_PATH_NAME_LENGTH];
+			if (find_directory(B_TRASH_DIRECTORY, device, false,
+					trashPath, B_PATH_NAME_LENGTH) == B_OK) {
+				BPath trashDirectory(trashPath);
+				BPath parentDirectory;
+				item->path.GetParent(&parentDirectory);
+				if (parentDirectory == trashDirectory) {
+					// The entry was moved into the Trash.
+					// If the download is still in progress,
+					// cancel it.
+					item->missing = true;
+					CancelDownload(item);
+					Window()->PostMessage(DOWNLOADS_CHANGED);
+					break;
+				} else if (item->missing) {
+					// Maybe it was moved out of the trash.
+					item->missing = false;
+				}
+			}
+
+			// Inform download of the new path
+			if (item->segmented != NULL)
+				item->segmented->HasMovedTo(item->path);
+			else if (item->download != NULL)
+				item->download->HasMovedTo(item->path);
+
+			_ItemChanged(item);
+			Window()->PostMessage(DOWNLOADS_CHANGED);
+			break;
+		}
+		case B_ATTR_CHANGED:
+			item->missing = false;
+			item->iconLoaded = false;
+			_ItemChanged(item);
+			break;
+	}
+}
+
+
+/*!	Carries out the action of one of the buttons of \a item.
+*/
+void
+DownloadProgressView::_ItemMessage(DownloadItem* item, BMessage* message)
+{
+	switch (message->what) {
+		case OPEN_DOWNLOAD:
+		{
+			// TODO: In case of executable files, ask the user first!
+			entry_ref ref;
+			status_t status = get_ref_for_path(item->path.Path(), &ref);
+			if (status == B_OK)
+				status = be_roster->Launch(&ref);
+			if (status != B_OK && status != B_ALREADY_RUNNING) {
+				BAlert* alert = new BAlert(B_TRANSLATE("Open download error"),
+					B_TRANSLATE("The download could not be opened."),
+					B_TRANSLATE("OK"));
+				alert->SetFlags(alert->Flags() | B_CLOSE_ON_ESCAPE);
+				alert->Go(NULL);
+			}
+			break;
+		}
+		case RESTART_DOWNLOAD:
+		{
+			if (item->IsRunning() || item->restarting)
+				break;
+			if (!item->CanResume()) {
+				RestartDownload(item);
+				break;
+			}
+
+			// The window continues the download where it stopped, and
+			// falls back to starting it over.
+			BMessage resume(RESUME_DOWNLOAD);
+			resume.AddUInt32("id", item->id);
+			Window()->PostMessage(&resume);
+
+			item->restarting = true;
+			_ItemChanged(item);
+			break;
+		}
+
+		case CANCEL_DOWNLOAD:
+			CancelDownload(item);
+			break;
+
+		case PAUSE_DOWNLOAD:
+			PauseDownload(item);
+			break;
+
+		case SET_DOWNLOAD_PRIORITY:
+		{
+			int32 priority;
+			if (message->FindInt32("priority", &priority) != B_OK)
+				break;
+			item->priority = priority;
+			if (item->segmented != NULL)
+				item->segmented->SetPriority(priority);
+			_ItemChanged(item);
+			break;
+		}
+
+		case REMOVE_DOWNLOAD:
+			RemoveDownload(item);
+			Window()->PostMessage(DOWNLOADS_CHANGED);
+			break;
+	}
+}
+
+
+/*!	Applies the progress the running downloads made since the last time, in
+	a single pass. The rows that changed are invalidated together, and are
+	redrawn in one update.
+*/
+void
+DownloadProgressView::_CollectProgress()
+{
+	std::vector<DownloadProgressAggregator::Progress> progress;
+	fAggregator.Collect(progress);
+	if (progress.empty())
+		return;
+
+	for (size_t i = 0; i < progress.size(); i++) {
+		DownloadItem* item = fModel.FindDownload(progress[i].download);
+		if (item != NULL) {
+			_UpdateStatus(item, progress[i].currentSize,
+				progress[i].expectedSize);
+		}
+	}
+
+	Window()->PostMessage(DOWNLOADS_PROGRESSED);
+}
+
+
+void
+DownloadProgressView::_UpdateStatus(DownloadItem* item, off_t currentSize,
+	off_t expectedSize)
+{
+	item->currentSize = currentSize;
+	item->expectedSize = expectedSize;
+	item->resumeOffset = item->segmented != NULL
+		? item->segmented->ResumeOffset() : currentSize;
+
+	float progress = expectedSize > 0
+		? 100.0 * currentSize / expectedSize : 0;
+	bool changed = progress != item->progress;
+	item->progress = progress;
 
 	bigtime_t currentTime = system_time();
-	if ((currentTime - fLastUpdateTime) > kMaxUpdateInterval) {
-		fLastUpdateTime = currentTime;
+	if ((currentTime - item->lastUpdateTime) > kMaxUpdateInterval) {
+		item->lastUpdateTime = currentTime;
+		changed = true;
 
-		if (currentTime >= fLastSpeedReferenceTime + kSpeedReferenceInterval) {
+		if (currentTime
+				>= item->lastSpeedReferenceTime + kSpeedReferenceInterval) {
 			// update current speed every kSpeedReferenceInterval
-			fCurrentBytesPerSecondSlot
-				= (fCurrentBytesPerSecondSlot + 1) % kBytesPerSecondSlots;
-			fBytesPerSecondSlot[fCurrentBytesPerSecondSlot]
-				= (double)(currentSize - fLastSpeedReferenceSize)
-					* 1000000LL / (currentTime - fLastSpeedReferenceTime);
-			fLastSpeedReferenceSize = currentSize;
-			fLastSpeedReferenceTime = currentTime;
-			fBytesPerSecond = 0.0;
+			item->currentBytesPerSecondSlot
+				= (item->currentBytesPerSecondSlot + 1)
+					% DownloadItem::kBytesPerSecondSlots;
+			item->bytesPerSecondSlot[item->currentBytesPerSecondSlot]
+				= (double)(currentSize - item->lastSpeedReferenceSize)
+					* 1000000LL / (currentTime - item->lastSpeedReferenceTime);
+			item->lastSpeedReferenceSize = currentSize;
+			item->lastSpeedReferenceTime = currentTime;
+			item->bytesPerSecond = 0.0;
 			size_t count = 0;
-			for (size_t i = 0; i < kBytesPerSecondSlots; i++) {
-				if (fBytesPerSecondSlot[i] != 0.0) {
-					fBytesPerSecond += fBytesPerSecondSlot[i];
+			for (size_t i = 0; i < DownloadItem::kBytesPerSecondSlots; i++) {
+				if (item->bytesPerSecondSlot[i] != 0.0) {
+					item->bytesPerSecond += item->bytesPerSecondSlot[i];
 					count++;
 				}
 			}
 			if (count > 0)
-				fBytesPerSecond /= count;
+				item->bytesPerSecond /= count;
 		}
-		_UpdateStatusText();
 	}
+
+	fModel.CheckpointProgress(item);
+
+	if (changed)
+		InvalidateItem(fModel.IndexOf(item));
 }
 
 
-void
-DownloadProgressView::_UpdateStatusText()
+/*!	Returns the speed or the estimated finish time of a running download,
+	in a version that fits into \a width, or an empty string.
+*/
+BString
+DownloadProgressView::_StatusText(const DownloadItem* item, float width)
 {
-	fInfoView->SetText("");
 	BString buffer;
-	if (sShowSpeed && fBytesPerSecond != 0.0) {
+	if (!item->IsRunning())
+		return buffer;
+
+	if (sShowSpeed && item->bytesPerSecond != 0.0) {
 		// Draw speed info
 		char sizeBuffer[128];
 		// Get strings for current and expected size and remove the unit
 		// from the current size string if it's the same as the expected
 		// size unit.
-		BString currentSize = string_for_size((double)fCurrentSize, sizeBuffer,
-			sizeof(sizeBuffer));
-		BString expectedSize = string_for_size((double)fExpectedSize, sizeBuffer,
-			sizeof(sizeBuffer));
+		BString currentSize = string_for_size((double)item->currentSize,
+			sizeBuffer, sizeof(sizeBuffer));
+		BString expectedSize = string_for_size((double)item->expectedSize,
+			sizeBuffer, sizeof(sizeBuffer));
 		int currentSizeUnitPos = currentSize.FindLast(' ');
 		int expectedSizeUnitPos = expectedSize.FindLast(' ');
 		if (currentSizeUnitPos >= 0 && expectedSizeUnitPos >= 0
@@ -770,26 +1091,23 @@ DownloadProgressView::_UpdateStatusText()
 		buffer = B_TRANSLATE("(%currentSize% of %expectedSize%, %rate%/s)");
 		buffer.ReplaceFirst("%currentSize%", currentSize);
 		buffer.ReplaceFirst("%expectedSize%", expectedSize);
-		buffer.ReplaceFirst("%rate%", string_for_size(fBytesPerSecond,
+		buffer.ReplaceFirst("%rate%", string_for_size(item->bytesPerSecond,
 				sizeBuffer, sizeof(sizeBuffer)));
 
-		float stringWidth = fInfoView->StringWidth(buffer.String());
-		if (stringWidth < fInfoView->Bounds().Width())
-			fInfoView->SetText(buffer.String());
-		else {
-			// complete string too wide, try with shorter version
-			buffer = string_for_size(fBytesPerSecond, sizeBuffer,
-				sizeof(sizeBuffer));
-			buffer << B_TRANSLATE_COMMENT("/s)", "...as in 'per second'");
-			stringWidth = fInfoView->StringWidth(buffer.String());
-			if (stringWidth < fInfoView->Bounds().Width())
-				fInfoView->SetText(buffer.String());
-		}
-	} else if (!sShowSpeed && fCurrentSize < fExpectedSize) {
-		double totalBytesPerSecond = (double)(fCurrentSize
-				- fEstimatedFinishReferenceSize)
-			* 1000000LL / (system_time() - fEstimatedFinishReferenceTime);
-		double secondsRemaining = (fExpectedSize - fCurrentSize)
+		if (fSmallFont.StringWidth(buffer.String()) < width)
+			return buffer;
+
+		// complete string too wide, try with shorter version
+		buffer = string_for_size(item->bytesPerSecond, sizeBuffer,
+			sizeof(sizeBuffer));
+		buffer << B_TRANSLATE_COMMENT("/s)", "...as in 'per second'");
+		if (fSmallFont.StringWidth(buffer.String()) < width)
+			return buffer;
+	} else if (!sShowSpeed && item->currentSize < item->expectedSize) {
+		double totalBytesPerSecond = (double)(item->currentSize
+				- item->estimatedFinishReferenceSize)
+			* 1000000LL / (system_time() - item->estimatedFinishReferenceTime);
+		double secondsRemaining = (item->expectedSize - item->currentSize)
 			/ totalBytesPerSecond;
 		time_t now = (time_t)real_time_clock();
 		time_t finishTime = (time_t)(now + secondsRemaining);
@@ -817,33 +1135,162 @@ DownloadProgressView::_UpdateStatusText()
 		statusString.ReplaceFirst("%date", timeText);
 		statusString.ReplaceFirst("%duration", finishString);
 
-		float stringWidth = fInfoView->StringWidth(statusString.String());
-		if (stringWidth < fInfoView->Bounds().Width())
-			fInfoView->SetText(statusString.String());
-		else {
-			// complete string too wide, try with shorter version
-			statusString.SetTo(B_TRANSLATE("(Finish: %date)"));
-			statusString.ReplaceFirst("%date", timeText);
-			stringWidth = fInfoView->StringWidth(statusString.String());
-			if (stringWidth < fInfoView->Bounds().Width())
-				fInfoView->SetText(statusString.String());
+		if (fSmallFont.StringWidth(statusString.String()) < width)
+			return statusString;
+
+		// complete string too wide, try with shorter version
+		statusString.SetTo(B_TRANSLATE("(Finish: %date)"));
+		statusString.ReplaceFirst("%date", timeText);
+		if (fSmallFont.StringWidth(statusString.String()) < width)
+			return statusString;
+	}
+
+	return BString();
+}
+
+
+/*!	Returns the icon of \a item in the bitmap shared by all rows, or \c NULL
+	if there is none. The icon is read from the file the first time it is
+	needed; downloads from the history only get it when they are shown.
+*/
+const BBitmap*
+DownloadProgressView::_Icon(DownloadItem* item)
+{
+	if (!item->iconLoaded && !item->missing
+		&& item->path.InitCheck() == B_OK) {
+		item->iconLoaded = true;
+		BNode node(item->path.Path());
+		BNodeInfo info(&node);
+		if (node.InitCheck() == B_OK
+			&& info.GetTrackerIcon(fIconBitmap, B_LARGE_ICON) == B_OK) {
+			const uint8* bits = (const uint8*)fIconBitmap->Bits();
+			item->icon.assign(bits, bits + fIconBitmap->BitsLength());
 		}
 	}
+
+	if (item->icon.size() != (size_t)fIconBitmap->BitsLength())
+		return NULL;
+
+	memcpy(fIconBitmap->Bits(), &item->icon[0], item->icon.size());
+	return fIconBitmap;
 }
 
 
+/*!	Updates the model and the row after the state of \a item changed.
+*/
 void
-DownloadProgressView::_StartNodeMonitor(const BEntry& entry)
+DownloadProgressView::_ItemChanged(DownloadItem* item)
+{
+	fModel.ItemChanged(item);
+	InvalidateItem(fModel.IndexOf(item));
+}
+
+
+BRect
+DownloadProgressView::_ButtonFrame(const BRect& itemFrame, bool top) const
+{
+	float contentTop = itemFrame.top + kInsetTop;
+	float contentHeight = itemFrame.Height() - kInsetTop - kInsetBottom;
+	float buttonsTop = floorf(contentTop
+		+ (contentHeight - (2 * fButtonHeight + 3)) / 2);
+
+	BRect frame(itemFrame.right - kInsetRight - fButtonWidth, buttonsTop,
+		itemFrame.right - kInsetRight, buttonsTop + fButtonHeight - 1);
+	if (!top)
+		frame.OffsetBy(0, fButtonHeight + 3);
+	return frame;
+}
+
+
+/*!	Returns the download at \a where, and in \a _button which of its buttons
+	is there, or -1 for none.
+*/
+DownloadItem*
+DownloadProgressView::_ItemAt(BPoint where, int32* _button)
+{
+	*_button = -1;
+	if (where.y < 0)
+		return NULL;
+
+	int32 index = (int32)(where.y / ItemHeight());
+	DownloadItem* item = fModel.ItemAt(index);
+	if (item == NULL)
+		return NULL;
+
+	BRect frame = ItemFrame(index);
+	if (_ButtonFrame(frame, true).Contains(where))
+		*_button = TOP_BUTTON;
+	else if (_ButtonFrame(frame, false).Contains(where))
+		*_button = BOTTOM_BUTTON;
+	return item;
+}
+
+
+/*!	Starts watching the downloaded file of \a item. Returns \c false if
+	there is no such file.
+*/
+bool
+DownloadProgressView::_StartNodeMonitor(DownloadItem* item)
 {
+	_StopNodeMonitor(item);
+
+	BEntry entry(item->path.Path());
 	node_ref nref;
-	if (entry.GetNodeRef(&nref) == B_OK)
-		watch_node(&nref, B_WATCH_ALL, this);
+	if (item->path.InitCheck() != B_OK || entry.GetNodeRef(&nref) != B_OK)
+		return false;
+
+	if (watch_node(&nref, B_WATCH_ALL, BMessenger(this)) == B_OK)
+		item->node = nref;
+	return true;
 }
 
 
 void
-DownloadProgressView::_StopNodeMonitor()
+DownloadProgressView::_StopNodeMonitor(DownloadItem* item)
 {
-	stop_watching(this);
+	if (item->node == node_ref())
+		return;
+
+	watch_node(&item->node, B_STOP_WATCHING, BMessenger(this));
+	item->node = node_ref();
+	fModel.ItemChanged(item);
 }
 
+
+void
+DownloadProgressView::_StartListening(DownloadItem* item)
+{
+	if (item->listener != NULL || !item->IsRunning())
+		return;
+
+	// Will start the node monitor upon receiving the B_DOWNLOAD_STARTED
+	// message.
+	if (item->segmented != NULL)
+		item->listener = fAggregator.AddDownload(item->segmented);
+	else
+		item->listener = fAggregator.AddDownload(item->download);
+}
+
+
+void
+DownloadProgressView::_StopListening(DownloadItem* item)
+{
+	if (item->listener == NULL)
+		return;
+
+	fAggregator.RemoveDownload(item->listener);
+	item->listener = NULL;
+}
+
+
+/*!	Forgets about the download of \a item once it ended. */
+void
+DownloadProgressView::_ReleaseDownload(DownloadItem* item)
+{
+	_StopListening(item);
+	item->download = NULL;
+	if (item->segmented != NULL) {
+		item->segmented->ReleaseReference();
+		item->segmented = NULL;
+	}
+}
@@ -7,81 +7,100 @@
 #define DOWNLOAD_PROGRESS_VIEW_H
 
 
-#include <GroupView.h>
-#include <Path.h>
+#include <Font.h>
 #include <String.h>
 
-class BEntry;
-class BStatusBar;
-class BStringView;
-class BWebDownload;
-class IconView;
-class SmallButton;
+#include "DownloadModel.h"
+#include "VirtualListView.h"
+
+class BBitmap;
+class DownloadProgressAggregator;
+class SegmentedDownload;
 
 
 enum {
-	SAVE_SETTINGS = 'svst'
+	DOWNLOADS_CHANGED = 'dlch',
+	DOWNLOADS_PROGRESSED = 'dlpg',
+	RESUME_DOWNLOAD = 'dlrs'
 };
 
 
-class DownloadProgressView : public BGroupView {
+/*!	Shows the progress of the downloads in a DownloadModel, one row per
+	download. Only the rows currently visible are drawn; the downloads have
+	no views of their own. The view also watches the downloaded files, and
+	collects the progress of the running downloads from a
+	DownloadProgressAggregator whenever it has some.
+*/
+class DownloadProgressView : public VirtualListView {
 public:
-								DownloadProgressView(BWebDownload* download);
-								DownloadProgressView(const BMessage* archive);
-
-			bool				Init(BMessage* archive = NULL);
+								DownloadProgressView(DownloadModel& model,
+									DownloadProgressAggregator& aggregator);
+	virtual						~DownloadProgressView();
 
-			status_t			SaveSettings(BMessage* archive);
 	virtual	void				AttachedToWindow();
 	virtual	void				DetachedFromWindow();
-	virtual	void				AllAttached();
-
-	virtual	void				Draw(BRect updateRect);
-
 	virtual	void				MessageReceived(BMessage* message);
-
-			void				ShowContextMenu(BPoint screenWhere);
-
-			BWebDownload*		Download() const;
-			const BString&		URL() const;
-			bool				IsMissing() const;
-			bool				IsFinished() const;
-
-			void				DownloadFinished();
-			void				CancelDownload();
+	virtual	void				MouseDown(BPoint where);
+	virtual	void				MouseUp(BPoint where);
+	virtual	void				Pulse();
+
+			void				AddDownload(DownloadItem* item, int32 index);
+			void				RemoveDownload(DownloadItem* item);
+			void				RemoveDownloads(
+									DownloadModel::ItemFilter filter);
+			void				DownloadFinished(DownloadItem* item);
+			void				CancelDownload(DownloadItem* item);
+			status_t			ResumeDownload(DownloadItem* item,
+									SegmentedDownload* download,
+									int32 connections);
+			void				RestartDownload(DownloadItem* item);
+			void				PauseDownload(DownloadItem* item);
+
+			void				ShowContextMenu(DownloadItem* item,
+									BPoint screenWhere);
 
 	static	void				SpeedVersusEstimatedFinishTogglePulse();
 
+protected:
+	virtual	void				DrawItem(int32 index, BRect frame,
+									bool selected);
+
 private:
-			void				_UpdateStatus(off_t currentSize,
-									off_t expectedSize);
-			void				_UpdateStatusText();
-			void				_StartNodeMonitor(const BEntry& entry);
-			void				_StopNodeMonitor();
+			void				_DownloadMessage(DownloadItem* item,
+									BMessage* message);
+			void				_NodeMonitorMessage(BMessage* message);
+			void				_ItemMessage(DownloadItem* item,
+									BMessage* message);
+
+			void				_CollectProgress();
+			void				_UpdateStatus(DownloadItem* item,
+									off_t currentSize, off_t expectedSize);
+			BString				_StatusText(const DownloadItem* item,
+									float width);
+			const BBitmap*		_Icon(DownloadItem* item);
+			void				_ItemChanged(DownloadItem* item);
+
+			BRect				_ButtonFrame(const BRect& itemFrame,
+									bool top) const;
+			DownloadItem*		_ItemAt(BPoint where, int32* _button);
+
+			bool				_StartNodeMonitor(DownloadItem* item);
+			void				_StopNodeMonitor(DownloadItem* item);
+			void				_StartListening(DownloadItem* item);
+			void				_StopListening(DownloadItem* item);
+			void				_ReleaseDownload(DownloadItem* item);
 
 private:
-			IconView*			fIconView;
-			BStatusBar*			fStatusBar;
-			BStringView*		fInfoView;
-			SmallButton*		fTopButton;
-			SmallButton*		fBottomButton;
-			BWebDownload*		fDownload;
-			BString				fURL;
-			BPath				fPath;
-
-			off_t				fCurrentSize;
-			off_t				fExpectedSize;
-			off_t				fLastSpeedReferenceSize;
-			off_t				fEstimatedFinishReferenceSize;
-			bigtime_t			fLastUpdateTime;
-			bigtime_t			fLastSpeedReferenceTime;
-			bigtime_t			fProcessStartTime;
-			bigtime_t			fLastSpeedUpdateTime;
-			bigtime_t			fEstimatedFinishReferenceTime;
-	static	const size_t		kBytesPerSecondSlots = 10;
-			size_t				fCurrentBytesPerSecondSlot;
-			double				fBytesPerSecondSlot[kBytesPerSecondSlots];
-			double				fBytesPerSecond;
+			DownloadModel&		fModel;
+			DownloadProgressAggregator& fAggregator;
+			BBitmap*			fIconBitmap;
+				// shared by all rows for drawing their icon
+			BFont				fSmallFont;
+			float				fButtonWidth;
+			float				fButtonHeight;
+
+			DownloadItem*		fPressedItem;
+			int32				fPressedButton;
 
 	static	bigtime_t			sLastEstimatedFinishSpeedToggleTime;
 	static	bool				sShowSpeed;
@@ -13,25 +13,31 @@
 #include <Catalog.h>
 #include <ControlLook.h>
 #include <Entry.h>
-#include <File.h>
 #include <FindDirectory.h>
 #include <GroupLayout.h>
 #include <GroupLayoutBuilder.h>
 #include <Locale.h>
 #include <MenuBar.h>
 #include <MenuItem.h>
+#include <Notification.h>
+#include <NumberFormat.h>
 #include <Path.h>
 #include <Roster.h>
+#include <ScrollBar.h>
 #include <ScrollView.h>
 #include <SeparatorView.h>
-#include <SpaceLayoutItem.h>
 #include <UrlContext.h>
 
+#include "BandwidthScheduler.h"
 #include "BrowserApp.h"
 #include "BrowserWindow.h"
+#include "DownloadJournal.h"
+#include "DownloadProgressAggregator.h"
 #include "DownloadProgressView.h"
+#include "SegmentedDownload.h"
 #include "SettingsKeys.h"
 #include "SettingsMessage.h"
+#include "StringForSize.h"
 #include "WebDownload.h"
 #include "WebPage.h"
 
@@ -47,44 +53,22 @@ enum {
 };
 
 
-class DownloadsContainerView : public BGroupView {
-public:
-	DownloadsContainerView()
-		:
-		BGroupView(B_VERTICAL, 0.0)
-	{
-		SetFlags(Flags() | B_PULSE_NEEDED);
-		SetViewUIColor(B_LIST_BACKGROUND_COLOR);
-		AddChild(BSpaceLayoutItem::CreateGlue());
-	}
+static const bigtime_t kProgressNotificationInterval = 1000000;
+	// The overall progress is shown in the Deskbar at most this often.
 
-	virtual BSize MinSize()
-	{
-		BSize minSize = BGroupView::MinSize();
-		return BSize(minSize.width, 80);
-	}
 
-	virtual void Pulse()
-	{
-		DownloadProgressView::SpeedVersusEstimatedFinishTogglePulse();
-	}
+static bool
+is_finished(const DownloadItem* item)
+{
+	return item->IsFinished();
+}
 
-protected:
-	virtual void DoLayout()
-	{
-		BGroupView::DoLayout();
-		if (BScrollBar* scrollBar = ScrollBar(B_VERTICAL)) {
-			BSize minSize = BGroupView::MinSize();
-			float height = Bounds().Height();
-			float max = minSize.height - height;
-			scrollBar->SetRange(0, max);
-			if (minSize.height > 0)
-				scrollBar->SetProportion(height / minSize.height);
-			else
-				scrollBar->SetProportion(1);
-		}
-	}
-};
+
+static bool
+is_missing(const DownloadItem* item)
+{
+	return item->IsMissing();
+}
 
 
 class DownloadContainerScrollView : public BScrollView {
@@ -105,11 +89,6 @@ protected:
 		scrollBar->MoveBy(1, -1);
 		scrollBar->ResizeBy(0, 2);
 		Target()->ResizeBy(1, 0);
-		// Set the scroll steps
-		if (BView* item = Target()->ChildAt(0)) {
-			scrollBar->SetSteps(item->MinSize().height + 1,
-				item->MinSize().height + 1);
-		}
 	}
 };
 
@@ -118,12 +97,18 @@ protected:
 
 
 DownloadWindow::DownloadWindow(BRect frame, bool visible,
-		SettingsMessage* settings)
+		SettingsMessage* settings, BPrivate::Network::BUrlContext* context,
+		const BMessage* downloads)
 	: BWindow(frame, B_TRANSLATE("Downloads"),
 		B_TITLED_WINDOW_LOOK, B_NORMAL_WINDOW_FEEL,
 		B_AUTO_UPDATE_SIZE_LIMITS | B_ASYNCHRONOUS_CONTROLS | B_NOT_ZOOMABLE),
+	fProgressAggregator(new DownloadProgressAggregator()),
+	fLastProgressNotification(0),
+	fContext(context),
 	fMinimizeOnClose(false)
 {
+	fProgressAggregator->Run();
+
 	SetPulseRate(1000000);
 
 	settings->AddListener(BMessenger(this));
@@ -133,11 +118,18 @@ DownloadWindow::DownloadWindow(BRect frame, bool visible,
 	fDownloadPath = settings->GetValue(kSettingsKeyDownloadPath,
 		downloadPath.Path());
 	settings->SetValue(kSettingsKeyDownloadPath, fDownloadPath);
+	fDownloadConnections = settings->GetValue(kSettingsKeyDownloadConnections,
+		kDefaultDownloadConnections);
+	fDownloadRateLimit = settings->GetValue(kSettingsKeyDownloadRateLimit,
+		(uint32)0);
+	BandwidthScheduler::DefaultInstance()->SetRateLimit(
+		(off_t)fDownloadRateLimit * 1024);
+	BandwidthScheduler::DefaultInstance()->SetYieldToBrowsing(
+		settings->GetValue(kSettingsKeyDownloadsYieldToBrowsing, true));
 
 	SetLayout(new BGroupLayout(B_VERTICAL, 0.0));
 
-	DownloadsContainerView* downloadsGroupView = new DownloadsContainerView();
-	fDownloadViewsLayout = downloadsGroupView->GroupLayout();
+	fDownloadsView = new DownloadProgressView(fModel, *fProgressAggregator);
 
 	BMenuBar* menuBar = new BMenuBar("Menu bar");
 	BMenu* menu = new BMenu(B_TRANSLATE("Downloads"));
@@ -154,7 +146,7 @@ DownloadWindow::DownloadWindow(BRect frame, bool visible,
 		new BMessage(B_QUIT_REQUESTED), 'D'));
 	menuBar->AddItem(menu);
 
-	fDownloadsScrollView = new DownloadContainerScrollView(downloadsGroupView);
+	fDownloadsScrollView = new DownloadContainerScrollView(fDownloadsView);
 
 	fRemoveFinishedButton = new BButton(B_TRANSLATE("Remove finished"),
 		new BMessage(REMOVE_FINISHED_DOWNLOADS));
@@ -178,7 +170,12 @@ DownloadWindow::DownloadWindow(BRect frame, bool visible,
 		)
 	);
 
-	PostMessage(INIT);
+	// The list of downloads may already have been read by the caller,
+	// otherwise it is read in the window thread.
+	BMessage init(INIT);
+	if (downloads != NULL)
+		init.AddMessage("downloads", downloads);
+	PostMessage(&init);
 
 	if (!visible)
 		Hide();
@@ -189,38 +186,17 @@ DownloadWindow::DownloadWindow(BRect frame, bool visible,
 
 DownloadWindow::~DownloadWindow()
 {
-	// Only necessary to save the current progress of unfinished downloads:
-	_SaveSettings();
-}
+	// Everything else is journaled as it happens.
+	fModel.CheckpointRunning();
+	DownloadJournal::DefaultInstance()->Shutdown();
 
+	// The downloads view works on the model, which goes away before the
+	// window deletes its views.
+	fDownloadsScrollView->RemoveSelf();
+	delete fDownloadsScrollView;
 
-void
-DownloadWindow::DispatchMessage(BMessage* message, BHandler* target)
-{
-	// We need to intercept mouse down events inside the area of download
-	// progress views (regardless of whether they have children at the click),
-	// so that they may display a context menu.
-	BPoint where;
-	int32 buttons;
-	if (message->what == B_MOUSE_DOWN
-		&& message->FindPoint("screen_where", &where) == B_OK
-		&& message->FindInt32("buttons", &buttons) == B_OK
-		&& (buttons & B_SECONDARY_MOUSE_BUTTON) != 0) {
-		for (int32 i = fDownloadViewsLayout->CountItems() - 1;
-				BLayoutItem* item = fDownloadViewsLayout->ItemAt(i); i--) {
-			DownloadProgressView* view = dynamic_cast<DownloadProgressView*>(
-				item->View());
-			if (!view)
-				continue;
-			BPoint viewWhere(where);
-			view->ConvertFromScreen(&viewWhere);
-			if (view->Bounds().Contains(viewWhere)) {
-				view->ShowContextMenu(where);
-				return;
-			}
-		}
-	}
-	BWindow::DispatchMessage(message, target);
+	if (fProgressAggregator->Lock())
+		fProgressAggregator->Quit();
 }
 
 
@@ -237,10 +213,13 @@ DownloadWindow::MessageReceived(BMessage* message)
 	switch (message->what) {
 		case INIT:
 		{
-			_LoadSettings();
-			// Small trick to get the correct enabled status of the Remove
-			// finished button
-			_DownloadFinished(NULL);
+			BMessage downloads;
+			if (message->FindMessage("downloads", &downloads) == B_OK
+				|| ReadDownloads(downloads) == B_OK) {
+				_LoadSettings(downloads);
+			}
+			DownloadJournal::DefaultInstance()->Start();
+			_ValidateButtonStatus();
 			break;
 		}
 		case B_DOWNLOAD_ADDED:
@@ -254,13 +233,19 @@ DownloadWindow::MessageReceived(BMessage* message)
 		}
 		case B_DOWNLOAD_REMOVED:
 		{
-			BWebDownload* download;
-			if (message->FindPointer("download", reinterpret_cast<void**>(
-					&download)) == B_OK) {
+			void* download;
+			if (message->FindPointer("download", &download) == B_OK) {
 				_DownloadFinished(download);
 			}
 			break;
 		}
+		case RESUME_DOWNLOAD:
+		{
+			uint32 id;
+			if (message->FindUInt32("id", &id) == B_OK)
+				_ResumeDownload(id);
+			break;
+		}
 		case OPEN_DOWNLOADS_FOLDER:
 		{
 			entry_ref ref;
@@ -285,18 +270,36 @@ DownloadWindow::MessageReceived(BMessage* message)
 		case REMOVE_MISSING_DOWNLOADS:
 			_RemoveMissingDownloads();
 			break;
-		case SAVE_SETTINGS:
+		case DOWNLOADS_CHANGED:
 			_ValidateButtonStatus();
-			_SaveSettings();
+			_UpdateTotals();
+			break;
+		case DOWNLOADS_PROGRESSED:
+			_UpdateTotals();
 			break;
 
 		case SETTINGS_VALUE_CHANGED:
 		{
+			BString name;
+			if (message->FindString("name", &name) != B_OK)
+				break;
 			BString string;
-			if (message->FindString("name", &string) == B_OK
-				&& string == kSettingsKeyDownloadPath
+			uint32 value;
+			bool flag;
+			if (name == kSettingsKeyDownloadPath
 				&& message->FindString("value", &string) == B_OK) {
 				fDownloadPath = string;
+			} else if (name == kSettingsKeyDownloadConnections
+				&& message->FindUInt32("value", &value) == B_OK) {
+				fDownloadConnections = value;
+			} else if (name == kSettingsKeyDownloadRateLimit
+				&& message->FindUInt32("value", &value) == B_OK) {
+				fDownloadRateLimit = value;
+				BandwidthScheduler::DefaultInstance()->SetRateLimit(
+					(off_t)value * 1024);
+			} else if (name == kSettingsKeyDownloadsYieldToBrowsing
+				&& message->FindBool("value", &flag) == B_OK) {
+				BandwidthScheduler::DefaultInstance()->SetYieldToBrowsing(flag);
 			}
 			break;
 		}
@@ -328,17 +331,7 @@ DownloadWindow::DownloadsInProgress()
 	if (!Lock())
 		return downloadsInProgress;
 
-	for (int32 i = fDownloadViewsLayout->CountItems() - 1;
-			BLayoutItem* item = fDownloadViewsLayout->ItemAt(i); i--) {
-		DownloadProgressView* view = dynamic_cast<DownloadProgressView*>(
-			item->View());
-		if (!view)
-			continue;
-		if (view->Download() != NULL) {
-			downloadsInProgress = true;
-			break;
-		}
-	}
+	downloadsInProgress = fModel.CountRunning() > 0;
 
 	Unlock();
 
@@ -356,61 +349,66 @@ DownloadWindow::SetMinimizeOnClose(bool minimize)
 }
 
 
+/*!	Reads the list of downloads from the journal. This does not touch the
+	window, and can be called from any thread.
+*/
+/*static*/ status_t
+DownloadWindow::ReadDownloads(BMessage& downloads)
+{
+	return DownloadJournal::DefaultInstance()->Load(downloads);
+}
+
+
 // #pragma mark - private
 
 
+/*!	Starts \a download. With more than one connection per download, or a
+	speed limit set, a SegmentedDownload first tries to take it over, so it
+	runs over that many connections, and under the BandwidthScheduler.
+	WebKit's download is only started if the server does not allow that.
+	The default settings leave all downloads to WebKit, which cannot be
+	paused, prioritized or slowed down.
+*/
 void
 DownloadWindow::_DownloadStarted(BWebDownload* download)
 {
-	download->Start(BPath(fDownloadPath.String()));
-
-	int32 finishedCount = 0;
-	int32 missingCount = 0;
-	int32 index = 0;
-	for (int32 i = fDownloadViewsLayout->CountItems() - 1;
-			BLayoutItem* item = fDownloadViewsLayout->ItemAt(i); i--) {
-		DownloadProgressView* view = dynamic_cast<DownloadProgressView*>(
-			item->View());
-		if (!view)
-			continue;
-		if (view->URL() == download->URL()) {
-			index = i;
-			view->RemoveSelf();
-			delete view;
-			continue;
-		}
-		if (view->IsFinished())
-			finishedCount++;
-		if (view->IsMissing())
-			missingCount++;
+	// A new download of the same URL takes the place of the old one.
+	int32 index = -1;
+	while (DownloadItem* item = fModel.FindURL(download->URL())) {
+		int32 itemIndex = fModel.IndexOf(item);
+		if (index < 0 || itemIndex < index)
+			index = itemIndex;
+		fDownloadsView->RemoveDownload(item);
 	}
-	fRemoveFinishedButton->SetEnabled(finishedCount > 0);
-	fRemoveMissingButton->SetEnabled(missingCount > 0);
-	DownloadProgressView* view = new DownloadProgressView(download);
-	if (!view->Init()) {
-		delete view;
-		return;
+	if (index < 0)
+		index = 0;
+
+	DownloadItem* item = new DownloadItem(download);
+	if ((fDownloadConnections > 1 || fDownloadRateLimit > 0)
+		&& SegmentedDownload::CanDownload(download->URL())) {
+		item->segmented = new SegmentedDownload(download->URL(),
+			fContext.Get());
+		item->segmented->SetPriority(item->priority);
+	}
+	fDownloadsView->AddDownload(item, index);
+
+	BPath directory(fDownloadPath.String());
+	if (item->segmented == NULL
+		|| item->segmented->Start(directory, fDownloadConnections) != B_OK) {
+		if (item->segmented != NULL) {
+			// Hand the download back to WebKit.
+			BMessage declined(SEGMENTED_DOWNLOAD_DECLINED);
+			declined.AddPointer("download", item->segmented);
+			PostMessage(&declined, fDownloadsView);
+		} else
+			download->Start(directory);
 	}
-	fDownloadViewsLayout->AddView(index, view);
 
 	// Scroll new download into view
-	if (BScrollBar* scrollBar = fDownloadsScrollView->ScrollBar(B_VERTICAL)) {
-		float min;
-		float max;
-		scrollBar->GetRange(&min, &max);
-		float viewHeight = view->MinSize().height + 1;
-		float scrollOffset = min + index * viewHeight;
-		float scrollBarHeight = scrollBar->Bounds().Height() - 1;
-		float value = scrollBar->Value();
-		if (scrollOffset < value)
-			scrollBar->SetValue(scrollOffset);
-		else if (scrollOffset + viewHeight > value + scrollBarHeight) {
-			float diff = scrollOffset + viewHeight - (value + scrollBarHeight);
-			scrollBar->SetValue(value + diff);
-		}
-	}
+	fDownloadsView->Select(index);
 
-	_SaveSettings();
+	_ValidateButtonStatus();
+	_UpdateTotals();
 
 	SetWorkspaces(B_CURRENT_WORKSPACE);
 	if (IsHidden())
@@ -419,152 +417,140 @@ DownloadWindow::_DownloadStarted(BWebDownload* download)
 
 
 void
-DownloadWindow::_DownloadFinished(BWebDownload* download)
+DownloadWindow::_DownloadFinished(const void* download)
 {
-	int32 finishedCount = 0;
-	int32 missingCount = 0;
-	for (int32 i = 0;
-			BLayoutItem* item = fDownloadViewsLayout->ItemAt(i); i++) {
-		DownloadProgressView* view = dynamic_cast<DownloadProgressView*>(
-			item->View());
-		if (!view)
-			continue;
-		if (download && view->Download() == download) {
-			view->DownloadFinished();
-			finishedCount++;
-			continue;
+	if (download != NULL) {
+		DownloadItem* item = fModel.FindDownload(download);
+		if (item != NULL)
+			fDownloadsView->DownloadFinished(item);
+	}
+	_ValidateButtonStatus();
+	_UpdateTotals();
+}
+
+
+/*!	Continues the download with the given \a id where it stopped, with a
+	range request. If that is not possible, the download is started over.
+*/
+void
+DownloadWindow::_ResumeDownload(uint32 id)
+{
+	DownloadItem* item = fModel.FindID(id);
+	if (item == NULL || item->IsRunning())
+		return;
+
+	if (item->CanResume()) {
+		SegmentedDownload* download = new SegmentedDownload(item->url,
+			fContext.Get());
+		download->SetPriority(item->priority);
+		if (fDownloadsView->ResumeDownload(item, download,
+				fDownloadConnections) == B_OK) {
+			_ValidateButtonStatus();
+			_UpdateTotals();
+			return;
 		}
-		if (view->IsFinished())
-			finishedCount++;
-		if (view->IsMissing())
-			missingCount++;
 	}
-	fRemoveFinishedButton->SetEnabled(finishedCount > 0);
-	fRemoveMissingButton->SetEnabled(missingCount > 0);
-	if (download)
-		_SaveSettings();
+	fDownloadsView->RestartDownload(item);
 }
 
 
 void
 DownloadWindow::_RemoveFinishedDownloads()
 {
-	int32 missingCount = 0;
-	for (int32 i = fDownloadViewsLayout->CountItems() - 1;
-			BLayoutItem* item = fDownloadViewsLayout->ItemAt(i); i--) {
-		DownloadProgressView* view = dynamic_cast<DownloadProgressView*>(
-			item->View());
-		if (!view)
-			continue;
-		if (view->IsFinished()) {
-			view->RemoveSelf();
-			delete view;
-		} else if (view->IsMissing())
-			missingCount++;
-	}
-	fRemoveFinishedButton->SetEnabled(false);
-	fRemoveMissingButton->SetEnabled(missingCount > 0);
-	_SaveSettings();
+	fDownloadsView->RemoveDownloads(&is_finished);
+	_ValidateButtonStatus();
 }
 
 
 void
 DownloadWindow::_RemoveMissingDownloads()
 {
-	int32 finishedCount = 0;
-	for (int32 i = fDownloadViewsLayout->CountItems() - 1;
-			BLayoutItem* item = fDownloadViewsLayout->ItemAt(i); i--) {
-		DownloadProgressView* view = dynamic_cast<DownloadProgressView*>(
-			item->View());
-		if (!view)
-			continue;
-		if (view->IsMissing()) {
-			view->RemoveSelf();
-			delete view;
-		} else if (view->IsFinished())
-			finishedCount++;
-	}
-	fRemoveMissingButton->SetEnabled(false);
-	fRemoveFinishedButton->SetEnabled(finishedCount > 0);
-	_SaveSettings();
+	fDownloadsView->RemoveDownloads(&is_missing);
+	_ValidateButtonStatus();
 }
 
 
 void
 DownloadWindow::_ValidateButtonStatus()
 {
-	int32 finishedCount = 0;
-	int32 missingCount = 0;
-	for (int32 i = fDownloadViewsLayout->CountItems() - 1;
-			BLayoutItem* item = fDownloadViewsLayout->ItemAt(i); i--) {
-		DownloadProgressView* view = dynamic_cast<DownloadProgressView*>(
-			item->View());
-		if (!view)
-			continue;
-		if (view->IsFinished())
-			finishedCount++;
-		if (view->IsMissing())
-			missingCount++;
-	}
-	fRemoveFinishedButton->SetEnabled(finishedCount > 0);
-	fRemoveMissingButton->SetEnabled(missingCount > 0);
+	fRemoveFinishedButton->SetEnabled(fModel.CountFinished() > 0);
+	fRemoveMissingButton->SetEnabled(fModel.CountMissing() > 0);
 }
 
 
+/*!	Shows the overall progress and speed of the running downloads in the
+	window title, and thereby in the Deskbar. While the window is not shown,
+	they are also shown in a progress notification.
+*/
 void
-DownloadWindow::_SaveSettings()
+DownloadWindow::_UpdateTotals()
 {
-	BFile file;
-	if (!_OpenSettingsFile(file, B_ERASE_FILE | B_CREATE_FILE | B_WRITE_ONLY))
-		return;
-	BMessage message;
-	for (int32 i = fDownloadViewsLayout->CountItems() - 1;
-			BLayoutItem* item = fDownloadViewsLayout->ItemAt(i); i--) {
-		DownloadProgressView* view = dynamic_cast<DownloadProgressView*>(
-			item->View());
-		if (!view)
-			continue;
-
-	BMessage downloadArchive;
-		if (view->SaveSettings(&downloadArchive) == B_OK)
-			message.AddMessage("download", &downloadArchive);
+	DownloadModel::Totals totals;
+	fModel.GetRunningTotals(totals);
+
+	BString title(B_TRANSLATE("Downloads"));
+	BString percent;
+	if (totals.running > 0) {
+		char buffer[128];
+		BString rate = string_for_size(totals.bytesPerSecond, buffer,
+			sizeof(buffer));
+		if (totals.expectedSize > 0) {
+			BNumberFormat().FormatPercent(percent,
+				(double)totals.currentSize / totals.expectedSize);
+			title = B_TRANSLATE_COMMENT("Downloads (%percent, %rate/s)",
+				"Don't translate variables %percent and %rate");
+			title.ReplaceFirst("%percent", percent);
+		} else {
+			title = B_TRANSLATE_COMMENT("Downloads (%rate/s)",
+				"Don't translate variable %rate");
+		}
+		title.ReplaceFirst("%rate", rate);
+
+		bigtime_t now = system_time();
+		if ((IsHidden() || IsMinimized())
+			&& now - fLastProgressNotification
+				>= kProgressNotificationInterval) {
+			fLastProgressNotification = now;
+
+			BString content(B_TRANSLATE_COMMENT(
+				"%count running at %rate/s",
+				"Don't translate variables %count and %rate"));
+			content.ReplaceFirst("%count", BString() << totals.running);
+			content.ReplaceFirst("%rate", rate);
+
+			BNotification notification(B_PROGRESS_NOTIFICATION);
+			notification.SetGroup(B_TRANSLATE("WebPositive"));
+			notification.SetTitle(B_TRANSLATE("Downloading"));
+			notification.SetContent(content);
+			notification.SetMessageID("downloads");
+			if (totals.expectedSize > 0) {
+				notification.SetProgress(
+					(float)totals.currentSize / totals.expectedSize);
+			}
+			notification.Send();
+		}
 	}
-	message.Flatten(&file);
+
+	if (title != Title())
+		SetTitle(title.String());
 }
 
 
 void
-DownloadWindow::_LoadSettings()
+DownloadWindow::_LoadSettings(const BMessage& downloads)
 {
-	BFile file;
-	if (!_OpenSettingsFile(file, B_READ_ONLY))
-		return;
-	BMessage message;
-	if (message.Unflatten(&file) != B_OK)
+	// The newest download was archived last, and is shown first.
+	type_code type;
+	int32 count;
+	if (downloads.GetInfo("download", &type, &count) != B_OK)
 		return;
+
 	BMessage downloadArchive;
-	for (int32 i = 0;
-			message.FindMessage("download", i, &downloadArchive) == B_OK;
-			i++) {
-		DownloadProgressView* view = new DownloadProgressView(
-			&downloadArchive);
-		if (!view->Init(&downloadArchive))
+	for (int32 i = count - 1; i >= 0; i--) {
+		if (downloads.FindMessage("download", i, &downloadArchive) != B_OK)
 			continue;
-		fDownloadViewsLayout->AddView(0, view);
-	}
-}
-
-
-bool
-DownloadWindow::_OpenSettingsFile(BFile& file, uint32 mode)
-{
-	BPath path;
-	if (find_directory(B_USER_SETTINGS_DIRECTORY, &path) != B_OK
-		|| path.Append(kApplicationName) != B_OK
-		|| path.Append("Downloads") != B_OK) {
-		return false;
+		fDownloadsView->AddDownload(new DownloadItem(&downloadArchive),
+			fModel.CountItems());
 	}
-	return file.SetTo(path.Path(), mode) == B_OK;
 }
 
-
@@ -8,24 +8,27 @@
 
 
 #include <String.h>
+#include <UrlContext.h>
 #include <Window.h>
 
+#include "DownloadModel.h"
+
 class BButton;
-class BFile;
-class BGroupLayout;
 class BScrollView;
 class BWebDownload;
+class DownloadProgressAggregator;
+class DownloadProgressView;
 class SettingsMessage;
 
 
 class DownloadWindow : public BWindow {
 public:
 								DownloadWindow(BRect frame, bool visible,
-									SettingsMessage* settings);
+									SettingsMessage* settings,
+									BPrivate::Network::BUrlContext* context,
+									const BMessage* downloads = NULL);
 	virtual						~DownloadWindow();
 
-	virtual	void				DispatchMessage(BMessage* message,
-									BHandler* target);
 	virtual void				FrameResized(float newWidth, float newHeight);
 	virtual	void				MessageReceived(BMessage* message);
 	virtual	bool				QuitRequested();
@@ -33,22 +36,31 @@ public:
 			bool				DownloadsInProgress();
 			void				SetMinimizeOnClose(bool minimize);
 
+	static	status_t			ReadDownloads(BMessage& downloads);
+
 private:
 			void				_DownloadStarted(BWebDownload* download);
-			void				_DownloadFinished(BWebDownload* download);
+			void				_DownloadFinished(const void* download);
+			void				_ResumeDownload(uint32 id);
 			void				_RemoveFinishedDownloads();
 			void				_RemoveMissingDownloads();
 			void				_ValidateButtonStatus();
-			void				_SaveSettings();
-			void				_LoadSettings();
-			bool				_OpenSettingsFile(BFile& file, uint32 mode);
+			void				_UpdateTotals();
+			void				_LoadSettings(const BMessage& downloads);
 
 private:
+			DownloadModel		fModel;
 			BScrollView*		fDownloadsScrollView;
-			BGroupLayout*		fDownloadViewsLayout;
+			DownloadProgressView* fDownloadsView;
+			DownloadProgressAggregator* fProgressAggregator;
+			bigtime_t			fLastProgressNotification;
 			BButton*			fRemoveFinishedButton;
 			BButton*			fRemoveMissingButton;
 			BString				fDownloadPath;
+			uint32				fDownloadConnections;
+			uint32				fDownloadRateLimit;
+				// in KiB per second, 0 for none
+			BReference<BPrivate::Network::BUrlContext> fContext;
 			bool				fMinimizeOnClose;
 };
 
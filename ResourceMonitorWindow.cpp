@@ -0,0 +1,396 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "ResourceMonitorWindow.h"
+
+#include <Button.h>
+#include <Catalog.h>
+#include <ColumnListView.h>
+#include <ColumnTypes.h>
+#include <GroupLayoutBuilder.h>
+#include <MessageRunner.h>
+#include <OS.h>
+#include <StringView.h>
+
+#include <set>
+
+#include "BrowserWindow.h"
+#include "StringForSize.h"
+#include "TabIndex.h"
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Resource monitor"
+
+
+enum {
+	SAMPLE				= 'rmsm',
+	TAB_SELECTED		= 'rmts',
+	TAB_INVOKED			= 'rmti',
+	SHOW_TAB			= 'rmst',
+	DISCARD_SELECTED	= 'rmds',
+	CLOSE_SELECTED		= 'rmcs'
+};
+
+enum {
+	kTitleColumn = 0,
+	kStateColumn,
+	kIdleColumn,
+	kAddressColumn
+};
+
+static const bigtime_t kSampleInterval = 2000000;
+
+
+class IdleColumn : public BIntegerColumn {
+public:
+	IdleColumn(const char* title, float width)
+		:
+		BIntegerColumn(title, width, width / 2, width * 2, B_ALIGN_RIGHT)
+	{
+	}
+
+	void DrawField(BField* field, BRect rect, BView* parent)
+	{
+		int32 seconds = ((BIntegerField*)field)->Value();
+
+		BString text;
+		if (seconds < 60)
+			text.SetToFormat(B_TRANSLATE("%" B_PRId32 " s"), seconds);
+		else if (seconds < 3600)
+			text.SetToFormat(B_TRANSLATE("%" B_PRId32 " min"), seconds / 60);
+		else {
+			text.SetToFormat(B_TRANSLATE("%" B_PRId32 " h %" B_PRId32 " min"),
+				seconds / 3600, seconds % 3600 / 60);
+		}
+		DrawString(text.String(), parent, rect);
+	}
+};
+
+
+class TabRow : public BRow {
+public:
+	TabRow(const TabIndex::TabInfo& info)
+		:
+		BRow(),
+		fWindow(info.window),
+		fTab(info.tab)
+	{
+	}
+
+	void Update(const TabIndex::TabInfo& info, bigtime_t now)
+	{
+		fWindow = info.window;
+
+		BString state;
+		switch (info.loadState) {
+			case TabIndex::LOAD_LOADING:
+				state.SetToFormat(B_TRANSLATE("Loading %d%%"),
+					(int)info.progress);
+				break;
+			case TabIndex::LOAD_FINISHED:
+				state = B_TRANSLATE("Loaded");
+				break;
+			case TabIndex::LOAD_FAILED:
+				state = B_TRANSLATE("Failed");
+				break;
+			case TabIndex::LOAD_DISCARDED:
+				state = B_TRANSLATE("Discarded");
+				break;
+			case TabIndex::LOAD_NONE:
+				state = B_TRANSLATE("Blank");
+				break;
+		}
+
+		SetField(new BStringField(info.title.Length() > 0
+			? info.title.String() : info.url.String()), kTitleColumn);
+		SetField(new BStringField(state.String()), kStateColumn);
+		SetField(new BIntegerField((now - info.lastActivity) / 1000000),
+			kIdleColumn);
+		SetField(new BStringField(info.url.String()), kAddressColumn);
+	}
+
+	const BMessenger& Window() const
+	{
+		return fWindow;
+	}
+
+	const void* Tab() const
+	{
+		return fTab;
+	}
+
+private:
+	BMessenger	fWindow;
+	const void*	fTab;
+};
+
+
+ResourceMonitorWindow::ResourceMonitorWindow(BRect frame)
+	:
+	BWindow(frame, B_TRANSLATE("Resource monitor"), B_TITLED_WINDOW,
+		B_NORMAL_WINDOW_FEEL,
+		B_AUTO_UPDATE_SIZE_LIMITS | B_ASYNCHRONOUS_CONTROLS | B_NOT_ZOOMABLE),
+	fSampleRunner(NULL),
+	fLastSampleTime(0),
+	fLastCPUTime(0)
+{
+	SetLayout(new BGroupLayout(B_VERTICAL, 0.0));
+
+	fTabList = new BColumnListView("tab list", B_WILL_DRAW, B_FANCY_BORDER,
+		false);
+	fTabList->SetSelectionMessage(new BMessage(TAB_SELECTED));
+	fTabList->SetInvocationMessage(new BMessage(TAB_INVOKED));
+
+	int em = fTabList->StringWidth("M");
+	fTabList->AddColumn(new BStringColumn(B_TRANSLATE("Title"),
+		20 * em, 10 * em, 50 * em, B_TRUNCATE_END), kTitleColumn);
+	fTabList->AddColumn(new BStringColumn(B_TRANSLATE("State"),
+		8 * em, 5 * em, 15 * em, B_TRUNCATE_END), kStateColumn);
+	fTabList->AddColumn(new IdleColumn(B_TRANSLATE("Idle"), 6 * em),
+		kIdleColumn);
+	fTabList->AddColumn(new BStringColumn(B_TRANSLATE("Address"),
+		20 * em, 10 * em, 80 * em, B_TRUNCATE_MIDDLE), kAddressColumn);
+	fTabList->SetSortColumn(fTabList->ColumnAt(kIdleColumn), false, true);
+
+	fMemoryView = new BStringView("memory", "");
+	fCPUView = new BStringView("cpu", "");
+	fTabCountView = new BStringView("tabs", "");
+	fBackgroundView = new BStringView("background", "");
+
+	fShowButton = new BButton("show", B_TRANSLATE("Show tab"),
+		new BMessage(SHOW_TAB));
+	fDiscardButton = new BButton("discard", B_TRANSLATE("Discard"),
+		new BMessage(DISCARD_SELECTED));
+	fCloseButton = new BButton("close", B_TRANSLATE("Close tab"),
+		new BMessage(CLOSE_SELECTED));
+
+	AddChild(BGroupLayoutBuilder(B_VERTICAL, B_USE_SMALL_SPACING)
+		.Add(fTabList)
+		.Add(BGroupLayoutBuilder(B_HORIZONTAL, B_USE_DEFAULT_SPACING)
+			.Add(fMemoryView)
+			.Add(fCPUView)
+			.Add(fTabCountView)
+			.Add(fBackgroundView)
+			.AddGlue())
+		.Add(BGroupLayoutBuilder(B_HORIZONTAL, B_USE_SMALL_SPACING)
+			.AddGlue()
+			.Add(fShowButton)
+			.Add(fDiscardButton)
+			.Add(fCloseButton))
+		.SetInsets(B_USE_SMALL_SPACING, B_USE_SMALL_SPACING,
+			B_USE_SMALL_SPACING, B_USE_SMALL_SPACING)
+	);
+
+	_UpdateButtons();
+
+	if (!frame.IsValid())
+		CenterOnScreen();
+}
+
+
+ResourceMonitorWindow::~ResourceMonitorWindow()
+{
+	delete fSampleRunner;
+}
+
+
+void
+ResourceMonitorWindow::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case SAMPLE:
+			_Sample();
+			break;
+
+		case TAB_SELECTED:
+			_UpdateButtons();
+			break;
+
+		case TAB_INVOKED:
+		case SHOW_TAB:
+			_SendToSelectedTab(ACTIVATE_TAB);
+			break;
+
+		case DISCARD_SELECTED:
+			_SendToSelectedTab(DISCARD_TAB);
+			break;
+
+		case CLOSE_SELECTED:
+			_SendToSelectedTab(CLOSE_TAB);
+			break;
+
+		default:
+			BWindow::MessageReceived(message);
+			break;
+	}
+}
+
+
+void
+ResourceMonitorWindow::Show()
+{
+	BWindow::Show();
+	if (IsHidden())
+		return;
+
+	// Only sample while somebody is looking.
+	if (fSampleRunner == NULL) {
+		BMessage message(SAMPLE);
+		fSampleRunner = new BMessageRunner(BMessenger(this), &message,
+			kSampleInterval);
+	}
+	PostMessage(SAMPLE);
+}
+
+
+void
+ResourceMonitorWindow::Hide()
+{
+	BWindow::Hide();
+	if (!IsHidden())
+		return;
+
+	delete fSampleRunner;
+	fSampleRunner = NULL;
+}
+
+
+bool
+ResourceMonitorWindow::QuitRequested()
+{
+	if (!IsHidden())
+		Hide();
+	return false;
+}
+
+
+// #pragma mark - private
+
+
+void
+ResourceMonitorWindow::_Sample()
+{
+	_SampleTabs();
+	_SampleProcess();
+	_UpdateButtons();
+}
+
+
+void
+ResourceMonitorWindow::_SampleTabs()
+{
+	TabIndex::TabInfoList tabs;
+	TabIndex::DefaultInstance()->GetTabs(tabs);
+
+	bigtime_t now = system_time();
+	std::set<const void*> seen;
+
+	// Update the rows in place, so the selection and scroll position stay.
+	for (size_t i = 0; i < tabs.size(); i++) {
+		const TabIndex::TabInfo& info = tabs[i];
+		seen.insert(info.tab);
+
+		std::map<const void*, TabRow*>::iterator found = fRows.find(info.tab);
+		if (found != fRows.end()) {
+			found->second->Update(info, now);
+			fTabList->UpdateRow(found->second);
+		} else {
+			TabRow* row = new TabRow(info);
+			row->Update(info, now);
+			fTabList->AddRow(row);
+			fRows[info.tab] = row;
+		}
+	}
+
+	std::map<const void*, TabRow*>::iterator iterator = fRows.begin();
+	while (iterator != fRows.end()) {
+		if (seen.find(iterator->first) != seen.end()) {
+			iterator++;
+			continue;
+		}
+		fTabList->RemoveRow(iterator->second);
+		delete iterator->second;
+		fRows.erase(iterator++);
+	}
+
+	BString text;
+	text.SetToFormat(B_TRANSLATE("Tabs: %" B_PRId32 " (%" B_PRId32
+		" discarded, %" B_PRId32 " reloaded)"), (int32)tabs.size(),
+		BrowserWindow::DiscardedTabCount(), BrowserWindow::ReloadedTabCount());
+	fTabCountView->SetText(text.String());
+
+	text.SetToFormat(B_TRANSLATE("Background: %.1f tab minutes, %" B_PRId64
+		" page updates skipped"), BrowserWindow::BackgroundTime() / 60000000.0,
+		BrowserWindow::SkippedUpdateCount());
+	fBackgroundView->SetText(text.String());
+}
+
+
+/*!	The pages all share the application's process and threads, so memory
+	and CPU use can only be given for the application as a whole.
+*/
+void
+ResourceMonitorWindow::_SampleProcess()
+{
+	uint64 memory = 0;
+	ssize_t cookie = 0;
+	area_info areaInfo;
+	while (get_next_area_info(B_CURRENT_TEAM, &cookie, &areaInfo) == B_OK)
+		memory += areaInfo.ram_size;
+
+	char sizeText[128];
+	BString text;
+	text.SetToFormat(B_TRANSLATE("Memory: %s"),
+		string_for_size((double)memory, sizeText, sizeof(sizeText)));
+	fMemoryView->SetText(text.String());
+
+	team_usage_info usage;
+	if (get_team_usage_info(B_CURRENT_TEAM, B_TEAM_USAGE_SELF, &usage)
+			!= B_OK) {
+		return;
+	}
+
+	bigtime_t now = system_time();
+	bigtime_t cpuTime = usage.user_time + usage.kernel_time;
+	if (fLastSampleTime > 0 && now > fLastSampleTime) {
+		system_info info;
+		int32 cpuCount = 1;
+		if (get_system_info(&info) == B_OK && info.cpu_count > 0)
+			cpuCount = info.cpu_count;
+
+		float load = 100.0f * (cpuTime - fLastCPUTime)
+			/ ((now - fLastSampleTime) * cpuCount);
+		text.SetToFormat(B_TRANSLATE("CPU: %.1f%%"), load);
+		fCPUView->SetText(text.String());
+	}
+	fLastSampleTime = now;
+	fLastCPUTime = cpuTime;
+}
+
+
+void
+ResourceMonitorWindow::_UpdateButtons()
+{
+	TabRow* row = dynamic_cast<TabRow*>(fTabList->CurrentSelection());
+	fShowButton->SetEnabled(row != NULL);
+	fDiscardButton->SetEnabled(row != NULL);
+	fCloseButton->SetEnabled(row != NULL);
+}
+
+
+void
+ResourceMonitorWindow::_SendToSelectedTab(uint32 what)
+{
+	TabRow* row = dynamic_cast<TabRow*>(fTabList->CurrentSelection());
+	if (row == NULL)
+		return;
+
+	BMessage message(what);
+	message.AddPointer("tab", row->Tab());
+	row->Window().SendMessage(&message);
+
+	PostMessage(SAMPLE);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef RESOURCE_MONITOR_WINDOW_H
+#define RESOURCE_MONITOR_WINDOW_H
+
+
+#include <Window.h>
+
+#include <map>
+
+
+class BButton;
+class BColumnListView;
+class BMessageRunner;
+class BStringView;
+class TabRow;
+
+
+/*!	Lists the tabs of all browser windows with their load state and the
+	time since their last activity, together with the resource usage of the
+	whole application. The figures are sampled every few seconds while the
+	window is shown.
+*/
+class ResourceMonitorWindow : public BWindow {
+public:
+								ResourceMonitorWindow(BRect frame);
+	virtual						~ResourceMonitorWindow();
+
+	virtual	void				MessageReceived(BMessage* message);
+	virtual	void				Show();
+	virtual	void				Hide();
+	virtual	bool				QuitRequested();
+
+private:
+			void				_Sample();
+			void				_SampleTabs();
+			void				_SampleProcess();
+			void				_UpdateButtons();
+			void				_SendToSelectedTab(uint32 what);
+
+private:
+			BColumnListView*	fTabList;
+			BStringView*		fMemoryView;
+			BStringView*		fCPUView;
+			BStringView*		fTabCountView;
+			BStringView*		fBackgroundView;
+			BButton*			fShowButton;
+			BButton*			fDiscardButton;
+			BButton*			fCloseButton;
+
+			BMessageRunner*		fSampleRunner;
+			std::map<const void*, TabRow*> fRows;
+
+			bigtime_t			fLastSampleTime;
+			bigtime_t			fLastCPUTime;
+};
+
+
+#endif // RESOURCE_MONITOR_WINDOW_H
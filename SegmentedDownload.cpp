@@ -0,0 +1,871 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "SegmentedDownload.h"
+
+#include <stdlib.h>
+#include <strings.h>
+
+#include <Autolock.h>
+#include <DataIO.h>
+#include <DateTime.h>
+#include <Entry.h>
+#include <HttpHeaders.h>
+#include <HttpRequest.h>
+#include <HttpResult.h>
+#include <HttpTime.h>
+#include <Message.h>
+#include <Mime.h>
+#include <Url.h>
+#include <UrlProtocolRoster.h>
+
+#include "BandwidthScheduler.h"
+#include "WebDownload.h"
+
+
+using BPrivate::Network::BHttpHeaders;
+using BPrivate::Network::BHttpRequest;
+using BPrivate::Network::BHttpResult;
+using BPrivate::Network::BHttpTime;
+using BPrivate::Network::BUrlContext;
+using BPrivate::Network::BUrlProtocolRoster;
+using BPrivate::Network::BUrlRequest;
+
+
+static const off_t kMinSegmentSize = 1024 * 1024;
+	// Smaller segments are not worth a connection of their own.
+static const int32 kMaxAttempts = 3;
+	// How often the segments are requested, when connections break before
+	// they are complete.
+static const bigtime_t kProgressInterval = 50000;
+	// The progress listener is sent the progress at most this often.
+static const bigtime_t kBandwidthTimeout = 100000;
+	// A request waiting for bandwidth checks this often whether the
+	// download was cancelled.
+
+static BLocker sRunningLock("segmented downloads");
+static std::vector<SegmentedDownload*> sRunning;
+	// The downloads whose threads still run, in the order they started.
+
+
+/*!	Returns the file name a Content-Disposition header suggests, if any.
+*/
+static BString
+disposition_filename(const char* disposition)
+{
+	BString filename;
+	if (disposition == NULL)
+		return filename;
+
+	const char* start = strcasestr(disposition, "filename*=");
+	bool encoded = start != NULL;
+	if (encoded) {
+		start += strlen("filename*=");
+		// Skip the character set and language, "UTF-8''".
+		const char* quotes = strstr(start, "''");
+		if (quotes != NULL)
+			start = quotes + 2;
+	} else {
+		start = strcasestr(disposition, "filename=");
+		if (start == NULL)
+			return filename;
+		start += strlen("filename=");
+	}
+
+	if (*start == '"') {
+		start++;
+		const char* end = strchr(start, '"');
+		filename.SetTo(start, end != NULL ? end - start : strlen(start));
+	} else {
+		const char* end = strchr(start, ';');
+		filename.SetTo(start, end != NULL ? end - start : strlen(start));
+		filename.Trim();
+	}
+
+	if (encoded)
+		filename = BUrl::UrlDecode(filename);
+	return filename;
+}
+
+
+/*!	Writes what a request receives to its segment of the file. The first
+	write checks that the server answered with the requested range; when it
+	ignores the range and sends the whole file instead, or the download was
+	cancelled, the write fails, which ends the request.
+	Without a segment, when probing, the data is dropped.
+*/
+class SegmentedDownload::SegmentWriter : public BDataIO {
+public:
+	SegmentWriter(SegmentedDownload* download, Segment* segment)
+		:
+		fDownload(download),
+		fSegment(segment),
+		fRequest(NULL),
+		fChecked(false)
+	{
+	}
+
+	void SetRequest(BHttpRequest* request)
+	{
+		fRequest = request;
+	}
+
+	virtual ssize_t Write(const void* buffer, size_t size)
+	{
+		if (fDownload->_IsCancelled())
+			return B_CANCELED;
+
+		if (!fChecked) {
+			const BHttpResult& result
+				= static_cast<const BHttpResult&>(fRequest->Result());
+			if (result.StatusCode() != 206)
+				return B_NOT_SUPPORTED;
+			fChecked = true;
+		}
+
+		if (fSegment == NULL)
+			return size;
+
+		// Don't write past the end of the segment, should the server send
+		// more than asked for.
+		off_t offset = fSegment->start + fSegment->written;
+		size_t length = size;
+		if ((off_t)length > fSegment->end + 1 - offset)
+			length = fSegment->end + 1 - offset;
+		if (length == 0)
+			return size;
+
+		BandwidthScheduler* scheduler = BandwidthScheduler::DefaultInstance();
+		while (scheduler->Acquire(length, fDownload->Priority(),
+				kBandwidthTimeout) != B_OK) {
+			if (fDownload->_IsCancelled())
+				return B_CANCELED;
+		}
+
+		ssize_t written = fDownload->fFile.WriteAt(offset, buffer, length);
+		if (written < 0)
+			return written;
+
+		fDownload->fLock.Lock();
+		fSegment->written += written;
+		fDownload->fLock.Unlock();
+		fDownload->_BytesWritten(written);
+		return size;
+	}
+
+private:
+	SegmentedDownload*	fDownload;
+	Segment*			fSegment;
+	BHttpRequest*		fRequest;
+	bool				fChecked;
+};
+
+
+// #pragma mark - SegmentedDownload
+
+
+SegmentedDownload::SegmentedDownload(const BString& url, BUrlContext* context)
+	:
+	fLock("segmented download"),
+	fURL(url),
+	fContext(context),
+	fConnections(1),
+	fResumeOffset(0),
+	fCurrentSize(0),
+	fExpectedSize(0),
+	fPriority(BandwidthScheduler::PRIORITY_NORMAL),
+	fLastProgress(0),
+	fCancelled(false),
+	fThread(-1)
+{
+}
+
+
+SegmentedDownload::~SegmentedDownload()
+{
+}
+
+
+BPath
+SegmentedDownload::Directory() const
+{
+	BAutolock _(fLock);
+	return fDirectory;
+}
+
+
+BPath
+SegmentedDownload::Path() const
+{
+	BAutolock _(fLock);
+	return fPath;
+}
+
+
+off_t
+SegmentedDownload::CurrentSize() const
+{
+	return atomic_get64(const_cast<int64*>(&fCurrentSize));
+}
+
+
+off_t
+SegmentedDownload::ExpectedSize() const
+{
+	BAutolock _(fLock);
+	return fExpectedSize;
+}
+
+
+/*!	Returns how much of the start of the file is complete. A download that
+	stopped early can be resumed from there.
+*/
+off_t
+SegmentedDownload::ResumeOffset() const
+{
+	BAutolock _(fLock);
+	for (size_t i = 0; i < fSegments.size(); i++) {
+		const Segment& segment = fSegments[i];
+		if (segment.start + segment.written <= segment.end)
+			return segment.start + segment.written;
+	}
+	if (!fSegments.empty())
+		return fSegments.back().end + 1;
+	return fResumeOffset;
+}
+
+
+BString
+SegmentedDownload::ETag() const
+{
+	BAutolock _(fLock);
+	return fETag;
+}
+
+
+BString
+SegmentedDownload::LastModified() const
+{
+	BAutolock _(fLock);
+	return fLastModified;
+}
+
+
+void
+SegmentedDownload::SetProgressListener(const BMessenger& listener)
+{
+	BAutolock _(fLock);
+	fListener = listener;
+}
+
+
+void
+SegmentedDownload::SetPriority(int32 priority)
+{
+	atomic_set(&fPriority, priority);
+}
+
+
+int32
+SegmentedDownload::Priority() const
+{
+	return atomic_get(const_cast<int32*>(&fPriority));
+}
+
+
+/*!	Starts downloading into a new file in \a directory, named the way the
+	server suggests, over at most \a connections connections.
+*/
+status_t
+SegmentedDownload::Start(const BPath& directory, int32 connections)
+{
+	fLock.Lock();
+	fDirectory = directory;
+	fConnections = connections > 0 ? connections : 1;
+	fLock.Unlock();
+
+	return _StartThread();
+}
+
+
+/*!	Continues the download of the file at \a path, of which the first
+	\a offset bytes are complete, over at most \a connections connections.
+	The file was \a expectedSize bytes large when it was started, and the
+	server described it with \a etag and \a lastModified, which may be
+	empty.
+*/
+status_t
+SegmentedDownload::Resume(const BPath& path, off_t offset, off_t expectedSize,
+	const BString& etag, const BString& lastModified, int32 connections)
+{
+	if (offset <= 0 || expectedSize <= offset)
+		return B_BAD_VALUE;
+
+	fLock.Lock();
+	fPath = path;
+	path.GetParent(&fDirectory);
+	fConnections = connections > 0 ? connections : 1;
+	fResumeOffset = offset;
+	fExpectedSize = expectedSize;
+	fETag = etag;
+	fLastModified = lastModified;
+	fLock.Unlock();
+	atomic_set64(&fCurrentSize, offset);
+
+	return _StartThread();
+}
+
+
+/*!	The downloaded file was moved. The file stays open, so the download
+	just goes on, only the path is updated.
+*/
+void
+SegmentedDownload::HasMovedTo(const BPath& path)
+{
+	BAutolock _(fLock);
+	fPath = path;
+}
+
+
+/*!	Stops all requests. The file is left as it is, and no more messages are
+	sent to the progress listener.
+*/
+void
+SegmentedDownload::Cancel()
+{
+	BAutolock _(fLock);
+	fCancelled = true;
+	for (size_t i = 0; i < fRequests.size(); i++)
+		fRequests[i]->Stop();
+}
+
+
+/*!	Returns whether \a url is one a SegmentedDownload could try to fetch.
+*/
+/*static*/ bool
+SegmentedDownload::CanDownload(const BString& url)
+{
+	BUrl parsed(url);
+	return parsed.IsValid()
+		&& (parsed.Protocol() == "http" || parsed.Protocol() == "https");
+}
+
+
+// #pragma mark - private
+
+
+status_t
+SegmentedDownload::_StartThread()
+{
+	thread_id thread = spawn_thread(_ThreadEntry, "segmented download",
+		B_NORMAL_PRIORITY, this);
+	if (thread < 0)
+		return thread;
+
+	sRunningLock.Lock();
+	fThread = thread;
+	sRunning.push_back(this);
+	sRunningLock.Unlock();
+
+	// The thread keeps the download alive until it is done.
+	AcquireReference();
+	resume_thread(thread);
+	return B_OK;
+}
+
+
+/*static*/ int32
+SegmentedDownload::_ThreadEntry(void* data)
+{
+	SegmentedDownload* download = static_cast<SegmentedDownload*>(data);
+	download->_Run();
+
+	sRunningLock.Lock();
+	for (size_t i = 0; i < sRunning.size(); i++) {
+		if (sRunning[i] == download) {
+			sRunning.erase(sRunning.begin() + i);
+			break;
+		}
+	}
+	sRunningLock.Unlock();
+
+	download->ReleaseReference();
+	return B_OK;
+}
+
+
+void
+SegmentedDownload::_Run()
+{
+	bool resume = fResumeOffset > 0;
+	off_t length;
+	BString filename;
+	status_t status = B_OK;
+	if (resume) {
+		_WaitForEarlierWriters();
+		status = _OpenFile();
+	}
+	if (status == B_OK)
+		status = _Probe(length, filename);
+	if (resume) {
+		// The server must still have the file that was partly downloaded.
+		if (status == B_OK && length != ExpectedSize())
+			status = B_MISMATCHED_VALUES;
+		if (status == B_OK)
+			status = _ExtendFile(length);
+	} else if (status == B_OK)
+		status = _CreateFile(filename, length);
+	if (status != B_OK) {
+		fFile.Unset();
+		BMessage declined(SEGMENTED_DOWNLOAD_DECLINED);
+		_Send(declined);
+		return;
+	}
+
+	BMessage started(B_DOWNLOAD_STARTED);
+	started.AddString("path", Path().Path());
+	_Send(started);
+
+	_Split(fResumeOffset, length);
+	for (int32 attempt = 0; attempt < kMaxAttempts && !_IsCancelled();
+			attempt++) {
+		if (_FetchSegments())
+			break;
+	}
+
+	// Always report the final size.
+	fLock.Lock();
+	fLastProgress = 0;
+	fLock.Unlock();
+	_SendProgress();
+
+	fFile.Sync();
+	fFile.Unset();
+	update_mime_info(Path().Path(), false, false, false);
+
+	BMessage removed(B_DOWNLOAD_REMOVED);
+	_Send(removed);
+}
+
+
+/*!	Waits until no download that was started before this one writes to the
+	file anymore. A paused download was only cancelled, the writes of its
+	requests may still be under way when it is resumed. Only earlier
+	downloads are waited for, so two resumed downloads of the same file
+	cannot wait for each other.
+*/
+void
+SegmentedDownload::_WaitForEarlierWriters()
+{
+	BPath path = Path();
+	while (true) {
+		thread_id thread = -1;
+		sRunningLock.Lock();
+		for (size_t i = 0; i < sRunning.size() && sRunning[i] != this; i++) {
+			if (sRunning[i]->Path() == path) {
+				thread = sRunning[i]->fThread;
+				break;
+			}
+		}
+		sRunningLock.Unlock();
+
+		if (thread < 0)
+			return;
+
+		status_t exitValue;
+		wait_for_thread(thread, &exitValue);
+	}
+}
+
+
+/*static*/ int32
+SegmentedDownload::_SegmentThreadEntry(void* data)
+{
+	SegmentJob* job = static_cast<SegmentJob*>(data);
+	job->download->_Fetch(*job->segment);
+	return B_OK;
+}
+
+
+/*!	Creates a request for the bytes from \a start to \a end of the file,
+	which writes to \a output. Once the server described the file with a
+	validator, only a range of that same file is accepted.
+*/
+BHttpRequest*
+SegmentedDownload::_MakeRequest(BDataIO* output, off_t start, off_t end)
+{
+	BUrlRequest* request = BUrlProtocolRoster::MakeRequest(BUrl(fURL),
+		output, NULL, fContext.Get());
+	BHttpRequest* httpRequest = dynamic_cast<BHttpRequest*>(request);
+	if (httpRequest == NULL) {
+		delete request;
+		return NULL;
+	}
+
+	httpRequest->SetFollowLocation(true);
+	httpRequest->SetStopOnError(true);
+	httpRequest->SetRangeStart(start);
+	httpRequest->SetRangeEnd(end);
+
+	// A weak ETag cannot be used for ranges.
+	BString validator;
+	fLock.Lock();
+	if (!fETag.IsEmpty() && !fETag.StartsWith("W/"))
+		validator = fETag;
+	else
+		validator = fLastModified;
+	fLock.Unlock();
+
+	if (!validator.IsEmpty()) {
+		BHttpHeaders* headers = new BHttpHeaders();
+		headers->AddHeader("If-Range", validator.String());
+		httpRequest->AdoptHeaders(headers);
+	}
+	return httpRequest;
+}
+
+
+/*!	Asks for a single byte of the file where the download starts, to find
+	out whether the server supports ranges, how large the file is, and how
+	to tell whether it changed. When resuming, the server only answers with
+	a range if the file is still the same.
+*/
+status_t
+SegmentedDownload::_Probe(off_t& length, BString& filename)
+{
+	SegmentWriter writer(this, NULL);
+	BHttpRequest* httpRequest = _MakeRequest(&writer, fResumeOffset,
+		fResumeOffset);
+	if (httpRequest == NULL)
+		return B_NOT_SUPPORTED;
+	writer.SetRequest(httpRequest);
+
+	if (!_AddRequest(httpRequest)) {
+		delete httpRequest;
+		return B_CANCELED;
+	}
+	thread_id thread = httpRequest->Run();
+	if (thread >= 0) {
+		status_t exitValue;
+		wait_for_thread(thread, &exitValue);
+	}
+	_RemoveRequest(httpRequest);
+
+	const BHttpResult& result
+		= static_cast<const BHttpResult&>(httpRequest->Result());
+	status_t status = B_NOT_SUPPORTED;
+	const char* range = result.Headers()["Content-Range"];
+	const char* total = range != NULL ? strrchr(range, '/') : NULL;
+	if (result.StatusCode() == 206 && total != NULL && total[1] != '*') {
+		length = strtoll(total + 1, NULL, 10);
+		filename = disposition_filename(
+			result.Headers()["Content-Disposition"]);
+		status = length > 0 ? B_OK : B_NOT_SUPPORTED;
+	}
+
+	const char* etag = result.Headers()["ETag"];
+	const char* lastModified = result.Headers()["Last-Modified"];
+	if (status == B_OK && fResumeOffset > 0 && ETag().IsEmpty()
+		&& LastModified().IsEmpty()) {
+		// Nothing told the file apart when it was started. It is only
+		// assumed to be the same if the server says it was not modified
+		// since.
+		time_t created;
+		if (lastModified == NULL
+			|| fFile.GetCreationTime(&created) != B_OK
+			|| BHttpTime(lastModified).Parse().Time_t() > created) {
+			status = B_MISMATCHED_VALUES;
+		}
+	}
+	if (status == B_OK) {
+		BAutolock _(fLock);
+		fETag = etag;
+		fLastModified = lastModified;
+	}
+	delete httpRequest;
+
+	if (status != B_OK)
+		return status;
+
+	BUrl url(fURL);
+	if (filename.IsEmpty()) {
+		filename = BUrl::UrlDecode(BPath(url.Path().String()).Leaf());
+		if (filename.IsEmpty())
+			filename = "Download";
+	}
+	filename.ReplaceAll('/', '-');
+	return B_OK;
+}
+
+
+/*!	Creates the file in the download directory at its full size, so the
+	segments can be written to their place as they arrive. An existing file
+	of the same name is not touched, a number is added to the name instead.
+*/
+status_t
+SegmentedDownload::_CreateFile(const BString& filename, off_t length)
+{
+	BString base = filename;
+	BString extension;
+	int32 dot = filename.FindLast('.');
+	if (dot > 0) {
+		filename.CopyInto(base, 0, dot);
+		filename.CopyInto(extension, dot, filename.Length() - dot);
+	}
+
+	BPath path;
+	status_t status = B_ERROR;
+	for (int32 i = 0; i < 100; i++) {
+		BString name = base;
+		if (i > 0)
+			name << " (" << i << ")";
+		name << extension;
+
+		status = path.SetTo(fDirectory.Path(), name.String());
+		if (status != B_OK)
+			return status;
+		status = fFile.SetTo(path.Path(),
+			B_READ_WRITE | B_CREATE_FILE | B_FAIL_IF_EXISTS);
+		if (status != B_FILE_EXISTS)
+			break;
+	}
+	if (status != B_OK)
+		return status;
+
+	status = fFile.SetSize(length);
+	if (status != B_OK) {
+		fFile.Unset();
+		BEntry(path.Path()).Remove();
+		return status;
+	}
+
+	BAutolock _(fLock);
+	fPath = path;
+	fExpectedSize = length;
+	return B_OK;
+}
+
+
+/*!	Opens the partly downloaded file to continue it. Only as much of it as
+	is actually there is continued from.
+*/
+status_t
+SegmentedDownload::_OpenFile()
+{
+	off_t size;
+	status_t status = fFile.SetTo(Path().Path(), B_READ_WRITE);
+	if (status == B_OK)
+		status = fFile.GetSize(&size);
+	if (status == B_OK && size <= 0)
+		status = B_BAD_DATA;
+	if (status != B_OK) {
+		fFile.Unset();
+		return status;
+	}
+
+	if (size < fResumeOffset) {
+		BAutolock _(fLock);
+		fResumeOffset = size;
+		atomic_set64(&fCurrentSize, size);
+	}
+	return B_OK;
+}
+
+
+/*!	Brings the continued file to its full size.
+*/
+status_t
+SegmentedDownload::_ExtendFile(off_t length)
+{
+	off_t size;
+	status_t status = fFile.GetSize(&size);
+	if (status == B_OK && size < length)
+		status = fFile.SetSize(length);
+	return status;
+}
+
+
+/*!	Splits the part of the file from \a start to \a length into the
+	segments that are fetched in parallel.
+*/
+void
+SegmentedDownload::_Split(off_t start, off_t length)
+{
+	off_t remaining = length - start;
+	int32 count = fConnections;
+	if (remaining / count < kMinSegmentSize)
+		count = remaining / kMinSegmentSize;
+	if (count < 1)
+		count = 1;
+
+	BAutolock _(fLock);
+	off_t segmentSize = remaining / count;
+	for (int32 i = 0; i < count; i++) {
+		Segment segment;
+		segment.start = start + i * segmentSize;
+		segment.end = i == count - 1 ? length - 1
+			: segment.start + segmentSize - 1;
+		segment.written = 0;
+		fSegments.push_back(segment);
+	}
+}
+
+
+/*!	Fetches all incomplete segments in parallel, and returns whether all of
+	them are complete afterwards. Broken segments continue where they
+	stopped the next time.
+*/
+bool
+SegmentedDownload::_FetchSegments()
+{
+	std::vector<thread_id> threads;
+	std::vector<SegmentJob> jobs(fSegments.size());
+	Segment* local = NULL;
+
+	for (size_t i = 0; i < fSegments.size(); i++) {
+		Segment& segment = fSegments[i];
+		if (segment.start + segment.written > segment.end)
+			continue;
+
+		// The first incomplete segment is fetched in this thread.
+		if (local == NULL) {
+			local = &segment;
+			continue;
+		}
+
+		jobs[i].download = this;
+		jobs[i].segment = &segment;
+		thread_id thread = spawn_thread(_SegmentThreadEntry,
+			"download segment", B_NORMAL_PRIORITY, &jobs[i]);
+		if (thread >= 0) {
+			threads.push_back(thread);
+			resume_thread(thread);
+		}
+	}
+
+	if (local != NULL)
+		_Fetch(*local);
+
+	for (size_t i = 0; i < threads.size(); i++) {
+		status_t exitValue;
+		wait_for_thread(threads[i], &exitValue);
+	}
+
+	for (size_t i = 0; i < fSegments.size(); i++) {
+		if (fSegments[i].start + fSegments[i].written <= fSegments[i].end)
+			return false;
+	}
+	return true;
+}
+
+
+/*!	Requests the rest of \a segment, and writes it to the file. Returns
+	when the segment is complete, or the request ended early.
+*/
+status_t
+SegmentedDownload::_Fetch(Segment& segment)
+{
+	SegmentWriter writer(this, &segment);
+	BHttpRequest* httpRequest = _MakeRequest(&writer,
+		segment.start + segment.written, segment.end);
+	if (httpRequest == NULL)
+		return B_NOT_SUPPORTED;
+	writer.SetRequest(httpRequest);
+
+	if (!_AddRequest(httpRequest)) {
+		delete httpRequest;
+		return B_CANCELED;
+	}
+	thread_id thread = httpRequest->Run();
+	if (thread >= 0) {
+		status_t exitValue;
+		wait_for_thread(thread, &exitValue);
+	}
+	_RemoveRequest(httpRequest);
+	delete httpRequest;
+
+	return segment.start + segment.written > segment.end ? B_OK : B_IO_ERROR;
+}
+
+
+/*!	Registers a request to be stopped by Cancel(). Returns \c false if the
+	download was cancelled already, and the request should not be run.
+*/
+bool
+SegmentedDownload::_AddRequest(BUrlRequest* request)
+{
+	BAutolock _(fLock);
+	if (fCancelled)
+		return false;
+	fRequests.push_back(request);
+	return true;
+}
+
+
+void
+SegmentedDownload::_RemoveRequest(BUrlRequest* request)
+{
+	BAutolock _(fLock);
+	for (size_t i = 0; i < fRequests.size(); i++) {
+		if (fRequests[i] == request) {
+			fRequests.erase(fRequests.begin() + i);
+			break;
+		}
+	}
+}
+
+
+bool
+SegmentedDownload::_IsCancelled() const
+{
+	BAutolock _(fLock);
+	return fCancelled;
+}
+
+
+/*!	Called by the segment writers, in the threads of the requests.
+	_SendProgress() checks under the lock whether it is time to send.
+*/
+void
+SegmentedDownload::_BytesWritten(size_t bytes)
+{
+	atomic_add64(&fCurrentSize, bytes);
+	_SendProgress();
+}
+
+
+void
+SegmentedDownload::_SendProgress()
+{
+	BMessage progress(B_DOWNLOAD_PROGRESS);
+	{
+		BAutolock _(fLock);
+		bigtime_t now = system_time();
+		if (now - fLastProgress < kProgressInterval)
+			return;
+		fLastProgress = now;
+
+		progress.AddInt64("current size", CurrentSize());
+		progress.AddInt64("expected size", fExpectedSize);
+	}
+	_Send(progress);
+}
+
+
+/*!	Sends \a message to the progress listener, unless the download was
+	cancelled.
+*/
+void
+SegmentedDownload::_Send(BMessage& message)
+{
+	BMessenger listener;
+	{
+		BAutolock _(fLock);
+		if (fCancelled)
+			return;
+		listener = fListener;
+	}
+	listener.SendMessage(&message);
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SEGMENTED_DOWNLOAD_H
+#define SEGMENTED_DOWNLOAD_H
+
+
+#include <File.h>
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <Path.h>
+#include <Referenceable.h>
+#include <String.h>
+#include <UrlContext.h>
+
+#include <vector>
+
+
+namespace BPrivate {
+namespace Network {
+	class BHttpRequest;
+	class BUrlRequest;
+}
+}
+
+
+enum {
+	SEGMENTED_DOWNLOAD_DECLINED = 'sgdd'
+};
+
+
+/*!	Downloads a file over HTTP with the network kit instead of WebKit, over
+	one or several connections at once. The server is asked for the first
+	byte of the file first; if it answers with a range, the file is created
+	at its full size, split into segments, and each segment is fetched with
+	a range request of its own and written to its place in the file. Every
+	segment is at least 1 MiB large, so files smaller than 2 MiB are fetched
+	over a single connection, but still by the SegmentedDownload.
+
+	The progress listener is sent the same messages a BWebDownload sends:
+	B_DOWNLOAD_STARTED with the "path" once the file was created,
+	B_DOWNLOAD_PROGRESS, and B_DOWNLOAD_REMOVED when the download ended,
+	complete or not. If the server does not support ranges, nothing is
+	written, and SEGMENTED_DOWNLOAD_DECLINED is sent instead.
+
+	What the requests receive is written at the pace the BandwidthScheduler
+	allows for the priority of the download.
+
+	A download that stopped early can be resumed with Resume(): the rest of
+	the file is requested with a range starting where the complete part of
+	it ends, and, if the server sent one, the ETag or Last-Modified
+	validator in If-Range. If the file changed on the server in the
+	meantime, or the server does not support ranges anymore, the file is
+	left as it is, and SEGMENTED_DOWNLOAD_DECLINED is sent. Cancel() only
+	stops the requests, so before the file is opened again, a resumed
+	download waits until the threads of the downloads started before it
+	for the same file, which may still be writing to it, are gone.
+
+	The download runs in threads of its own, which keep a reference to it.
+*/
+class SegmentedDownload : public BReferenceable {
+public:
+								SegmentedDownload(const BString& url,
+									BPrivate::Network::BUrlContext* context);
+
+			const BString&		URL() const { return fURL; }
+			BPath				Directory() const;
+			BPath				Path() const;
+			off_t				CurrentSize() const;
+			off_t				ExpectedSize() const;
+			off_t				ResumeOffset() const;
+			BString				ETag() const;
+			BString				LastModified() const;
+
+			void				SetProgressListener(
+									const BMessenger& listener);
+			void				SetPriority(int32 priority);
+			int32				Priority() const;
+
+			status_t			Start(const BPath& directory,
+									int32 connections);
+			status_t			Resume(const BPath& path, off_t offset,
+									off_t expectedSize, const BString& etag,
+									const BString& lastModified,
+									int32 connections);
+			void				HasMovedTo(const BPath& path);
+			void				Cancel();
+
+	static	bool				CanDownload(const BString& url);
+
+private:
+			struct Segment {
+				off_t			start;
+				off_t			end;
+					// inclusive
+				off_t			written;
+			};
+
+			struct SegmentJob {
+				SegmentedDownload* download;
+				Segment*		segment;
+			};
+
+			class SegmentWriter;
+			friend class SegmentWriter;
+
+	virtual						~SegmentedDownload();
+
+			status_t			_StartThread();
+	static	int32				_ThreadEntry(void* data);
+			void				_Run();
+			void				_WaitForEarlierWriters();
+	static	int32				_SegmentThreadEntry(void* data);
+
+			BPrivate::Network::BHttpRequest* _MakeRequest(BDataIO* output,
+									off_t start, off_t end);
+			status_t			_Probe(off_t& length, BString& filename);
+			status_t			_CreateFile(const BString& filename,
+									off_t length);
+			status_t			_OpenFile();
+			status_t			_ExtendFile(off_t length);
+			void				_Split(off_t start, off_t length);
+			bool				_FetchSegments();
+			status_t			_Fetch(Segment& segment);
+
+			bool				_AddRequest(
+									BPrivate::Network::BUrlRequest* request);
+			void				_RemoveRequest(
+									BPrivate::Network::BUrlRequest* request);
+			bool				_IsCancelled() const;
+
+			void				_BytesWritten(size_t bytes);
+			void				_SendProgress();
+			void				_Send(BMessage& message);
+
+private:
+	mutable	BLocker				fLock;
+			BString				fURL;
+			BReference<BPrivate::Network::BUrlContext> fContext;
+			BMessenger			fListener;
+
+			BPath				fDirectory;
+			BPath				fPath;
+			BFile				fFile;
+			int32				fConnections;
+			std::vector<Segment> fSegments;
+			std::vector<BPrivate::Network::BUrlRequest*> fRequests;
+				// the running ones, so they can be stopped
+
+			off_t				fResumeOffset;
+				// where the file is continued, 0 for a new download
+			BString				fETag;
+			BString				fLastModified;
+
+			int64				fCurrentSize;
+			off_t				fExpectedSize;
+			int32				fPriority;
+			bigtime_t			fLastProgress;
+			bool				fCancelled;
+			thread_id			fThread;
+};
+
+
+#endif // SEGMENTED_DOWNLOAD_H
@@ -0,0 +1,404 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "SessionJournal.h"
+
+#include <new>
+
+#include <Autolock.h>
+#include <InterfaceDefs.h>
+#include <Message.h>
+
+
+enum {
+	kWindowOpenedRecord		= 'jwop',
+	kWindowChangedRecord	= 'jwch',
+	kWindowClosedRecord		= 'jwcl',
+	kTabOpenedRecord		= 'jtop',
+	kTabNavigatedRecord		= 'jtnv',
+	kTabClosedRecord		= 'jtcl'
+};
+
+
+struct SessionJournal::TabState {
+	TabState(uint32 id, const void* key, const BString& url)
+		:
+		id(id),
+		key(key),
+		url(url)
+	{
+	}
+
+	uint32		id;
+	const void*	key;
+	BString		url;
+};
+
+
+struct SessionJournal::WindowState {
+	WindowState(uint32 id, BRect frame, uint32 workspaces)
+		:
+		id(id),
+		frame(frame),
+		workspaces(workspaces)
+	{
+	}
+
+	~WindowState()
+	{
+		for (size_t i = 0; i < tabs.size(); i++)
+			delete tabs[i];
+	}
+
+	uint32					id;
+	BRect					frame;
+	uint32					workspaces;
+	std::vector<TabState*>	tabs;
+};
+
+
+SessionJournal SessionJournal::sDefaultInstance;
+
+
+SessionJournal::SessionJournal()
+	:
+	RecordJournal("session journal", "SessionJournal"),
+	fNextID(1)
+{
+}
+
+
+SessionJournal::~SessionJournal()
+{
+	Shutdown();
+
+	for (size_t i = 0; i < fWindows.size(); i++)
+		delete fWindows[i];
+}
+
+
+/*static*/ SessionJournal*
+SessionJournal::DefaultInstance()
+{
+	return &sDefaultInstance;
+}
+
+
+/*!	Replays the journal into \a session, using the same layout the old
+	session archive had: one "window" message per window, containing
+	"window frame", "window workspaces" and one "tab" string per tab.
+	Nothing is written before Start() is called, so a crash while the
+	restored windows are being created leaves the journal untouched.
+*/
+status_t
+SessionJournal::Load(BMessage& session)
+{
+	BAutolock _(this);
+
+	status_t status = _Replay();
+	if (status != B_OK)
+		return status;
+
+	for (size_t i = 0; i < fWindows.size(); i++) {
+		const WindowState* window = fWindows[i];
+		if (window->tabs.empty())
+			continue;
+
+		BMessage archive;
+		archive.AddRect("window frame", window->frame);
+		archive.AddUInt32("window workspaces", window->workspaces);
+		for (size_t j = 0; j < window->tabs.size(); j++)
+			archive.AddString("tab", window->tabs[j]->url);
+		session.AddMessage("window", &archive);
+	}
+
+	// The restored windows register themselves again.
+	for (size_t i = 0; i < fWindows.size(); i++)
+		delete fWindows[i];
+	fWindows.clear();
+
+	return B_OK;
+}
+
+
+uint32
+SessionJournal::WindowOpened(BRect frame, uint32 workspaces)
+{
+	BAutolock _(this);
+
+	uint32 id = fNextID++;
+
+	BMessage* record = new(std::nothrow) BMessage(kWindowOpenedRecord);
+	if (record == NULL)
+		return id;
+	record->AddUInt32("window", id);
+	record->AddRect("frame", frame);
+	record->AddUInt32("workspaces", workspaces);
+
+	_Apply(*record);
+	_Append(record);
+	return id;
+}
+
+
+void
+SessionJournal::WindowChanged(uint32 id, BRect frame, uint32 workspaces)
+{
+	BAutolock _(this);
+
+	WindowState* window = _FindWindow(id);
+	if (window == NULL
+		|| (window->frame == frame && window->workspaces == workspaces)) {
+		return;
+	}
+
+	BMessage* record = new(std::nothrow) BMessage(kWindowChangedRecord);
+	if (record == NULL)
+		return;
+	record->AddUInt32("window", id);
+	record->AddRect("frame", frame);
+	record->AddUInt32("workspaces", workspaces);
+
+	_Apply(*record);
+	_Append(record, "window");
+}
+
+
+void
+SessionJournal::WindowClosed(uint32 id)
+{
+	BAutolock _(this);
+
+	if (_FindWindow(id) == NULL)
+		return;
+
+	BMessage* record = new(std::nothrow) BMessage(kWindowClosedRecord);
+	if (record == NULL)
+		return;
+	record->AddUInt32("window", id);
+
+	_Apply(*record);
+	_Append(record);
+}
+
+
+/*!	A tab was opened at \a index in the tab strip of the window.
+*/
+void
+SessionJournal::TabOpened(uint32 windowID, const void* tab, int32 index,
+	const BString& url)
+{
+	BAutolock _(this);
+
+	if (_FindWindow(windowID) == NULL)
+		return;
+
+	BMessage* record = new(std::nothrow) BMessage(kTabOpenedRecord);
+	if (record == NULL)
+		return;
+	record->AddUInt32("window", windowID);
+	record->AddUInt32("tab", fNextID++);
+	record->AddInt32("index", index);
+	record->AddString("url", url);
+
+	_Apply(*record, tab);
+	_Append(record);
+}
+
+
+void
+SessionJournal::TabNavigated(uint32 windowID, const void* tab,
+	const BString& url)
+{
+	BAutolock _(this);
+
+	TabState* state = _FindTab(_FindWindow(windowID), tab);
+	if (state == NULL || state->url == url)
+		return;
+
+	BMessage* record = new(std::nothrow) BMessage(kTabNavigatedRecord);
+	if (record == NULL)
+		return;
+	record->AddUInt32("window", windowID);
+	record->AddUInt32("tab", state->id);
+	record->AddString("url", url);
+
+	_Apply(*record);
+	_Append(record);
+}
+
+
+void
+SessionJournal::TabClosed(uint32 windowID, const void* tab)
+{
+	BAutolock _(this);
+
+	TabState* state = _FindTab(_FindWindow(windowID), tab);
+	if (state == NULL)
+		return;
+
+	BMessage* record = new(std::nothrow) BMessage(kTabClosedRecord);
+	if (record == NULL)
+		return;
+	record->AddUInt32("window", windowID);
+	record->AddUInt32("tab", state->id);
+
+	_Apply(*record);
+	_Append(record);
+}
+
+
+/*!	The view shown for a tab changed, which does not change the session.
+	Only the key identifying the tab is updated.
+*/
+void
+SessionJournal::TabReplaced(uint32 windowID, const void* tab,
+	const void* replacement)
+{
+	BAutolock _(this);
+
+	TabState* state = _FindTab(_FindWindow(windowID), tab);
+	if (state != NULL)
+		state->key = replacement;
+}
+
+
+// #pragma mark - private
+
+
+SessionJournal::WindowState*
+SessionJournal::_FindWindow(uint32 id) const
+{
+	for (size_t i = 0; i < fWindows.size(); i++) {
+		if (fWindows[i]->id == id)
+			return fWindows[i];
+	}
+	return NULL;
+}
+
+
+SessionJournal::TabState*
+SessionJournal::_FindTab(const WindowState* window, const void* key) const
+{
+	if (window == NULL || key == NULL)
+		return NULL;
+
+	for (size_t i = 0; i < window->tabs.size(); i++) {
+		if (window->tabs[i]->key == key)
+			return window->tabs[i];
+	}
+	return NULL;
+}
+
+
+void
+SessionJournal::_Apply(const BMessage& record)
+{
+	_Apply(record, NULL);
+}
+
+
+/*!	Applies a record to the in-memory session model. This is used both for
+	replaying the journal and for live events, so both always agree.
+*/
+void
+SessionJournal::_Apply(const BMessage& record, const void* tabKey)
+{
+	uint32 windowID = record.GetUInt32("window", 0);
+	uint32 tabID = record.GetUInt32("tab", 0);
+
+	if (record.what == kWindowOpenedRecord) {
+		WindowState* window = new(std::nothrow) WindowState(windowID,
+			record.GetRect("frame", BRect()),
+			record.GetUInt32("workspaces", B_CURRENT_WORKSPACE));
+		if (window != NULL)
+			fWindows.push_back(window);
+		return;
+	}
+
+	WindowState* window = _FindWindow(windowID);
+	if (window == NULL)
+		return;
+
+	switch (record.what) {
+		case kWindowChangedRecord:
+			window->frame = record.GetRect("frame", window->frame);
+			window->workspaces = record.GetUInt32("workspaces",
+				window->workspaces);
+			break;
+
+		case kWindowClosedRecord:
+			for (size_t i = 0; i < fWindows.size(); i++) {
+				if (fWindows[i] == window) {
+					fWindows.erase(fWindows.begin() + i);
+					break;
+				}
+			}
+			delete window;
+			break;
+
+		case kTabOpenedRecord:
+		{
+			TabState* tab = new(std::nothrow) TabState(tabID, tabKey,
+				record.GetString("url", ""));
+			if (tab == NULL)
+				break;
+
+			// Records without a valid index append the tab.
+			int32 index = record.GetInt32("index", -1);
+			if (index < 0 || index > (int32)window->tabs.size())
+				index = window->tabs.size();
+			window->tabs.insert(window->tabs.begin() + index, tab);
+			break;
+		}
+
+		case kTabNavigatedRecord:
+		case kTabClosedRecord:
+			for (size_t i = 0; i < window->tabs.size(); i++) {
+				TabState* tab = window->tabs[i];
+				if (tab->id != tabID)
+					continue;
+				if (record.what == kTabNavigatedRecord)
+					tab->url = record.GetString("url", tab->url);
+				else {
+					window->tabs.erase(window->tabs.begin() + i);
+					delete tab;
+				}
+				break;
+			}
+			break;
+	}
+}
+
+
+/*!	Creates the records that rebuild the current session model from
+	scratch. Must be called with the lock held.
+*/
+void
+SessionJournal::_SnapshotRecords(RecordList& records) const
+{
+	for (size_t i = 0; i < fWindows.size(); i++) {
+		const WindowState* window = fWindows[i];
+
+		BMessage* record = new(std::nothrow) BMessage(kWindowOpenedRecord);
+		if (record == NULL)
+			return;
+		record->AddUInt32("window", window->id);
+		record->AddRect("frame", window->frame);
+		record->AddUInt32("workspaces", window->workspaces);
+		records.push_back(record);
+
+		for (size_t j = 0; j < window->tabs.size(); j++) {
+			record = new(std::nothrow) BMessage(kTabOpenedRecord);
+			if (record == NULL)
+				return;
+			record->AddUInt32("window", window->id);
+			record->AddUInt32("tab", window->tabs[j]->id);
+			record->AddInt32("index", j);
+			record->AddString("url", window->tabs[j]->url);
+			records.push_back(record);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SESSION_JOURNAL_H
+#define SESSION_JOURNAL_H
+
+
+#include <Rect.h>
+#include <String.h>
+
+#include <vector>
+
+#include "RecordJournal.h"
+
+
+class BMessage;
+
+
+/*!	Keeps the browsing session on disk as an append-only journal of small
+	records (window opened/changed/closed, tab opened/navigated/closed).
+
+	Records are queued by the window threads and written in batches by the
+	RecordJournal writer thread. An in-memory model of the session is kept
+	alongside, so the journal can periodically be compacted into a snapshot
+	of the live state. Window and tab events reported after Shutdown() are
+	ignored, so that the windows being closed on quit stay in the session.
+*/
+class SessionJournal : public RecordJournal {
+public:
+	static	SessionJournal*		DefaultInstance();
+
+			status_t			Load(BMessage& session);
+
+			uint32				WindowOpened(BRect frame, uint32 workspaces);
+			void				WindowChanged(uint32 window, BRect frame,
+									uint32 workspaces);
+			void				WindowClosed(uint32 window);
+
+			void				TabOpened(uint32 window, const void* tab,
+									int32 index, const BString& url);
+			void				TabNavigated(uint32 window, const void* tab,
+									const BString& url);
+			void				TabClosed(uint32 window, const void* tab);
+			void				TabReplaced(uint32 window, const void* tab,
+									const void* replacement);
+
+private:
+			struct TabState;
+			struct WindowState;
+
+								SessionJournal();
+	virtual						~SessionJournal();
+
+			WindowState*		_FindWindow(uint32 id) const;
+			TabState*			_FindTab(const WindowState* window,
+									const void* key) const;
+	virtual	void				_Apply(const BMessage& record);
+			void				_Apply(const BMessage& record,
+									const void* tabKey);
+	virtual	void				_SnapshotRecords(RecordList& records) const;
+
+private:
+			std::vector<WindowState*> fWindows;
+			uint32				fNextID;
+
+	static	SessionJournal		sDefaultInstance;
+};
+
+
+#endif // SESSION_JOURNAL_H
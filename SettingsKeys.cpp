@@ -14,6 +14,11 @@
 
 
 const char* kSettingsKeyDownloadPath = "download path";
+const char* kSettingsKeyDownloadConnections = "download connections";
+const char* kSettingsKeyDownloadRateLimit = "download rate limit";
+	// in KiB/s, 0 for none
+const char* kSettingsKeyDownloadsYieldToBrowsing
+	= "downloads yield to browsing";
 const char* kSettingsKeyShowTabsIfSinglePageOpen
 	= "show tabs if single page open";
 const char* kSettingsKeyAutoHideInterfaceInFullscreenMode
@@ -31,6 +36,8 @@ const char* kDefaultDownloadPath = "/boot/home/Desktop/";
 const char* kDefaultStartPageURL
 	= "file:///boot/home/config/settings/WebPositive/LoaderPages/Welcome";
 const char* kDefaultSearchPageURL = "https://duckduckgo.com/?q=%s";
+const uint32 kDefaultDownloadConnections = 1;
+const uint32 kDefaultDiscardTabsAfter = 30;
 
 const char* kSettingsKeyUseProxy = "use http proxy";
 const char* kSettingsKeyProxyAddress = "http proxy address";
@@ -39,6 +46,8 @@ const char* kSettingsKeyUseProxyAuth = "use http proxy authentication";
 const char* kSettingsKeyProxyUsername = "http proxy username";
 const char* kSettingsKeyProxyPassword = "http proxy password";
 
+const char* kSettingsKeyDiscardTabsAfter = "discard inactive tabs after";
+
 const char* kSettingsShowBookmarkBar = "show bookmarks bar";
 
 const struct SearchEngine kSearchEngines[] = {
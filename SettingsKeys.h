@@ -16,6 +16,9 @@
 
 
 extern const char* kSettingsKeyDownloadPath;
+extern const char* kSettingsKeyDownloadConnections;
+extern const char* kSettingsKeyDownloadRateLimit;
+extern const char* kSettingsKeyDownloadsYieldToBrowsing;
 extern const char* kSettingsKeyShowTabsIfSinglePageOpen;
 extern const char* kSettingsKeyAutoHideInterfaceInFullscreenMode;
 extern const char* kSettingsKeyAutoHidePointer;
@@ -30,6 +33,9 @@ extern const char* kSettingsKeySearchPageURL;
 extern const char* kDefaultDownloadPath;
 extern const char* kDefaultStartPageURL;
 extern const char* kDefaultSearchPageURL;
+extern const uint32 kDefaultDownloadConnections;
+extern const uint32 kDefaultDiscardTabsAfter;
+	// In minutes, 0 only discards tabs when memory is low.
 
 extern const char* kSettingsKeyUseProxy;
 extern const char* kSettingsKeyProxyAddress;
@@ -38,6 +44,8 @@ extern const char* kSettingsKeyUseProxyAuth;
 extern const char* kSettingsKeyProxyUsername;
 extern const char* kSettingsKeyProxyPassword;
 
+extern const char* kSettingsKeyDiscardTabsAfter;
+
 extern const char* kSettingsShowBookmarkBar;
 
 struct SearchEngine {
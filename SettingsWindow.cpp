@@ -50,10 +50,14 @@ enum {
 	MSG_SEARCH_PAGE_CHANGED						= 'spch',
 	MSG_SEARCH_PAGE_CHANGED_MENU				= 'spcm',
 	MSG_DOWNLOAD_FOLDER_CHANGED					= 'dnfc',
+	MSG_DOWNLOAD_CONNECTIONS_CHANGED			= 'dncc',
+	MSG_DOWNLOAD_RATE_LIMIT_CHANGED				= 'dnrl',
+	MSG_DOWNLOADS_YIELD_TO_BROWSING_CHANGED		= 'dnyb',
 	MSG_NEW_WINDOWS_BEHAVIOR_CHANGED			= 'nwbc',
 	MSG_NEW_TABS_BEHAVIOR_CHANGED				= 'ntbc',
 	MSG_START_UP_BEHAVIOR_CHANGED				= 'subc',
 	MSG_HISTORY_MENU_DAYS_CHANGED				= 'digm',
+	MSG_DISCARD_TABS_AFTER_CHANGED				= 'dtac',
 	MSG_TAB_DISPLAY_BEHAVIOR_CHANGED			= 'tdbc',
 	MSG_AUTO_HIDE_INTERFACE_BEHAVIOR_CHANGED	= 'ahic',
 	MSG_AUTO_HIDE_POINTER_BEHAVIOR_CHANGED		= 'ahpc',
@@ -131,10 +135,9 @@ SettingsWindow::SettingsWindow(BRect frame, SettingsMessage* settings)
 	if (!frame.IsValid())
 		CenterOnScreen();
 
-	// load settings from disk
+	// load settings from disk, the application already applied them to
+	// WebKit on start up
 	_RevertSettings();
-	// apply to WebKit
-	_ApplySettings();
 
 	// Start hidden
 	Hide();
@@ -219,10 +222,14 @@ SettingsWindow::MessageReceived(BMessage* message)
 		case MSG_START_PAGE_CHANGED:
 		case MSG_SEARCH_PAGE_CHANGED:
 		case MSG_DOWNLOAD_FOLDER_CHANGED:
+		case MSG_DOWNLOAD_CONNECTIONS_CHANGED:
+		case MSG_DOWNLOAD_RATE_LIMIT_CHANGED:
+		case MSG_DOWNLOADS_YIELD_TO_BROWSING_CHANGED:
 		case MSG_START_UP_BEHAVIOR_CHANGED:
 		case MSG_NEW_WINDOWS_BEHAVIOR_CHANGED:
 		case MSG_NEW_TABS_BEHAVIOR_CHANGED:
 		case MSG_HISTORY_MENU_DAYS_CHANGED:
+		case MSG_DISCARD_TABS_AFTER_CHANGED:
 		case MSG_TAB_DISPLAY_BEHAVIOR_CHANGED:
 		case MSG_AUTO_HIDE_INTERFACE_BEHAVIOR_CHANGED:
 		case MSG_AUTO_HIDE_POINTER_BEHAVIOR_CHANGED:
@@ -267,6 +274,57 @@ SettingsWindow::Show()
 }
 
 
+/*!	Applies the stored font and proxy settings to the default web page
+	settings. This does not need the window, so it is also used on start up
+	before the window is created.
+*/
+/*static*/ void
+SettingsWindow::ApplyWebSettings(const SettingsMessage* settings)
+{
+	int32 standardFontSize = settings->GetValue("standard font size",
+		kDefaultFontSize);
+	int32 fixedFontSize = settings->GetValue("fixed font size",
+		kDefaultFontSize);
+
+	BFont standardFont = settings->GetValue("standard font", *be_plain_font);
+	standardFont.SetSize(standardFontSize);
+	BFont serifFont = settings->GetValue("serif font",
+		_FindDefaultSerifFont());
+	serifFont.SetSize(standardFontSize);
+	BFont sansSerifFont = settings->GetValue("sans serif font",
+		*be_plain_font);
+	sansSerifFont.SetSize(standardFontSize);
+	BFont fixedFont = settings->GetValue("fixed font", *be_fixed_font);
+	fixedFont.SetSize(fixedFontSize);
+
+	BWebSettings::Default()->SetStandardFont(standardFont);
+	BWebSettings::Default()->SetSerifFont(serifFont);
+	BWebSettings::Default()->SetSansSerifFont(sansSerifFont);
+	BWebSettings::Default()->SetFixedFont(fixedFont);
+	BWebSettings::Default()->SetDefaultStandardFontSize(standardFontSize);
+	BWebSettings::Default()->SetDefaultFixedFontSize(fixedFontSize);
+
+	if (settings->GetValue(kSettingsKeyUseProxy, false)) {
+		BString address = settings->GetValue(kSettingsKeyProxyAddress, "");
+		uint32 port = settings->GetValue(kSettingsKeyProxyPort, (uint32)0);
+		if (settings->GetValue(kSettingsKeyUseProxyAuth, false)) {
+			BWebSettings::Default()->SetProxyInfo(address, port,
+				B_PROXY_TYPE_HTTP,
+				settings->GetValue(kSettingsKeyProxyUsername, ""),
+				settings->GetValue(kSettingsKeyProxyPassword, ""));
+		} else {
+			BWebSettings::Default()->SetProxyInfo(address, port,
+				B_PROXY_TYPE_HTTP, "", "");
+		}
+	} else
+		BWebSettings::Default()->SetProxyInfo();
+
+	// This will find all currently instantiated page settings and apply
+	// the default values, unless the page settings have local overrides.
+	BWebSettings::Default()->Apply();
+}
+
+
 // #pragma mark - private
 
 
@@ -373,6 +431,29 @@ SettingsWindow::_CreateGeneralPage(float spacing)
 	fNewTabBehaviorMenu = new BMenuField("new tab behavior",
 		B_TRANSLATE("New tabs:"), newTabBehaviorMenu);
 
+	// The tabs that are not used for this many minutes are discarded.
+	static const uint32 kDiscardTabsAfterChoices[] = { 0, 5, 15, 30, 60, 120 };
+	const char* discardTabsLabels[] = {
+		B_TRANSLATE("Never"),
+		B_TRANSLATE("After 5 minutes"),
+		B_TRANSLATE("After 15 minutes"),
+		B_TRANSLATE("After 30 minutes"),
+		B_TRANSLATE("After 1 hour"),
+		B_TRANSLATE("After 2 hours")
+	};
+	BPopUpMenu* discardTabsMenu = new BPopUpMenu("Discard tabs");
+	for (size_t i = 0; i < sizeof(kDiscardTabsAfterChoices)
+			/ sizeof(kDiscardTabsAfterChoices[0]); i++) {
+		BMessage* message = new BMessage(MSG_DISCARD_TABS_AFTER_CHANGED);
+		message->AddUInt32("minutes", kDiscardTabsAfterChoices[i]);
+		discardTabsMenu->AddItem(new BMenuItem(discardTabsLabels[i], message));
+	}
+	fDiscardTabsMenu = new BMenuField("discard tabs",
+		B_TRANSLATE("Discard unused tabs:"), discardTabsMenu);
+	fDiscardTabsMenu->SetToolTip(B_TRANSLATE("Discarded tabs are loaded "
+		"again when selected. When memory runs low, tabs are discarded after "
+		"a minute, even with \"Never\"."));
+
 	fDaysInHistory = new BSpinner("days in history",
 		B_TRANSLATE("Number of days to keep links in History menu:"),
 		new BMessage(MSG_HISTORY_MENU_DAYS_CHANGED));
@@ -380,6 +461,32 @@ SettingsWindow::_CreateGeneralPage(float spacing)
 	fDaysInHistory->SetValue(
 		BrowsingHistory::DefaultInstance()->MaxHistoryItemAge());
 
+	fDownloadConnections = new BSpinner("download connections",
+		B_TRANSLATE("Connections per download:"),
+		new BMessage(MSG_DOWNLOAD_CONNECTIONS_CHANGED));
+	fDownloadConnections->SetRange(1, 8);
+	fDownloadConnections->SetValue(fSettings->GetValue(
+		kSettingsKeyDownloadConnections, kDefaultDownloadConnections));
+	fDownloadConnections->SetToolTip(B_TRANSLATE("Large files are "
+		"downloaded in parts over this many connections, if the server "
+		"allows it."));
+
+	fDownloadRateLimit = new BSpinner("download rate limit",
+		B_TRANSLATE("Download speed limit (KiB/s):"),
+		new BMessage(MSG_DOWNLOAD_RATE_LIMIT_CHANGED));
+	fDownloadRateLimit->SetRange(0, 1000000);
+	fDownloadRateLimit->SetValue(fSettings->GetValue(
+		kSettingsKeyDownloadRateLimit, (uint32)0));
+	fDownloadRateLimit->SetToolTip(B_TRANSLATE("0 - No limit"));
+
+	fDownloadsYieldToBrowsing = new BCheckBox("downloads yield to browsing",
+		B_TRANSLATE("Slow down downloads while pages load"),
+		new BMessage(MSG_DOWNLOADS_YIELD_TO_BROWSING_CHANGED));
+	fDownloadsYieldToBrowsing->SetValue(fSettings->GetValue(
+		kSettingsKeyDownloadsYieldToBrowsing, true));
+	fDownloadsYieldToBrowsing->SetToolTip(B_TRANSLATE("Only applies to "
+		"downloads over more than one connection, or with a speed limit."));
+
 	fShowTabsIfOnlyOnePage = new BCheckBox("show tabs if only one page",
 		B_TRANSLATE("Show tabs if only one page is open"),
 		new BMessage(MSG_TAB_DISPLAY_BEHAVIOR_CHANGED));
@@ -420,9 +527,12 @@ SettingsWindow::_CreateGeneralPage(float spacing)
 			.Add(fNewTabBehaviorMenu->CreateLabelLayoutItem(), 0, 4)
 			.Add(fNewTabBehaviorMenu->CreateMenuBarLayoutItem(), 1, 4, 4)
 
-			.Add(fDownloadFolderControl->CreateLabelLayoutItem(), 0, 5)
-			.Add(fDownloadFolderControl->CreateTextViewLayoutItem(), 1, 5, 3)
-			.Add(fChooseButton, 4, 5)
+			.Add(fDiscardTabsMenu->CreateLabelLayoutItem(), 0, 5)
+			.Add(fDiscardTabsMenu->CreateMenuBarLayoutItem(), 1, 5, 4)
+
+			.Add(fDownloadFolderControl->CreateLabelLayoutItem(), 0, 6)
+			.Add(fDownloadFolderControl->CreateTextViewLayoutItem(), 1, 6, 3)
+			.Add(fChooseButton, 4, 6)
 		)
 		.Add(BSpaceLayoutItem::CreateVerticalStrut(spacing))
 		.Add(new BSeparatorView(B_HORIZONTAL, B_PLAIN_BORDER))
@@ -437,6 +547,12 @@ SettingsWindow::_CreateGeneralPage(float spacing)
 			.Add(fDaysInHistory)
 			.AddGlue()
 			.End()
+		.AddGroup(B_HORIZONTAL)
+			.Add(fDownloadConnections)
+			.Add(fDownloadRateLimit)
+			.AddGlue()
+			.End()
+		.Add(fDownloadsYieldToBrowsing)
 		.AddGlue()
 		.SetInsets(B_USE_WINDOW_SPACING, B_USE_WINDOW_SPACING,
 			B_USE_WINDOW_SPACING, B_USE_DEFAULT_SPACING)
@@ -615,6 +731,18 @@ SettingsWindow::_CanApplySettings() const
 	canApply = canApply || (fDaysInHistory->Value()
 		!= BrowsingHistory::DefaultInstance()->MaxHistoryItemAge());
 
+	canApply = canApply || ((uint32)fDownloadConnections->Value()
+		!= fSettings->GetValue(kSettingsKeyDownloadConnections,
+			kDefaultDownloadConnections));
+
+	canApply = canApply || ((uint32)fDownloadRateLimit->Value()
+		!= fSettings->GetValue(kSettingsKeyDownloadRateLimit, (uint32)0));
+
+	canApply = canApply
+		|| ((fDownloadsYieldToBrowsing->Value() == B_CONTROL_ON)
+			!= fSettings->GetValue(kSettingsKeyDownloadsYieldToBrowsing,
+				true));
+
 	// Start up policy
 	canApply = canApply || (_StartUpPolicy()
 		!= fSettings->GetValue(kSettingsKeyStartUpPolicy,
@@ -630,6 +758,10 @@ SettingsWindow::_CanApplySettings() const
 		!= fSettings->GetValue(kSettingsKeyNewTabPolicy,
 			(uint32)OpenBlankPage));
 
+	canApply = canApply || (_DiscardTabsAfter()
+		!= fSettings->GetValue(kSettingsKeyDiscardTabsAfter,
+			kDefaultDiscardTabsAfter));
+
 	// Font settings
 	canApply = canApply || (fStandardFontView->Font()
 		!= fSettings->GetValue("standard font", *be_plain_font));
@@ -681,6 +813,12 @@ SettingsWindow::_ApplySettings()
 	fSettings->SetValue(kSettingsKeyStartPageURL, fStartPageControl->Text());
 	fSettings->SetValue(kSettingsKeySearchPageURL, fSearchPageControl->Text());
 	fSettings->SetValue(kSettingsKeyDownloadPath, fDownloadFolderControl->Text());
+	fSettings->SetValue(kSettingsKeyDownloadConnections,
+		(uint32)fDownloadConnections->Value());
+	fSettings->SetValue(kSettingsKeyDownloadRateLimit,
+		(uint32)fDownloadRateLimit->Value());
+	fSettings->SetValue(kSettingsKeyDownloadsYieldToBrowsing,
+		fDownloadsYieldToBrowsing->Value() == B_CONTROL_ON);
 	fSettings->SetValue(kSettingsKeyShowTabsIfSinglePageOpen,
 		fShowTabsIfOnlyOnePage->Value() == B_CONTROL_ON);
 	fSettings->SetValue(kSettingsKeyAutoHideInterfaceInFullscreenMode,
@@ -689,6 +827,7 @@ SettingsWindow::_ApplySettings()
 		fAutoHidePointer->Value() == B_CONTROL_ON);
 	fSettings->SetValue(kSettingsKeyShowHomeButton,
 		fShowHomeButton->Value() == B_CONTROL_ON);
+	fSettings->SetValue(kSettingsKeyDiscardTabsAfter, _DiscardTabsAfter());
 
 	// New page policies
 	fSettings->SetValue(kSettingsKeyStartUpPolicy, _StartUpPolicy());
@@ -722,29 +861,7 @@ SettingsWindow::_ApplySettings()
 
 	fSettings->Save();
 
-	// Apply settings to default web page settings.
-	BWebSettings::Default()->SetStandardFont(fStandardFontView->Font());
-	BWebSettings::Default()->SetSerifFont(fSerifFontView->Font());
-	BWebSettings::Default()->SetSansSerifFont(fSansSerifFontView->Font());
-	BWebSettings::Default()->SetFixedFont(fFixedFontView->Font());
-	BWebSettings::Default()->SetDefaultStandardFontSize(standardFontSize);
-	BWebSettings::Default()->SetDefaultFixedFontSize(fixedFontSize);
-
-	if (fUseProxyCheckBox->Value() == B_CONTROL_ON) {
-		if (fUseProxyAuthCheckBox->Value() == B_CONTROL_ON) {
-			BWebSettings::Default()->SetProxyInfo(fProxyAddressControl->Text(),
-				proxyPort, B_PROXY_TYPE_HTTP, fProxyUsernameControl->Text(),
-				fProxyPasswordControl->Text());
-		} else {
-			BWebSettings::Default()->SetProxyInfo(fProxyAddressControl->Text(),
-				proxyPort, B_PROXY_TYPE_HTTP, "", "");
-		}
-	} else
-		BWebSettings::Default()->SetProxyInfo();
-
-	// This will find all currently instantiated page settings and apply
-	// the default values, unless the page settings have local overrides.
-	BWebSettings::Default()->Apply();
+	ApplyWebSettings(fSettings);
 
 	_ValidateControlsEnabledStatus();
 }
@@ -792,6 +909,12 @@ SettingsWindow::_RevertSettings()
 
 	fDaysInHistory->SetValue(
 		BrowsingHistory::DefaultInstance()->MaxHistoryItemAge());
+	fDownloadConnections->SetValue(fSettings->GetValue(
+		kSettingsKeyDownloadConnections, kDefaultDownloadConnections));
+	fDownloadRateLimit->SetValue(fSettings->GetValue(
+		kSettingsKeyDownloadRateLimit, (uint32)0));
+	fDownloadsYieldToBrowsing->SetValue(fSettings->GetValue(
+		kSettingsKeyDownloadsYieldToBrowsing, true));
 
 	// Start Up policy
 	uint32 startUpPolicy = fSettings->GetValue(kSettingsKeyStartUpPolicy,
@@ -841,6 +964,21 @@ SettingsWindow::_RevertSettings()
 			break;
 	}
 
+	// Discarding tabs. A time that is not in the menu is kept, until
+	// another one is chosen.
+	uint32 discardTabsAfter = fSettings->GetValue(kSettingsKeyDiscardTabsAfter,
+		kDefaultDiscardTabsAfter);
+	BMenu* discardTabsMenu = fDiscardTabsMenu->Menu();
+	BMenuItem* marked = discardTabsMenu->FindMarked();
+	if (marked != NULL)
+		marked->SetMarked(false);
+	for (int32 i = 0; BMenuItem* item = discardTabsMenu->ItemAt(i); i++) {
+		if (item->Message()->GetUInt32("minutes", 0) == discardTabsAfter) {
+			item->SetMarked(true);
+			break;
+		}
+	}
+
 	// Font settings
 	int32 defaultFontSize = fSettings->GetValue("standard font size",
 		kDefaultFontSize);
@@ -922,6 +1060,10 @@ SettingsWindow::_ValidateControlsEnabledStatus()
 	bool useProxyAuth = useProxy && fUseProxyAuthCheckBox->Value() == B_CONTROL_ON;
 	fProxyUsernameControl->SetEnabled(useProxyAuth);
 	fProxyPasswordControl->SetEnabled(useProxyAuth);
+
+	// Downloads WebKit runs itself cannot be slowed down.
+	fDownloadsYieldToBrowsing->SetEnabled(fDownloadConnections->Value() > 1
+		|| fDownloadRateLimit->Value() > 0);
 }
 
 
@@ -966,8 +1108,21 @@ SettingsWindow::_NewTabPolicy() const
 }
 
 
-BFont
-SettingsWindow::_FindDefaultSerifFont() const
+uint32
+SettingsWindow::_DiscardTabsAfter() const
+{
+	BMenuItem* markedItem = fDiscardTabsMenu->Menu()->FindMarked();
+	if (markedItem == NULL) {
+		return fSettings->GetValue(kSettingsKeyDiscardTabsAfter,
+			kDefaultDiscardTabsAfter);
+	}
+	return markedItem->Message()->GetUInt32("minutes",
+		kDefaultDiscardTabsAfter);
+}
+
+
+/*static*/ BFont
+SettingsWindow::_FindDefaultSerifFont()
 {
 	// Default to the first "serif" font we find.
 	BFont serifFont(*be_plain_font);
@@ -33,6 +33,9 @@ public:
 
 	virtual	void				Show();
 
+	static	void				ApplyWebSettings(
+									const SettingsMessage* settings);
+
 private:
 			BView*				_CreateGeneralPage(float spacing);
 			BView*				_CreateFontsPage(float spacing);
@@ -53,8 +56,9 @@ private:
 			uint32				_StartUpPolicy() const;
 			uint32				_NewWindowPolicy() const;
 			uint32				_NewTabPolicy() const;
+			uint32				_DiscardTabsAfter() const;
 
-			BFont				_FindDefaultSerifFont() const;
+	static	BFont				_FindDefaultSerifFont();
 
 			uint32				_ProxyPort() const;
 
@@ -82,7 +86,12 @@ private:
 			BMenuItem*			fStartUpBehaviorResumePriorSession;
 			BMenuItem*			fStartUpBehaviorStartNewSession;
 
+			BMenuField*			fDiscardTabsMenu;
+
 			BSpinner*			fDaysInHistory;
+			BSpinner*			fDownloadConnections;
+			BSpinner*			fDownloadRateLimit;
+			BCheckBox*			fDownloadsYieldToBrowsing;
 			BCheckBox*			fShowTabsIfOnlyOnePage;
 			BCheckBox*			fAutoHideInterfaceInFullscreenMode;
 			BCheckBox*			fAutoHidePointer;
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "SparePool.h"
+
+#include <Application.h>
+#include <MessageQueue.h>
+#include <MessageRunner.h>
+
+#include "BrowserWindow.h"
+#include "MemoryPressure.h"
+#include "TraceLog.h"
+#include "WebView.h"
+
+
+static const size_t kMaxSpareWindows = 1;
+static const size_t kMaxSpareWebViews = 2;
+	// Together these are the memory cap of the pool.
+
+static const bigtime_t kInitialDelay = 2000000;
+static const bigtime_t kReplenishDelay = 500000;
+	// Time after a spare was taken before its replacement is built.
+static const bigtime_t kBusyDelay = 100000;
+static const bigtime_t kPressureCheckInterval = 30000000;
+
+
+SparePool SparePool::sDefaultInstance;
+
+
+SparePool::SparePool()
+	:
+	fSettings(NULL),
+	fReplenishRunner(NULL),
+	fPressureRunner(NULL),
+	fEnabled(false)
+{
+}
+
+
+SparePool::~SparePool()
+{
+	delete fReplenishRunner;
+	delete fPressureRunner;
+}
+
+
+/*static*/ SparePool*
+SparePool::DefaultInstance()
+{
+	return &sDefaultInstance;
+}
+
+
+void
+SparePool::Init(SettingsMessage* settings,
+	BPrivate::Network::BUrlContext* context)
+{
+	fSettings = settings;
+	fContext = context;
+	fEnabled = true;
+
+	// Also drains the pool when memory gets low while nothing is taken.
+	BMessage message(MSG_REPLENISH);
+	fPressureRunner = new BMessageRunner(be_app_messenger, &message,
+		kPressureCheckInterval);
+
+	_ScheduleReplenish(kInitialDelay);
+}
+
+
+void
+SparePool::Shutdown()
+{
+	fEnabled = false;
+
+	delete fReplenishRunner;
+	fReplenishRunner = NULL;
+	delete fPressureRunner;
+	fPressureRunner = NULL;
+
+	_Drain();
+}
+
+
+/*!	Returns a hidden spare window, or \c NULL if there is none. The window
+	must be turned into a regular one with BrowserWindow::ActivateSpare().
+*/
+BrowserWindow*
+SparePool::TakeWindow()
+{
+	if (fWindows.empty())
+		return NULL;
+
+	BrowserWindow* window = fWindows.back();
+	fWindows.pop_back();
+	_ScheduleReplenish(kReplenishDelay);
+	return window;
+}
+
+
+/*!	Returns a blank web view, or \c NULL if there is none.
+*/
+BWebView*
+SparePool::TakeWebView()
+{
+	if (fWebViews.empty())
+		return NULL;
+
+	BWebView* webView = fWebViews.back();
+	fWebViews.pop_back();
+	_ScheduleReplenish(kReplenishDelay);
+	return webView;
+}
+
+
+/*!	Builds one missing spare, and schedules itself again until the pool is
+	full. Called in the application thread on MSG_REPLENISH.
+*/
+void
+SparePool::Replenish()
+{
+	if (!fEnabled)
+		return;
+
+	if (isLowOnMemory()) {
+		_Drain();
+		return;
+	}
+
+	if (fWindows.size() >= kMaxSpareWindows
+		&& fWebViews.size() >= kMaxSpareWebViews) {
+		return;
+	}
+
+	// Only build spares while the application is idle.
+	BMessageQueue* queue = be_app->MessageQueue();
+	if (queue != NULL && !queue->IsEmpty()) {
+		_ScheduleReplenish(kBusyDelay);
+		return;
+	}
+
+	// New tabs are more common than new windows, so web views come first.
+	if (fWebViews.size() < kMaxSpareWebViews) {
+		TraceSpan span("spares", "Create spare web view");
+		fWebViews.push_back(new BWebView("web view", fContext));
+	} else {
+		TraceSpan span("spares", "Create spare window");
+		BrowserWindow* window = new BrowserWindow(BRect(50, 50, 950, 750),
+			fSettings, BString(), fContext, INTERFACE_ELEMENT_ALL,
+			new BWebView("web view", fContext), B_CURRENT_WORKSPACE, true);
+		// Start the window thread, but keep it off screen.
+		window->Hide();
+		window->Show();
+		fWindows.push_back(window);
+	}
+
+	if (fWindows.size() < kMaxSpareWindows
+		|| fWebViews.size() < kMaxSpareWebViews) {
+		_ScheduleReplenish(kBusyDelay);
+	}
+}
+
+
+// #pragma mark - private
+
+
+void
+SparePool::_ScheduleReplenish(bigtime_t delay)
+{
+	if (!fEnabled)
+		return;
+
+	delete fReplenishRunner;
+	BMessage message(MSG_REPLENISH);
+	fReplenishRunner = new BMessageRunner(be_app_messenger, &message, delay,
+		1);
+}
+
+
+void
+SparePool::_Drain()
+{
+	for (size_t i = 0; i < fWindows.size(); i++) {
+		BrowserWindow* window = fWindows[i];
+		if (window->Lock()) {
+			if (window->QuitRequested())
+				window->Quit();
+			else
+				window->Unlock();
+		}
+	}
+	fWindows.clear();
+
+	for (size_t i = 0; i < fWebViews.size(); i++)
+		fWebViews[i]->Shutdown();
+	fWebViews.clear();
+}
+
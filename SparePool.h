@@ -0,0 +1,66 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SPARE_POOL_H
+#define SPARE_POOL_H
+
+
+#include <OS.h>
+#include <UrlContext.h>
+
+#include <vector>
+
+
+class BMessageRunner;
+class BWebView;
+class BrowserWindow;
+class SettingsMessage;
+
+
+/*!	Keeps a few hidden browser windows and blank web views constructed in
+	advance, so that opening a new window or tab does not have to wait for
+	them to be built.
+
+	Everything happens in the application thread, since that is where web
+	views have to be created. After a spare has been handed out, the pool is
+	refilled one item at a time, and only while the application has nothing
+	else to do. When the system runs low on memory, the pool is emptied and
+	not refilled.
+*/
+class SparePool {
+public:
+	static	const uint32		MSG_REPLENISH = 'sprp';
+
+	static	SparePool*			DefaultInstance();
+
+			void				Init(SettingsMessage* settings,
+									BPrivate::Network::BUrlContext* context);
+			void				Shutdown();
+
+			BrowserWindow*		TakeWindow();
+			BWebView*			TakeWebView();
+
+			void				Replenish();
+
+private:
+								SparePool();
+								~SparePool();
+
+			void				_ScheduleReplenish(bigtime_t delay);
+			void				_Drain();
+
+private:
+			SettingsMessage*	fSettings;
+			BReference<BPrivate::Network::BUrlContext> fContext;
+			std::vector<BrowserWindow*> fWindows;
+			std::vector<BWebView*> fWebViews;
+			BMessageRunner*		fReplenishRunner;
+			BMessageRunner*		fPressureRunner;
+			bool				fEnabled;
+
+	static	SparePool			sDefaultInstance;
+};
+
+
+#endif // SPARE_POOL_H
@@ -0,0 +1,349 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "TabIndex.h"
+
+#include <algorithm>
+
+#include <Autolock.h>
+#include <OS.h>
+
+
+static const int32 kConsecutiveBonus = 5;
+static const int32 kWordStartBonus = 8;
+static const int32 kMaxGapPenalty = 3;
+static const int32 kTitleBonus = 2;
+	// Titles are what the user sees in the tab strip, prefer them.
+
+
+struct TabIndex::Entry {
+	Entry(const BMessenger& window, const void* tab)
+		:
+		window(window),
+		tab(tab),
+		loadState(LOAD_NONE),
+		progress(0),
+		lastActivity(system_time())
+	{
+	}
+
+	void SetTitle(const BString& _title)
+	{
+		title = _title;
+		lowerTitle = _title;
+		lowerTitle.ToLower();
+	}
+
+	void SetURL(const BString& _url)
+	{
+		url = _url;
+		lowerURL = _url;
+		lowerURL.ToLower();
+	}
+
+	BMessenger	window;
+	const void*	tab;
+	BString		title;
+	BString		url;
+	BString		lowerTitle;
+	BString		lowerURL;
+	LoadState	loadState;
+	float		progress;
+	bigtime_t	lastActivity;
+};
+
+
+static bool
+is_word_start(const BString& text, int32 index)
+{
+	if (index == 0)
+		return true;
+
+	switch (text.ByteAt(index - 1)) {
+		case ' ':
+		case '/':
+		case '.':
+		case '-':
+		case '_':
+		case ':':
+		case '?':
+		case '=':
+		case '&':
+			return true;
+	}
+	return false;
+}
+
+
+static bool
+compare_matches(const TabIndex::Match& a, const TabIndex::Match& b)
+{
+	return a.score > b.score;
+}
+
+
+TabIndex TabIndex::sDefaultInstance;
+
+
+TabIndex::TabIndex()
+	:
+	BLocker("tab index"),
+	fLoadingCount(0)
+{
+}
+
+
+TabIndex::~TabIndex()
+{
+}
+
+
+/*static*/ TabIndex*
+TabIndex::DefaultInstance()
+{
+	return &sDefaultInstance;
+}
+
+
+void
+TabIndex::TabOpened(const BMessenger& window, const void* tab,
+	const BString& url)
+{
+	BAutolock _(this);
+
+	if (fPositions.find(tab) != fPositions.end())
+		return;
+
+	fPositions[tab] = fEntries.size();
+	fEntries.push_back(Entry(window, tab));
+	fEntries.back().SetURL(url);
+}
+
+
+void
+TabIndex::TabNavigated(const void* tab, const BString& url)
+{
+	BAutolock _(this);
+
+	Entry* entry = _FindEntry(tab);
+	if (entry != NULL) {
+		entry->SetURL(url);
+		entry->lastActivity = system_time();
+	}
+}
+
+
+void
+TabIndex::TabTitleChanged(const void* tab, const BString& title)
+{
+	BAutolock _(this);
+
+	Entry* entry = _FindEntry(tab);
+	if (entry != NULL)
+		entry->SetTitle(title);
+}
+
+
+void
+TabIndex::TabReplaced(const void* tab, const void* replacement)
+{
+	BAutolock _(this);
+
+	std::unordered_map<const void*, size_t>::iterator found
+		= fPositions.find(tab);
+	if (found == fPositions.end())
+		return;
+
+	size_t position = found->second;
+	fPositions.erase(found);
+	fPositions[replacement] = position;
+	fEntries[position].tab = replacement;
+}
+
+
+void
+TabIndex::TabClosed(const void* tab)
+{
+	BAutolock _(this);
+
+	std::unordered_map<const void*, size_t>::iterator found
+		= fPositions.find(tab);
+	if (found == fPositions.end())
+		return;
+
+	// Fill the gap with the last entry, so removal is constant time.
+	size_t position = found->second;
+	if (fEntries[position].loadState == LOAD_LOADING)
+		atomic_add(&fLoadingCount, -1);
+	fPositions.erase(found);
+	if (position != fEntries.size() - 1) {
+		fEntries[position] = fEntries.back();
+		fPositions[fEntries[position].tab] = position;
+	}
+	fEntries.pop_back();
+}
+
+
+void
+TabIndex::TabLoadStateChanged(const void* tab, LoadState state,
+	float progress)
+{
+	BAutolock _(this);
+
+	Entry* entry = _FindEntry(tab);
+	if (entry == NULL)
+		return;
+
+	if (entry->loadState != LOAD_LOADING && state == LOAD_LOADING)
+		atomic_add(&fLoadingCount, 1);
+	else if (entry->loadState == LOAD_LOADING && state != LOAD_LOADING)
+		atomic_add(&fLoadingCount, -1);
+	entry->loadState = state;
+	entry->progress = progress;
+	entry->lastActivity = system_time();
+}
+
+
+/*!	Called when the tab is selected.
+*/
+void
+TabIndex::TabActivated(const void* tab)
+{
+	BAutolock _(this);
+
+	Entry* entry = _FindEntry(tab);
+	if (entry != NULL)
+		entry->lastActivity = system_time();
+}
+
+
+int32
+TabIndex::CountTabs()
+{
+	BAutolock _(this);
+	return fEntries.size();
+}
+
+
+/*!	Returns how many tabs are loading a page. This is called often, and
+	does not lock.
+*/
+int32
+TabIndex::CountLoading() const
+{
+	return atomic_get(const_cast<int32*>(&fLoadingCount));
+}
+
+
+void
+TabIndex::GetTabs(TabInfoList& tabs)
+{
+	BAutolock _(this);
+
+	tabs.resize(fEntries.size());
+	for (size_t i = 0; i < fEntries.size(); i++) {
+		const Entry& entry = fEntries[i];
+		TabInfo& info = tabs[i];
+		info.window = entry.window;
+		info.tab = entry.tab;
+		info.title = entry.title;
+		info.url = entry.url;
+		info.loadState = entry.loadState;
+		info.progress = entry.progress;
+		info.lastActivity = entry.lastActivity;
+	}
+}
+
+
+/*!	Fills \a matches with the tabs whose title or URL fuzzy matches
+	\a query, best matches first. An empty query matches every tab.
+*/
+void
+TabIndex::Search(const BString& query, MatchList& matches, int32 maxMatches)
+{
+	matches.clear();
+
+	BString pattern(query);
+	pattern.Trim().ToLower();
+
+	BAutolock _(this);
+
+	for (size_t i = 0; i < fEntries.size(); i++) {
+		const Entry& entry = fEntries[i];
+
+		int32 score = 0;
+		if (pattern.Length() > 0) {
+			int32 titleScore = FuzzyScore(pattern, entry.lowerTitle);
+			if (titleScore >= 0)
+				titleScore += kTitleBonus;
+			score = std::max(titleScore, FuzzyScore(pattern, entry.lowerURL));
+			if (score < 0)
+				continue;
+		}
+
+		Match match;
+		match.window = entry.window;
+		match.tab = entry.tab;
+		match.title = entry.title;
+		match.url = entry.url;
+		match.score = score;
+		matches.push_back(match);
+	}
+
+	std::stable_sort(matches.begin(), matches.end(), compare_matches);
+	if (maxMatches >= 0 && (int32)matches.size() > maxMatches)
+		matches.resize(maxMatches);
+}
+
+
+/*!	Returns how well \a text matches \a pattern, or -1 if the characters of
+	the pattern do not all appear in \a text in order. Both are expected to
+	be lower case already. Runs of consecutive characters and characters at
+	the start of words score higher, gaps between them lower.
+*/
+/*static*/ int32
+TabIndex::FuzzyScore(const BString& pattern, const BString& text)
+{
+	int32 score = 0;
+	int32 textIndex = 0;
+	int32 previousMatch = -1;
+
+	for (int32 i = 0; i < pattern.Length(); i++) {
+		char c = pattern.ByteAt(i);
+		if (c == ' ')
+			continue;
+
+		int32 found = text.FindFirst(c, textIndex);
+		if (found < 0)
+			return -1;
+
+		score++;
+		if (previousMatch >= 0 && found == previousMatch + 1)
+			score += kConsecutiveBonus;
+		if (is_word_start(text, found))
+			score += kWordStartBonus;
+		if (previousMatch >= 0)
+			score -= std::min(found - previousMatch - 1, kMaxGapPenalty);
+
+		previousMatch = found;
+		textIndex = found + 1;
+	}
+
+	return std::max(score, (int32)0);
+}
+
+
+// #pragma mark - private
+
+
+TabIndex::Entry*
+TabIndex::_FindEntry(const void* tab)
+{
+	std::unordered_map<const void*, size_t>::iterator found
+		= fPositions.find(tab);
+	if (found == fPositions.end())
+		return NULL;
+	return &fEntries[found->second];
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef TAB_INDEX_H
+#define TAB_INDEX_H
+
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <String.h>
+
+#include <unordered_map>
+#include <vector>
+
+
+/*!	Keeps the title and URL of every tab in every browser window, so they can
+	be searched without going through the windows.
+
+	The windows report their tab changes as they happen, from their own
+	threads. A tab is identified by its view, and its window by a messenger.
+	Besides title and URL, the load state and the time of the last activity
+	are kept for the resource monitor, and the number of tabs loading for
+	the BandwidthScheduler.
+*/
+class TabIndex : public BLocker {
+public:
+			enum LoadState {
+				LOAD_NONE = 0,
+				LOAD_LOADING,
+				LOAD_FINISHED,
+				LOAD_FAILED,
+				LOAD_DISCARDED
+			};
+
+			struct TabInfo {
+				BMessenger		window;
+				const void*		tab;
+				BString			title;
+				BString			url;
+				LoadState		loadState;
+				float			progress;
+				bigtime_t		lastActivity;
+			};
+			typedef std::vector<TabInfo> TabInfoList;
+
+			struct Match {
+				BMessenger		window;
+				const void*		tab;
+				BString			title;
+				BString			url;
+				int32			score;
+			};
+			typedef std::vector<Match> MatchList;
+
+	static	TabIndex*			DefaultInstance();
+
+			void				TabOpened(const BMessenger& window,
+									const void* tab, const BString& url);
+			void				TabNavigated(const void* tab,
+									const BString& url);
+			void				TabTitleChanged(const void* tab,
+									const BString& title);
+			void				TabReplaced(const void* tab,
+									const void* replacement);
+			void				TabClosed(const void* tab);
+			void				TabLoadStateChanged(const void* tab,
+									LoadState state, float progress = 0);
+			void				TabActivated(const void* tab);
+
+			int32				CountTabs();
+			int32				CountLoading() const;
+			void				GetTabs(TabInfoList& tabs);
+			void				Search(const BString& query,
+									MatchList& matches, int32 maxMatches);
+
+	static	int32				FuzzyScore(const BString& pattern,
+									const BString& text);
+
+private:
+			struct Entry;
+
+								TabIndex();
+	virtual						~TabIndex();
+
+			Entry*				_FindEntry(const void* tab);
+
+private:
+			std::vector<Entry>	fEntries;
+			std::unordered_map<const void*, size_t> fPositions;
+			int32				fLoadingCount;
+				// changed with the lock held, but read without it
+
+	static	TabIndex			sDefaultInstance;
+};
+
+
+#endif // TAB_INDEX_H
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "TabSwitcherWindow.h"
+
+#include <Catalog.h>
+
+#include "BrowserWindow.h"
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Tab switcher"
+
+
+static const int32 kMaxMatches = 1000;
+
+
+TabSwitcherWindow::TabSwitcherWindow()
+	:
+	SearchPopUpWindow(B_TRANSLATE("Switch to tab"))
+{
+}
+
+
+TabSwitcherWindow::~TabSwitcherWindow()
+{
+}
+
+
+void
+TabSwitcherWindow::GetResult(int32 index, BString& title, BString& url) const
+{
+	const TabIndex::Match& match = fMatches[index];
+	title = match.title.Length() > 0 ? match.title : match.url;
+	url = match.url;
+}
+
+
+// #pragma mark - protected
+
+
+void
+TabSwitcherWindow::UpdateResults()
+{
+	TabIndex::DefaultInstance()->Search(Query(), fMatches, kMaxMatches);
+	SetResultCount(fMatches.size());
+}
+
+
+void
+TabSwitcherWindow::InvokeResult(int32 index)
+{
+	const TabIndex::Match& match = fMatches[index];
+	BMessage message(ACTIVATE_TAB);
+	message.AddPointer("tab", match.tab);
+	match.window.SendMessage(&message);
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef TAB_SWITCHER_WINDOW_H
+#define TAB_SWITCHER_WINDOW_H
+
+
+#include "SearchPopUpWindow.h"
+#include "TabIndex.h"
+
+
+/*!	Lets the user search the tabs of all browser windows by title and URL,
+	and brings the chosen tab to front.
+*/
+class TabSwitcherWindow : public SearchPopUpWindow {
+public:
+								TabSwitcherWindow();
+	virtual						~TabSwitcherWindow();
+
+	virtual	void				GetResult(int32 index, BString& title,
+									BString& url) const;
+
+protected:
+	virtual	void				UpdateResults();
+	virtual	void				InvokeResult(int32 index);
+
+private:
+			TabIndex::MatchList	fMatches;
+};
+
+
+#endif // TAB_SWITCHER_WINDOW_H
@@ -27,6 +27,7 @@
 #include "BitmapButton.h"
 #include "BrowserWindow.h"
 #include "BrowsingHistory.h"
+#include "FaviconStore.h"
 #include "IconButton.h"
 #include "IconUtils.h"
 #include "TextViewCompleter.h"
@@ -502,9 +503,8 @@ public:
 	PageIconView()
 		:
 		BView("page icon view", B_WILL_DRAW | B_FULL_UPDATE_ON_RESIZE),
-		fIcon(NULL),
-		fClickPoint(-1, 0),
-		fPageIconSet(false)
+		fPlaceholderIcon(NULL),
+		fClickPoint(-1, 0)
 	{
 		SetDrawingMode(B_OP_ALPHA);
 		SetBlendingMode(B_PIXEL_ALPHA, B_ALPHA_OVERLAY);
@@ -513,7 +513,7 @@ public:
 
 	~PageIconView()
 	{
-		delete fIcon;
+		delete fPlaceholderIcon;
 	}
 
 	virtual void Draw(BRect updateRect)
@@ -525,7 +525,8 @@ public:
 				- (iconBounds.left + iconBounds.right)) / 2 + 0.5f),
 			floorf((bounds.top + bounds.bottom
 				- (iconBounds.top + iconBounds.bottom)) / 2 + 0.5f));
-		DrawBitmap(fIcon, fIcon->Bounds(), iconBounds,
+		const BBitmap* icon = _Icon();
+		DrawBitmap(icon, icon->Bounds(), iconBounds,
 			B_FILTER_BITMAP_BILINEAR);
 	}
 
@@ -586,11 +587,11 @@ public:
 			fileName.ReplaceAll('/', '-');
 			fileName.Truncate(B_FILE_NAME_LENGTH - 1);
 
-			BBitmap miniIcon(BRect(0, 0, 15, 15), B_BITMAP_NO_SERVER_LINK,
-				B_CMAP8);
-			miniIcon.ImportBits(fIcon);
-			// TODO:  obtain and send the large icon in addition to the mini icon.
-			// Currently PageUserData does not provide a function that returns this.
+			// The store has the icons in the bookmark color space already.
+			const BBitmap* miniIcon = fPageIcon.IsSet()
+				? fPageIcon->MiniIcon() : NULL;
+			const BBitmap* largeIcon = fPageIcon.IsSet()
+				? fPageIcon->LargeIcon() : NULL;
 
 			BMessage drag(B_SIMPLE_DATA);
 			drag.AddInt32("be:actions", B_COPY_TARGET);
@@ -602,13 +603,17 @@ public:
 			data.AddString("url", url);
 			data.AddString("title", title);
 				// The title may differ from the validated filename
-			if (fPageIconSet == true) {
+			if (miniIcon != NULL) {
 				// Don't bother sending the placeholder web icon, if that is all we have.
-				data.AddData("miniIcon", B_COLOR_8_BIT_TYPE, &miniIcon, sizeof(miniIcon));
+				data.AddData("miniIcon", B_COLOR_8_BIT_TYPE, miniIcon, sizeof(BBitmap));
+			}
+			if (largeIcon != NULL) {
+				data.AddData("largeIcon", B_COLOR_8_BIT_TYPE, largeIcon,
+					sizeof(BBitmap));
 			}
 			drag.AddMessage("be:originator-data", &data);
 
-			BBitmap* iconClone = new BBitmap(fIcon);
+			BBitmap* iconClone = new BBitmap(_Icon());
 				// Needed because DragMessage will delete the bitmap when it's done.
 
 			DragMessage(&drag, iconClone, B_OP_ALPHA, offset);
@@ -616,25 +621,28 @@ public:
 		return;
 	}
 
-	void SetIcon(const BBitmap* icon)
+	void SetIcon(Favicon* icon)
 	{
-		delete fIcon;
-		if (icon) {
-			fIcon = new BBitmap(icon);
-			fPageIconSet = true;
-		} else {
-			fIcon = new BBitmap(BRect(0, 0, 15, 15), B_RGB32);
+		// The icon is shared with the tabs, only a reference is kept.
+		fPageIcon.SetTo(icon);
+		if (icon == NULL && fPlaceholderIcon == NULL) {
+			fPlaceholderIcon = new BBitmap(BRect(0, 0, 15, 15), B_RGB32);
 			BIconUtils::GetVectorIcon(kPlaceholderIcon,
-				sizeof(kPlaceholderIcon), fIcon);
-			fPageIconSet = false;
+				sizeof(kPlaceholderIcon), fPlaceholderIcon);
 		}
 		Invalidate();
 	}
 
 private:
-	BBitmap* fIcon;
+	const BBitmap* _Icon() const
+	{
+		return fPageIcon.IsSet() ? fPageIcon->Bitmap() : fPlaceholderIcon;
+	}
+
+private:
+	BReference<Favicon> fPageIcon;
+	BBitmap* fPlaceholderIcon;
 	BPoint fClickPoint;
-	bool fPageIconSet;
 };
 
 
@@ -756,7 +764,7 @@ URLInputGroup::GoButton() const
 
 
 void
-URLInputGroup::SetPageIcon(const BBitmap* icon)
+URLInputGroup::SetPageIcon(Favicon* icon)
 {
 	fIconView->SetIcon(icon);
 }
@@ -9,6 +9,7 @@
 
 class BButton;
 class BTextView;
+class Favicon;
 
 
 class URLInputGroup : public BGroupView {
@@ -27,7 +28,7 @@ public:
 
 			BButton*			GoButton() const;
 
-			void				SetPageIcon(const BBitmap* icon);
+			void				SetPageIcon(Favicon* icon);
 
 			bool				IsURLInputLocked() const;
 	virtual	void				LockURLInput(bool lock = true);
@@ -0,0 +1,706 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "FaviconStore.h"
+
+#include <algorithm>
+#include <new>
+#include <string.h>
+
+#include <Autolock.h>
+#include <Bitmap.h>
+#include <Directory.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Looper.h>
+#include <Message.h>
+
+#include "MemoryPressure.h"
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+
+static const size_t kMaxIcons = 256;
+	// Icons no tab uses anymore are dropped beyond this.
+static const size_t kTrimBatch = 8;
+	// How many icons are looked at per insertion to get back to kMaxIcons.
+static const int32 kMaxCachedIconSize = 64;
+static const uint32 kCacheFileMagic = 'wpfi';
+
+static const uint32 kMsgLoad = 'fsld';
+static const uint32 kMsgSave = 'fssv';
+
+
+struct cache_file_header {
+	uint32	magic;
+	uint16	width;
+	uint16	height;
+};
+
+
+static inline bool
+is_size(const BBitmap* bitmap, int32 size)
+{
+	return bitmap->Bounds() == BRect(0, 0, size - 1, size - 1);
+}
+
+
+static uint32
+hash_bitmap(const BBitmap* bitmap)
+{
+	// FNV-1a over the visible bytes, without the row padding
+	int32 width = bitmap->Bounds().IntegerWidth() + 1;
+	int32 height = bitmap->Bounds().IntegerHeight() + 1;
+	int32 rowLength = width * 4;
+	if (bitmap->ColorSpace() == B_CMAP8 || bitmap->ColorSpace() == B_GRAY8)
+		rowLength = width;
+
+	uint32 hash = 2166136261u;
+	hash = (hash ^ width) * 16777619u;
+	hash = (hash ^ height) * 16777619u;
+	const uint8* row = (const uint8*)bitmap->Bits();
+	for (int32 y = 0; y < height; y++, row += bitmap->BytesPerRow()) {
+		for (int32 x = 0; x < rowLength; x++)
+			hash = (hash ^ row[x]) * 16777619u;
+	}
+	return hash;
+}
+
+
+static bool
+equal_bitmaps(const BBitmap* a, const BBitmap* b)
+{
+	return a->Bounds() == b->Bounds() && a->ColorSpace() == b->ColorSpace()
+		&& a->BitsLength() == b->BitsLength()
+		&& memcmp(a->Bits(), b->Bits(), a->BitsLength()) == 0;
+}
+
+
+/*!	Doubles the \a width pixels at \a source into \a target. */
+static void
+scale_up_row(const uint8* source, uint8* target, int32 width,
+	int32 bytesPerPixel)
+{
+	int32 x = 0;
+#if defined(__SSE2__)
+	if (bytesPerPixel == 4) {
+		for (; x + 4 <= width; x += 4) {
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(source + x * 4));
+			_mm_storeu_si128((__m128i*)(target + x * 8),
+				_mm_unpacklo_epi32(pixels, pixels));
+			_mm_storeu_si128((__m128i*)(target + x * 8 + 16),
+				_mm_unpackhi_epi32(pixels, pixels));
+		}
+	} else {
+		for (; x + 16 <= width; x += 16) {
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(source + x));
+			_mm_storeu_si128((__m128i*)(target + x * 2),
+				_mm_unpacklo_epi8(pixels, pixels));
+			_mm_storeu_si128((__m128i*)(target + x * 2 + 16),
+				_mm_unpackhi_epi8(pixels, pixels));
+		}
+	}
+#endif
+	for (; x < width; x++) {
+		const uint8* pixel = source + x * bytesPerPixel;
+		memcpy(target + x * 2 * bytesPerPixel, pixel, bytesPerPixel);
+		memcpy(target + (x * 2 + 1) * bytesPerPixel, pixel, bytesPerPixel);
+	}
+}
+
+
+/*!	Averages each 2x2 block of 32 bit pixels in the rows \a top and
+	\a bottom into one of the \a width pixels at \a target.
+*/
+static void
+scale_down_row(const uint8* top, const uint8* bottom, uint8* target,
+	int32 width)
+{
+	int32 x = 0;
+#if defined(__SSE2__)
+	for (; x + 4 <= width; x += 4) {
+		__m128i left = _mm_avg_epu8(
+			_mm_loadu_si128((const __m128i*)(top + x * 8)),
+			_mm_loadu_si128((const __m128i*)(bottom + x * 8)));
+		__m128i right = _mm_avg_epu8(
+			_mm_loadu_si128((const __m128i*)(top + x * 8 + 16)),
+			_mm_loadu_si128((const __m128i*)(bottom + x * 8 + 16)));
+		__m128 even = _mm_shuffle_ps(_mm_castsi128_ps(left),
+			_mm_castsi128_ps(right), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(left),
+			_mm_castsi128_ps(right), _MM_SHUFFLE(3, 1, 3, 1));
+		_mm_storeu_si128((__m128i*)(target + x * 4),
+			_mm_avg_epu8(_mm_castps_si128(even), _mm_castps_si128(odd)));
+	}
+#endif
+	for (; x < width; x++) {
+		for (int32 i = 0; i < 4; i++) {
+			target[x * 4 + i] = (top[x * 8 + i] + top[x * 8 + 4 + i]
+				+ bottom[x * 8 + i] + bottom[x * 8 + 4 + i] + 2) / 4;
+		}
+	}
+}
+
+
+// #pragma mark - Favicon
+
+
+Favicon::Favicon(BBitmap* bitmap, uint32 hash)
+	:
+	fBitmap(bitmap),
+	fMiniIcon(NULL),
+	fLargeIcon(NULL),
+	fHash(hash)
+{
+	const BRect miniBounds(0, 0, 15, 15);
+	const BRect largeBounds(0, 0, 31, 31);
+
+	// Bring the icon to both sizes in 32 bits first, so the conversion
+	// to the palette is done once for each.
+	const BBitmap* mini = bitmap;
+	BBitmap* miniCopy = NULL;
+	if (!is_size(bitmap, 16) || bitmap->ColorSpace() != B_RGBA32) {
+		miniCopy = new(std::nothrow) BBitmap(miniBounds,
+			B_BITMAP_NO_SERVER_LINK, B_RGBA32);
+		if (miniCopy == NULL || !miniCopy->IsValid()) {
+			delete miniCopy;
+			return;
+		}
+		if (is_size(bitmap, 32) && bitmap->ColorSpace() == B_RGBA32) {
+			const uint8* source = (const uint8*)bitmap->Bits();
+			uint8* target = (uint8*)miniCopy->Bits();
+			for (int32 y = 0; y < 16; y++) {
+				scale_down_row(source, source + bitmap->BytesPerRow(), target,
+					16);
+				source += bitmap->BytesPerRow() * 2;
+				target += miniCopy->BytesPerRow();
+			}
+		} else
+			miniCopy->ImportBits(bitmap);
+		mini = miniCopy;
+	}
+
+	const BBitmap* large = bitmap;
+	BBitmap* largeCopy = NULL;
+	if (!is_size(bitmap, 32) || bitmap->ColorSpace() != B_RGBA32) {
+		largeCopy = new(std::nothrow) BBitmap(largeBounds,
+			B_BITMAP_NO_SERVER_LINK, B_RGBA32);
+		if (largeCopy != NULL && largeCopy->IsValid()
+			&& FaviconStore::ScaleUp(mini, largeCopy) == B_OK) {
+			large = largeCopy;
+		} else
+			large = NULL;
+	}
+
+	fMiniIcon = new(std::nothrow) BBitmap(miniBounds, B_BITMAP_NO_SERVER_LINK,
+		B_CMAP8);
+	if (fMiniIcon != NULL)
+		fMiniIcon->ImportBits(mini);
+	if (large != NULL) {
+		fLargeIcon = new(std::nothrow) BBitmap(largeBounds,
+			B_BITMAP_NO_SERVER_LINK, B_CMAP8);
+		if (fLargeIcon != NULL)
+			fLargeIcon->ImportBits(large);
+	}
+
+	delete miniCopy;
+	delete largeCopy;
+}
+
+
+Favicon::~Favicon()
+{
+	delete fBitmap;
+	delete fMiniIcon;
+	delete fLargeIcon;
+}
+
+
+// #pragma mark - FaviconStore::Worker
+
+
+/*!	Reads and writes the cache files, so that neither the windows nor
+	anyone holding the store lock waits for the disk.
+*/
+class FaviconStore::Worker : public BLooper {
+public:
+	Worker(FaviconStore* store)
+		:
+		BLooper("favicon store", B_LOW_PRIORITY),
+		fStore(store)
+	{
+	}
+
+	virtual void MessageReceived(BMessage* message)
+	{
+		switch (message->what) {
+			case kMsgLoad:
+			{
+				BString host = message->GetString("host", "");
+				BMessenger target;
+				BMessage reply;
+				if (message->FindMessenger("target", &target) != B_OK
+					|| message->FindMessage("reply", &reply) != B_OK) {
+					break;
+				}
+
+				// The page may have sent its icon meanwhile.
+				BReference<Favicon> favicon = fStore->Get(host);
+				if (!favicon.IsSet()) {
+					BBitmap* icon = fStore->_ReadFile(host);
+					if (icon == NULL)
+						break;
+					favicon = fStore->_Insert(host, icon, true);
+					delete icon;
+				}
+				if (favicon.IsSet()) {
+					reply.AddString("host", host);
+					target.SendMessage(&reply);
+				}
+				break;
+			}
+
+			case kMsgSave:
+			{
+				Favicon* favicon;
+				if (message->FindPointer("favicon", (void**)&favicon) != B_OK)
+					break;
+				fStore->_WriteFile(message->GetString("host", ""), favicon);
+				favicon->ReleaseReference();
+				break;
+			}
+
+			default:
+				BLooper::MessageReceived(message);
+				break;
+		}
+	}
+
+private:
+	FaviconStore*	fStore;
+};
+
+
+// #pragma mark - FaviconStore
+
+
+FaviconStore FaviconStore::sDefaultInstance;
+
+
+FaviconStore::FaviconStore()
+	:
+	BLocker("favicon store"),
+	fWorker(NULL),
+	fQuitting(false),
+	fCacheStatus(B_NO_INIT)
+{
+}
+
+
+FaviconStore::~FaviconStore()
+{
+	IconMap::iterator iterator = fIcons.begin();
+	for (; iterator != fIcons.end(); iterator++)
+		iterator->second->ReleaseReference();
+}
+
+
+/*static*/ FaviconStore*
+FaviconStore::DefaultInstance()
+{
+	return &sDefaultInstance;
+}
+
+
+/*!	Writes the icons that are still queued, and stops the worker. */
+void
+FaviconStore::Shutdown()
+{
+	Worker* worker;
+	{
+		BAutolock _(this);
+		fQuitting = true;
+		worker = fWorker;
+		fWorker = NULL;
+	}
+	if (worker == NULL)
+		return;
+
+	// The quit request is handled after the queued writes.
+	thread_id thread = worker->Thread();
+	worker->PostMessage(B_QUIT_REQUESTED);
+	status_t exitValue;
+	wait_for_thread(thread, &exitValue);
+}
+
+
+/*!	Makes \a icon the icon of \a host, and returns the shared icon for it.
+	If an equal icon is known already, no copy is made.
+*/
+BReference<Favicon>
+FaviconStore::Put(const BString& host, const BBitmap* icon)
+{
+	if (icon == NULL || !icon->IsValid())
+		return BReference<Favicon>();
+
+	return _Insert(host, icon, false);
+}
+
+
+/*!	Returns the icon last seen for \a host, or an empty reference if there
+	is none in memory. Use Load() to look in the disk cache.
+*/
+BReference<Favicon>
+FaviconStore::Get(const BString& host)
+{
+	if (host.IsEmpty())
+		return BReference<Favicon>();
+
+	BAutolock _(this);
+	HostMap::const_iterator found = fHosts.find(host);
+	if (found == fHosts.end())
+		return BReference<Favicon>();
+
+	_Touch(found->second);
+	return BReference<Favicon>(found->second);
+}
+
+
+/*!	Looks for the icon of \a host in the disk cache, in the worker thread.
+	If there is one, it is added to the store, and \a message is sent to
+	\a target with the "host" added; Get() then returns the icon.
+*/
+void
+FaviconStore::Load(const BString& host, const BMessenger& target,
+	const BMessage& message)
+{
+	if (host.IsEmpty())
+		return;
+
+	BMessage request(kMsgLoad);
+	request.AddString("host", host);
+	request.AddMessenger("target", target);
+	request.AddMessage("reply", &message);
+
+	BAutolock _(this);
+	Worker* worker = _Worker();
+	if (worker != NULL)
+		worker->PostMessage(&request);
+}
+
+
+/*!	Scales \a source up to twice its size into \a target, by doubling each
+	pixel. Both must be of the same 8 or 32 bit color space.
+*/
+/*static*/ status_t
+FaviconStore::ScaleUp(const BBitmap* source, BBitmap* target)
+{
+	int32 width = source->Bounds().IntegerWidth() + 1;
+	int32 height = source->Bounds().IntegerHeight() + 1;
+	if (source->ColorSpace() != target->ColorSpace()
+		|| target->Bounds().IntegerWidth() + 1 != width * 2
+		|| target->Bounds().IntegerHeight() + 1 != height * 2) {
+		return B_BAD_VALUE;
+	}
+
+	int32 bytesPerPixel;
+	switch (source->ColorSpace()) {
+		case B_CMAP8:
+		case B_GRAY8:
+			bytesPerPixel = 1;
+			break;
+		case B_RGB32:
+		case B_RGBA32:
+			bytesPerPixel = 4;
+			break;
+		default:
+			return B_BAD_VALUE;
+	}
+
+	const uint8* sourceRow = (const uint8*)source->Bits();
+	uint8* targetRow = (uint8*)target->Bits();
+	int32 targetBytesPerRow = target->BytesPerRow();
+	for (int32 y = 0; y < height; y++) {
+		scale_up_row(sourceRow, targetRow, width, bytesPerPixel);
+		memcpy(targetRow + targetBytesPerRow, targetRow,
+			width * 2 * bytesPerPixel);
+		sourceRow += source->BytesPerRow();
+		targetRow += targetBytesPerRow * 2;
+	}
+	return B_OK;
+}
+
+
+// #pragma mark - private
+
+
+/*!	Adds \a icon as the icon of \a host. An icon \a loaded from the disk
+	cache does not replace one the host already has, since that one is
+	newer. Any other one is written to the cache.
+*/
+BReference<Favicon>
+FaviconStore::_Insert(const BString& host, const BBitmap* icon, bool loaded)
+{
+	uint32 hash = hash_bitmap(icon);
+
+	BReference<Favicon> reference;
+	BMessenger worker;
+	{
+		BAutolock _(this);
+		HostMap::iterator current = fHosts.find(host);
+		if (current != fHosts.end() && (loaded
+			|| (current->second->Hash() == hash
+				&& equal_bitmaps(current->second->Bitmap(), icon)))) {
+			_Touch(current->second);
+			return BReference<Favicon>(current->second);
+		}
+
+		Favicon* favicon = _Find(icon, hash);
+		if (favicon == NULL) {
+			BBitmap* copy = new(std::nothrow) BBitmap(icon);
+			if (copy == NULL || !copy->IsValid()) {
+				delete copy;
+				return BReference<Favicon>();
+			}
+			favicon = new(std::nothrow) Favicon(copy, hash);
+			if (favicon == NULL) {
+				delete copy;
+				return BReference<Favicon>();
+			}
+			// The store keeps the initial reference.
+			fIcons.insert(std::make_pair(hash, favicon));
+			fLRU.push_front(favicon);
+			favicon->fLRUPosition = fLRU.begin();
+		} else
+			_Touch(favicon);
+
+		reference.SetTo(favicon);
+		if (!host.IsEmpty()) {
+			_SetHost(host, favicon);
+			Worker* looper = loaded ? NULL : _Worker();
+			if (looper != NULL)
+				worker = BMessenger(looper);
+		}
+
+		if (isLowOnMemory())
+			_Trim(true);
+		else if (fIcons.size() > kMaxIcons)
+			_Trim(false);
+	}
+
+	// Posting may block while the worker's queue is full, and the worker
+	// needs the lock to empty it. The messenger stays safe to use should
+	// the worker quit meanwhile.
+	if (worker.IsValid()) {
+		BMessage save(kMsgSave);
+		save.AddString("host", host);
+		save.AddPointer("favicon", reference.Get());
+		reference->AcquireReference();
+		if (worker.SendMessage(&save) != B_OK)
+			reference->ReleaseReference();
+	}
+	return reference;
+}
+
+
+Favicon*
+FaviconStore::_Find(const BBitmap* icon, uint32 hash) const
+{
+	std::pair<IconMap::const_iterator, IconMap::const_iterator> range
+		= fIcons.equal_range(hash);
+	for (IconMap::const_iterator iterator = range.first;
+			iterator != range.second; iterator++) {
+		if (equal_bitmaps(iterator->second->Bitmap(), icon))
+			return iterator->second;
+	}
+	return NULL;
+}
+
+
+void
+FaviconStore::_SetHost(const BString& host, Favicon* favicon)
+{
+	HostMap::iterator current = fHosts.find(host);
+	if (current != fHosts.end()) {
+		if (current->second == favicon)
+			return;
+
+		std::vector<BString>& hosts = current->second->fHosts;
+		hosts.erase(std::remove(hosts.begin(), hosts.end(), host),
+			hosts.end());
+		current->second = favicon;
+	} else
+		fHosts[host] = favicon;
+
+	favicon->fHosts.push_back(host);
+}
+
+
+void
+FaviconStore::_Touch(Favicon* favicon)
+{
+	fLRU.splice(fLRU.begin(), fLRU, favicon->fLRUPosition);
+}
+
+
+/*!	Drops the least recently used icons that nobody but the store holds on
+	to, until there are no more than kMaxIcons, or with \a all, every one of
+	them. Their hosts can still get them back from the disk cache.
+
+	Icons that are still in use are moved to the front, so they are only
+	looked at again after all others. Unless \a all is set, only a few icons
+	are looked at, so an insertion never goes through all of them, even if
+	more than kMaxIcons are in use.
+*/
+void
+FaviconStore::_Trim(bool all)
+{
+	size_t limit = all ? fLRU.size() : kTrimBatch;
+	for (size_t i = 0; i < limit && !fLRU.empty(); i++) {
+		if (!all && fIcons.size() <= kMaxIcons)
+			break;
+
+		Favicon* favicon = fLRU.back();
+		if (favicon->CountReferences() == 1)
+			_Remove(favicon);
+		else
+			_Touch(favicon);
+	}
+}
+
+
+void
+FaviconStore::_Remove(Favicon* favicon)
+{
+	for (size_t i = 0; i < favicon->fHosts.size(); i++)
+		fHosts.erase(favicon->fHosts[i]);
+
+	std::pair<IconMap::iterator, IconMap::iterator> range
+		= fIcons.equal_range(favicon->Hash());
+	for (IconMap::iterator iterator = range.first; iterator != range.second;
+			iterator++) {
+		if (iterator->second == favicon) {
+			fIcons.erase(iterator);
+			break;
+		}
+	}
+
+	fLRU.erase(favicon->fLRUPosition);
+	favicon->ReleaseReference();
+}
+
+
+/*!	Returns the worker, and starts it if needed. Must be called with the
+	lock held.
+*/
+FaviconStore::Worker*
+FaviconStore::_Worker()
+{
+	if (fWorker == NULL && !fQuitting) {
+		fWorker = new(std::nothrow) Worker(this);
+		if (fWorker != NULL)
+			fWorker->Run();
+	}
+	return fWorker;
+}
+
+
+/*!	Returns the cache file of \a host. The cache directory is only looked
+	up and created the first time. Only called by the worker.
+*/
+status_t
+FaviconStore::_CachePath(const BString& host, BPath& path)
+{
+	if (host.IsEmpty() || host.FindFirst('/') >= 0 || host[0] == '.')
+		return B_BAD_VALUE;
+
+	if (fCacheStatus == B_NO_INIT) {
+		fCacheStatus = find_directory(B_USER_CACHE_DIRECTORY,
+			&fCacheDirectory, true);
+		if (fCacheStatus == B_OK)
+			fCacheStatus = fCacheDirectory.Append("WebPositive/Favicons");
+		if (fCacheStatus == B_OK)
+			fCacheStatus = create_directory(fCacheDirectory.Path(), 0755);
+	}
+	if (fCacheStatus != B_OK)
+		return fCacheStatus;
+
+	path = fCacheDirectory;
+	return path.Append(host.String());
+}
+
+
+BBitmap*
+FaviconStore::_ReadFile(const BString& host)
+{
+	BPath path;
+	if (_CachePath(host, path) != B_OK)
+		return NULL;
+
+	BFile file(path.Path(), B_READ_ONLY);
+	cache_file_header header;
+	if (file.Read(&header, sizeof(header)) != (ssize_t)sizeof(header)
+		|| header.magic != kCacheFileMagic || header.width == 0
+		|| header.height == 0 || header.width > kMaxCachedIconSize
+		|| header.height > kMaxCachedIconSize) {
+		return NULL;
+	}
+
+	// This runs on the worker thread, which has no link to the app_server.
+	BBitmap* icon = new(std::nothrow) BBitmap(
+		BRect(0, 0, header.width - 1, header.height - 1),
+		B_BITMAP_NO_SERVER_LINK, B_RGBA32);
+	if (icon == NULL || !icon->IsValid()) {
+		delete icon;
+		return NULL;
+	}
+
+	uint8* row = (uint8*)icon->Bits();
+	ssize_t rowLength = header.width * 4;
+	for (int32 y = 0; y < header.height; y++, row += icon->BytesPerRow()) {
+		if (file.Read(row, rowLength) != rowLength) {
+			delete icon;
+			return NULL;
+		}
+	}
+	return icon;
+}
+
+
+/*!	Writes the icon as a small header followed by the bare pixels, without
+	any row padding. Only plain 32 bit icons of a sensible size are kept.
+	The bitmap of a Favicon never changes, so this doesn't need the lock.
+*/
+void
+FaviconStore::_WriteFile(const BString& host, const Favicon* icon)
+{
+	const BBitmap* bitmap = icon->Bitmap();
+	int32 width = bitmap->Bounds().IntegerWidth() + 1;
+	int32 height = bitmap->Bounds().IntegerHeight() + 1;
+	if ((bitmap->ColorSpace() != B_RGBA32 && bitmap->ColorSpace() != B_RGB32)
+		|| width > kMaxCachedIconSize || height > kMaxCachedIconSize) {
+		return;
+	}
+
+	BPath path;
+	if (_CachePath(host, path) != B_OK)
+		return;
+
+	BFile file(path.Path(), B_CREATE_FILE | B_ERASE_FILE | B_WRITE_ONLY);
+	if (file.InitCheck() != B_OK)
+		return;
+
+	cache_file_header header;
+	header.magic = kCacheFileMagic;
+	header.width = width;
+	header.height = height;
+	file.Write(&header, sizeof(header));
+
+	const uint8* row = (const uint8*)bitmap->Bits();
+	for (int32 y = 0; y < height; y++, row += bitmap->BytesPerRow())
+		file.Write(row, width * 4);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef FAVICON_STORE_H
+#define FAVICON_STORE_H
+
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <Path.h>
+#include <Referenceable.h>
+#include <String.h>
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "HashFunctions.h"
+
+
+class BBitmap;
+class BMessage;
+
+
+/*!	A site icon as received from the page, together with the variants made
+	from it for bookmark files. The variants are made once, when the icon
+	enters the FaviconStore; the bitmaps never change afterwards.
+*/
+class Favicon : public BReferenceable {
+public:
+			const BBitmap*		Bitmap() const { return fBitmap; }
+			const BBitmap*		MiniIcon() const { return fMiniIcon; }
+			const BBitmap*		LargeIcon() const { return fLargeIcon; }
+
+			uint32				Hash() const { return fHash; }
+
+private:
+	friend class FaviconStore;
+
+								Favicon(BBitmap* bitmap, uint32 hash);
+	virtual						~Favicon();
+
+private:
+			BBitmap*			fBitmap;
+			BBitmap*			fMiniIcon;
+				// 16x16, B_CMAP8
+			BBitmap*			fLargeIcon;
+				// 32x32, B_CMAP8
+			uint32				fHash;
+
+			// Maintained by the FaviconStore, under its lock
+			std::list<Favicon*>::iterator fLRUPosition;
+			std::vector<BString> fHosts;
+};
+
+
+/*!	Shares the site icons between all tabs, the URL bar and new bookmarks.
+	Icons are kept by host, and by the hash of their contents, so the same
+	icon is only held once, no matter how many tabs show it or how many
+	hosts use it.
+
+	Every host's last icon is also written to a small file in the cache
+	directory, so it can be shown right away the next time the host is
+	visited. The files are read and written by a worker thread, Load()
+	reports back by message when it has found one.
+*/
+class FaviconStore : public BLocker {
+public:
+	static	FaviconStore*		DefaultInstance();
+
+			void				Shutdown();
+
+			BReference<Favicon>	Put(const BString& host, const BBitmap* icon);
+			BReference<Favicon>	Get(const BString& host);
+			void				Load(const BString& host,
+									const BMessenger& target,
+									const BMessage& message);
+
+	static	status_t			ScaleUp(const BBitmap* source, BBitmap* target);
+
+private:
+			class Worker;
+
+			typedef std::unordered_map<BString, Favicon*, StringHash> HostMap;
+			typedef std::unordered_multimap<uint32, Favicon*> IconMap;
+
+								FaviconStore();
+	virtual						~FaviconStore();
+
+			BReference<Favicon>	_Insert(const BString& host,
+									const BBitmap* icon, bool loaded);
+			Favicon*			_Find(const BBitmap* icon, uint32 hash) const;
+			void				_SetHost(const BString& host,
+									Favicon* favicon);
+			void				_Touch(Favicon* favicon);
+			void				_Trim(bool all);
+			void				_Remove(Favicon* favicon);
+			Worker*				_Worker();
+
+			status_t			_CachePath(const BString& host,
+									BPath& path);
+			BBitmap*			_ReadFile(const BString& host);
+			void				_WriteFile(const BString& host,
+									const Favicon* icon);
+
+private:
+			HostMap				fHosts;
+			IconMap				fIcons;
+				// holds a reference to each icon
+			std::list<Favicon*>	fLRU;
+				// all icons, the least recently used last
+			Worker*				fWorker;
+			bool				fQuitting;
+
+			// Only used by the worker
+			BPath				fCacheDirectory;
+			status_t			fCacheStatus;
+
+	static	FaviconStore		sDefaultInstance;
+};
+
+
+#endif // FAVICON_STORE_H
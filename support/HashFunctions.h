@@ -0,0 +1,32 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef HASH_FUNCTIONS_H
+#define HASH_FUNCTIONS_H
+
+
+#include <Node.h>
+#include <String.h>
+
+
+/*!	Hash functors to key std::unordered_map and friends by the Haiku types
+	that do not come with a std::hash specialization.
+*/
+struct StringHash {
+	size_t operator()(const BString& string) const
+	{
+		return string.HashValue();
+	}
+};
+
+
+struct NodeRefHash {
+	size_t operator()(const node_ref& ref) const
+	{
+		return (size_t)ref.node ^ ((size_t)ref.device << 24);
+	}
+};
+
+
+#endif // HASH_FUNCTIONS_H
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "MemoryPressure.h"
+
+#include <OS.h>
+
+
+static const uint64 kLowMemoryThreshold = 256 * 1024 * 1024;
+	// There is no public low memory notification, caches that can be
+	// rebuilt are dropped once free memory falls below this.
+
+
+uint64
+freeMemory()
+{
+	system_info info;
+	if (get_system_info(&info) != B_OK)
+		return 0;
+
+	return (uint64)(info.max_pages - info.used_pages) * B_PAGE_SIZE;
+}
+
+
+bool
+isLowOnMemory()
+{
+	uint64 available = freeMemory();
+	return available != 0 && available < kLowMemoryThreshold;
+}
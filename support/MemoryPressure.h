@@ -0,0 +1,15 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef MEMORY_PRESSURE_H
+#define MEMORY_PRESSURE_H
+
+#include <SupportDefs.h>
+
+
+uint64 freeMemory();
+bool isLowOnMemory();
+
+
+#endif // MEMORY_PRESSURE_H
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "MiniIconCache.h"
+
+#include <new>
+#include <string.h>
+
+#include <Autolock.h>
+#include <Bitmap.h>
+#include <Entry.h>
+#include <NodeInfo.h>
+
+
+static const size_t kMaxIcons = 4096;
+	// The cache is simply emptied when it grows beyond this.
+
+
+struct MiniIconCache::Icon {
+	time_t				modified;
+	time_t				changed;
+		// Writing the icon attribute only changes the latter.
+	std::vector<uint8>	bits;
+};
+
+
+MiniIconCache MiniIconCache::sDefaultInstance;
+
+
+MiniIconCache::MiniIconCache()
+	:
+	BLocker("mini icon cache")
+{
+}
+
+
+MiniIconCache::~MiniIconCache()
+{
+	std::unordered_map<node_ref, Icon*, NodeRefHash>::iterator iterator
+		= fIcons.begin();
+	for (; iterator != fIcons.end(); iterator++)
+		delete iterator->second;
+}
+
+
+/*static*/ MiniIconCache*
+MiniIconCache::DefaultInstance()
+{
+	return &sDefaultInstance;
+}
+
+
+/*!	Copies the mini icon of the file at \a ref into \a icon, which must be
+	a 16x16 B_RGBA32 bitmap. Symbolic links are not followed.
+*/
+status_t
+MiniIconCache::GetIcon(const entry_ref& ref, BBitmap* icon)
+{
+	if (icon->ColorSpace() != B_RGBA32
+		|| icon->Bounds() != BRect(0, 0, B_MINI_ICON - 1, B_MINI_ICON - 1)) {
+		return B_BAD_VALUE;
+	}
+
+	BNode node(&ref);
+	node_ref nodeRef;
+	struct stat nodeStat;
+	status_t status = node.GetNodeRef(&nodeRef);
+	if (status == B_OK)
+		status = node.GetStat(&nodeStat);
+	if (status != B_OK)
+		return status;
+
+	{
+		BAutolock _(this);
+		std::unordered_map<node_ref, Icon*, NodeRefHash>::iterator found
+			= fIcons.find(nodeRef);
+		if (found != fIcons.end()
+			&& found->second->modified == nodeStat.st_mtime
+			&& found->second->changed == nodeStat.st_ctime
+			&& found->second->bits.size() == (size_t)icon->BitsLength()) {
+			memcpy(icon->Bits(), &found->second->bits[0],
+				icon->BitsLength());
+			return B_OK;
+		}
+	}
+
+	// Decode outside of the lock, this may have to go to the MIME database.
+	BNodeInfo info(&node);
+	status = info.GetTrackerIcon(icon, B_MINI_ICON);
+	if (status != B_OK)
+		return status;
+
+	Icon* entry = new(std::nothrow) Icon;
+	if (entry == NULL)
+		return B_OK;
+	entry->modified = nodeStat.st_mtime;
+	entry->changed = nodeStat.st_ctime;
+	const uint8* bits = (const uint8*)icon->Bits();
+	entry->bits.assign(bits, bits + icon->BitsLength());
+
+	BAutolock _(this);
+	if (fIcons.size() >= kMaxIcons) {
+		std::unordered_map<node_ref, Icon*, NodeRefHash>::iterator iterator
+			= fIcons.begin();
+		for (; iterator != fIcons.end(); iterator++)
+			delete iterator->second;
+		fIcons.clear();
+	}
+
+	Icon*& slot = fIcons[nodeRef];
+	delete slot;
+	slot = entry;
+	return B_OK;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef MINI_ICON_CACHE_H
+#define MINI_ICON_CACHE_H
+
+
+#include <Locker.h>
+#include <Node.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "HashFunctions.h"
+
+
+class BBitmap;
+struct entry_ref;
+
+
+/*!	Keeps the decoded mini icons of files, as Tracker would show them, so
+	that the bookmark bars of all windows share them. An icon is decoded
+	again once its file has changed.
+
+	Safe to use from any thread. The icons are copied out into a 16x16
+	B_RGBA32 bitmap of the caller.
+*/
+class MiniIconCache : public BLocker {
+public:
+	static	MiniIconCache*		DefaultInstance();
+
+			status_t			GetIcon(const entry_ref& ref, BBitmap* icon);
+
+private:
+			struct Icon;
+
+								MiniIconCache();
+	virtual						~MiniIconCache();
+
+private:
+			std::unordered_map<node_ref, Icon*, NodeRefHash> fIcons;
+
+	static	MiniIconCache		sDefaultInstance;
+};
+
+
+#endif // MINI_ICON_CACHE_H
@@ -0,0 +1,335 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "RecordJournal.h"
+
+#include <stdio.h>
+
+#include <Autolock.h>
+#include <DataIO.h>
+#include <Entry.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Message.h>
+#include <Path.h>
+
+#include "BrowserApp.h"
+
+
+static const bigtime_t kBatchDelay = 250000;
+	// Records arriving within this time end up in the same write.
+static const size_t kCompactionThreshold = 256;
+	// Number of appended records after which the journal is rewritten as a
+	// snapshot of the live state.
+
+
+RecordJournal::RecordJournal(const char* name, const char* fileName)
+	:
+	BLocker(name),
+	fName(name),
+	fFileName(fileName),
+	fRecordsSinceCompaction(0),
+	fStarted(false),
+	fQuitting(false),
+	fWakeSem(-1),
+	fWriterThread(-1)
+{
+}
+
+
+RecordJournal::~RecordJournal()
+{
+	Shutdown();
+
+	_DeleteRecords(fPending);
+}
+
+
+/*!	Rewrites the journal as a snapshot of the current state and starts the
+	writer thread. Records are only written from here on, changes made
+	before are part of the snapshot.
+*/
+status_t
+RecordJournal::Start()
+{
+	BAutolock _(this);
+
+	if (fStarted)
+		return B_OK;
+
+	RecordList snapshot;
+	_SnapshotRecords(snapshot);
+	_Compact(snapshot);
+	_DeleteRecords(snapshot);
+
+	BString name(fName);
+	name << " wake";
+	fWakeSem = create_sem(0, name.String());
+	if (fWakeSem < 0)
+		return fWakeSem;
+
+	name = fName;
+	name << " writer";
+	fWriterThread = spawn_thread(_WriterThreadEntry, name.String(),
+		B_LOW_PRIORITY, this);
+	if (fWriterThread < 0) {
+		fprintf(stderr, "Failed to spawn %s thread!\n", fName.String());
+		delete_sem(fWakeSem);
+		fWakeSem = -1;
+		return fWriterThread;
+	}
+
+	fStarted = true;
+	resume_thread(fWriterThread);
+	return B_OK;
+}
+
+
+/*!	Writes out all pending records and stops the writer thread. Records
+	appended after this are dropped.
+*/
+void
+RecordJournal::Shutdown()
+{
+	if (!Lock())
+		return;
+
+	if (!fStarted || fQuitting) {
+		Unlock();
+		return;
+	}
+
+	fQuitting = true;
+	thread_id thread = fWriterThread;
+	release_sem(fWakeSem);
+	Unlock();
+
+	status_t exitValue;
+	wait_for_thread(thread, &exitValue);
+
+	delete_sem(fWakeSem);
+	fWakeSem = -1;
+	fWriterThread = -1;
+}
+
+
+// #pragma mark - protected
+
+
+/*!	Hands every record of the journal on disk to _Apply(), oldest first.
+	Must be called with the lock held.
+*/
+status_t
+RecordJournal::_Replay()
+{
+	BPath path;
+	status_t status = _JournalPath(path);
+	if (status != B_OK)
+		return status;
+
+	BFile file(path.Path(), B_READ_ONLY);
+	status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	BMessage record;
+	while (record.Unflatten(&file) == B_OK)
+		_Apply(record);
+			// A truncated record at the end of the file (we crashed while
+			// appending it) fails to unflatten and simply ends the replay.
+
+	return B_OK;
+}
+
+
+/*!	Queues a record for the writer thread, which takes ownership of it.
+	Must be called with the lock held.
+	With \a replaceField, a still pending record of the same kind with the
+	same value in that field is dropped, which keeps frequent updates of the
+	same thing from flooding the journal. The new record still goes to the
+	end, so it is not overtaken by the records queued in between.
+*/
+void
+RecordJournal::_Append(BMessage* record, const char* replaceField)
+{
+	if (!fStarted || fQuitting) {
+		delete record;
+		return;
+	}
+
+	if (replaceField != NULL) {
+		uint32 key = record->GetUInt32(replaceField, 0);
+		for (size_t i = 0; i < fPending.size(); i++) {
+			if (fPending[i]->what == record->what
+				&& fPending[i]->GetUInt32(replaceField, 0) == key) {
+				delete fPending[i];
+				fPending.erase(fPending.begin() + i);
+				break;
+			}
+		}
+	}
+
+	fPending.push_back(record);
+	if (fPending.size() == 1)
+		release_sem(fWakeSem);
+}
+
+
+/*!	Returns the number of appended records after which the journal is
+	compacted. Must be called with the lock held.
+*/
+size_t
+RecordJournal::_CompactionThreshold() const
+{
+	return kCompactionThreshold;
+}
+
+
+/*static*/ void
+RecordJournal::_DeleteRecords(RecordList& records)
+{
+	for (size_t i = 0; i < records.size(); i++)
+		delete records[i];
+	records.clear();
+}
+
+
+// #pragma mark - private
+
+
+void
+RecordJournal::_WriteBatch(const RecordList& records)
+{
+	BPath path;
+	if (_JournalPath(path) != B_OK)
+		return;
+
+	BFile file(path.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_OPEN_AT_END);
+	if (file.InitCheck() != B_OK
+		|| _WriteRecords(file, records) != B_OK) {
+		fprintf(stderr, "Failed to append to the %s!\n", fName.String());
+		return;
+	}
+	file.Sync();
+}
+
+
+/*!	Replaces the journal with \a snapshot. The snapshot is written to a
+	temporary file first and then renamed over the journal, so there is
+	always a complete journal on disk.
+*/
+void
+RecordJournal::_Compact(const RecordList& snapshot)
+{
+	BPath path;
+	BPath temporaryPath;
+	if (_JournalPath(path) != B_OK || _JournalPath(temporaryPath, true) != B_OK)
+		return;
+
+	BFile file(temporaryPath.Path(),
+		B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK || _WriteRecords(file, snapshot) != B_OK) {
+		fprintf(stderr, "Failed to compact the %s!\n", fName.String());
+		return;
+	}
+	file.Sync();
+	file.Unset();
+
+	BEntry entry(temporaryPath.Path());
+	if (entry.Rename(path.Path(), true) != B_OK)
+		fprintf(stderr, "Failed to replace the %s!\n", fName.String());
+}
+
+
+status_t
+RecordJournal::_WriteRecords(BFile& file, const RecordList& records) const
+{
+	// Flatten everything first, so the batch hits the disk in a single write.
+	BMallocIO buffer;
+	for (size_t i = 0; i < records.size(); i++) {
+		status_t status = records[i]->Flatten(&buffer);
+		if (status != B_OK)
+			return status;
+	}
+
+	if (buffer.BufferLength() == 0)
+		return B_OK;
+
+	ssize_t written = file.Write(buffer.Buffer(), buffer.BufferLength());
+	if (written < 0)
+		return written;
+	return (size_t)written == buffer.BufferLength() ? B_OK : B_IO_ERROR;
+}
+
+
+status_t
+RecordJournal::_JournalPath(BPath& path, bool temporary) const
+{
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+	if (status == B_OK)
+		status = path.Append(kApplicationName);
+	if (status == B_OK) {
+		BString fileName(fFileName);
+		if (temporary)
+			fileName << "~";
+		status = path.Append(fileName.String());
+	}
+	return status;
+}
+
+
+/*static*/ int32
+RecordJournal::_WriterThreadEntry(void* data)
+{
+	static_cast<RecordJournal*>(data)->_WriterThread();
+	return B_OK;
+}
+
+
+void
+RecordJournal::_WriterThread()
+{
+	while (true) {
+		// Wait for the first record of a batch, then give the following
+		// ones a moment to arrive. Shutdown() cuts that wait short.
+		if (acquire_sem(fWakeSem) != B_OK)
+			break;
+		if (!fQuitting)
+			acquire_sem_etc(fWakeSem, 1, B_RELATIVE_TIMEOUT, kBatchDelay);
+
+		RecordList batch;
+		RecordList snapshot;
+		bool compact = false;
+		bool quitting;
+
+		if (!Lock())
+			break;
+		quitting = fQuitting;
+		if (fRecordsSinceCompaction + fPending.size()
+				>= _CompactionThreshold()) {
+			// The model already reflects the pending records, so they can
+			// be dropped in favour of the snapshot.
+			_SnapshotRecords(snapshot);
+			_DeleteRecords(fPending);
+			fRecordsSinceCompaction = 0;
+			compact = true;
+		} else {
+			batch.swap(fPending);
+			fRecordsSinceCompaction += batch.size();
+		}
+		Unlock();
+
+		if (compact)
+			_Compact(snapshot);
+		else if (!batch.empty())
+			_WriteBatch(batch);
+
+		_DeleteRecords(batch);
+		_DeleteRecords(snapshot);
+
+		if (quitting)
+			break;
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef RECORD_JOURNAL_H
+#define RECORD_JOURNAL_H
+
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+#include <vector>
+
+
+class BFile;
+class BMessage;
+class BPath;
+
+
+/*!	An append-only journal of small records (flattened BMessages) in the
+	settings directory, for state that changes a little at a time.
+
+	Records are queued under the lock and written in batches by a writer
+	thread. Subclasses keep an in-memory model of the state alongside, which
+	they update in _Apply(), both for replayed and for live records. Once
+	enough records were appended, the journal is compacted into the records
+	_SnapshotRecords() rebuilds the model from. A torn record at the end of
+	the file (from a crash) simply ends the replay.
+
+	Subclasses have to call Shutdown() in their destructor, the writer thread
+	calls into them.
+*/
+class RecordJournal : public BLocker {
+public:
+			status_t			Start();
+			void				Shutdown();
+
+protected:
+			typedef std::vector<BMessage*> RecordList;
+
+								RecordJournal(const char* name,
+									const char* fileName);
+	virtual						~RecordJournal();
+
+			status_t			_Replay();
+			void				_Append(BMessage* record,
+									const char* replaceField = NULL);
+
+	virtual	void				_Apply(const BMessage& record) = 0;
+	virtual	void				_SnapshotRecords(RecordList& records) const
+									= 0;
+	virtual	size_t				_CompactionThreshold() const;
+
+	static	void				_DeleteRecords(RecordList& records);
+
+private:
+			void				_WriteBatch(const RecordList& records);
+			void				_Compact(const RecordList& snapshot);
+			status_t			_WriteRecords(BFile& file,
+									const RecordList& records) const;
+			status_t			_JournalPath(BPath& path,
+									bool temporary = false) const;
+
+	static	int32				_WriterThreadEntry(void* data);
+			void				_WriterThread();
+
+private:
+			BString				fName;
+				// as used in thread names and error messages
+			BString				fFileName;
+			RecordList			fPending;
+			size_t				fRecordsSinceCompaction;
+			bool				fStarted;
+			bool				fQuitting;
+
+			sem_id				fWakeSem;
+			thread_id			fWriterThread;
+};
+
+
+#endif // RECORD_JOURNAL_H
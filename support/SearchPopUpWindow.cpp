@@ -0,0 +1,220 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "SearchPopUpWindow.h"
+
+#include <string.h>
+
+#include <ControlLook.h>
+#include <LayoutBuilder.h>
+#include <ScrollView.h>
+#include <String.h>
+#include <TextControl.h>
+
+#include "VirtualListView.h"
+
+
+enum {
+	QUERY_CHANGED		= 'spqc',
+	INVOKE_SELECTION	= 'spis'
+};
+
+
+class SearchResultListView : public VirtualListView {
+public:
+	SearchResultListView(const SearchPopUpWindow* window)
+		:
+		VirtualListView("search result list", new BMessage(INVOKE_SELECTION)),
+		fWindow(window)
+	{
+	}
+
+	virtual void AttachedToWindow()
+	{
+		VirtualListView::AttachedToWindow();
+
+		// Each item shows the title and below it the URL.
+		font_height fontHeight;
+		GetFontHeight(&fontHeight);
+		float lineHeight = ceilf(fontHeight.ascent + fontHeight.descent
+			+ fontHeight.leading);
+		SetItemHeight(2 * lineHeight + be_control_look->DefaultLabelSpacing());
+	}
+
+protected:
+	virtual void DrawItem(int32 index, BRect frame, bool selected)
+	{
+		BString title;
+		BString url;
+		fWindow->GetResult(index, title, url);
+
+		SetLowUIColor(selected
+			? B_LIST_SELECTED_BACKGROUND_COLOR : B_LIST_BACKGROUND_COLOR);
+		FillRect(frame, B_SOLID_LOW);
+
+		font_height fontHeight;
+		GetFontHeight(&fontHeight);
+		float spacing = be_control_look->DefaultLabelSpacing();
+		float lineHeight = ceilf(fontHeight.ascent + fontHeight.descent
+			+ fontHeight.leading);
+		float width = frame.Width() - 2 * spacing;
+
+		TruncateString(&title, B_TRUNCATE_END, width);
+		SetHighUIColor(selected
+			? B_LIST_SELECTED_ITEM_TEXT_COLOR : B_LIST_ITEM_TEXT_COLOR);
+		DrawString(title.String(), BPoint(frame.left + spacing,
+			frame.top + spacing / 2 + ceilf(fontHeight.ascent)));
+
+		TruncateString(&url, B_TRUNCATE_MIDDLE, width);
+		SetHighUIColor(selected
+			? B_LIST_SELECTED_ITEM_TEXT_COLOR : B_LIST_ITEM_TEXT_COLOR,
+			B_DISABLED_LABEL_TINT);
+		DrawString(url.String(), BPoint(frame.left + spacing,
+			frame.top + spacing / 2 + lineHeight + ceilf(fontHeight.ascent)));
+
+		SetLowUIColor(B_LIST_BACKGROUND_COLOR);
+	}
+
+private:
+	const SearchPopUpWindow*	fWindow;
+};
+
+
+SearchPopUpWindow::SearchPopUpWindow(const char* title)
+	:
+	BWindow(BRect(0, 0, 500, 350), title,
+		B_TITLED_WINDOW_LOOK, B_FLOATING_APP_WINDOW_FEEL,
+		B_NOT_ZOOMABLE | B_NOT_MINIMIZABLE | B_CLOSE_ON_ESCAPE
+			| B_AUTO_UPDATE_SIZE_LIMITS | B_ASYNCHRONOUS_CONTROLS)
+{
+	fSearchControl = new BTextControl("search", NULL, "",
+		new BMessage(INVOKE_SELECTION));
+	fSearchControl->SetModificationMessage(new BMessage(QUERY_CHANGED));
+
+	fResultsView = new SearchResultListView(this);
+	BScrollView* scrollView = new BScrollView("search result scroll",
+		fResultsView, 0, false, true);
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL, B_USE_SMALL_SPACING)
+		.SetInsets(B_USE_SMALL_SPACING)
+		.Add(fSearchControl)
+		.Add(scrollView);
+
+	CenterOnScreen();
+}
+
+
+SearchPopUpWindow::~SearchPopUpWindow()
+{
+}
+
+
+void
+SearchPopUpWindow::DispatchMessage(BMessage* message, BHandler* target)
+{
+	// Let the arrow keys move the selection while typing the query.
+	if (message->what == B_KEY_DOWN && target == fSearchControl->TextView()) {
+		const char* bytes;
+		if (message->FindString("bytes", &bytes) == B_OK) {
+			switch (bytes[0]) {
+				case B_UP_ARROW:
+				case B_DOWN_ARROW:
+				case B_PAGE_UP:
+				case B_PAGE_DOWN:
+					fResultsView->KeyDown(bytes, strlen(bytes));
+					return;
+			}
+		}
+	}
+
+	BWindow::DispatchMessage(message, target);
+}
+
+
+void
+SearchPopUpWindow::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case QUERY_CHANGED:
+			UpdateResults();
+			break;
+
+		case INVOKE_SELECTION:
+			_InvokeSelection();
+			break;
+
+		default:
+			BWindow::MessageReceived(message);
+			break;
+	}
+}
+
+
+void
+SearchPopUpWindow::WindowActivated(bool active)
+{
+	BWindow::WindowActivated(active);
+
+	// Behave like a pop-up, and go away once the user looks elsewhere.
+	if (!active && !IsHidden())
+		Hide();
+}
+
+
+bool
+SearchPopUpWindow::QuitRequested()
+{
+	if (!IsHidden())
+		Hide();
+	return false;
+}
+
+
+/*!	Clears the query and updates the results for it. Must be called with
+	the window locked, before showing it.
+*/
+void
+SearchPopUpWindow::Reset()
+{
+	fSearchControl->SetText("");
+	fSearchControl->MakeFocus(true);
+	UpdateResults();
+	CenterOnScreen();
+}
+
+
+// #pragma mark - protected
+
+
+const char*
+SearchPopUpWindow::Query() const
+{
+	return fSearchControl->Text();
+}
+
+
+/*!	Shows \a count results, which are then drawn with GetResult(). Must be
+	called whenever the results change.
+*/
+void
+SearchPopUpWindow::SetResultCount(int32 count)
+{
+	fResultsView->SetItemCount(count);
+}
+
+
+// #pragma mark - private
+
+
+void
+SearchPopUpWindow::_InvokeSelection()
+{
+	int32 index = fResultsView->CurrentSelection();
+	if (index < 0 || index >= fResultsView->CountItems())
+		return;
+
+	InvokeResult(index);
+	Hide();
+}
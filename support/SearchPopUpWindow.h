@@ -0,0 +1,56 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SEARCH_POP_UP_WINDOW_H
+#define SEARCH_POP_UP_WINDOW_H
+
+
+#include <Window.h>
+
+
+class BString;
+class BTextControl;
+class SearchResultListView;
+
+
+/*!	A window that behaves like a pop-up, with a query field and below it
+	the list of results, each one shown with a title and a URL. The arrow
+	keys move the selection while typing, and Enter or a double click
+	invokes the selected result.
+
+	Subclasses run the search and provide the results.
+*/
+class SearchPopUpWindow : public BWindow {
+public:
+								SearchPopUpWindow(const char* title);
+	virtual						~SearchPopUpWindow();
+
+	virtual	void				DispatchMessage(BMessage* message,
+									BHandler* target);
+	virtual	void				MessageReceived(BMessage* message);
+	virtual	void				WindowActivated(bool active);
+	virtual	bool				QuitRequested();
+
+			void				Reset();
+
+	virtual	void				GetResult(int32 index, BString& title,
+									BString& url) const = 0;
+
+protected:
+			const char*			Query() const;
+			void				SetResultCount(int32 count);
+
+	virtual	void				UpdateResults() = 0;
+	virtual	void				InvokeResult(int32 index) = 0;
+
+private:
+			void				_InvokeSelection();
+
+private:
+			BTextControl*		fSearchControl;
+			SearchResultListView* fResultsView;
+};
+
+
+#endif // SEARCH_POP_UP_WINDOW_H
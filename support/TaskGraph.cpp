@@ -0,0 +1,312 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "TaskGraph.h"
+
+#include <new>
+#include <stdio.h>
+
+#include <Autolock.h>
+
+#include "TraceLog.h"
+
+
+static const int32 kMaxWorkers = 4;
+	// The startup work is mostly I/O bound, more threads do not help.
+
+
+struct TaskGraph::Task {
+	Task(const char* name, task_function function, void* cookie)
+		:
+		name(name),
+		function(function),
+		cookie(cookie),
+		pendingDependencies(0),
+		result(B_OK),
+		done(false),
+		completionMessage(NULL),
+		doneSem(create_sem(0, name))
+	{
+	}
+
+	~Task()
+	{
+		delete completionMessage;
+		delete_sem(doneSem);
+	}
+
+	const char*			name;
+	task_function		function;
+	void*				cookie;
+	std::vector<int32>	dependents;
+	int32				pendingDependencies;
+	status_t			result;
+	bool				done;
+	BMessenger			completionTarget;
+	BMessage*			completionMessage;
+	sem_id				doneSem;
+};
+
+
+TaskGraph::TaskGraph(const char* name)
+	:
+	fLock(name),
+	fName(name),
+	fReadySem(-1),
+	fRemainingTasks(0),
+	fStarted(false)
+{
+}
+
+
+TaskGraph::~TaskGraph()
+{
+	WaitForAll();
+
+	for (size_t i = 0; i < fWorkers.size(); i++) {
+		status_t exitValue;
+		wait_for_thread(fWorkers[i], &exitValue);
+	}
+	if (fReadySem >= 0)
+		delete_sem(fReadySem);
+
+	for (size_t i = 0; i < fTasks.size(); i++)
+		delete fTasks[i];
+}
+
+
+/*!	Adds a task and returns its index, which is used to refer to it later
+	on. The name must stay valid for the lifetime of the graph.
+*/
+int32
+TaskGraph::AddTask(const char* name, task_function function, void* cookie)
+{
+	BAutolock _(fLock);
+
+	if (fStarted)
+		return B_NOT_ALLOWED;
+
+	Task* task = new(std::nothrow) Task(name, function, cookie);
+	if (task == NULL)
+		return B_NO_MEMORY;
+	if (task->doneSem < 0) {
+		status_t status = task->doneSem;
+		delete task;
+		return status;
+	}
+
+	fTasks.push_back(task);
+	return fTasks.size() - 1;
+}
+
+
+status_t
+TaskGraph::AddDependency(int32 task, int32 dependency)
+{
+	BAutolock _(fLock);
+
+	if (fStarted)
+		return B_NOT_ALLOWED;
+	if (task < 0 || task >= (int32)fTasks.size() || dependency < 0
+		|| dependency >= (int32)fTasks.size() || task == dependency) {
+		return B_BAD_VALUE;
+	}
+
+	fTasks[dependency]->dependents.push_back(task);
+	fTasks[task]->pendingDependencies++;
+	return B_OK;
+}
+
+
+/*!	Sends \a message to \a target when the task is done. The result of the
+	task is added as "status" field.
+*/
+status_t
+TaskGraph::SetCompletionMessage(int32 task, const BMessenger& target,
+	const BMessage& message)
+{
+	BAutolock _(fLock);
+
+	if (fStarted)
+		return B_NOT_ALLOWED;
+	if (task < 0 || task >= (int32)fTasks.size())
+		return B_BAD_VALUE;
+
+	BMessage* copy = new(std::nothrow) BMessage(message);
+	if (copy == NULL)
+		return B_NO_MEMORY;
+
+	delete fTasks[task]->completionMessage;
+	fTasks[task]->completionMessage = copy;
+	fTasks[task]->completionTarget = target;
+	return B_OK;
+}
+
+
+status_t
+TaskGraph::Start(int32 workerCount)
+{
+	BAutolock _(fLock);
+
+	if (fStarted)
+		return B_NOT_ALLOWED;
+
+	if (workerCount <= 0) {
+		system_info info;
+		if (get_system_info(&info) == B_OK)
+			workerCount = info.cpu_count;
+		if (workerCount < 2)
+			workerCount = 2;
+	}
+	if (workerCount > kMaxWorkers)
+		workerCount = kMaxWorkers;
+	if (workerCount > (int32)fTasks.size())
+		workerCount = fTasks.size();
+
+	fReadySem = create_sem(0, fName);
+	if (fReadySem < 0)
+		return fReadySem;
+
+	fRemainingTasks = fTasks.size();
+	for (size_t i = 0; i < fTasks.size(); i++) {
+		if (fTasks[i]->pendingDependencies == 0)
+			fReadyTasks.push_back(i);
+	}
+
+	for (int32 i = 0; i < workerCount; i++) {
+		thread_id thread = spawn_thread(_WorkerEntry, fName, B_NORMAL_PRIORITY,
+			this);
+		if (thread < 0)
+			break;
+		fWorkers.push_back(thread);
+		resume_thread(thread);
+	}
+
+	if (fWorkers.empty() && !fTasks.empty()) {
+		fprintf(stderr, "%s: failed to spawn worker threads!\n", fName);
+		return B_NO_MORE_THREADS;
+	}
+
+	fStarted = true;
+	release_sem_etc(fReadySem, fReadyTasks.size(), 0);
+	return B_OK;
+}
+
+
+/*!	Blocks until the task is done, and returns its result.
+*/
+status_t
+TaskGraph::WaitFor(int32 index)
+{
+	if (!fLock.Lock())
+		return B_ERROR;
+	if (index < 0 || index >= (int32)fTasks.size()) {
+		fLock.Unlock();
+		return B_BAD_VALUE;
+	}
+	Task* task = fTasks[index];
+	if (task->done || !fStarted) {
+		status_t result = task->done ? task->result : B_NOT_INITIALIZED;
+		fLock.Unlock();
+		return result;
+	}
+	fLock.Unlock();
+
+	// Pass the semaphore on, so that any number of threads can wait
+	while (acquire_sem(task->doneSem) == B_INTERRUPTED)
+		;
+	release_sem(task->doneSem);
+
+	BAutolock _(fLock);
+	return task->result;
+}
+
+
+void
+TaskGraph::WaitForAll()
+{
+	for (int32 i = 0; i < (int32)fTasks.size(); i++)
+		WaitFor(i);
+}
+
+
+// #pragma mark - private
+
+
+/*static*/ int32
+TaskGraph::_WorkerEntry(void* data)
+{
+	static_cast<TaskGraph*>(data)->_Worker();
+	return B_OK;
+}
+
+
+void
+TaskGraph::_Worker()
+{
+	while (true) {
+		status_t status = acquire_sem(fReadySem);
+		if (status == B_INTERRUPTED)
+			continue;
+		if (status != B_OK)
+			break;
+
+		if (!fLock.Lock())
+			break;
+		if (fReadyTasks.empty()) {
+			// All tasks are done, we were woken up to quit.
+			fLock.Unlock();
+			break;
+		}
+		Task* task = fTasks[fReadyTasks.front()];
+		fReadyTasks.erase(fReadyTasks.begin());
+		fLock.Unlock();
+
+		TraceSpan span("startup", task->name);
+		status_t result = task->function(task->cookie);
+		span.End();
+
+		_TaskDone(task, result);
+	}
+}
+
+
+void
+TaskGraph::_TaskDone(Task* task, status_t result)
+{
+	if (!fLock.Lock())
+		return;
+
+	task->result = result;
+	task->done = true;
+
+	int32 readied = 0;
+	for (size_t i = 0; i < task->dependents.size(); i++) {
+		Task* dependent = fTasks[task->dependents[i]];
+		if (--dependent->pendingDependencies == 0) {
+			fReadyTasks.push_back(task->dependents[i]);
+			readied++;
+		}
+	}
+
+	// Once the last task is done, wake up all workers so they can quit.
+	if (--fRemainingTasks == 0)
+		readied += fWorkers.size();
+
+	BMessenger target = task->completionTarget;
+	BMessage* message = task->completionMessage;
+	task->completionMessage = NULL;
+	fLock.Unlock();
+
+	if (readied > 0)
+		release_sem_etc(fReadySem, readied, 0);
+	release_sem(task->doneSem);
+
+	if (message != NULL) {
+		message->AddInt32("status", result);
+		target.SendMessage(message);
+		delete message;
+	}
+}
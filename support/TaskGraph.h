@@ -0,0 +1,62 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+
+#include <Locker.h>
+#include <Message.h>
+#include <Messenger.h>
+#include <OS.h>
+
+#include <vector>
+
+
+/*!	Runs a set of tasks on a small pool of worker threads, honouring the
+	dependencies between them. All tasks and dependencies have to be added
+	before Start() is called.
+
+	Any thread can block on a single task with WaitFor(). Alternatively a
+	message can be sent once a task is done, so the follow-up work runs in a
+	looper without blocking it.
+*/
+class TaskGraph {
+public:
+	typedef	status_t			(*task_function)(void* cookie);
+
+								TaskGraph(const char* name);
+								~TaskGraph();
+
+			int32				AddTask(const char* name,
+									task_function function, void* cookie);
+			status_t			AddDependency(int32 task, int32 dependency);
+			status_t			SetCompletionMessage(int32 task,
+									const BMessenger& target,
+									const BMessage& message);
+
+			status_t			Start(int32 workerCount = 0);
+			status_t			WaitFor(int32 task);
+			void				WaitForAll();
+
+private:
+			struct Task;
+
+	static	int32				_WorkerEntry(void* data);
+			void				_Worker();
+			void				_TaskDone(Task* task, status_t result);
+
+private:
+			BLocker				fLock;
+			const char*			fName;
+			std::vector<Task*>	fTasks;
+			std::vector<int32>	fReadyTasks;
+			std::vector<thread_id> fWorkers;
+			sem_id				fReadySem;
+			int32				fRemainingTasks;
+			bool				fStarted;
+};
+
+
+#endif // TASK_GRAPH_H
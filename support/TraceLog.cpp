@@ -0,0 +1,369 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "TraceLog.h"
+
+#include <algorithm>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Autolock.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Locker.h>
+#include <Path.h>
+#include <String.h>
+#include <TLS.h>
+
+
+static const int32 kEventsPerThread = 1024;
+	// Older events of a thread are overwritten once its buffer is full.
+static const size_t kMaxArgumentLength = 64;
+
+static const char* kTraceFileVariable = "WEBPOSITIVE_TRACE_FILE";
+	// If set, the trace is written to this file when the application quits.
+
+
+struct TraceEvent {
+	const char*	category;
+	const char*	name;
+	bigtime_t	start;
+	bigtime_t	duration;
+		// -1 for instant events
+	char		argument[kMaxArgumentLength];
+};
+
+
+struct TraceBuffer {
+	thread_id	thread;
+	char		threadName[B_OS_NAME_LENGTH];
+	int32		count;
+		// Number of events ever recorded, only written by the owning thread.
+	TraceBuffer* next;
+	TraceBuffer* nextFree;
+	TraceEvent	events[kEventsPerThread];
+};
+
+
+static TraceBuffer* sBuffers = NULL;
+static TraceBuffer* sFreeBuffers = NULL;
+	// Buffers of threads that have exited. They keep their events until a
+	// new thread takes them over.
+
+
+/*!	The state below is set up on first use, so tracing works from the
+	static constructors of other files, too.
+*/
+static BLocker&
+buffers_lock()
+{
+	static BLocker lock("trace buffers");
+	return lock;
+}
+
+
+static int32
+buffer_slot()
+{
+	static const int32 slot = tls_allocate();
+	return slot;
+}
+
+
+static bigtime_t
+trace_origin()
+{
+	static const bigtime_t origin = system_time();
+	return origin;
+}
+
+
+static void
+release_buffer(void* _buffer)
+{
+	TraceBuffer* buffer = (TraceBuffer*)_buffer;
+
+	BAutolock _(buffers_lock());
+	buffer->nextFree = sFreeBuffers;
+	sFreeBuffers = buffer;
+}
+
+
+static TraceBuffer*
+current_buffer()
+{
+	TraceBuffer* buffer = (TraceBuffer*)tls_get(buffer_slot());
+	if (buffer != NULL)
+		return buffer;
+
+	BAutolock _(buffers_lock());
+
+	bool reused = sFreeBuffers != NULL;
+	if (reused) {
+		buffer = sFreeBuffers;
+		sFreeBuffers = buffer->nextFree;
+	} else {
+		buffer = new(std::nothrow) TraceBuffer;
+		if (buffer == NULL)
+			return NULL;
+	}
+
+	if (on_exit_thread(&release_buffer, buffer) != B_OK) {
+		if (reused) {
+			buffer->nextFree = sFreeBuffers;
+			sFreeBuffers = buffer;
+		} else
+			delete buffer;
+		return NULL;
+	}
+
+	// The lock keeps Dump() from reading the buffer while it changes hands.
+	buffer->thread = find_thread(NULL);
+	buffer->count = 0;
+	thread_info info;
+	if (get_thread_info(buffer->thread, &info) == B_OK)
+		strlcpy(buffer->threadName, info.name, sizeof(buffer->threadName));
+	else
+		buffer->threadName[0] = '\0';
+
+	if (!reused) {
+		buffer->next = sBuffers;
+		sBuffers = buffer;
+	}
+	tls_set(buffer_slot(), buffer);
+	return buffer;
+}
+
+
+static void
+record_event(const char* category, const char* name, bigtime_t start,
+	bigtime_t duration, const char* argument)
+{
+	TraceBuffer* buffer = current_buffer();
+	if (buffer == NULL)
+		return;
+
+	TraceEvent& event = buffer->events[buffer->count % kEventsPerThread];
+	event.category = category;
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+	if (argument != NULL)
+		strlcpy(event.argument, argument, sizeof(event.argument));
+	else
+		event.argument[0] = '\0';
+
+	// Publish the event only after it has been completely written, a
+	// concurrent Dump() then never sees a half filled slot at the end.
+	atomic_add(&buffer->count, 1);
+}
+
+
+/*!	Copies the events of \a buffer into \a snapshot, and returns the index
+	of the first and the end of the valid ones. The owning thread keeps
+	recording meanwhile; once it wraps around, it overwrites the oldest
+	events, so those that may have changed while they were copied are
+	dropped.
+*/
+static void
+snapshot_buffer(const TraceBuffer* buffer, TraceEvent* snapshot,
+	int32& first, int32& end)
+{
+	end = atomic_get((int32*)&buffer->count);
+	first = end > kEventsPerThread ? end - kEventsPerThread : 0;
+	for (int32 i = first; i < end; i++)
+		snapshot[i % kEventsPerThread] = buffer->events[i % kEventsPerThread];
+
+	// The writer may be filling the slot of the event after the last one
+	// published, which held the event kEventsPerThread before it.
+	int32 count = atomic_get((int32*)&buffer->count);
+	first = std::max(first, count - kEventsPerThread + 1);
+}
+
+
+static void
+append_escaped(BString& output, const char* text)
+{
+	for (; *text != '\0'; text++) {
+		switch (*text) {
+			case '"':
+				output << "\\\"";
+				break;
+			case '\\':
+				output << "\\\\";
+				break;
+			case '\n':
+				output << "\\n";
+				break;
+			default:
+				if ((uint8)*text < 0x20) {
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", *text);
+					output << escaped;
+				} else
+					output << *text;
+				break;
+		}
+	}
+}
+
+
+// #pragma mark - TraceLog
+
+
+/*static*/ void
+TraceLog::Instant(const char* category, const char* name,
+	const char* argument)
+{
+	record_event(category, name, system_time(), -1, argument);
+}
+
+
+/*static*/ void
+TraceLog::Complete(const char* category, const char* name, bigtime_t start,
+	bigtime_t duration, const char* argument)
+{
+	record_event(category, name, start, duration, argument);
+}
+
+
+/*!	Writes all recorded events as a Chrome trace event JSON file.
+*/
+/*static*/ status_t
+TraceLog::Dump(const char* path)
+{
+	BFile file(path, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	TraceEvent* snapshot = new(std::nothrow) TraceEvent[kEventsPerThread];
+	if (snapshot == NULL)
+		return B_NO_MEMORY;
+
+	team_id team = getpid();
+	bigtime_t origin = trace_origin();
+	BString output("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	bool first = true;
+
+	BAutolock _(buffers_lock());
+	for (TraceBuffer* buffer = sBuffers; buffer != NULL;
+			buffer = buffer->next) {
+		if (!first)
+			output << ",";
+		first = false;
+
+		output << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << team
+			<< ",\"tid\":" << buffer->thread << ",\"args\":{\"name\":\"";
+		append_escaped(output, buffer->threadName);
+		output << "\"}}";
+
+		int32 firstEvent;
+		int32 endEvent;
+		snapshot_buffer(buffer, snapshot, firstEvent, endEvent);
+		for (int32 i = firstEvent; i < endEvent; i++) {
+			const TraceEvent& event = snapshot[i % kEventsPerThread];
+			output << ",\n{\"cat\":\"" << event.category << "\",\"name\":\"";
+			append_escaped(output, event.name);
+			output << "\",\"pid\":" << team << ",\"tid\":" << buffer->thread
+				<< ",\"ts\":" << event.start - origin;
+			if (event.duration >= 0)
+				output << ",\"ph\":\"X\",\"dur\":" << event.duration;
+			else
+				output << ",\"ph\":\"i\",\"s\":\"t\"";
+			if (event.argument[0] != '\0') {
+				output << ",\"args\":{\"detail\":\"";
+				append_escaped(output, event.argument);
+				output << "\"}";
+			}
+			output << "}";
+		}
+
+		// Flush each thread separately to keep the buffer small.
+		ssize_t written = file.Write(output.String(), output.Length());
+		if (written < 0) {
+			delete[] snapshot;
+			return written;
+		}
+		output.Truncate(0);
+	}
+	delete[] snapshot;
+
+	output << "\n]}\n";
+	ssize_t written = file.Write(output.String(), output.Length());
+	return written < 0 ? written : B_OK;
+}
+
+
+/*!	Writes the trace into a new file in the temporary directory, and
+	returns its location in \a path.
+*/
+/*static*/ status_t
+TraceLog::Dump(BPath& path)
+{
+	status_t status = find_directory(B_SYSTEM_TEMP_DIRECTORY, &path);
+	if (status != B_OK)
+		return status;
+
+	BString name;
+	name.SetToFormat("WebPositive-trace-%" B_PRId32 "-%" B_PRIdBIGTIME ".json",
+		getpid(), system_time() - trace_origin());
+	status = path.Append(name.String());
+	if (status != B_OK)
+		return status;
+
+	return Dump(path.Path());
+}
+
+
+/*static*/ status_t
+TraceLog::DumpIfRequested()
+{
+	const char* path = getenv(kTraceFileVariable);
+	if (path == NULL || path[0] == '\0')
+		return B_OK;
+
+	status_t status = Dump(path);
+	if (status != B_OK) {
+		fprintf(stderr, "Failed to write trace to %s: %s\n", path,
+			strerror(status));
+	}
+	return status;
+}
+
+
+// #pragma mark - TraceSpan
+
+
+TraceSpan::TraceSpan(const char* category, const char* name,
+	const char* argument)
+	:
+	fCategory(category),
+	fName(name),
+	fArgument(argument)
+{
+	// Make sure the origin of the trace isn't after the start of the span.
+	trace_origin();
+	fStart = system_time();
+}
+
+
+TraceSpan::~TraceSpan()
+{
+	End();
+}
+
+
+void
+TraceSpan::End()
+{
+	if (fName == NULL)
+		return;
+
+	record_event(fCategory, fName, fStart, system_time() - fStart, fArgument);
+	fName = NULL;
+}
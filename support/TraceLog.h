@@ -0,0 +1,58 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef TRACE_LOG_H
+#define TRACE_LOG_H
+
+
+#include <OS.h>
+#include <SupportDefs.h>
+
+
+class BPath;
+
+
+/*!	Minimal always-on tracing. Every thread records into its own ring
+	buffer, so recording never takes a lock. When a thread exits, its
+	buffer is handed on to the next thread that starts tracing. The
+	collected events can be written out in the Chrome trace event format
+	(load the file in chrome://tracing or Perfetto).
+
+	Category and name must be string literals, only the optional argument
+	is copied. The argument of a TraceSpan is copied when the span ends.
+*/
+class TraceLog {
+public:
+	static	void				Instant(const char* category,
+									const char* name,
+									const char* argument = NULL);
+	static	void				Complete(const char* category,
+									const char* name, bigtime_t start,
+									bigtime_t duration,
+									const char* argument = NULL);
+
+	static	status_t			Dump(const char* path);
+	static	status_t			Dump(BPath& path);
+	static	status_t			DumpIfRequested();
+};
+
+
+class TraceSpan {
+public:
+								TraceSpan(const char* category,
+									const char* name,
+									const char* argument = NULL);
+								~TraceSpan();
+
+			void				End();
+
+private:
+			const char*			fCategory;
+			const char*			fName;
+			const char*			fArgument;
+			bigtime_t			fStart;
+};
+
+
+#endif // TRACE_LOG_H
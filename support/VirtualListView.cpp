@@ -0,0 +1,285 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "VirtualListView.h"
+
+#include <algorithm>
+
+#include <ScrollBar.h>
+#include <Window.h>
+
+
+VirtualListView::VirtualListView(const char* name, BMessage* invocationMessage)
+	:
+	BView(name, B_WILL_DRAW | B_NAVIGABLE | B_FRAME_EVENTS),
+	BInvoker(invocationMessage, NULL),
+	fItemCount(0),
+	fItemHeight(20),
+	fSelection(-1)
+{
+	SetViewUIColor(B_LIST_BACKGROUND_COLOR);
+	SetLowUIColor(B_LIST_BACKGROUND_COLOR);
+}
+
+
+VirtualListView::~VirtualListView()
+{
+}
+
+
+void
+VirtualListView::AttachedToWindow()
+{
+	BView::AttachedToWindow();
+	if (Target() == NULL)
+		SetTarget(Window());
+	_UpdateScrollBar();
+}
+
+
+void
+VirtualListView::Draw(BRect updateRect)
+{
+	// Only the items intersecting the update rect are drawn.
+	int32 first = std::max((int32)0, (int32)(updateRect.top / fItemHeight));
+	int32 last = std::min(fItemCount - 1,
+		(int32)(updateRect.bottom / fItemHeight));
+
+	for (int32 i = first; i <= last; i++)
+		DrawItem(i, ItemFrame(i), i == fSelection);
+
+	BRect rest(Bounds());
+	rest.top = fItemCount * fItemHeight;
+	if (rest.IsValid() && rest.Intersects(updateRect))
+		FillRect(rest & updateRect, B_SOLID_LOW);
+}
+
+
+void
+VirtualListView::FrameResized(float width, float height)
+{
+	BView::FrameResized(width, height);
+	_UpdateScrollBar();
+}
+
+
+void
+VirtualListView::MouseDown(BPoint where)
+{
+	MakeFocus(true);
+
+	int32 index = (int32)(where.y / fItemHeight);
+	if (index < 0 || index >= fItemCount)
+		return;
+
+	int32 clicks = 1;
+	if (Window() != NULL && Window()->CurrentMessage() != NULL)
+		Window()->CurrentMessage()->FindInt32("clicks", &clicks);
+
+	if (clicks > 1 && index == fSelection)
+		InvokeSelection();
+	else
+		Select(index);
+}
+
+
+void
+VirtualListView::KeyDown(const char* bytes, int32 numBytes)
+{
+	int32 pageItems = std::max((int32)1,
+		(int32)(Bounds().Height() / fItemHeight));
+
+	switch (bytes[0]) {
+		case B_UP_ARROW:
+			Select(std::max(fSelection - 1, (int32)0));
+			break;
+		case B_DOWN_ARROW:
+			Select(fSelection + 1);
+			break;
+		case B_PAGE_UP:
+			Select(std::max(fSelection - pageItems, (int32)0));
+			break;
+		case B_PAGE_DOWN:
+			Select(fSelection + pageItems);
+			break;
+		case B_HOME:
+			Select(0);
+			break;
+		case B_END:
+			Select(fItemCount - 1);
+			break;
+		case B_ENTER:
+			InvokeSelection();
+			break;
+		default:
+			BView::KeyDown(bytes, numBytes);
+			break;
+	}
+}
+
+
+void
+VirtualListView::TargetedByScrollView(BScrollView* scrollView)
+{
+	BView::TargetedByScrollView(scrollView);
+	_UpdateScrollBar();
+}
+
+
+/*!	Sets the number of items, and selects the first one. Only the visible
+	items are redrawn.
+*/
+void
+VirtualListView::SetItemCount(int32 count)
+{
+	fItemCount = std::max(count, (int32)0);
+	fSelection = fItemCount > 0 ? 0 : -1;
+
+	_UpdateScrollBar();
+	ScrollTo(0, 0);
+	Invalidate();
+}
+
+
+/*!	Updates the list after \a count items were inserted at \a index. Unlike
+	SetItemCount(), this keeps the selection and the scroll position, and
+	only redraws the items that moved.
+*/
+void
+VirtualListView::ItemsInserted(int32 index, int32 count)
+{
+	if (count <= 0)
+		return;
+
+	fItemCount += count;
+	if (fSelection >= index)
+		fSelection += count;
+
+	_UpdateScrollBar();
+	BRect dirty(Bounds());
+	dirty.top = std::max(dirty.top, index * fItemHeight);
+	if (dirty.IsValid())
+		Invalidate(dirty);
+}
+
+
+/*!	Updates the list after \a count items were removed at \a index. The
+	selection stays on the same item, or moves to the next one if it was
+	removed.
+*/
+void
+VirtualListView::ItemsRemoved(int32 index, int32 count)
+{
+	count = std::min(count, fItemCount - index);
+	if (count <= 0)
+		return;
+
+	fItemCount -= count;
+	if (fSelection >= index + count)
+		fSelection -= count;
+	else if (fSelection >= index)
+		fSelection = std::min(index, fItemCount - 1);
+
+	_UpdateScrollBar();
+	BRect dirty(Bounds());
+	dirty.top = std::max(dirty.top, index * fItemHeight);
+	if (dirty.IsValid())
+		Invalidate(dirty);
+}
+
+
+void
+VirtualListView::InvalidateItem(int32 index)
+{
+	if (index >= 0 && index < fItemCount)
+		Invalidate(ItemFrame(index));
+}
+
+
+void
+VirtualListView::SetItemHeight(float height)
+{
+	if (height < 1)
+		height = 1;
+	fItemHeight = height;
+
+	_UpdateScrollBar();
+	Invalidate();
+}
+
+
+BRect
+VirtualListView::ItemFrame(int32 index) const
+{
+	BRect frame(Bounds());
+	frame.top = index * fItemHeight;
+	frame.bottom = frame.top + fItemHeight - 1;
+	return frame;
+}
+
+
+void
+VirtualListView::Select(int32 index)
+{
+	if (index >= fItemCount)
+		index = fItemCount - 1;
+	if (index == fSelection)
+		return;
+
+	if (fSelection >= 0)
+		Invalidate(ItemFrame(fSelection));
+	fSelection = index;
+	if (fSelection >= 0)
+		Invalidate(ItemFrame(fSelection));
+
+	ScrollToSelection();
+}
+
+
+void
+VirtualListView::ScrollToSelection()
+{
+	if (fSelection < 0)
+		return;
+
+	BRect frame = ItemFrame(fSelection);
+	BRect bounds = Bounds();
+	if (frame.top < bounds.top)
+		ScrollTo(0, frame.top);
+	else if (frame.bottom > bounds.bottom)
+		ScrollTo(0, frame.bottom - bounds.Height());
+}
+
+
+void
+VirtualListView::InvokeSelection()
+{
+	if (fSelection < 0 || Message() == NULL)
+		return;
+
+	BMessage message(*Message());
+	message.AddInt32("index", fSelection);
+	Invoke(&message);
+}
+
+
+// #pragma mark - private
+
+
+void
+VirtualListView::_UpdateScrollBar()
+{
+	BScrollBar* scrollBar = ScrollBar(B_VERTICAL);
+	if (scrollBar == NULL)
+		return;
+
+	float totalHeight = fItemCount * fItemHeight;
+	float visibleHeight = Bounds().Height();
+	scrollBar->SetRange(0, std::max(totalHeight - visibleHeight, 0.0f));
+	scrollBar->SetProportion(totalHeight > 0
+		? std::min(visibleHeight / totalHeight, 1.0f) : 1.0f);
+	scrollBar->SetSteps(fItemHeight, std::max(visibleHeight - fItemHeight,
+		fItemHeight));
+}
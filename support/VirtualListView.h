@@ -0,0 +1,66 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef VIRTUAL_LIST_VIEW_H
+#define VIRTUAL_LIST_VIEW_H
+
+
+#include <Invoker.h>
+#include <View.h>
+
+
+/*!	A list view that has no item objects. It only knows the number of items,
+	and subclasses draw the items that are currently visible, directly from
+	their own data. This keeps long lists cheap to fill and to update.
+
+	The invocation message is sent with the index of the selected item in
+	the "index" field, on double click and when Enter is pressed.
+*/
+class VirtualListView : public BView, public BInvoker {
+public:
+								VirtualListView(const char* name,
+									BMessage* invocationMessage = NULL);
+	virtual						~VirtualListView();
+
+	virtual	void				AttachedToWindow();
+	virtual	void				Draw(BRect updateRect);
+	virtual	void				FrameResized(float width, float height);
+	virtual	void				MouseDown(BPoint where);
+	virtual	void				KeyDown(const char* bytes, int32 numBytes);
+	virtual	void				TargetedByScrollView(BScrollView* scrollView);
+
+			void				SetItemCount(int32 count);
+			int32				CountItems() const
+									{ return fItemCount; }
+			void				ItemsInserted(int32 index, int32 count);
+			void				ItemsRemoved(int32 index, int32 count);
+			void				InvalidateItem(int32 index);
+
+			void				SetItemHeight(float height);
+			float				ItemHeight() const
+									{ return fItemHeight; }
+			BRect				ItemFrame(int32 index) const;
+
+			void				Select(int32 index);
+			int32				CurrentSelection() const
+									{ return fSelection; }
+			void				ScrollToSelection();
+
+			void				InvokeSelection();
+
+protected:
+	virtual	void				DrawItem(int32 index, BRect frame,
+									bool selected) = 0;
+
+private:
+			void				_UpdateScrollBar();
+
+private:
+			int32				fItemCount;
+			float				fItemHeight;
+			int32				fSelection;
+};
+
+
+#endif // VIRTUAL_LIST_VIEW_H
@@ -9,6 +9,8 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+
 #include <Application.h>
 #include <AbstractLayoutItem.h>
 #include <Bitmap.h>
@@ -33,12 +35,14 @@ static const float kLeftTabInset = 4;
 TabContainerView::TabContainerView(Controller* controller)
 	:
 	BGroupView(B_HORIZONTAL, 0.0),
+	fValidTabOffsets(0),
 	fLastMouseEventTab(NULL),
 	fMouseDown(false),
 	fClickCount(0),
 	fSelectedTab(NULL),
 	fController(controller),
-	fFirstVisibleTabIndex(0)
+	fFirstVisibleTabIndex(0),
+	fRenderGeneration(0)
 {
 	SetFlags(Flags() | B_WILL_DRAW | B_FULL_UPDATE_ON_RESIZE);
 	SetViewColor(B_TRANSPARENT_COLOR);
@@ -49,6 +53,10 @@ TabContainerView::TabContainerView(Controller* controller)
 
 TabContainerView::~TabContainerView()
 {
+	for (size_t i = 0; i < fTabs.size(); i++) {
+		fTabs[i]->SetContainerView(NULL);
+		delete fTabs[i];
+	}
 }
 
 
@@ -66,6 +74,11 @@ void
 TabContainerView::MessageReceived(BMessage* message)
 {
 	switch (message->what) {
+		case B_COLORS_UPDATED:
+			InvalidateTabs();
+			BGroupView::MessageReceived(message);
+			break;
+
 		default:
 			BGroupView::MessageReceived(message);
 	}
@@ -75,26 +88,38 @@ TabContainerView::MessageReceived(BMessage* message)
 void
 TabContainerView::Draw(BRect updateRect)
 {
-	// draw tab frame
-	BRect rect(Bounds());
-	rgb_color base = ui_color(B_PANEL_BACKGROUND_COLOR);
-	uint32 borders = BControlLook::B_TOP_BORDER
-		| BControlLook::B_BOTTOM_BORDER;
-	be_control_look->DrawTabFrame(this, rect, updateRect, base, 0,
-		borders, B_NO_BORDER);
+	DrawBackground(this, Bounds(), updateRect);
 
-	// draw tabs on top of frame
+	// Draw tabs on top of frame, only the visible ones are in the layout,
+	// from left to right. Each tab copies the damaged part from its cache.
 	BGroupLayout* layout = GroupLayout();
 	int32 count = layout->CountItems() - 1;
 	for (int32 i = 0; i < count; i++) {
 		TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(layout->ItemAt(i));
 		if (item == NULL || !item->IsVisible())
 			continue;
-		item->Parent()->Draw(item->Frame());
+		if (item->Frame().left > updateRect.right)
+			break;
+		item->Parent()->Draw(updateRect);
 	}
 }
 
 
+/*!	Draws the tab frame for a strip at \a frame. Also used by the tabs to
+	put the strip background behind their cached bitmaps.
+*/
+void
+TabContainerView::DrawBackground(BView* owner, BRect frame,
+	const BRect& updateRect)
+{
+	rgb_color base = ui_color(B_PANEL_BACKGROUND_COLOR);
+	uint32 borders = BControlLook::B_TOP_BORDER
+		| BControlLook::B_BOTTOM_BORDER;
+	be_control_look->DrawTabFrame(owner, frame, updateRect, base, 0,
+		borders, B_NO_BORDER);
+}
+
+
 void
 TabContainerView::MouseDown(BPoint where)
 {
@@ -187,24 +212,23 @@ TabContainerView::AddTab(TabView* tab, int32 index)
 {
 	tab->SetContainerView(this);
 
-	if (index == -1)
-		index = GroupLayout()->CountItems() - 1;
+	if (index < 0 || index > CountTabs())
+		index = CountTabs();
 
-	tab->Update();
+	// The layout item is only added to the layout once the tab becomes
+	// visible, see _UpdateTabVisibility().
+	fTabs.insert(fTabs.begin() + index, tab);
+	_UpdateIndices(index);
+	_InvalidateTabOffsets(index);
 
-	GroupLayout()->AddItem(index, tab->LayoutItem());
+	tab->Update();
 
 	if (fSelectedTab == NULL)
 		SelectTab(tab);
 
-	bool isLast = index == GroupLayout()->CountItems() - 1;
-	if (isLast) {
-		TabLayoutItem* item
-			= dynamic_cast<TabLayoutItem*>(GroupLayout()->ItemAt(index - 1));
-		if (item != NULL)
-			item->Parent()->Update();
-	}
-
+	bool isLast = index == CountTabs() - 1;
+	if (isLast && index > 0)
+		fTabs[index - 1]->Update();
 
 	SetFirstVisibleTabIndex(MaxFirstVisibleTabIndex());
 	_ValidateTabVisibility();
@@ -214,42 +238,48 @@ TabContainerView::AddTab(TabView* tab, int32 index)
 TabView*
 TabContainerView::RemoveTab(int32 index)
 {
-	TabLayoutItem* item
-		= dynamic_cast<TabLayoutItem*>(GroupLayout()->RemoveItem(index));
-	if (item == NULL)
+	if (index < 0 || index >= CountTabs())
 		return NULL;
 
+	TabView* removedTab = fTabs[index];
+	BLayoutItem* removedItem = removedTab->LayoutItem();
+
 	BRect dirty(Bounds());
-	dirty.left = item->Frame().left;
-	TabView* removedTab = item->Parent();
+	if (removedItem->Layout() == GroupLayout()) {
+		dirty.left = removedItem->Frame().left;
+		GroupLayout()->RemoveItem(removedItem);
+	}
+
+	fTabs.erase(fTabs.begin() + index);
+	_UpdateIndices(index);
+	_InvalidateTabOffsets(index);
+
 	removedTab->SetContainerView(NULL);
+	removedTab->fIndex = -1;
 
 	if (removedTab == fLastMouseEventTab)
 		fLastMouseEventTab = NULL;
 
 	// Update tabs after or before the removed tab.
-	item = dynamic_cast<TabLayoutItem*>(GroupLayout()->ItemAt(index));
-	if (item != NULL) {
+	if (index < CountTabs()) {
 		// This tab is behind the removed tab.
-		TabView* tab = item->Parent();
+		TabView* tab = fTabs[index];
 		tab->Update();
 		if (removedTab == fSelectedTab) {
 			fSelectedTab = NULL;
 			SelectTab(tab);
 		} else if (fController != NULL && tab == fSelectedTab)
 			fController->UpdateSelection(index);
-	} else {
+	} else if (index > 0) {
 		// The removed tab was the last tab.
-		item = dynamic_cast<TabLayoutItem*>(GroupLayout()->ItemAt(index - 1));
-		if (item != NULL) {
-			TabView* tab = item->Parent();
-			tab->Update();
-			if (removedTab == fSelectedTab) {
-				fSelectedTab = NULL;
-				SelectTab(tab);
-			}
+		TabView* tab = fTabs[index - 1];
+		tab->Update();
+		if (removedTab == fSelectedTab) {
+			fSelectedTab = NULL;
+			SelectTab(tab);
 		}
-	}
+	} else if (removedTab == fSelectedTab)
+		fSelectedTab = NULL;
 
 	Invalidate(dirty);
 	_ValidateTabVisibility();
@@ -261,35 +291,27 @@ TabContainerView::RemoveTab(int32 index)
 TabView*
 TabContainerView::TabAt(int32 index) const
 {
-	TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(
-		GroupLayout()->ItemAt(index));
-	if (item != NULL)
-		return item->Parent();
+	if (index < 0 || index >= CountTabs())
+		return NULL;
 
-	return NULL;
+	return fTabs[index];
 }
 
 
 int32
 TabContainerView::IndexOf(TabView* tab) const
 {
-	if (tab == NULL || GroupLayout() == NULL)
+	if (tab == NULL || tab->ContainerView() != this)
 		return -1;
 
-	return GroupLayout()->IndexOfItem(tab->LayoutItem());
+	return tab->fIndex;
 }
 
 
 void
 TabContainerView::SelectTab(int32 index)
 {
-	TabView* tab = NULL;
-	TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(
-		GroupLayout()->ItemAt(index));
-	if (item != NULL)
-		tab = item->Parent();
-
-	SelectTab(tab);
+	SelectTab(TabAt(index));
 }
 
 
@@ -309,12 +331,12 @@ TabContainerView::SelectTab(TabView* tab)
 	if (fSelectedTab != NULL)
 		fSelectedTab->Update();
 
-	int32 index = -1;
-	if (fSelectedTab != NULL)
-		index = GroupLayout()->IndexOfItem(tab->LayoutItem());
+	int32 index = IndexOf(fSelectedTab);
 
-	if (!tab->LayoutItem()->IsVisible())
+	if (fSelectedTab != NULL
+		&& fSelectedTab->LayoutItem()->Layout() != GroupLayout()) {
 		SetFirstVisibleTabIndex(index);
+	}
 
 	if (fController != NULL)
 		fController->UpdateSelection(index);
@@ -324,12 +346,11 @@ TabContainerView::SelectTab(TabView* tab)
 void
 TabContainerView::SetTabLabel(int32 index, const char* label)
 {
-	TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(
-		GroupLayout()->ItemAt(index));
-	if (item == NULL)
+	TabView* tab = TabAt(index);
+	if (tab == NULL)
 		return;
 
-	item->Parent()->SetLabel(label);
+	tab->SetLabel(label);
 }
 
 
@@ -362,26 +383,13 @@ TabContainerView::MaxFirstVisibleTabIndex() const
 	float availableWidth = _AvailableWidthForTabs();
 	if (availableWidth < 0)
 		return 0;
-	float visibleTabsWidth = 0;
-
-	BGroupLayout* layout = GroupLayout();
-	int32 i = layout->CountItems() - 2;
-	for (; i >= 0; i--) {
-		TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(
-			layout->ItemAt(i));
-		if (item == NULL)
-			continue;
-
-		float itemWidth = item->MinSize().width;
-		if (availableWidth >= visibleTabsWidth + itemWidth)
-			visibleTabsWidth += itemWidth;
-		else {
-			// The tab before this tab is the last one that can be visible.
-			return i + 1;
-		}
-	}
 
-	return 0;
+	// The first tab from which all remaining tabs still fit.
+	_ValidateTabOffsets();
+	float totalWidth = fTabOffsets[CountTabs()];
+	return std::lower_bound(fTabOffsets.begin(),
+		fTabOffsets.begin() + CountTabs() + 1, totalWidth - availableWidth)
+		- fTabOffsets.begin();
 }
 
 
@@ -395,14 +403,22 @@ TabContainerView::CanScrollLeft() const
 bool
 TabContainerView::CanScrollRight() const
 {
-	BGroupLayout* layout = GroupLayout();
-	int32 count = layout->CountItems() - 1;
-	if (count > 0) {
-		TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(
-			layout->ItemAt(count - 1));
-		return !item->IsVisible();
-	}
-	return false;
+	if (CountTabs() == 0)
+		return false;
+
+	return fTabs[CountTabs() - 1]->LayoutItem()->Layout() != GroupLayout();
+}
+
+
+/*!	Makes all tabs render themselves again, for changes that affect every
+	tab, like the colors. Takes constant time, the tabs notice it when they
+	are drawn next.
+*/
+void
+TabContainerView::InvalidateTabs()
+{
+	fRenderGeneration++;
+	Invalidate();
 }
 
 
@@ -412,19 +428,32 @@ TabContainerView::CanScrollRight() const
 TabView*
 TabContainerView::_TabAt(const BPoint& where) const
 {
+	// The layout only contains the visible tabs from left to right, followed
+	// by the glue item, so the tab under the mouse can be searched for.
 	BGroupLayout* layout = GroupLayout();
-	int32 count = layout->CountItems() - 1;
-	for (int32 i = 0; i < count; i++) {
-		TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(layout->ItemAt(i));
-		if (item == NULL || !item->IsVisible())
-			continue;
-		// Account for the fact that the tab frame does not contain the
-		// visible bottom border.
-		BRect frame = item->Frame();
-		frame.bottom++;
-		if (frame.Contains(where))
-			return item->Parent();
+	int32 lower = 0;
+	int32 upper = layout->CountItems() - 1;
+	if (upper <= 0)
+		return NULL;
+	upper--;
+	while (lower < upper) {
+		int32 middle = (lower + upper) / 2;
+		if (layout->ItemAt(middle)->Frame().right < where.x)
+			lower = middle + 1;
+		else
+			upper = middle;
 	}
+
+	TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(layout->ItemAt(lower));
+	if (item == NULL)
+		return NULL;
+
+	// Account for the fact that the tab frame does not contain the
+	// visible bottom border.
+	BRect frame = item->Frame();
+	frame.bottom++;
+	if (frame.Contains(where))
+		return item->Parent();
 	return NULL;
 }
 
@@ -474,27 +503,43 @@ TabContainerView::_UpdateTabVisibility()
 	float availableWidth = _AvailableWidthForTabs();
 	if (availableWidth < 0)
 		return;
-	float visibleTabsWidth = 0;
 
-	bool canScrollTabsLeft = fFirstVisibleTabIndex > 0;
-	bool canScrollTabsRight = false;
+	_ValidateTabOffsets();
+
+	// Find the range of tabs that fit, starting at the first visible one.
+	int32 count = CountTabs();
+	int32 first = std::min(fFirstVisibleTabIndex, count);
+	int32 end = std::upper_bound(fTabOffsets.begin() + first,
+		fTabOffsets.begin() + count + 1, fTabOffsets[first] + availableWidth)
+		- fTabOffsets.begin() - 1;
+
+	bool canScrollTabsLeft = first > 0;
+	bool canScrollTabsRight = end < count;
 
+	// Only the visible tabs have their items in the layout, so that the
+	// layout work does not grow with the number of tabs. Remove the items
+	// of tabs that went out of view, then insert the ones that came into
+	// view, keeping the order of the tabs.
 	BGroupLayout* layout = GroupLayout();
-	int32 count = layout->CountItems() - 1;
-	for (int32 i = 0; i < count; i++) {
+	for (int32 i = layout->CountItems() - 1; i >= 0; i--) {
 		TabLayoutItem* item = dynamic_cast<TabLayoutItem*>(
 			layout->ItemAt(i));
-		if (i < fFirstVisibleTabIndex)
-			item->SetVisible(false);
-		else {
-			float itemWidth = item->MinSize().width;
-			bool visible = availableWidth >= visibleTabsWidth + itemWidth;
-			item->SetVisible(visible && !canScrollTabsRight);
-			visibleTabsWidth += itemWidth;
-			if (!visible)
-				canScrollTabsRight = true;
+		if (item == NULL)
+			continue;
+		int32 index = IndexOf(item->Parent());
+		if (index < first || index >= end) {
+			layout->RemoveItem(i);
+			// Forget the frame, so the tab is drawn when it comes back.
+			item->SetFrame(BRect());
+			item->Parent()->_DiscardCache();
 		}
 	}
+	for (int32 i = first; i < end; i++) {
+		BLayoutItem* item = fTabs[i]->LayoutItem();
+		if (layout->ItemAt(i - first) != item)
+			layout->AddItem(i - first, item);
+	}
+
 	fController->UpdateTabScrollability(canScrollTabsLeft, canScrollTabsRight);
 }
 
@@ -523,3 +568,37 @@ TabContainerView::_SendFakeMouseMoved()
 	if (Bounds().Contains(where))
 		_MouseMoved(where, B_INSIDE_VIEW, NULL);
 }
+
+
+void
+TabContainerView::_UpdateIndices(int32 from)
+{
+	for (int32 i = from; i < CountTabs(); i++)
+		fTabs[i]->fIndex = i;
+}
+
+
+void
+TabContainerView::_InvalidateTabOffsets(int32 from)
+{
+	// Offsets up to and including the one of the changed tab stay valid.
+	fValidTabOffsets = std::min(fValidTabOffsets, from + 1);
+}
+
+
+void
+TabContainerView::_ValidateTabOffsets() const
+{
+	int32 count = CountTabs();
+	fTabOffsets.resize(count + 1);
+	if (fValidTabOffsets < 1) {
+		fTabOffsets[0] = 0;
+		fValidTabOffsets = 1;
+	}
+
+	// Only recompute the sums after the first changed tab, appending a tab
+	// is therefore constant time.
+	for (int32 i = fValidTabOffsets; i <= count; i++)
+		fTabOffsets[i] = fTabOffsets[i - 1] + fTabs[i - 1]->MinSize().width;
+	fValidTabOffsets = count + 1;
+}
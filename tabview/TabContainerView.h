@@ -8,6 +8,8 @@
 
 #include <GroupView.h>
 
+#include <vector>
+
 
 class TabView;
 
@@ -34,6 +36,8 @@ public:
 	virtual	void				MessageReceived(BMessage*);
 
 	virtual	void				Draw(BRect updateRect);
+			void				DrawBackground(BView* owner, BRect frame,
+									const BRect& updateRect);
 
 	virtual	void				MouseDown(BPoint where);
 	virtual	void				MouseUp(BPoint where);
@@ -46,13 +50,14 @@ public:
 			void				AddTab(TabView* tab, int32 index = -1);
 			TabView*			RemoveTab(int32 index);
 			TabView*			TabAt(int32 index) const;
+			int32				CountTabs() const
+									{ return fTabs.size(); };
 
 			int32				IndexOf(TabView* tab) const;
 
 			int32				FirstTabIndex() { return 0; };
 			int32				LastTabIndex()
-									{ return GroupLayout() == NULL ? -1
-										: GroupLayout()->CountItems() - 1; };
+									{ return CountTabs() - 1; };
 			int32				SelectedTabIndex()
 									{ return fSelectedTab == NULL ? -1
 										: IndexOf(fSelectedTab); };
@@ -71,6 +76,10 @@ public:
 			bool				CanScrollLeft() const;
 			bool				CanScrollRight() const;
 
+			void				InvalidateTabs();
+			uint32				RenderGeneration() const
+									{ return fRenderGeneration; };
+
 private:
 			TabView*			_TabAt(const BPoint& where) const;
 			void				_MouseMoved(BPoint where, uint32 transit,
@@ -80,13 +89,25 @@ private:
 			float				_AvailableWidthForTabs() const;
 			void				_SendFakeMouseMoved();
 
+			void				_UpdateIndices(int32 from);
+			void				_InvalidateTabOffsets(int32 from);
+			void				_ValidateTabOffsets() const;
+
 private:
+			std::vector<TabView*> fTabs;
+			mutable std::vector<float> fTabOffsets;
+				// fTabOffsets[i] is the summed minimum width of the tabs
+				// before tab i, with one extra entry for the total.
+			mutable int32		fValidTabOffsets;
+
 			TabView*			fLastMouseEventTab;
 			bool				fMouseDown;
 			uint32				fClickCount;
 			TabView*			fSelectedTab;
 			Controller*			fController;
 			int32				fFirstVisibleTabIndex;
+			uint32				fRenderGeneration;
+				// cached tab bitmaps from older generations are stale
 };
 
 #endif // TAB_CONTAINER_VIEW_H
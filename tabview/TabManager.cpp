@@ -26,6 +26,7 @@
 #include <SpaceLayoutItem.h>
 #include <Window.h>
 
+#include "FaviconStore.h"
 #include "TabContainerView.h"
 #include "TabView.h"
 
@@ -257,7 +258,7 @@ public:
 			case MSG_OPEN_TAB_MENU:
 			{
 				BPopUpMenu* tabMenu = new BPopUpMenu("tab menu", true, false);
-				int tabCount = fTabContainerView->GetLayout()->CountItems();
+				int tabCount = fTabContainerView->CountTabs();
 				for (int i = 0; i < tabCount; i++) {
 					TabView* tab = fTabContainerView->TabAt(i);
 					if (tab != NULL) {
@@ -444,14 +445,16 @@ public:
 	virtual void MouseMoved(BPoint where, uint32 transit,
 		const BMessage* dragMessage);
 
-	void SetIcon(const BBitmap* icon);
+	void SetIcon(Favicon* icon);
 
 private:
 	void _DrawCloseButton(BView* owner, BRect& frame, const BRect& updateRect);
 	BRect _CloseRectFrame(BRect frame) const;
 
 private:
-	BBitmap* fIcon;
+	BReference<Favicon> fFavicon;
+	const BBitmap* fIcon;
+		// the bitmap of fFavicon, shared with the other tabs of the site
 	TabManagerController* fController;
 	bool fOverCloseRect;
 	bool fClicked;
@@ -471,7 +474,6 @@ WebTabView::WebTabView(TabManagerController* controller)
 
 WebTabView::~WebTabView()
 {
-	delete fIcon;
 }
 
 
@@ -551,6 +553,7 @@ WebTabView::MouseDown(BPoint where, uint32 buttons)
 	}
 
 	fClicked = true;
+	InvalidateCache();
 	ContainerView()->Invalidate(closeRect);
 }
 
@@ -580,6 +583,7 @@ WebTabView::MouseMoved(BPoint where, uint32 transit,
 	if (overCloseRect != fOverCloseRect
 		&& fController->CloseButtonsAvailable()) {
 		fOverCloseRect = overCloseRect;
+		InvalidateCache();
 		ContainerView()->Invalidate(closeRect);
 	}
 
@@ -591,13 +595,11 @@ WebTabView::MouseMoved(BPoint where, uint32 transit,
 
 
 void
-WebTabView::SetIcon(const BBitmap* icon)
+WebTabView::SetIcon(Favicon* icon)
 {
-	delete fIcon;
-	if (icon)
-		fIcon = new BBitmap(icon);
-	else
-		fIcon = NULL;
+	fFavicon.SetTo(icon);
+	fIcon = icon != NULL ? icon->Bitmap() : NULL;
+	Update();
 	LayoutItem()->InvalidateLayout();
 }
 
@@ -829,13 +831,11 @@ TabManager::ViewForTab(int32 tabIndex) const
 int32
 TabManager::TabForView(const BView* containedView) const
 {
-	int32 count = fCardLayout->CountItems();
-	for (int32 i = 0; i < count; i++) {
-		BLayoutItem* item = fCardLayout->ItemAt(i);
-		if (item->View() == containedView)
-			return i;
-	}
-	return -1;
+	std::unordered_map<const BView*, TabView*>::const_iterator found
+		= fTabsByView.find(containedView);
+	if (found == fTabsByView.end())
+		return -1;
+	return fTabContainerView->IndexOf(found->second);
 }
 
 
@@ -886,8 +886,12 @@ TabManager::CloseTab(int32 tabIndex)
 void
 TabManager::AddTab(BView* view, const char* label, int32 index)
 {
+	if (index < 0 || index > CountTabs())
+		index = CountTabs();
+
 	fTabContainerView->AddTab(label, index);
 	fCardLayout->AddView(index, view);
+	fTabsByView[view] = fTabContainerView->TabAt(index);
 }
 
 
@@ -906,11 +910,39 @@ TabManager::RemoveTab(int32 index)
 	delete tab;
 
 	BView* view = item->View();
+	fTabsByView.erase(view);
 	delete item;
 	return view;
 }
 
 
+/*!	Swaps the view shown for a tab, while leaving the tab itself alone.
+	Returns the previous view, which is removed from the layout but not
+	deleted.
+*/
+BView*
+TabManager::ReplaceView(int32 index, BView* view)
+{
+	bool visible = fCardLayout->VisibleIndex() == index;
+
+	BLayoutItem* item = fCardLayout->RemoveItem(index);
+	if (item == NULL)
+		return NULL;
+
+	BView* oldView = item->View();
+	delete item;
+	oldView->RemoveSelf();
+
+	fTabsByView.erase(oldView);
+	fTabsByView[view] = fTabContainerView->TabAt(index);
+
+	fCardLayout->AddView(index, view);
+	if (visible)
+		fCardLayout->SetVisibleItem(index);
+	return oldView;
+}
+
+
 int32
 TabManager::CountTabs() const
 {
@@ -935,10 +967,14 @@ TabManager::TabLabel(int32 tabIndex)
 }
 
 void
-TabManager::SetTabIcon(const BView* containedView, const BBitmap* icon)
+TabManager::SetTabIcon(const BView* containedView, Favicon* icon)
 {
-	WebTabView* tab = dynamic_cast<WebTabView*>(fTabContainerView->TabAt(
-		TabForView(containedView)));
+	std::unordered_map<const BView*, TabView*>::const_iterator found
+		= fTabsByView.find(containedView);
+	if (found == fTabsByView.end())
+		return;
+
+	WebTabView* tab = dynamic_cast<WebTabView*>(found->second);
 	if (tab)
 		tab->SetIcon(icon);
 }
@@ -950,5 +986,5 @@ TabManager::SetCloseButtonsAvailable(bool available)
 	if (available == fController->CloseButtonsAvailable())
 		return;
 	fController->SetCloseButtonsAvailable(available);
-	fTabContainerView->Invalidate();
+	fTabContainerView->InvalidateTabs();
 }
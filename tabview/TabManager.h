@@ -9,6 +9,8 @@
 #include <Messenger.h>
 #include <TabView.h>
 
+#include <unordered_map>
+
 enum {
 	TAB_CHANGED = 'tcha',
 	CLOSE_TAB = 'cltb'
@@ -16,12 +18,14 @@ enum {
 
 class BBitmap;
 class BCardLayout;
+class Favicon;
 class BGroupView;
 class BGroupLayout;
 class BMenu;
 class TabContainerGroup;
 class TabContainerView;
 class TabManagerController;
+class TabView;
 
 #define INTEGRATE_MENU_INTO_TAB_BAR 0
 
@@ -55,12 +59,13 @@ public:
 			void				AddTab(BView* view, const char* label,
 									int32 index = -1);
 			BView*				RemoveTab(int32 index);
+			BView*				ReplaceView(int32 index, BView* view);
 			int32				CountTabs() const;
 
 			void				SetTabLabel(int32 tabIndex, const char* label);
 	const	BString&			TabLabel(int32);
 			void				SetTabIcon(const BView* containedView,
-									const BBitmap* icon);
+									Favicon* icon);
 			void				SetCloseButtonsAvailable(bool available);
 
 private:
@@ -73,6 +78,9 @@ private:
 			BCardLayout*		fCardLayout;
 			TabManagerController* fController;
 
+			std::unordered_map<const BView*, TabView*> fTabsByView;
+				// The index of a tab is kept by the TabView itself.
+
 			BMessenger			fTarget;
 };
 
@@ -7,6 +7,7 @@
 
 #include "TabView.h"
 
+#include <new>
 #include <stdio.h>
 
 #include <Application.h>
@@ -29,16 +30,22 @@ TabView::TabView()
 	:
 	fContainerView(NULL),
 	fLayoutItem(new TabLayoutItem(this)),
-	fLabel()
+	fIndex(-1),
+	fLabel(),
+	fCache(NULL),
+	fCacheValid(false)
 {
 }
 
 
 TabView::~TabView()
 {
-	// The layout item is deleted for us by the layout which contains it.
-	if (fContainerView == NULL)
-		delete fLayoutItem;
+	// The TabContainerView only keeps the layout items of visible tabs in
+	// its layout, so the item always belongs to us.
+	if (fLayoutItem->Layout() != NULL)
+		fLayoutItem->Layout()->RemoveItem(fLayoutItem);
+	delete fLayoutItem;
+	delete fCache;
 }
 
 
@@ -67,6 +74,10 @@ TabView::MaxSize()
 }
 
 
+/*!	Draws the part of the tab within \a updateRect. The tab is rendered
+	into an offscreen bitmap once, and then only copied to the container
+	until it looks different.
+*/
 void
 TabView::Draw(BRect updateRect)
 {
@@ -74,24 +85,21 @@ TabView::Draw(BRect updateRect)
 	frame.right++;
 	frame.bottom++;
 
-	int32 index = fContainerView->IndexOf(this);
-
 	// make room for tail of last tab
-	bool isLast = index == fContainerView->LastTabIndex();
-	if (isLast)
+	if (fContainerView->IndexOf(this) == fContainerView->LastTabIndex())
 		frame.right -= 2;
 
-	DrawBackground(fContainerView, frame, updateRect);
+	BRect dirty = frame & updateRect;
+	if (!dirty.IsValid())
+		return;
 
-	bool isFront = index == fContainerView->SelectedTabIndex();
-	if (isFront)
-		frame.top += 3.0f;
-	else
-		frame.top += 6.0f;
+	if (!_ValidateCache(frame)) {
+		_Render(fContainerView, frame, updateRect);
+		return;
+	}
 
-	float spacing = be_control_look->DefaultLabelSpacing();
-	frame.InsetBy(spacing, spacing / 2);
-	DrawContents(fContainerView, frame, updateRect);
+	fContainerView->DrawBitmap(fCache,
+		dirty.OffsetByCopy(-frame.left, -frame.top), dirty);
 }
 
 
@@ -149,10 +157,22 @@ TabView::MouseMoved(BPoint where, uint32 transit, const BMessage* dragMessage)
 void
 TabView::Update()
 {
+	InvalidateCache();
 	fLayoutItem->InvalidateContainer();
 }
 
 
+/*!	Makes the tab render itself again the next time it is drawn. Subclasses
+	call this when something that changes their look, but not their size,
+	has changed. The caller still has to invalidate the area to redraw.
+*/
+void
+TabView::InvalidateCache()
+{
+	fCacheValid = false;
+}
+
+
 void
 TabView::SetContainerView(TabContainerView* containerView)
 {
@@ -181,6 +201,7 @@ TabView::SetLabel(const char* label)
 		return;
 
 	fLabel = label;
+	Update();
 	fLayoutItem->InvalidateLayout();
 }
 
@@ -208,6 +229,96 @@ TabView::_LabelHeight() const
 }
 
 
+void
+TabView::_Render(BView* owner, BRect frame, const BRect& updateRect)
+{
+	DrawBackground(owner, frame, updateRect);
+
+	bool isFront = fContainerView->IndexOf(this)
+		== fContainerView->SelectedTabIndex();
+	if (isFront)
+		frame.top += 3.0f;
+	else
+		frame.top += 6.0f;
+
+	float spacing = be_control_look->DefaultLabelSpacing();
+	frame.InsetBy(spacing, spacing / 2);
+	DrawContents(owner, frame, updateRect);
+}
+
+
+/*!	Makes sure the cached bitmap shows the tab as it has to be drawn at
+	\a frame. Besides explicit invalidation, the look of a tab depends on
+	its size and on where it is relative to the selected tab and the ends
+	of the strip, but not on its index. Selecting another tab, or adding or
+	removing one, therefore only redraws the tabs whose neighbourhood
+	changes.
+	Returns \c false if there is no cache to draw from.
+*/
+bool
+TabView::_ValidateCache(BRect frame)
+{
+	RenderState state;
+	state.width = frame.Width();
+	state.height = frame.Height();
+	int32 index = fContainerView->IndexOf(this);
+	int32 selected = fContainerView->SelectedTabIndex();
+	state.isSelected = index == selected;
+	state.isLeftOfSelected = index < selected;
+	state.isNextToSelected = index == selected - 1 || index == selected + 1;
+	state.isFirst = index == fContainerView->FirstTabIndex();
+	state.isLast = index == fContainerView->LastTabIndex();
+	state.generation = fContainerView->RenderGeneration();
+
+	if (fCache != NULL && fCacheValid && fCacheState == state)
+		return true;
+
+	BRect bounds(0, 0, frame.Width(), frame.Height());
+	if (fCache == NULL || fCache->Bounds() != bounds) {
+		delete fCache;
+		fCache = new(std::nothrow) BBitmap(bounds, B_BITMAP_ACCEPTS_VIEWS,
+			B_RGB32);
+		if (fCache == NULL || fCache->InitCheck() != B_OK) {
+			delete fCache;
+			fCache = NULL;
+			return false;
+		}
+		fCache->AddChild(new BView(bounds, "tab cache", B_FOLLOW_NONE,
+			B_WILL_DRAW));
+	}
+
+	if (!fCache->Lock())
+		return false;
+
+	BView* view = fCache->ChildAt(0);
+	BFont font;
+	fContainerView->GetFont(&font);
+	view->SetFont(&font);
+
+	// The tab is drawn on top of the strip background, which is copied
+	// along, so that the bitmap does not need an alpha channel.
+	BRect strip(fContainerView->Bounds());
+	strip.OffsetBy(-frame.left, -frame.top);
+	fContainerView->DrawBackground(view, strip, bounds);
+	_Render(view, bounds, bounds);
+	view->Sync();
+	fCache->Unlock();
+
+	fCacheState = state;
+	fCacheValid = true;
+	return true;
+}
+
+
+void
+TabView::_DiscardCache()
+{
+	delete fCache;
+	fCache = NULL;
+	fCacheValid = false;
+}
+
+
 // #pragma mark - TabLayoutItem
 
 
@@ -249,6 +360,10 @@ TabLayoutItem::Frame()
 void
 TabLayoutItem::SetFrame(BRect frame)
 {
+	// Layouting all tabs again must not repaint the ones that stay put.
+	if (frame == fFrame)
+		return;
+
 	BRect dirty = fFrame;
 	fFrame = frame;
 	dirty = dirty | fFrame;
@@ -11,6 +11,7 @@
 #include <String.h>
 
 
+class BBitmap;
 class BMessage;
 class BView;
 class TabContainerView;
@@ -38,6 +39,7 @@ public:
 									const BMessage* dragMessage);
 
 	virtual	void				Update();
+			void				InvalidateCache();
 
 			BLayoutItem*		LayoutItem() const;
 
@@ -50,13 +52,46 @@ public:
 			BRect				Frame() const;
 
 private:
+			struct RenderState {
+				float			width;
+				float			height;
+				bool			isSelected;
+				bool			isLeftOfSelected;
+				bool			isNextToSelected;
+				bool			isFirst;
+				bool			isLast;
+				uint32			generation;
+
+				bool operator==(const RenderState& other) const
+				{
+					return width == other.width && height == other.height
+						&& isSelected == other.isSelected
+						&& isLeftOfSelected == other.isLeftOfSelected
+						&& isNextToSelected == other.isNextToSelected
+						&& isFirst == other.isFirst && isLast == other.isLast
+						&& generation == other.generation;
+				}
+			};
+
 			float				_LabelHeight() const;
+			void				_Render(BView* owner, BRect frame,
+									const BRect& updateRect);
+			bool				_ValidateCache(BRect frame);
+			void				_DiscardCache();
 
 private:
+	friend class TabContainerView;
+
 			TabContainerView*	fContainerView;
 			TabLayoutItem*		fLayoutItem;
+			int32				fIndex;
+				// maintained by the TabContainerView
 
 			BString				fLabel;
+
+			BBitmap*			fCache;
+			RenderState			fCacheState;
+			bool				fCacheValid;
 };
 
 
@@ -0,0 +1,382 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "RangeServer.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Autolock.h>
+
+
+static const size_t kChunkSize = 16 * 1024;
+static const size_t kMaxRequestSize = 8 * 1024;
+static const char* kLastModified = "Mon, 05 Oct 2026 10:00:00 GMT";
+
+
+struct Connection {
+	RangeServer*	server;
+	int				socket;
+};
+
+
+static uint8
+byte_at(off_t offset, uint8 version)
+{
+	return (uint8)((offset * 31 + offset / 4096 + version * 97) & 0xff);
+}
+
+
+/*!	Returns the value of the header \a name in \a request, or an empty
+	string.
+*/
+static BString
+header_value(const BString& request, const char* name)
+{
+	BString prefix("\r\n");
+	prefix << name << ":";
+	int32 start = request.IFindFirst(prefix);
+	if (start < 0)
+		return BString();
+
+	start += prefix.Length();
+	int32 end = request.FindFirst("\r\n", start);
+	BString value;
+	request.CopyInto(value, start, end - start);
+	value.Trim();
+	return value;
+}
+
+
+RangeServer::RangeServer(off_t size)
+	:
+	fLock("range server"),
+	fSize(size),
+	fSocket(-1),
+	fPort(0),
+	fListener(-1),
+	fRangesSupported(true),
+	fRate(0),
+	fVersion(1),
+	fRangeRequests(0),
+	fFullRequests(0),
+	fConnectionCount(0),
+	fStopping(false)
+{
+}
+
+
+RangeServer::~RangeServer()
+{
+	Stop();
+}
+
+
+/*!	Starts listening on a free port of the loopback interface.
+*/
+status_t
+RangeServer::Start()
+{
+	fSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (fSocket < 0)
+		return errno;
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t length = sizeof(address);
+	if (bind(fSocket, (sockaddr*)&address, sizeof(address)) != 0
+		|| listen(fSocket, 16) != 0
+		|| getsockname(fSocket, (sockaddr*)&address, &length) != 0) {
+		status_t status = errno;
+		close(fSocket);
+		fSocket = -1;
+		return status;
+	}
+	fPort = ntohs(address.sin_port);
+
+	fListener = spawn_thread(_ListenerEntry, "range server", B_NORMAL_PRIORITY,
+		this);
+	if (fListener < 0) {
+		close(fSocket);
+		fSocket = -1;
+		return fListener;
+	}
+	resume_thread(fListener);
+	return B_OK;
+}
+
+
+/*!	Stops listening, and waits until all connections are closed.
+*/
+void
+RangeServer::Stop()
+{
+	if (fSocket < 0)
+		return;
+
+	fLock.Lock();
+	fStopping = true;
+	fLock.Unlock();
+
+	shutdown(fSocket, SHUT_RDWR);
+	close(fSocket);
+	fSocket = -1;
+
+	status_t exitValue;
+	wait_for_thread(fListener, &exitValue);
+	fListener = -1;
+
+	while (atomic_get(&fConnectionCount) > 0)
+		snooze(10000);
+}
+
+
+BString
+RangeServer::URL() const
+{
+	BString url("http://127.0.0.1:");
+	url << (int32)fPort << "/file.bin";
+	return url;
+}
+
+
+void
+RangeServer::SetRangesSupported(bool supported)
+{
+	BAutolock _(fLock);
+	fRangesSupported = supported;
+}
+
+
+void
+RangeServer::SetRate(off_t bytesPerSecond)
+{
+	BAutolock _(fLock);
+	fRate = bytesPerSecond;
+}
+
+
+/*!	Replaces the file with a different one of the same size, as if it was
+	updated on the server.
+*/
+void
+RangeServer::ChangeFile()
+{
+	BAutolock _(fLock);
+	fVersion++;
+}
+
+
+uint8
+RangeServer::ByteAt(off_t offset) const
+{
+	BAutolock _(fLock);
+	return byte_at(offset, fVersion);
+}
+
+
+BString
+RangeServer::ETag() const
+{
+	BAutolock _(fLock);
+	BString etag("\"version-");
+	etag << (int32)fVersion << "\"";
+	return etag;
+}
+
+
+int32
+RangeServer::CountRangeRequests() const
+{
+	BAutolock _(fLock);
+	return fRangeRequests;
+}
+
+
+int32
+RangeServer::CountFullRequests() const
+{
+	BAutolock _(fLock);
+	return fFullRequests;
+}
+
+
+// #pragma mark - private
+
+
+/*static*/ int32
+RangeServer::_ListenerEntry(void* data)
+{
+	static_cast<RangeServer*>(data)->_Listen();
+	return B_OK;
+}
+
+
+void
+RangeServer::_Listen()
+{
+	while (true) {
+		int socket = accept(fSocket, NULL, NULL);
+		if (socket < 0)
+			break;
+
+		Connection* connection = new Connection;
+		connection->server = this;
+		connection->socket = socket;
+
+		atomic_add(&fConnectionCount, 1);
+		thread_id thread = spawn_thread(_ConnectionEntry,
+			"range server connection", B_NORMAL_PRIORITY, connection);
+		if (thread < 0) {
+			close(socket);
+			delete connection;
+			atomic_add(&fConnectionCount, -1);
+			continue;
+		}
+		resume_thread(thread);
+	}
+}
+
+
+/*static*/ int32
+RangeServer::_ConnectionEntry(void* data)
+{
+	Connection* connection = static_cast<Connection*>(data);
+	RangeServer* server = connection->server;
+	server->_Serve(connection->socket);
+	close(connection->socket);
+	delete connection;
+	atomic_add(&server->fConnectionCount, -1);
+	return B_OK;
+}
+
+
+/*!	Answers a single request on \a socket. Every response closes the
+	connection.
+*/
+void
+RangeServer::_Serve(int socket)
+{
+	BString request;
+	char buffer[1024];
+	while (request.FindFirst("\r\n\r\n") < 0) {
+		ssize_t bytesRead = recv(socket, buffer, sizeof(buffer), 0);
+		if (bytesRead <= 0 || request.Length() > (int32)kMaxRequestSize)
+			return;
+		request.Append(buffer, bytesRead);
+	}
+
+	if (!request.StartsWith("GET /file.bin ")) {
+		const char* notFound = "HTTP/1.1 404 Not Found\r\n"
+			"Content-Length: 0\r\nConnection: close\r\n\r\n";
+		_SendAll(socket, notFound, strlen(notFound));
+		return;
+	}
+
+	fLock.Lock();
+	BString etag = ETag();
+	uint8 version = fVersion;
+	bool rangesSupported = fRangesSupported;
+	off_t rate = fRate;
+	fLock.Unlock();
+
+	// Only "bytes=start-" and "bytes=start-end" are understood, which is
+	// all a SegmentedDownload asks for.
+	off_t start = 0;
+	off_t end = fSize - 1;
+	bool partial = false;
+	BString range = header_value(request, "Range");
+	BString ifRange = header_value(request, "If-Range");
+	if (rangesSupported && range.StartsWith("bytes=")
+		&& (ifRange.IsEmpty() || ifRange == etag
+			|| ifRange == kLastModified)) {
+		char* next;
+		start = strtoll(range.String() + strlen("bytes="), &next, 10);
+		if (*next == '-' && next[1] != '\0')
+			end = std::min(strtoll(next + 1, NULL, 10), (long long)fSize - 1);
+		partial = true;
+	}
+
+	BString header;
+	if (partial && (start >= fSize || start > end)) {
+		header << "HTTP/1.1 416 Range Not Satisfiable\r\n"
+			"Content-Range: bytes */" << fSize << "\r\n"
+			"Content-Length: 0\r\nConnection: close\r\n\r\n";
+		_SendAll(socket, header.String(), header.Length());
+		return;
+	}
+
+	fLock.Lock();
+	if (partial)
+		fRangeRequests++;
+	else
+		fFullRequests++;
+	fLock.Unlock();
+
+	header << (partial ? "HTTP/1.1 206 Partial Content\r\n"
+		: "HTTP/1.1 200 OK\r\n");
+	if (partial) {
+		header << "Content-Range: bytes " << start << "-" << end << "/"
+			<< fSize << "\r\n";
+	}
+	if (rangesSupported)
+		header << "Accept-Ranges: bytes\r\n";
+	header << "Content-Length: " << (end + 1 - start) << "\r\n"
+		"Content-Type: application/octet-stream\r\n"
+		"ETag: " << etag << "\r\n"
+		"Last-Modified: " << kLastModified << "\r\n"
+		"Connection: close\r\n\r\n";
+	if (!_SendAll(socket, header.String(), header.Length()))
+		return;
+
+	uint8 chunk[kChunkSize];
+	bigtime_t startTime = system_time();
+	off_t sent = 0;
+	for (off_t offset = start; offset <= end; offset += kChunkSize) {
+		size_t size = std::min((off_t)kChunkSize, end + 1 - offset);
+		for (size_t i = 0; i < size; i++)
+			chunk[i] = byte_at(offset + i, version);
+		if (!_SendAll(socket, chunk, size))
+			return;
+		sent += size;
+
+		if (rate > 0) {
+			bigtime_t due = startTime + sent * 1000000 / rate;
+			bigtime_t now = system_time();
+			if (due > now)
+				snooze(due - now);
+		}
+
+		BAutolock _(fLock);
+		if (fStopping)
+			return;
+	}
+}
+
+
+bool
+RangeServer::_SendAll(int socket, const void* buffer, size_t size)
+{
+	const uint8* data = static_cast<const uint8*>(buffer);
+	while (size > 0) {
+		ssize_t bytesSent = send(socket, data, size, 0);
+		if (bytesSent <= 0)
+			return false;
+		data += bytesSent;
+		size -= bytesSent;
+	}
+	return true;
+}
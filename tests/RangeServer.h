@@ -0,0 +1,72 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef RANGE_SERVER_H
+#define RANGE_SERVER_H
+
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+
+/*!	A minimal HTTP server on the loopback interface, standing in for a
+	download server. It serves a single generated file at "/file.bin", and
+	answers range requests with 206, unless ranges are turned off, or the
+	If-Range validator does not match the file anymore, in which case the
+	whole file is sent with 200.
+
+	Every connection is sent at most the configured rate, so a download can
+	be watched while it runs, and be paused half way.
+*/
+class RangeServer {
+public:
+								RangeServer(off_t size);
+								~RangeServer();
+
+			status_t			Start();
+			void				Stop();
+
+			BString				URL() const;
+			off_t				Size() const { return fSize; }
+
+			void				SetRangesSupported(bool supported);
+			void				SetRate(off_t bytesPerSecond);
+			void				ChangeFile();
+
+			uint8				ByteAt(off_t offset) const;
+			BString				ETag() const;
+
+			int32				CountRangeRequests() const;
+			int32				CountFullRequests() const;
+
+private:
+	static	int32				_ListenerEntry(void* data);
+			void				_Listen();
+	static	int32				_ConnectionEntry(void* data);
+			void				_Serve(int socket);
+			bool				_SendAll(int socket, const void* buffer,
+									size_t size);
+
+private:
+	mutable	BLocker				fLock;
+			off_t				fSize;
+			int					fSocket;
+			uint16				fPort;
+			thread_id			fListener;
+
+			bool				fRangesSupported;
+			off_t				fRate;
+				// per connection, in bytes per second, 0 for no limit
+			uint8				fVersion;
+				// of the file, changes its contents and its ETag
+
+			int32				fRangeRequests;
+			int32				fFullRequests;
+			int32				fConnectionCount;
+			bool				fStopping;
+};
+
+
+#endif // RANGE_SERVER_H
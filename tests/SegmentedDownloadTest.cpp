@@ -0,0 +1,458 @@
+/*
+ * Copyright 2026 Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Runs SegmentedDownloads against a RangeServer on the loopback interface,
+	and checks what ends up on disk.
+*/
+
+
+#include <algorithm>
+#include <stdio.h>
+
+#include <Application.h>
+#include <Autolock.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <Looper.h>
+#include <Path.h>
+#include <UrlContext.h>
+
+#include "RangeServer.h"
+#include "SegmentedDownload.h"
+#include "WebDownload.h"
+
+
+using BPrivate::Network::BUrlContext;
+
+
+static const bigtime_t kTimeout = 30000000;
+static const off_t kMiB = 1024 * 1024;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			return false; \
+		} \
+	} while (false)
+
+
+/*!	Receives the messages of a download, the way the download window
+	does.
+*/
+class DownloadListener : public BLooper {
+public:
+	DownloadListener()
+		:
+		BLooper("download listener"),
+		fEnd(0),
+		fProgressCount(0),
+		fDone(create_sem(0, "download done"))
+	{
+	}
+
+	virtual ~DownloadListener()
+	{
+		delete_sem(fDone);
+	}
+
+	virtual void MessageReceived(BMessage* message)
+	{
+		switch (message->what) {
+			case B_DOWNLOAD_STARTED:
+				fPath.SetTo(message->GetString("path", NULL));
+				break;
+			case B_DOWNLOAD_PROGRESS:
+				fProgressCount++;
+				break;
+			case B_DOWNLOAD_REMOVED:
+			case SEGMENTED_DOWNLOAD_DECLINED:
+				fEnd = message->what;
+				release_sem(fDone);
+				break;
+			default:
+				BLooper::MessageReceived(message);
+				break;
+		}
+	}
+
+	/*!	Waits until the download ended, and returns the message it ended
+		with, or 0 if it did not end in time.
+	*/
+	uint32 WaitForEnd()
+	{
+		if (acquire_sem_etc(fDone, 1, B_RELATIVE_TIMEOUT, kTimeout) != B_OK)
+			return 0;
+		BAutolock _(this);
+		return fEnd;
+	}
+
+	BPath Path()
+	{
+		BAutolock _(this);
+		return fPath;
+	}
+
+	int32 CountProgress()
+	{
+		BAutolock _(this);
+		return fProgressCount;
+	}
+
+private:
+	BPath		fPath;
+	uint32		fEnd;
+	int32		fProgressCount;
+	sem_id		fDone;
+};
+
+
+/*!	Creates an empty directory for the files of a single test.
+*/
+static BPath
+make_directory(const char* name)
+{
+	BPath path("/tmp");
+	BString leaf("SegmentedDownloadTest-");
+	leaf << name << "-" << system_time();
+	path.Append(leaf.String());
+	create_directory(path.Path(), 0755);
+	return path;
+}
+
+
+static void
+remove_directory(const BPath& path)
+{
+	BDirectory directory(path.Path());
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK)
+		entry.Remove();
+	BEntry(path.Path()).Remove();
+}
+
+
+static int32
+count_entries(const BPath& path)
+{
+	BDirectory directory(path.Path());
+	return directory.CountEntries();
+}
+
+
+/*!	Returns whether the file at \a path is what \a server serves.
+*/
+static bool
+is_complete(const BPath& path, const RangeServer& server)
+{
+	BFile file(path.Path(), B_READ_ONLY);
+	off_t size;
+	if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK
+		|| size != server.Size()) {
+		return false;
+	}
+
+	uint8 buffer[64 * 1024];
+	for (off_t offset = 0; offset < size; offset += sizeof(buffer)) {
+		ssize_t bytesRead = file.ReadAt(offset, buffer, sizeof(buffer));
+		if (bytesRead <= 0)
+			return false;
+		for (ssize_t i = 0; i < bytesRead; i++) {
+			if (buffer[i] != server.ByteAt(offset + i))
+				return false;
+		}
+	}
+	return true;
+}
+
+
+static uint32
+checksum(const BPath& path, off_t length)
+{
+	BFile file(path.Path(), B_READ_ONLY);
+	uint8 buffer[64 * 1024];
+	uint32 sum = 0;
+	for (off_t offset = 0; offset < length; offset += sizeof(buffer)) {
+		size_t size = std::min((off_t)sizeof(buffer), length - offset);
+		ssize_t bytesRead = file.ReadAt(offset, buffer, size);
+		if (bytesRead <= 0)
+			break;
+		for (ssize_t i = 0; i < bytesRead; i++)
+			sum = sum * 31 + buffer[i];
+	}
+	return sum;
+}
+
+
+/*!	A large file is fetched over all connections at once, each segment
+	with a range request of its own.
+*/
+static bool
+test_segmented(BUrlContext* context)
+{
+	RangeServer server(4 * kMiB);
+	CHECK(server.Start() == B_OK);
+	server.SetRate(kMiB);
+
+	BPath directory = make_directory("segmented");
+	DownloadListener* listener = new DownloadListener;
+	listener->Run();
+
+	BReference<SegmentedDownload> download(
+		new SegmentedDownload(server.URL(), context), true);
+	download->SetProgressListener(BMessenger(listener));
+
+	bigtime_t start = system_time();
+	CHECK(download->Start(directory, 4) == B_OK);
+	CHECK(listener->WaitForEnd() == B_DOWNLOAD_REMOVED);
+	bigtime_t elapsed = system_time() - start;
+
+	CHECK(is_complete(listener->Path(), server));
+	CHECK(server.CountRangeRequests() == 5);
+		// the probe, and one request per segment
+	CHECK(server.CountFullRequests() == 0);
+	CHECK(listener->CountProgress() > 0);
+	CHECK(download->CurrentSize() == server.Size());
+	CHECK(download->ResumeOffset() == server.Size());
+
+	// One connection would have taken 4 seconds at that rate.
+	CHECK(elapsed > 700000);
+	CHECK(elapsed < 3000000);
+
+	listener->Lock();
+	listener->Quit();
+	server.Stop();
+	remove_directory(directory);
+	return true;
+}
+
+
+/*!	A file too small to be split is fetched over a single connection.
+*/
+static bool
+test_single_segment(BUrlContext* context)
+{
+	RangeServer server(512 * 1024);
+	CHECK(server.Start() == B_OK);
+
+	BPath directory = make_directory("single");
+	DownloadListener* listener = new DownloadListener;
+	listener->Run();
+
+	BReference<SegmentedDownload> download(
+		new SegmentedDownload(server.URL(), context), true);
+	download->SetProgressListener(BMessenger(listener));
+
+	CHECK(download->Start(directory, 4) == B_OK);
+	CHECK(listener->WaitForEnd() == B_DOWNLOAD_REMOVED);
+
+	CHECK(is_complete(listener->Path(), server));
+	CHECK(server.CountRangeRequests() == 2);
+
+	listener->Lock();
+	listener->Quit();
+	server.Stop();
+	remove_directory(directory);
+	return true;
+}
+
+
+/*!	Without range support, the download is declined before anything is
+	written, so WebKit can take over.
+*/
+static bool
+test_declined_without_ranges(BUrlContext* context)
+{
+	RangeServer server(4 * kMiB);
+	server.SetRangesSupported(false);
+	CHECK(server.Start() == B_OK);
+
+	BPath directory = make_directory("declined");
+	DownloadListener* listener = new DownloadListener;
+	listener->Run();
+
+	BReference<SegmentedDownload> download(
+		new SegmentedDownload(server.URL(), context), true);
+	download->SetProgressListener(BMessenger(listener));
+
+	CHECK(download->Start(directory, 4) == B_OK);
+	CHECK(listener->WaitForEnd() == SEGMENTED_DOWNLOAD_DECLINED);
+	CHECK(count_entries(directory) == 0);
+
+	listener->Lock();
+	listener->Quit();
+	server.Stop();
+	remove_directory(directory);
+	return true;
+}
+
+
+/*!	Starts a throttled download over a single connection, and cancels it
+	once at least \a size bytes arrived, the way the download window pauses
+	a download. Returns NULL if that did not happen in time.
+*/
+static SegmentedDownload*
+start_and_pause(const RangeServer& server, BUrlContext* context,
+	const BPath& directory, off_t size)
+{
+	SegmentedDownload* download = new SegmentedDownload(server.URL(),
+		context);
+	if (download->Start(directory, 1) != B_OK) {
+		download->ReleaseReference();
+		return NULL;
+	}
+
+	bigtime_t deadline = system_time() + kTimeout;
+	while (download->CurrentSize() < size) {
+		if (system_time() > deadline) {
+			download->Cancel();
+			download->ReleaseReference();
+			return NULL;
+		}
+		snooze(10000);
+	}
+	download->Cancel();
+	return download;
+}
+
+
+/*!	Resuming a paused download asks for the rest of the file with an
+	If-Range validator. The server still has the same file, and answers
+	with 206, so the file is completed in place. The resumed download is
+	started right away, while the writes of the paused one may still be
+	under way.
+*/
+static bool
+test_resume(BUrlContext* context)
+{
+	RangeServer server(4 * kMiB);
+	CHECK(server.Start() == B_OK);
+	server.SetRate(2 * kMiB);
+
+	BPath directory = make_directory("resume");
+	BReference<SegmentedDownload> paused(
+		start_and_pause(server, context, directory, kMiB), true);
+	CHECK(paused.Get() != NULL);
+	CHECK(paused->ETag() == server.ETag());
+	off_t offset = paused->ResumeOffset();
+	CHECK(offset >= kMiB && offset < server.Size());
+	int32 rangeRequests = server.CountRangeRequests();
+
+	server.SetRate(0);
+	DownloadListener* listener = new DownloadListener;
+	listener->Run();
+
+	BReference<SegmentedDownload> download(
+		new SegmentedDownload(server.URL(), context), true);
+	download->SetProgressListener(BMessenger(listener));
+	CHECK(download->Resume(paused->Path(), offset, server.Size(),
+		paused->ETag(), paused->LastModified(), 4) == B_OK);
+	CHECK(listener->WaitForEnd() == B_DOWNLOAD_REMOVED);
+
+	CHECK(listener->Path() == paused->Path());
+	CHECK(is_complete(listener->Path(), server));
+	CHECK(server.CountRangeRequests() > rangeRequests);
+	CHECK(server.CountFullRequests() == 0);
+	CHECK(count_entries(directory) == 1);
+
+	listener->Lock();
+	listener->Quit();
+	server.Stop();
+	remove_directory(directory);
+	return true;
+}
+
+
+/*!	When the file changed on the server since the download was paused, the
+	If-Range validator no longer matches, and the server answers with 200.
+	The resume is declined without touching the partial file, and the
+	download is started over, into a new file.
+*/
+static bool
+test_resume_changed(BUrlContext* context)
+{
+	RangeServer server(4 * kMiB);
+	CHECK(server.Start() == B_OK);
+	server.SetRate(2 * kMiB);
+
+	BPath directory = make_directory("changed");
+	BReference<SegmentedDownload> paused(
+		start_and_pause(server, context, directory, kMiB), true);
+	CHECK(paused.Get() != NULL);
+	off_t offset = paused->ResumeOffset();
+	BString etag = paused->ETag();
+	uint32 partialChecksum = checksum(paused->Path(), offset);
+
+	server.SetRate(0);
+	server.ChangeFile();
+	CHECK(server.ETag() != etag);
+
+	DownloadListener* listener = new DownloadListener;
+	listener->Run();
+
+	BReference<SegmentedDownload> download(
+		new SegmentedDownload(server.URL(), context), true);
+	download->SetProgressListener(BMessenger(listener));
+	CHECK(download->Resume(paused->Path(), offset, server.Size(), etag,
+		paused->LastModified(), 4) == B_OK);
+	CHECK(listener->WaitForEnd() == SEGMENTED_DOWNLOAD_DECLINED);
+	CHECK(server.CountFullRequests() == 1);
+	CHECK(checksum(paused->Path(), offset) == partialChecksum);
+
+	// Start over, the way the download window does once the resume was
+	// declined.
+	listener->Lock();
+	listener->Quit();
+	listener = new DownloadListener;
+	listener->Run();
+
+	BReference<SegmentedDownload> restarted(
+		new SegmentedDownload(server.URL(), context), true);
+	restarted->SetProgressListener(BMessenger(listener));
+	CHECK(restarted->Start(directory, 4) == B_OK);
+	CHECK(listener->WaitForEnd() == B_DOWNLOAD_REMOVED);
+
+	CHECK(listener->Path() != paused->Path());
+	CHECK(is_complete(listener->Path(), server));
+	CHECK(count_entries(directory) == 2);
+
+	listener->Lock();
+	listener->Quit();
+	server.Stop();
+	remove_directory(directory);
+	return true;
+}
+
+
+int
+main()
+{
+	BApplication app(
+		"application/x-vnd.Haiku-WebPositive-SegmentedDownloadTest");
+	BReference<BUrlContext> context(new BUrlContext(), true);
+
+	struct {
+		const char*	name;
+		bool		(*function)(BUrlContext* context);
+	} tests[] = {
+		{ "segmented", &test_segmented },
+		{ "single segment", &test_single_segment },
+		{ "declined without ranges", &test_declined_without_ranges },
+		{ "resume", &test_resume },
+		{ "resume of a changed file", &test_resume_changed },
+	};
+
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		bool passed = tests[i].function(context.Get());
+		printf("%s: %s\n", tests[i].name, passed ? "passed" : "FAILED");
+		if (!passed)
+			failed++;
+	}
+	return failed > 0 ? 1 : 0;
+}